@@ -0,0 +1,51 @@
+#include "macro_benchmark.hpp"
+
+// Computer Language Benchmarks Game binary-trees: allocation of short-lived trees next to
+// one long-lived tree, so scavenges promote little and major collections have real work
+MacroBenchmark binaryTreesBenchmark() {
+    MacroBenchmark benchmark;
+    benchmark.name = "binary-trees";
+    benchmark.description = "allocate and walk complete binary trees";
+    benchmark.classes = {
+        {"TreeNode", "Object", {"left", "right"}},
+        {"BinaryTreesBenchmark", "Object", {}},
+    };
+    benchmark.methods = {
+        {"TreeNode", "left: aNode right: anotherNode left := aNode. right := anotherNode"},
+        {"TreeNode", "check ^left isNil ifTrue: [1] ifFalse: [1 + left check + right check]"},
+        {"BinaryTreesBenchmark", R"(bottomUp: depth
+    depth > 0 ifFalse: [^TreeNode new].
+    ^TreeNode new left: (self bottomUp: depth - 1) right: (self bottomUp: depth - 1))"},
+        {"BinaryTreesBenchmark", R"(run: n
+    | minDepth maxDepth total longLived iterations check |
+    minDepth := 4.
+    maxDepth := n max: minDepth + 2.
+    total := (self bottomUp: maxDepth + 1) check.
+    longLived := self bottomUp: maxDepth.
+    minDepth to: maxDepth by: 2 do: [:depth |
+        iterations := 1 bitShift: maxDepth - depth + minDepth.
+        check := 0.
+        1 to: iterations do: [:i | check := check + (self bottomUp: depth) check].
+        total := total + check].
+    ^total + longLived check)"},
+    };
+    benchmark.entryClass = "BinaryTreesBenchmark";
+    benchmark.size = 12;
+    benchmark.quickSize = 6;
+
+    // Closed form of run: a complete tree of depth d has 2^(d+1) - 1 nodes.
+    auto checksum = [](int64_t n) {
+        int64_t minDepth = 4;
+        int64_t maxDepth = n > minDepth + 2 ? n : minDepth + 2;
+        int64_t total = (int64_t(1) << (maxDepth + 2)) - 1;
+        for (int64_t depth = minDepth; depth <= maxDepth; depth += 2) {
+            int64_t iterations = int64_t(1) << (maxDepth - depth + minDepth);
+            total += iterations * ((int64_t(1) << (depth + 1)) - 1);
+        }
+        return total + (int64_t(1) << (maxDepth + 1)) - 1;
+    };
+    for (int64_t n : {benchmark.quickSize, int64_t(10), benchmark.size}) {
+        benchmark.expected[n] = checksum(n);
+    }
+    return benchmark;
+}
@@ -0,0 +1,353 @@
+#include "macro_benchmark.hpp"
+
+// DeltaBlue: Maloney and Freeman-Benson's incremental one-way constraint solver, ported
+// from the Smalltalk and Octane versions. Runs the standard chain and projection tests.
+//
+// Compact port: strengths are SmallIntegers (0 required ... 6 weakest, lower is
+// stronger), directions are 1 forward, -1 backward, 0 none, DBOrderedCollection stands in
+// for OrderedCollection, and since there is no super, DBScaleConstraint repeats the
+// DBBinaryConstraint code it extends.
+MacroBenchmark deltaBlueBenchmark() {
+    MacroBenchmark benchmark;
+    benchmark.name = "deltablue";
+    benchmark.description = "incremental constraint solver";
+    benchmark.classes = {
+        {"DBOrderedCollection", "Object", {"items", "first", "last"}},
+        {"DBVariable", "Object", {"value", "constraints", "determinedBy", "mark", "walkStrength", "stay"}},
+        {"DBConstraint", "Object", {"strength", "planner"}},
+        {"DBUnaryConstraint", "DBConstraint", {"myOutput", "satisfied"}},
+        {"DBStayConstraint", "DBUnaryConstraint", {}},
+        {"DBEditConstraint", "DBUnaryConstraint", {}},
+        {"DBBinaryConstraint", "DBConstraint", {"v1", "v2", "direction"}},
+        {"DBEqualityConstraint", "DBBinaryConstraint", {}},
+        {"DBScaleConstraint", "DBBinaryConstraint", {"scale", "offset"}},
+        {"DBPlanner", "Object", {"currentMark"}},
+        {"DeltaBlueBenchmark", "Object", {"planner"}},
+    };
+    benchmark.methods = {
+        // Ordered collection over a growable Array
+        {"DBOrderedCollection", "initialize items := Array new: 8. first := 1. last := 0"},
+        {"DBOrderedCollection", "size ^last - first + 1"},
+        {"DBOrderedCollection", "at: index ^items at: first + index - 1"},
+        {"DBOrderedCollection", R"(add: anObject
+    last = items size ifTrue: [self makeRoom].
+    last := last + 1.
+    items at: last put: anObject.
+    ^anObject)"},
+        {"DBOrderedCollection", R"(makeRoom
+    | count grown |
+    count := self size.
+    grown := Array new: items size * 2.
+    1 to: count do: [:i | grown at: i put: (items at: first + i - 1)].
+    items := grown.
+    first := 1.
+    last := count)"},
+        {"DBOrderedCollection", R"(removeFirst
+    | item |
+    item := items at: first.
+    items at: first put: nil.
+    first := first + 1.
+    ^item)"},
+        {"DBOrderedCollection", R"(remove: anObject
+    | kept |
+    kept := first.
+    first to: last do: [:i |
+        (items at: i) == anObject ifFalse: [
+            items at: kept put: (items at: i).
+            kept := kept + 1]].
+    kept to: last do: [:i | items at: i put: nil].
+    last := kept - 1)"},
+
+        // Variable
+        {"DBVariable", R"(initializeValue: anInteger
+    value := anInteger.
+    constraints := DBOrderedCollection new initialize.
+    mark := 0.
+    walkStrength := 6.
+    stay := true)"},
+        {"DBVariable", "value ^value"},
+        {"DBVariable", "value: anInteger value := anInteger"},
+        {"DBVariable", "constraints ^constraints"},
+        {"DBVariable", "determinedBy ^determinedBy"},
+        {"DBVariable", "determinedBy: aConstraint determinedBy := aConstraint"},
+        {"DBVariable", "mark ^mark"},
+        {"DBVariable", "mark: anInteger mark := anInteger"},
+        {"DBVariable", "walkStrength ^walkStrength"},
+        {"DBVariable", "walkStrength: aStrength walkStrength := aStrength"},
+        {"DBVariable", "stay ^stay"},
+        {"DBVariable", "stay: aBoolean stay := aBoolean"},
+        {"DBVariable", "addConstraint: aConstraint constraints add: aConstraint"},
+        {"DBVariable", R"(removeConstraint: aConstraint
+    constraints remove: aConstraint.
+    determinedBy == aConstraint ifTrue: [determinedBy := nil])"},
+
+        // Constraint
+        {"DBConstraint", "strength ^strength"},
+        {"DBConstraint", "isInput ^false"},
+        {"DBConstraint", "addConstraint self addToGraph. planner incrementalAdd: self"},
+        {"DBConstraint", R"(satisfy: mark
+    | out overridden |
+    self chooseMethod: mark.
+    self isSatisfied ifFalse: [
+        strength = 0 ifTrue: [self error: 'Could not satisfy a required constraint'].
+        ^nil].
+    self markInputs: mark.
+    out := self output.
+    overridden := out determinedBy.
+    overridden notNil ifTrue: [overridden markUnsatisfied].
+    out determinedBy: self.
+    (planner addPropagate: self mark: mark) ifFalse: [self error: 'Cycle encountered'].
+    out mark: mark.
+    ^overridden)"},
+        {"DBConstraint", R"(destroyConstraint
+    self isSatisfied
+        ifTrue: [planner incrementalRemove: self]
+        ifFalse: [self removeFromGraph])"},
+
+        // Unary constraints
+        {"DBUnaryConstraint", R"(initializeVariable: aVariable strength: aStrength planner: aPlanner
+    strength := aStrength.
+    planner := aPlanner.
+    myOutput := aVariable.
+    satisfied := false.
+    self addConstraint)"},
+        {"DBUnaryConstraint", "addToGraph myOutput addConstraint: self. satisfied := false"},
+        {"DBUnaryConstraint", "chooseMethod: mark satisfied := myOutput mark ~= mark and: [strength < myOutput walkStrength]"},
+        {"DBUnaryConstraint", "isSatisfied ^satisfied"},
+        {"DBUnaryConstraint", "markInputs: mark"},
+        {"DBUnaryConstraint", "output ^myOutput"},
+        {"DBUnaryConstraint", R"(recalculate
+    myOutput walkStrength: strength.
+    myOutput stay: self isInput not.
+    myOutput stay ifTrue: [self execute])"},
+        {"DBUnaryConstraint", "markUnsatisfied satisfied := false"},
+        {"DBUnaryConstraint", "inputsKnown: mark ^true"},
+        {"DBUnaryConstraint", R"(removeFromGraph
+    myOutput notNil ifTrue: [myOutput removeConstraint: self].
+    satisfied := false)"},
+        {"DBStayConstraint", "execute"},
+        {"DBEditConstraint", "isInput ^true"},
+        {"DBEditConstraint", "execute"},
+
+        // Binary constraints
+        {"DBBinaryConstraint", R"(initializeVariable: aVariable variable: anotherVariable strength: aStrength planner: aPlanner
+    strength := aStrength.
+    planner := aPlanner.
+    v1 := aVariable.
+    v2 := anotherVariable.
+    direction := 0.
+    self addConstraint)"},
+        {"DBBinaryConstraint", R"(chooseMethod: mark
+    v1 mark = mark ifTrue: [
+        ^direction := (v2 mark ~= mark and: [strength < v2 walkStrength]) ifTrue: [1] ifFalse: [0]].
+    v2 mark = mark ifTrue: [
+        ^direction := (v1 mark ~= mark and: [strength < v1 walkStrength]) ifTrue: [-1] ifFalse: [0]].
+    v1 walkStrength > v2 walkStrength
+        ifTrue: [direction := strength < v1 walkStrength ifTrue: [-1] ifFalse: [0]]
+        ifFalse: [direction := strength < v2 walkStrength ifTrue: [1] ifFalse: [0]])"},
+        {"DBBinaryConstraint", "addToGraph v1 addConstraint: self. v2 addConstraint: self. direction := 0"},
+        {"DBBinaryConstraint", "isSatisfied ^direction ~= 0"},
+        {"DBBinaryConstraint", "markInputs: mark self input mark: mark"},
+        {"DBBinaryConstraint", "input ^direction = 1 ifTrue: [v1] ifFalse: [v2]"},
+        {"DBBinaryConstraint", "output ^direction = 1 ifTrue: [v2] ifFalse: [v1]"},
+        {"DBBinaryConstraint", R"(recalculate
+    | in out |
+    in := self input.
+    out := self output.
+    out walkStrength: (strength max: in walkStrength).
+    out stay: in stay.
+    out stay ifTrue: [self execute])"},
+        {"DBBinaryConstraint", "markUnsatisfied direction := 0"},
+        {"DBBinaryConstraint", R"(inputsKnown: mark
+    | in |
+    in := self input.
+    ^(in mark = mark or: [in stay]) or: [in determinedBy isNil])"},
+        {"DBBinaryConstraint", R"(removeFromGraph
+    v1 notNil ifTrue: [v1 removeConstraint: self].
+    v2 notNil ifTrue: [v2 removeConstraint: self].
+    direction := 0)"},
+        {"DBEqualityConstraint", "execute self output value: self input value"},
+        {"DBScaleConstraint", R"(initializeSource: aVariable scale: scaleVariable offset: offsetVariable destination: anotherVariable strength: aStrength planner: aPlanner
+    strength := aStrength.
+    planner := aPlanner.
+    v1 := aVariable.
+    v2 := anotherVariable.
+    direction := 0.
+    scale := scaleVariable.
+    offset := offsetVariable.
+    self addConstraint)"},
+        {"DBScaleConstraint", R"(addToGraph
+    v1 addConstraint: self.
+    v2 addConstraint: self.
+    direction := 0.
+    scale addConstraint: self.
+    offset addConstraint: self)"},
+        {"DBScaleConstraint", R"(removeFromGraph
+    v1 notNil ifTrue: [v1 removeConstraint: self].
+    v2 notNil ifTrue: [v2 removeConstraint: self].
+    direction := 0.
+    scale notNil ifTrue: [scale removeConstraint: self].
+    offset notNil ifTrue: [offset removeConstraint: self])"},
+        {"DBScaleConstraint", "markInputs: mark self input mark: mark. scale mark: mark. offset mark: mark"},
+        {"DBScaleConstraint", R"(execute
+    direction = 1
+        ifTrue: [v2 value: v1 value * scale value + offset value]
+        ifFalse: [v1 value: v2 value - offset value / scale value])"},
+        {"DBScaleConstraint", R"(recalculate
+    | in out |
+    in := self input.
+    out := self output.
+    out walkStrength: (strength max: in walkStrength).
+    out stay: ((in stay and: [scale stay]) and: [offset stay]).
+    out stay ifTrue: [self execute])"},
+
+        // Planner
+        {"DBPlanner", "initialize currentMark := 0"},
+        {"DBPlanner", "newMark currentMark := currentMark + 1. ^currentMark"},
+        {"DBPlanner", R"(incrementalAdd: aConstraint
+    | mark overridden |
+    mark := self newMark.
+    overridden := aConstraint satisfy: mark.
+    [overridden notNil] whileTrue: [overridden := overridden satisfy: mark])"},
+        {"DBPlanner", R"(incrementalRemove: aConstraint
+    | out unsatisfied strength candidate |
+    out := aConstraint output.
+    aConstraint markUnsatisfied.
+    aConstraint removeFromGraph.
+    unsatisfied := self removePropagateFrom: out.
+    strength := 0.
+    [1 to: unsatisfied size do: [:i |
+        candidate := unsatisfied at: i.
+        candidate strength = strength ifTrue: [self incrementalAdd: candidate]].
+     strength := strength + 1.
+     strength < 6] whileTrue)"},
+        {"DBPlanner", R"(makePlan: sources
+    | mark plan todo constraint |
+    mark := self newMark.
+    plan := DBOrderedCollection new initialize.
+    todo := sources.
+    [todo size > 0] whileTrue: [
+        constraint := todo removeFirst.
+        (constraint output mark ~= mark and: [constraint inputsKnown: mark]) ifTrue: [
+            plan add: constraint.
+            constraint output mark: mark.
+            self addConstraintsConsumingTo: constraint output into: todo]].
+    ^plan)"},
+        {"DBPlanner", R"(extractPlanFromConstraints: constraints
+    | sources constraint |
+    sources := DBOrderedCollection new initialize.
+    1 to: constraints size do: [:i |
+        constraint := constraints at: i.
+        (constraint isInput and: [constraint isSatisfied]) ifTrue: [sources add: constraint]].
+    ^self makePlan: sources)"},
+        {"DBPlanner", R"(addPropagate: aConstraint mark: mark
+    | todo constraint |
+    todo := DBOrderedCollection new initialize.
+    todo add: aConstraint.
+    [todo size > 0] whileTrue: [
+        constraint := todo removeFirst.
+        constraint output mark = mark ifTrue: [
+            self incrementalRemove: aConstraint.
+            ^false].
+        constraint recalculate.
+        self addConstraintsConsumingTo: constraint output into: todo].
+    ^true)"},
+        {"DBPlanner", R"(removePropagateFrom: out
+    | unsatisfied todo variable constraint determining |
+    out determinedBy: nil.
+    out walkStrength: 6.
+    out stay: true.
+    unsatisfied := DBOrderedCollection new initialize.
+    todo := DBOrderedCollection new initialize.
+    todo add: out.
+    [todo size > 0] whileTrue: [
+        variable := todo removeFirst.
+        1 to: variable constraints size do: [:i |
+            constraint := variable constraints at: i.
+            constraint isSatisfied ifFalse: [unsatisfied add: constraint]].
+        determining := variable determinedBy.
+        1 to: variable constraints size do: [:i |
+            constraint := variable constraints at: i.
+            (constraint ~~ determining and: [constraint isSatisfied]) ifTrue: [
+                constraint recalculate.
+                todo add: constraint output]]].
+    ^unsatisfied)"},
+        {"DBPlanner", R"(addConstraintsConsumingTo: aVariable into: aCollection
+    | determining constraints constraint |
+    determining := aVariable determinedBy.
+    constraints := aVariable constraints.
+    1 to: constraints size do: [:i |
+        constraint := constraints at: i.
+        (constraint ~~ determining and: [constraint isSatisfied]) ifTrue: [aCollection add: constraint]])"},
+        {"DBPlanner", "executePlan: aPlan 1 to: aPlan size do: [:i | (aPlan at: i) execute]"},
+
+        // Driver
+        {"DeltaBlueBenchmark", R"(chainTest: n
+    | previous first last variable edits plan |
+    planner := DBPlanner new initialize.
+    0 to: n do: [:i |
+        variable := DBVariable new initializeValue: 0.
+        previous notNil ifTrue: [
+            DBEqualityConstraint new initializeVariable: previous variable: variable strength: 0 planner: planner].
+        i = 0 ifTrue: [first := variable].
+        i = n ifTrue: [last := variable].
+        previous := variable].
+    DBStayConstraint new initializeVariable: last strength: 3 planner: planner.
+    edits := DBOrderedCollection new initialize.
+    edits add: (DBEditConstraint new initializeVariable: first strength: 2 planner: planner).
+    plan := planner extractPlanFromConstraints: edits.
+    0 to: 99 do: [:i |
+        first value: i.
+        planner executePlan: plan.
+        last value = i ifFalse: [self error: 'Chain test failed']].
+    ^last value)"},
+        {"DeltaBlueBenchmark", R"(change: aVariable to: newValue
+    | edit edits plan |
+    edit := DBEditConstraint new initializeVariable: aVariable strength: 2 planner: planner.
+    edits := DBOrderedCollection new initialize.
+    edits add: edit.
+    plan := planner extractPlanFromConstraints: edits.
+    10 timesRepeat: [
+        aVariable value: newValue.
+        planner executePlan: plan].
+    edit destroyConstraint)"},
+        {"DeltaBlueBenchmark", R"(projectionTest: n
+    | scale offset source destination destinations total |
+    planner := DBPlanner new initialize.
+    scale := DBVariable new initializeValue: 10.
+    offset := DBVariable new initializeValue: 1000.
+    destinations := DBOrderedCollection new initialize.
+    0 to: n - 1 do: [:i |
+        source := DBVariable new initializeValue: i.
+        destination := DBVariable new initializeValue: i.
+        destinations add: destination.
+        DBStayConstraint new initializeVariable: source strength: 4 planner: planner.
+        DBScaleConstraint new initializeSource: source scale: scale offset: offset
+            destination: destination strength: 0 planner: planner].
+    self change: source to: 17.
+    destination value = 1170 ifFalse: [self error: 'Projection 1 failed'].
+    self change: destination to: 1050.
+    source value = 5 ifFalse: [self error: 'Projection 2 failed'].
+    self change: scale to: 5.
+    1 to: n - 1 do: [:i |
+        (destinations at: i) value = (i - 1 * 5 + 1000) ifFalse: [self error: 'Projection 3 failed']].
+    self change: offset to: 2000.
+    1 to: n - 1 do: [:i |
+        (destinations at: i) value = (i - 1 * 5 + 2000) ifFalse: [self error: 'Projection 4 failed']].
+    total := 0.
+    1 to: destinations size do: [:i | total := total + (destinations at: i) value].
+    ^total)"},
+        {"DeltaBlueBenchmark", R"(run: n
+    | result |
+    n timesRepeat: [result := (self chainTest: 100) + (self projectionTest: 100)].
+    ^result)"},
+    };
+    benchmark.entryClass = "DeltaBlueBenchmark";
+    benchmark.size = 20;
+    benchmark.quickSize = 1;
+    // chainTest answers 99; projectionTest answers sum(5i + 2000, i < 99) + 5 * 5 + 2000
+    for (int64_t n : {benchmark.quickSize, benchmark.size}) {
+        benchmark.expected[n] = 99 + 224280;
+    }
+    return benchmark;
+}
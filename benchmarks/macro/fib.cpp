@@ -0,0 +1,61 @@
+#include "macro_benchmark.hpp"
+#include "assembler.hpp"
+#include "vm.hpp"
+
+namespace {
+
+TaggedValue integer(int64_t value) {
+    return TaggedValue::fromSmallInteger(value);
+}
+
+// fib: n
+//     n < 2 ifTrue: [^n].
+//     ^(self fib: n - 1) + (self fib: n - 2)
+void emitFib(VM& vm, Assembler& a) {
+    TaggedValue fib = vm.symbols().intern("fib:");
+    TaggedValue minus = vm.symbols().intern("-");
+    Assembler::Label recurse = a.newLabel();
+    a.pushTemporary(0);
+    a.pushLiteral(integer(2));
+    a.send(vm.symbols().intern("<"), 1);
+    a.jumpIfFalse(recurse);
+    a.pushTemporary(0);
+    a.returnTop();
+    a.bind(recurse);
+    for (int64_t back : {1, 2}) {
+        a.pushSelf();
+        a.pushTemporary(0);
+        a.pushLiteral(integer(back));
+        a.send(minus, 1);
+        a.send(fib, 1);
+    }
+    a.send(vm.symbols().intern("+"), 1);
+    a.returnTop();
+}
+
+// run: n ^self fib: n
+void emitRun(VM& vm, Assembler& a) {
+    a.pushSelf();
+    a.pushTemporary(0);
+    a.send(vm.symbols().intern("fib:"), 1);
+    a.returnTop();
+}
+
+} // namespace
+
+// Doubly recursive Fibonacci: sends, SmallInteger arithmetic, deep call stacks
+MacroBenchmark fibBenchmark() {
+    MacroBenchmark benchmark;
+    benchmark.name = "fib";
+    benchmark.description = "recursive Fibonacci";
+    benchmark.classes = {{"FibBenchmark", "Object", {}}};
+    benchmark.assembledMethods = {
+        {"FibBenchmark", "fib:", 1, 0, emitFib},
+        {"FibBenchmark", "run:", 1, 0, emitRun},
+    };
+    benchmark.entryClass = "FibBenchmark";
+    benchmark.size = 27;
+    benchmark.quickSize = 15;
+    benchmark.expected = {{15, 610}, {25, 75025}, {27, 196418}};
+    return benchmark;
+}
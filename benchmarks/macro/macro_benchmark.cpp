@@ -0,0 +1,38 @@
+#include "macro_benchmark.hpp"
+#include "assembler.hpp"
+#include "vm.hpp"
+
+void MacroBenchmark::install(VM& vm) const {
+    for (const ClassDefinition& cls : classes) {
+        vm.defineClass(cls.name, cls.superclass, cls.instanceVariables);
+    }
+    for (const Method& method : methods) {
+        vm.compile(method.className, method.source);
+    }
+    for (const AssembledMethod& method : assembledMethods) {
+        Assembler assembler;
+        MemoryManager::ScopedRoots literals(vm.memory(), assembler.literals());
+        method.emit(vm, assembler);
+        std::vector<TaggedValue> built = {
+            vm.newMethod(assembler.bytecodes(), assembler.literals(), method.numArgs, method.numTemps)};
+        MemoryManager::ScopedRoots rooted(vm.memory(), built);
+        vm.installMethod(vm.classIndexNamed(method.className), vm.symbols().intern(method.selector), built[0]);
+    }
+}
+
+TaggedValue MacroBenchmark::run(VM& vm, int64_t problemSize) const {
+    TaggedValue receiver = vm.instantiate(vm.classIndexNamed(entryClass));
+    return vm.send(receiver, "run:", {TaggedValue::fromSmallInteger(problemSize)});
+}
+
+const std::vector<MacroBenchmark>& macroBenchmarks() {
+    static const std::vector<MacroBenchmark> benchmarks = {
+        fibBenchmark(),
+        richardsBenchmark(),
+        deltaBlueBenchmark(),
+        binaryTreesBenchmark(),
+        nbodyBenchmark(),
+        wordCountBenchmark(),
+    };
+    return benchmarks;
+}
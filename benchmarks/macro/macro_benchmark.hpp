@@ -0,0 +1,70 @@
+#pragma once
+
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class Assembler;
+class VM;
+
+/**
+ * MacroBenchmark - a classic VM workload written in Smalltalk
+ *
+ * Each workload defines its classes and installs its methods into a fresh VM, then an
+ * instance of entryClass is sent run: with the problem size. run: answers a
+ * SmallInteger checksum, checked against expected for the sizes listed there.
+ *
+ * Methods are Smalltalk source for the compiler, or bytecode written directly against
+ * the Assembler (fib), which measures the interpreter on code no compiler shaped. The
+ * sources stay within what the compiler accepts: no real closures (only inlined
+ * control-structure blocks), no super, no class-side methods.
+ */
+struct MacroBenchmark {
+    struct ClassDefinition {
+        std::string name;
+        std::string superclass;
+        std::vector<std::string> instanceVariables;
+    };
+
+    struct Method {
+        std::string className;
+        std::string source;
+    };
+
+    // A method built by emitting its bytecodes; arguments are temporaries 0..numArgs-1
+    struct AssembledMethod {
+        std::string className;
+        std::string selector;
+        uint32_t numArgs;
+        uint32_t numTemps;  // besides the arguments
+        std::function<void(VM&, Assembler&)> emit;
+    };
+
+    std::string name;
+    std::string description;
+    std::vector<ClassDefinition> classes;
+    std::vector<Method> methods;
+    std::vector<AssembledMethod> assembledMethods;
+    std::string entryClass;
+    int64_t size;       // default problem size
+    int64_t quickSize;  // problem size for smoke runs
+    std::map<int64_t, int64_t> expected;  // size -> checksum
+
+    // Defines the classes, compiles the methods and assembles the assembled ones
+    void install(VM& vm) const;
+    // Sends run: problemSize to a new instance of entryClass
+    TaggedValue run(VM& vm, int64_t problemSize) const;
+};
+
+// All workloads, in report order
+const std::vector<MacroBenchmark>& macroBenchmarks();
+
+MacroBenchmark fibBenchmark();
+MacroBenchmark richardsBenchmark();
+MacroBenchmark deltaBlueBenchmark();
+MacroBenchmark binaryTreesBenchmark();
+MacroBenchmark nbodyBenchmark();
+MacroBenchmark wordCountBenchmark();
@@ -0,0 +1,108 @@
+#include "macro_benchmark.hpp"
+
+// Computer Language Benchmarks Game n-body: Jovian planet orbits with Float arithmetic.
+// The checksum is the final energy * 1e9, truncated. Floats are immediates that drop two
+// mantissa bits; after 1000 steps the energy still matches the reference -0.169087605.
+MacroBenchmark nbodyBenchmark() {
+    MacroBenchmark benchmark;
+    benchmark.name = "nbody";
+    benchmark.description = "planetary orbits in Float arithmetic";
+    benchmark.classes = {
+        {"Body", "Object", {"x", "y", "z", "vx", "vy", "vz", "mass"}},
+        {"NBodyBenchmark", "Object", {"bodies"}},
+    };
+    benchmark.methods = {
+        {"Body", R"(x: ax y: ay z: az vx: avx vy: avy vz: avz mass: aMass
+    | daysPerYear |
+    daysPerYear := 365.24.
+    x := ax. y := ay. z := az.
+    vx := avx * daysPerYear. vy := avy * daysPerYear. vz := avz * daysPerYear.
+    mass := aMass * 39.47841760435743)"},
+        {"Body", "x ^x"},
+        {"Body", "y ^y"},
+        {"Body", "z ^z"},
+        {"Body", "vx ^vx"},
+        {"Body", "vy ^vy"},
+        {"Body", "vz ^vz"},
+        {"Body", "mass ^mass"},
+        {"Body", "move: dt x := x + (dt * vx). y := y + (dt * vy). z := z + (dt * vz)"},
+        {"Body", R"(accelerateX: dx y: dy z: dz by: amount
+    vx := vx + (dx * amount).
+    vy := vy + (dy * amount).
+    vz := vz + (dz * amount))"},
+        {"Body", R"(offsetMomentumX: px y: py z: pz
+    | solarMass |
+    solarMass := 39.47841760435743.
+    vx := 0.0 - (px / solarMass).
+    vy := 0.0 - (py / solarMass).
+    vz := 0.0 - (pz / solarMass))"},
+
+        {"NBodyBenchmark", R"(setUp
+    bodies := Array new: 5.
+    bodies at: 1 put: (Body new x: 0.0 y: 0.0 z: 0.0 vx: 0.0 vy: 0.0 vz: 0.0 mass: 1.0).
+    bodies at: 2 put: (Body new
+        x: 4.84143144246472090 y: -1.16032004402742839 z: -0.103622044471123109
+        vx: 1.66007664274403694e-3 vy: 7.69901118419740425e-3 vz: -6.90460016972063023e-5
+        mass: 9.54791938424326609e-4).
+    bodies at: 3 put: (Body new
+        x: 8.34336671824457987 y: 4.12479856412430479 z: -0.403523417114321381
+        vx: -2.76742510726862411e-3 vy: 4.99852801234917238e-3 vz: 2.30417297573763929e-5
+        mass: 2.85885980666130812e-4).
+    bodies at: 4 put: (Body new
+        x: 12.8943695621391310 y: -15.1111514016986312 z: -0.223307578892655734
+        vx: 2.96460137564761618e-3 vy: 2.37847173959480950e-3 vz: -2.96589568540237556e-5
+        mass: 4.36624404335156298e-5).
+    bodies at: 5 put: (Body new
+        x: 15.3796971148509165 y: -25.9193146099879641 z: 0.179258772950371181
+        vx: 2.68067772490389322e-3 vy: 1.62824170038242295e-3 vz: -9.51592254519715870e-5
+        mass: 5.15138902046611451e-5))"},
+        {"NBodyBenchmark", R"(offsetMomentum
+    | px py pz body |
+    px := 0.0. py := 0.0. pz := 0.0.
+    1 to: bodies size do: [:i |
+        body := bodies at: i.
+        px := px + (body vx * body mass).
+        py := py + (body vy * body mass).
+        pz := pz + (body vz * body mass)].
+    (bodies at: 1) offsetMomentumX: px y: py z: pz)"},
+        {"NBodyBenchmark", R"(advance: dt
+    | n body other dx dy dz distanceSquared magnitude |
+    n := bodies size.
+    1 to: n do: [:i |
+        body := bodies at: i.
+        i + 1 to: n do: [:j |
+            other := bodies at: j.
+            dx := body x - other x.
+            dy := body y - other y.
+            dz := body z - other z.
+            distanceSquared := (dx * dx) + (dy * dy) + (dz * dz).
+            magnitude := dt / (distanceSquared * distanceSquared sqrt).
+            body accelerateX: dx y: dy z: dz by: 0.0 - (other mass * magnitude).
+            other accelerateX: dx y: dy z: dz by: body mass * magnitude]].
+    1 to: n do: [:i | (bodies at: i) move: dt])"},
+        {"NBodyBenchmark", R"(energy
+    | e n body other dx dy dz |
+    e := 0.0.
+    n := bodies size.
+    1 to: n do: [:i |
+        body := bodies at: i.
+        e := e + (0.5 * body mass * ((body vx * body vx) + (body vy * body vy) + (body vz * body vz))).
+        i + 1 to: n do: [:j |
+            other := bodies at: j.
+            dx := body x - other x.
+            dy := body y - other y.
+            dz := body z - other z.
+            e := e - (body mass * other mass / ((dx * dx) + (dy * dy) + (dz * dz)) sqrt)]].
+    ^e)"},
+        {"NBodyBenchmark", R"(run: n
+    self setUp.
+    self offsetMomentum.
+    n timesRepeat: [self advance: 0.01].
+    ^(self energy * 1000000000) truncated)"},
+    };
+    benchmark.entryClass = "NBodyBenchmark";
+    benchmark.size = 20000;
+    benchmark.quickSize = 1000;
+    benchmark.expected = {{1000, -169087605}, {20000, -169089262}};
+    return benchmark;
+}
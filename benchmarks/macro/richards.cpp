@@ -0,0 +1,211 @@
+#include "macro_benchmark.hpp"
+
+// Richards: Martin Richards' operating-system scheduler simulation, ported from the
+// Octane version. Polymorphic sends over four task kinds and linked packet queues.
+//
+// Task ids are 0 idle, 1 worker, 2/3 handlers A/B, 4/5 devices A/B; packet kinds are
+// 0 device, 1 work. TCB states: 0 running, 1 runnable, 2 suspended, 3 suspended and
+// runnable, bit 4 held.
+MacroBenchmark richardsBenchmark() {
+    MacroBenchmark benchmark;
+    benchmark.name = "richards";
+    benchmark.description = "OS task scheduler simulation";
+    benchmark.classes = {
+        {"RichardsPacket", "Object", {"link", "id", "kind", "a1", "a2"}},
+        {"RichardsTcb", "Object", {"link", "id", "priority", "queue", "task", "state"}},
+        {"RichardsScheduler", "Object", {"queueCount", "holdCount", "blocks", "list", "currentTcb", "currentId"}},
+        {"RichardsIdleTask", "Object", {"scheduler", "v1", "count"}},
+        {"RichardsDeviceTask", "Object", {"scheduler", "v1"}},
+        {"RichardsWorkerTask", "Object", {"scheduler", "v1", "v2"}},
+        {"RichardsHandlerTask", "Object", {"scheduler", "v1", "v2"}},
+        {"RichardsBenchmark", "Object", {}},
+    };
+    benchmark.methods = {
+        // Packet
+        {"RichardsPacket", R"(link: aPacket id: anId kind: aKind
+    link := aPacket. id := anId. kind := aKind. a1 := 0. a2 := Array new: 4)"},
+        {"RichardsPacket", "link ^link"},
+        {"RichardsPacket", "link: aPacket link := aPacket"},
+        {"RichardsPacket", "id ^id"},
+        {"RichardsPacket", "id: anId id := anId"},
+        {"RichardsPacket", "kind ^kind"},
+        {"RichardsPacket", "a1 ^a1"},
+        {"RichardsPacket", "a1: anInteger a1 := anInteger"},
+        {"RichardsPacket", "a2 ^a2"},
+        {"RichardsPacket", R"(addTo: queue
+    | next peek |
+    link := nil.
+    queue isNil ifTrue: [^self].
+    next := queue.
+    [(peek := next link) notNil] whileTrue: [next := peek].
+    next link: self.
+    ^queue)"},
+
+        // Task control block
+        {"RichardsTcb", R"(link: aTcb id: anId priority: aPriority queue: aPacket task: aTask
+    link := aTcb. id := anId. priority := aPriority. queue := aPacket. task := aTask.
+    state := aPacket isNil ifTrue: [2] ifFalse: [3])"},
+        {"RichardsTcb", "link ^link"},
+        {"RichardsTcb", "id ^id"},
+        {"RichardsTcb", "priority ^priority"},
+        {"RichardsTcb", "setRunning state := 0"},
+        {"RichardsTcb", "markAsNotHeld state := state bitAnd: -5"},
+        {"RichardsTcb", "markAsHeld state := state bitOr: 4"},
+        {"RichardsTcb", "markAsSuspended state := state bitOr: 2"},
+        {"RichardsTcb", "markAsRunnable state := state bitOr: 1"},
+        {"RichardsTcb", "isHeldOrSuspended ^(state bitAnd: 4) ~= 0 or: [state = 2]"},
+        {"RichardsTcb", R"(run
+    | packet |
+    state = 3
+        ifTrue: [
+            packet := queue.
+            queue := packet link.
+            state := queue isNil ifTrue: [0] ifFalse: [1]]
+        ifFalse: [packet := nil].
+    ^task run: packet)"},
+        {"RichardsTcb", R"(checkPriorityAdd: aTcb packet: aPacket
+    queue isNil
+        ifTrue: [
+            queue := aPacket.
+            self markAsRunnable.
+            priority > aTcb priority ifTrue: [^self]]
+        ifFalse: [queue := aPacket addTo: queue].
+    ^aTcb)"},
+
+        // Scheduler
+        {"RichardsScheduler", "initialize queueCount := 0. holdCount := 0. blocks := Array new: 6"},
+        {"RichardsScheduler", "queueCount ^queueCount"},
+        {"RichardsScheduler", "holdCount ^holdCount"},
+        {"RichardsScheduler", R"(addIdleTask: anId priority: aPriority queue: aPacket count: aCount
+    self addTask: anId priority: aPriority queue: aPacket
+        task: (RichardsIdleTask new scheduler: self v1: 1 count: aCount).
+    currentTcb setRunning)"},
+        {"RichardsScheduler", R"(addWorkerTask: anId priority: aPriority queue: aPacket
+    self addTask: anId priority: aPriority queue: aPacket
+        task: (RichardsWorkerTask new scheduler: self v1: 2 v2: 0))"},
+        {"RichardsScheduler", R"(addHandlerTask: anId priority: aPriority queue: aPacket
+    self addTask: anId priority: aPriority queue: aPacket task: (RichardsHandlerTask new scheduler: self))"},
+        {"RichardsScheduler", R"(addDeviceTask: anId priority: aPriority queue: aPacket
+    self addTask: anId priority: aPriority queue: aPacket task: (RichardsDeviceTask new scheduler: self))"},
+        {"RichardsScheduler", R"(addTask: anId priority: aPriority queue: aPacket task: aTask
+    currentTcb := RichardsTcb new link: list id: anId priority: aPriority queue: aPacket task: aTask.
+    list := currentTcb.
+    blocks at: anId + 1 put: currentTcb)"},
+        {"RichardsScheduler", R"(schedule
+    currentTcb := list.
+    [currentTcb notNil] whileTrue: [
+        currentTcb isHeldOrSuspended
+            ifTrue: [currentTcb := currentTcb link]
+            ifFalse: [
+                currentId := currentTcb id.
+                currentTcb := currentTcb run]])"},
+        {"RichardsScheduler", R"(release: anId
+    | tcb |
+    tcb := blocks at: anId + 1.
+    tcb isNil ifTrue: [^tcb].
+    tcb markAsNotHeld.
+    ^tcb priority > currentTcb priority ifTrue: [tcb] ifFalse: [currentTcb])"},
+        {"RichardsScheduler", R"(holdCurrent
+    holdCount := holdCount + 1.
+    currentTcb markAsHeld.
+    ^currentTcb link)"},
+        {"RichardsScheduler", "suspendCurrent currentTcb markAsSuspended. ^currentTcb"},
+        {"RichardsScheduler", R"(queue: aPacket
+    | tcb |
+    tcb := blocks at: aPacket id + 1.
+    tcb isNil ifTrue: [^tcb].
+    queueCount := queueCount + 1.
+    aPacket link: nil.
+    aPacket id: currentId.
+    ^tcb checkPriorityAdd: currentTcb packet: aPacket)"},
+
+        // Tasks
+        {"RichardsIdleTask", "scheduler: aScheduler v1: anInteger count: aCount scheduler := aScheduler. v1 := anInteger. count := aCount"},
+        {"RichardsIdleTask", R"(run: aPacket
+    count := count - 1.
+    count = 0 ifTrue: [^scheduler holdCurrent].
+    (v1 bitAnd: 1) = 0
+        ifTrue: [
+            v1 := v1 bitShift: -1.
+            ^scheduler release: 4]
+        ifFalse: [
+            v1 := (v1 bitShift: -1) bitXor: 16rD008.
+            ^scheduler release: 5])"},
+        {"RichardsDeviceTask", "scheduler: aScheduler scheduler := aScheduler"},
+        {"RichardsDeviceTask", R"(run: aPacket
+    | pending |
+    aPacket isNil ifTrue: [
+        v1 isNil ifTrue: [^scheduler suspendCurrent].
+        pending := v1.
+        v1 := nil.
+        ^scheduler queue: pending].
+    v1 := aPacket.
+    ^scheduler holdCurrent)"},
+        {"RichardsWorkerTask", "scheduler: aScheduler v1: anId v2: anInteger scheduler := aScheduler. v1 := anId. v2 := anInteger"},
+        {"RichardsWorkerTask", R"(run: aPacket
+    aPacket isNil ifTrue: [^scheduler suspendCurrent].
+    v1 := v1 = 2 ifTrue: [3] ifFalse: [2].
+    aPacket id: v1.
+    aPacket a1: 0.
+    1 to: 4 do: [:i |
+        v2 := v2 + 1.
+        v2 > 26 ifTrue: [v2 := 1].
+        aPacket a2 at: i put: v2].
+    ^scheduler queue: aPacket)"},
+        {"RichardsHandlerTask", "scheduler: aScheduler scheduler := aScheduler"},
+        {"RichardsHandlerTask", R"(run: aPacket
+    | count packet |
+    aPacket notNil ifTrue: [
+        aPacket kind = 1
+            ifTrue: [v1 := aPacket addTo: v1]
+            ifFalse: [v2 := aPacket addTo: v2]].
+    v1 notNil ifTrue: [
+        count := v1 a1.
+        count < 4
+            ifTrue: [
+                v2 notNil ifTrue: [
+                    packet := v2.
+                    v2 := v2 link.
+                    packet a1: (v1 a2 at: count + 1).
+                    v1 a1: count + 1.
+                    ^scheduler queue: packet]]
+            ifFalse: [
+                packet := v1.
+                v1 := v1 link.
+                ^scheduler queue: packet]].
+    ^scheduler suspendCurrent)"},
+
+        // Driver: one simulation of 1000 idle-task steps
+        {"RichardsBenchmark", R"(runOnce
+    | scheduler queue |
+    scheduler := RichardsScheduler new initialize.
+    scheduler addIdleTask: 0 priority: 0 queue: nil count: 1000.
+    queue := RichardsPacket new link: nil id: 1 kind: 1.
+    queue := RichardsPacket new link: queue id: 1 kind: 1.
+    scheduler addWorkerTask: 1 priority: 1000 queue: queue.
+    queue := RichardsPacket new link: nil id: 4 kind: 0.
+    queue := RichardsPacket new link: queue id: 4 kind: 0.
+    queue := RichardsPacket new link: queue id: 4 kind: 0.
+    scheduler addHandlerTask: 2 priority: 2000 queue: queue.
+    queue := RichardsPacket new link: nil id: 5 kind: 0.
+    queue := RichardsPacket new link: queue id: 5 kind: 0.
+    queue := RichardsPacket new link: queue id: 5 kind: 0.
+    scheduler addHandlerTask: 3 priority: 3000 queue: queue.
+    scheduler addDeviceTask: 4 priority: 4000 queue: nil.
+    scheduler addDeviceTask: 5 priority: 5000 queue: nil.
+    scheduler schedule.
+    ^scheduler queueCount * 10000 + scheduler holdCount)"},
+        {"RichardsBenchmark", R"(run: n
+    | result |
+    n timesRepeat: [result := self runOnce].
+    ^result)"},
+    };
+    benchmark.entryClass = "RichardsBenchmark";
+    benchmark.size = 20;
+    benchmark.quickSize = 1;
+    // queueCount 2322 and holdCount 928 per simulation, as in the reference implementations
+    for (int64_t n : {benchmark.quickSize, benchmark.size}) {
+        benchmark.expected[n] = 2322 * 10000 + 928;
+    }
+    return benchmark;
+}
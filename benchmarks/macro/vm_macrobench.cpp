@@ -0,0 +1,339 @@
+// vm_macrobench - runs the macro benchmark suite and reports, per workload, the median
+// iteration's wall time together with the interpreter and object memory counters
+// accumulated during that iteration.
+//
+//   vm_macrobench [--quick] [--iterations=N] [--size=N] [--filter=SUBSTRING]
+//                 [--profile] [--collapsed=FILE] [--stats] [--stats-json=FILE]
+//                 [--isolates=N,N,...]
+//
+// --quick runs every workload once at its small size (the ctest smoke test).
+// --profile prints each workload's opcode and method profile after its row, and
+// --collapsed samples the stacks of every workload into FILE for a flame graph; both
+// slow the interpreter down, so their timings are not comparable to plain runs.
+// --stats profiles allocations and prints each workload's VM statistics, with a heap
+// census and GC pause histograms, after its row; --stats-json writes the same for
+// every workload into FILE as one JSON object keyed by workload name.
+// --isolates reports throughput scaling instead: each workload is frozen into an image
+// segment once, then for every count N, N isolates sharing it each run the workload
+// --iterations times in parallel; the other reporting options do not apply.
+// Exits non-zero if a workload throws or answers the wrong checksum.
+
+#include "image_segment.hpp"
+#include "isolate.hpp"
+#include "macro_benchmark.hpp"
+#include "profiler.hpp"
+#include "vm.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    bool quick = false;
+    int iterations = 5;
+    int64_t size = 0;  // 0: each workload's default
+    std::string filter;
+    bool profile = false;
+    std::string collapsedPath;
+    bool stats = false;
+    std::string statsJsonPath;
+    std::vector<int> isolates;  // Empty: the usual single-VM report
+};
+
+struct Sample {
+    double milliseconds = 0;
+    uint64_t bytecodes = 0;
+    uint64_t sends = 0;
+    uint64_t allocations = 0;
+    uint64_t bytesAllocated = 0;
+    double gcMilliseconds = 0;
+    size_t minorCollections = 0;
+    size_t majorCollections = 0;
+    TaggedValue result;
+};
+
+bool startsWith(const char* arg, const char* prefix, const char** value) {
+    size_t length = std::strlen(prefix);
+    if (std::strncmp(arg, prefix, length) != 0) {
+        return false;
+    }
+    *value = arg + length;
+    return true;
+}
+
+void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--quick] [--iterations=N] [--size=N] [--filter=SUBSTRING] [--profile] "
+                 "[--collapsed=FILE] [--stats] [--stats-json=FILE] [--isolates=N,N,...]\n",
+                 program);
+    std::exit(2);
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const char* value;
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+            options.iterations = 1;
+        } else if (startsWith(argv[i], "--iterations=", &value)) {
+            options.iterations = std::atoi(value);
+        } else if (startsWith(argv[i], "--size=", &value)) {
+            options.size = std::atoll(value);
+        } else if (startsWith(argv[i], "--filter=", &value)) {
+            options.filter = value;
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            options.profile = true;
+        } else if (startsWith(argv[i], "--collapsed=", &value)) {
+            options.collapsedPath = value;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            options.stats = true;
+        } else if (startsWith(argv[i], "--stats-json=", &value)) {
+            options.statsJsonPath = value;
+        } else if (startsWith(argv[i], "--isolates=", &value)) {
+            for (char* end; *value != '\0'; value = *end == ',' ? end + 1 : end) {
+                long count = std::strtol(value, &end, 10);
+                if (end == value || count < 1) {
+                    usage(argv[0]);
+                }
+                options.isolates.push_back(static_cast<int>(count));
+            }
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (options.iterations < 1) {
+        usage(argv[0]);
+    }
+    return options;
+}
+
+Sample runOnce(VM& vm, const MacroBenchmark& benchmark, int64_t size) {
+    Interpreter& interpreter = vm.interpreter();
+    MemoryManager& memory = vm.memory();
+    uint64_t bytecodes = interpreter.bytecodesExecuted();
+    uint64_t sends = interpreter.sends();
+    uint64_t allocations = memory.allocations();
+    uint64_t bytes = memory.bytesAllocated();
+    auto gcTime = memory.collectionTime();
+    size_t minor = memory.minorCollections();
+    size_t major = memory.majorCollections();
+
+    auto started = std::chrono::steady_clock::now();
+    TaggedValue result = benchmark.run(vm, size);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    Sample sample;
+    sample.milliseconds = std::chrono::duration<double, std::milli>(elapsed).count();
+    sample.bytecodes = interpreter.bytecodesExecuted() - bytecodes;
+    sample.sends = interpreter.sends() - sends;
+    sample.allocations = memory.allocations() - allocations;
+    sample.bytesAllocated = memory.bytesAllocated() - bytes;
+    sample.gcMilliseconds = std::chrono::duration<double, std::milli>(memory.collectionTime() - gcTime).count();
+    sample.minorCollections = memory.minorCollections() - minor;
+    sample.majorCollections = memory.majorCollections() - major;
+    sample.result = result;
+    return sample;
+}
+
+// Whether result is the checksum benchmark expects at size
+bool checksumMatches(const MacroBenchmark& benchmark, int64_t size, TaggedValue result) {
+    auto expected = benchmark.expected.find(size);
+    return result.isSmallInteger() &&
+           (expected == benchmark.expected.end() || expected->second == result.toSmallInteger());
+}
+
+// Throughput of 1..N isolates sharing one image segment; answers the number of failures
+int runIsolates(const Options& options) {
+    std::printf("%-13s %8s %8s %10s %10s %8s %11s\n", "benchmark", "size", "isolates", "time(ms)", "runs/s",
+                "speedup", "efficiency");
+    int failures = 0;
+    for (const MacroBenchmark& benchmark : macroBenchmarks()) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        int64_t size = options.size != 0 ? options.size : options.quick ? benchmark.quickSize : benchmark.size;
+        double baseline = 0;
+        try {
+            std::shared_ptr<const ImageSegment> image;
+            {
+                VM vm;
+                benchmark.install(vm);
+                image = ImageSegment::build(vm);
+            }
+            std::printf("%-13s image segment: %zu objects, %.1f KB shared\n", benchmark.name.c_str(),
+                        image->objectCount(), image->bytes() / 1024.0);
+
+            for (int count : options.isolates) {
+                std::vector<std::unique_ptr<Isolate>> isolates;
+                for (int i = 0; i < count; i++) {
+                    isolates.push_back(std::make_unique<Isolate>(image));
+                }
+                auto runAll = [&](int runs) {
+                    std::vector<std::future<void>> done;
+                    for (auto& isolate : isolates) {
+                        done.push_back(isolate->post([&benchmark, size, runs](VM& vm) {
+                            for (int i = 0; i < runs; i++) {
+                                if (!checksumMatches(benchmark, size, benchmark.run(vm, size))) {
+                                    throw std::runtime_error("wrong checksum");
+                                }
+                            }
+                        }));
+                    }
+                    for (auto& future : done) {
+                        future.get();
+                    }
+                };
+                runAll(1);  // Warm up the method caches
+                auto started = std::chrono::steady_clock::now();
+                runAll(options.iterations);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+                double throughput = count * options.iterations / seconds;
+                if (baseline == 0) {
+                    baseline = throughput / count;
+                }
+                double speedup = throughput / baseline;
+                std::printf("%-13s %8lld %8d %10.1f %10.1f %8.2f %10.0f%%\n", benchmark.name.c_str(),
+                            static_cast<long long>(size), count, seconds * 1000.0, throughput, speedup,
+                            100.0 * speedup / count);
+                std::fflush(stdout);
+            }
+        } catch (const std::exception& e) {
+            std::printf("%-13s %8lld  FAILED: %s\n", benchmark.name.c_str(), static_cast<long long>(size), e.what());
+            failures++;
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options = parseOptions(argc, argv);
+    if (!options.isolates.empty()) {
+        return runIsolates(options) == 0 ? 0 : 1;
+    }
+
+    std::printf("%-13s %8s %10s %12s %9s %11s %11s %10s %9s %6s %6s  %s\n", "benchmark", "size",
+                "time(ms)", "bytecodes", "Mbc/s", "sends", "allocs", "alloc(MB)", "gc(ms)", "minor",
+                "major", "result");
+
+    std::ofstream collapsed;
+    if (!options.collapsedPath.empty()) {
+        collapsed.open(options.collapsedPath);
+        if (!collapsed) {
+            std::fprintf(stderr, "cannot write %s\n", options.collapsedPath.c_str());
+            return 2;
+        }
+    }
+    std::ofstream statsJson;
+    if (!options.statsJsonPath.empty()) {
+        statsJson.open(options.statsJsonPath);
+        if (!statsJson) {
+            std::fprintf(stderr, "cannot write %s\n", options.statsJsonPath.c_str());
+            return 2;
+        }
+        statsJson << "{";
+    }
+    bool collectStats = options.stats || statsJson.is_open();
+
+    int failures = 0;
+    const char* statsSeparator = "\n";
+    for (const MacroBenchmark& benchmark : macroBenchmarks()) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        int64_t size = options.size != 0 ? options.size : options.quick ? benchmark.quickSize : benchmark.size;
+
+        std::vector<Sample> samples;
+        Profiler profiler(options.profile);
+        VMStatistics statistics;
+        try {
+            VM vm;
+            benchmark.install(vm);
+            if (options.profile || collapsed.is_open()) {
+                vm.interpreter().setProfiler(&profiler);
+            }
+            if (collapsed.is_open()) {
+                profiler.startSampling();
+            }
+            if (collectStats) {
+                vm.startAllocationProfiling();
+            }
+            for (int i = 0; i < options.iterations; i++) {
+                samples.push_back(runOnce(vm, benchmark, size));
+            }
+            profiler.stopSampling();
+            if (collectStats) {
+                statistics = vm.statistics(true);
+            }
+        } catch (const std::exception& e) {
+            profiler.stopSampling();
+            std::printf("%-13s %8lld  FAILED: %s\n", benchmark.name.c_str(), static_cast<long long>(size),
+                        e.what());
+            failures++;
+            continue;
+        }
+
+        std::sort(samples.begin(), samples.end(),
+                  [](const Sample& a, const Sample& b) { return a.milliseconds < b.milliseconds; });
+        const Sample& median = samples[samples.size() / 2];
+
+        std::string result = median.result.isSmallInteger() ? std::to_string(median.result.toSmallInteger())
+                                                            : "not a SmallInteger";
+        auto expected = benchmark.expected.find(size);
+        if (!median.result.isSmallInteger() ||
+            (expected != benchmark.expected.end() && expected->second != median.result.toSmallInteger())) {
+            result += " (expected " +
+                      (expected != benchmark.expected.end() ? std::to_string(expected->second) : "SmallInteger") +
+                      ")";
+            failures++;
+        }
+
+        double seconds = median.milliseconds / 1000.0;
+        std::printf("%-13s %8lld %10.1f %12llu %9.1f %11llu %11llu %10.1f %9.1f %6zu %6zu  %s\n",
+                    benchmark.name.c_str(), static_cast<long long>(size), median.milliseconds,
+                    static_cast<unsigned long long>(median.bytecodes),
+                    seconds > 0 ? median.bytecodes / seconds / 1e6 : 0.0,
+                    static_cast<unsigned long long>(median.sends),
+                    static_cast<unsigned long long>(median.allocations),
+                    median.bytesAllocated / (1024.0 * 1024.0), median.gcMilliseconds, median.minorCollections,
+                    median.majorCollections, result.c_str());
+
+        if (collapsed.is_open()) {
+            profiler.writeCollapsedStacks(collapsed, benchmark.name);
+        }
+        if (options.profile) {
+            std::fflush(stdout);
+            std::cout << '\n';
+            profiler.writeReport(std::cout);
+            std::cout << std::endl;
+        }
+        if (options.stats) {
+            std::fflush(stdout);
+            std::cout << '\n';
+            statistics.writeText(std::cout);
+            std::cout << std::endl;
+        }
+        if (statsJson.is_open()) {
+            statsJson << statsSeparator << "\"" << benchmark.name << "\": ";
+            statistics.writeJson(statsJson);
+            statsSeparator = ",\n";
+        }
+    }
+    if (statsJson.is_open()) {
+        statsJson << "}\n";
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#include "macro_benchmark.hpp"
+
+// Word frequency count: String allocation, content-keyed Dictionary lookups and updates.
+// Words are 1-5 letters from a-f drawn with a Park-Miller generator, so the input is
+// the same on every run without reading a file.
+MacroBenchmark wordCountBenchmark() {
+    MacroBenchmark benchmark;
+    benchmark.name = "word-count";
+    benchmark.description = "Dictionary word frequencies";
+    benchmark.classes = {{"WordCountBenchmark", "Object", {"seed"}}};
+    benchmark.methods = {
+        {"WordCountBenchmark", "nextRandom seed := seed * 16807 \\\\ 2147483647. ^seed"},
+        {"WordCountBenchmark", R"(nextWord
+    | word |
+    word := String new: self nextRandom \\ 5 + 1.
+    1 to: word size do: [:i | word at: i put: $a + (self nextRandom \\ 6)].
+    ^word)"},
+        {"WordCountBenchmark", R"(run: n
+    | counts word keys letters |
+    seed := 42.
+    counts := Dictionary new.
+    n timesRepeat: [
+        word := self nextWord.
+        counts at: word put: (counts at: word default: 0) + 1].
+    keys := counts keys.
+    letters := 0.
+    1 to: keys size do: [:i | letters := letters + ((counts at: (keys at: i)) * (keys at: i) size)].
+    ^letters * 100000 + keys size)"},
+    };
+    benchmark.entryClass = "WordCountBenchmark";
+    benchmark.size = 100000;
+    benchmark.quickSize = 2000;
+    // letters * 100000 + distinct words
+    benchmark.expected = {{2000, 601900967}, {100000, 30023908739}};
+    return benchmark;
+}
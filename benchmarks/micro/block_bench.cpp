@@ -0,0 +1,89 @@
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Blocks: collection iteration through clean block literals, and blocks made by
+// CREATE_BLOCK in the frame and on the heap
+// ============================================================================
+
+namespace {
+
+constexpr int64_t ELEMENTS = 1000;
+
+// Selector and source of one pass over an Array, summing or mapping its elements
+const std::pair<const char*, const char*> ITERATIONS[] = {
+    // The inlined loop, the only way to write it before blocks were objects
+    {"inlined:",
+     "inlined: anArray | sum | sum := 0. 1 to: anArray size do: [:i | sum := sum + (anArray at: i)]. ^sum"},
+    {"inject:", "inject: anArray ^anArray inject: 0 into: [:sum :each | sum + each]"},
+    {"detect:", "detect: anArray ^anArray detect: [:each | each < 0] ifNone: [0]"},
+    {"collect:", "collect: anArray ^anArray collect: [:each | each + 1]"},
+};
+
+} // namespace
+
+// A pass over a 1000-element Array per iteration: the inlined to:do: loop (arg 0),
+// inject:into: (1), detect:ifNone: (2) and collect: (3) with clean blocks. Items are
+// elements; allocs_per_pass counts the objects each pass allocates.
+static void BM_Block_CollectionIteration(benchmark::State& state) {
+    VM vm;
+    const char* selector = ITERATIONS[state.range(0)].first;
+    vm.compile("Object", ITERATIONS[state.range(0)].second);
+    std::vector<TaggedValue> elements;
+    for (int64_t i = 1; i <= ELEMENTS; i++) {
+        elements.push_back(TaggedValue::fromSmallInteger(i));
+    }
+    std::vector<TaggedValue> roots = {vm.newArray(elements)};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+
+    uint64_t allocations = vm.memory().allocations();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(vm.send(TaggedValue::nil(), selector, {roots[0]}));
+    }
+    state.SetItemsProcessed(state.iterations() * ELEMENTS);
+    state.counters["allocs_per_pass"] =
+        static_cast<double>(vm.memory().allocations() - allocations) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_Block_CollectionIteration)->Arg(0)->Arg(1)->Arg(2)->Arg(3);
+
+namespace {
+
+constexpr int64_t BLOCKS = 1000;
+
+// Selector and source of a loop that makes and evaluates a block capturing i and x on
+// each of its iterations
+const std::pair<const char*, const char*> CAPTURES[] = {
+    // The block stays in the frame
+    {"inFrame:",
+     "inFrame: x | sum | sum := 0.\n"
+     "    1 to: 1000 do: [:i | | block | block := [i + x]. sum := sum + block value].\n"
+     "    ^sum"},
+    // Copying it to a second temporary lets it escape, so it is made on the heap
+    {"onHeap:",
+     "onHeap: x | sum | sum := 0.\n"
+     "    1 to: 1000 do: [:i | | block other | block := [i + x]. other := block. sum := sum + block value].\n"
+     "    ^sum"},
+};
+
+} // namespace
+
+// 1000 iterations per pass, each making a block with two copied values and evaluating
+// it: kept in the frame (arg 0) or moved to the heap (arg 1). Items are blocks;
+// allocs_per_pass counts the objects each pass allocates.
+static void BM_Block_CreateBlock(benchmark::State& state) {
+    VM vm;
+    const char* selector = CAPTURES[state.range(0)].first;
+    vm.compile("Object", CAPTURES[state.range(0)].second);
+
+    uint64_t allocations = vm.memory().allocations();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(vm.send(TaggedValue::nil(), selector, {TaggedValue::fromSmallInteger(3)}));
+    }
+    state.SetItemsProcessed(state.iterations() * BLOCKS);
+    state.counters["allocs_per_pass"] =
+        static_cast<double>(vm.memory().allocations() - allocations) / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_Block_CreateBlock)->Arg(0)->Arg(1);
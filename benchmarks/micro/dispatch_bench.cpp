@@ -0,0 +1,342 @@
+#include "../src/class_table.hpp"
+#include "../src/dictionary_table.hpp"
+#include "../src/inline_cache.hpp"
+#include "../src/runtime/dictionary.hpp"
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+// ============================================================================
+// Send-path lookups: inline cache check, method cache hit and method dictionary probe
+// ============================================================================
+
+namespace {
+
+constexpr size_t RECEIVERS = 1024;
+
+// Instances of one class spread over the nursery, so each check loads a header that is
+// not already in a register
+std::vector<TaggedValue> receivers(VM& vm, uint32_t slots) {
+    std::vector<TaggedValue> result;
+    for (size_t i = 0; i < RECEIVERS; i++) {
+        ObjectHeader* object = vm.memory().allocateSlots(ObjectHeader::TYPE_OBJECT, slots, vm.kernel().object);
+        result.push_back(object->toTaggedValue());
+        vm.memory().allocateSlots(ObjectHeader::TYPE_OBJECT, 3);
+    }
+    return result;
+}
+
+// The same send-site check if objects carried a class pointer in their first slot
+// instead of an index in the header
+struct ClassPointerCache {
+    TaggedValue classObject;
+    TaggedValue method;
+
+    bool matches(TaggedValue receiver) const {
+        return receiver.isPointer() && ObjectHeader::fromTaggedValue(receiver)->slots()[0] == classObject;
+    }
+};
+
+} // namespace
+
+// A monomorphic send site hitting: the class index from the header, an integer compare
+static void BM_InlineCache_Hit(benchmark::State& state) {
+    VM vm;
+    std::vector<TaggedValue> objects = receivers(vm, 0);
+    InlineCache cache;
+    cache.fill(objects[0], TaggedValue::trueValue());
+    size_t i = 0;
+    for (auto _ : state) {
+        TaggedValue receiver = objects[i++ % RECEIVERS];
+        benchmark::DoNotOptimize(cache.matches(receiver) ? cache.method : TaggedValue::nil());
+    }
+}
+BENCHMARK(BM_InlineCache_Hit);
+
+// The class-pointer layout BM_InlineCache_Hit is measured against: one more word per
+// object, loaded and compared as a pointer
+static void BM_ClassPointerCache_Hit(benchmark::State& state) {
+    VM vm;
+    std::vector<TaggedValue> objects = receivers(vm, 1);
+    TaggedValue classObject = vm.classes().classAt(vm.kernel().object);
+    for (TaggedValue object : objects) {
+        ObjectHeader::fromTaggedValue(object)->slots()[0] = classObject;
+    }
+    ClassPointerCache cache{classObject, TaggedValue::trueValue()};
+    size_t i = 0;
+    for (auto _ : state) {
+        TaggedValue receiver = objects[i++ % RECEIVERS];
+        benchmark::DoNotOptimize(cache.matches(receiver) ? cache.method : TaggedValue::nil());
+    }
+}
+BENCHMARK(BM_ClassPointerCache_Hit);
+
+// What every send pays when the interpreter's method cache hits: a hash of class index
+// and selector, then an integer compare on the class index
+static void BM_MethodCache_Hit(benchmark::State& state) {
+    VM vm;
+    uint32_t classIndex = ClassTable::classIndexOf(TaggedValue::fromSmallInteger(1));
+    TaggedValue selector = vm.symbols().intern("+");
+    vm.interpreter().lookup(classIndex, selector);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(classIndex);
+        benchmark::DoNotOptimize(vm.interpreter().lookup(classIndex, selector));
+    }
+}
+BENCHMARK(BM_MethodCache_Hit);
+
+// Heap of a freshly bootstrapped image: classWordBytes is what a class pointer per object
+// would add, savedFraction that over the total the heap would then need
+static void BM_ImageHeaderBytes(benchmark::State& state) {
+    VM vm;
+    size_t objects = 0;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        objects = 0;
+        bytes = 0;
+        vm.memory().forEachObject([&](ObjectHeader* object) {
+            objects++;
+            bytes += object->totalBytes();
+        });
+    }
+    double classWordBytes = static_cast<double>(objects * sizeof(TaggedValue));
+    state.counters["objects"] = static_cast<double>(objects);
+    state.counters["heapBytes"] = static_cast<double>(bytes);
+    state.counters["classWordBytes"] = classWordBytes;
+    state.counters["savedFraction"] = classWordBytes / (static_cast<double>(bytes) + classWordBytes);
+}
+BENCHMARK(BM_ImageHeaderBytes);
+
+static void BM_IdentityDictionary_At(benchmark::State& state) {
+    runtime::IdentityDictionary dictionary;
+    int64_t size = state.range(0);
+    for (int64_t i = 0; i < size; i++) {
+        dictionary.atPut(TaggedValue::fromSmallInteger(i), TaggedValue::fromSmallInteger(i));
+    }
+    int64_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dictionary.find(TaggedValue::fromSmallInteger(i)));
+        i = (i + 1) % size;
+    }
+}
+BENCHMARK(BM_IdentityDictionary_At)->Arg(8)->Arg(64)->Arg(4096);
+
+// The same lookups as a linear scan over association pairs, for comparison at small sizes
+static void BM_LinearScan_At(benchmark::State& state) {
+    int64_t size = state.range(0);
+    std::vector<std::pair<TaggedValue, TaggedValue>> pairs;
+    for (int64_t i = 0; i < size; i++) {
+        pairs.emplace_back(TaggedValue::fromSmallInteger(i), TaggedValue::fromSmallInteger(i));
+    }
+    int64_t i = 0;
+    for (auto _ : state) {
+        TaggedValue key = TaggedValue::fromSmallInteger(i);
+        const TaggedValue* found = nullptr;
+        for (const auto& pair : pairs) {
+            if (pair.first == key) {
+                found = &pair.second;
+                break;
+            }
+        }
+        benchmark::DoNotOptimize(found);
+        i = (i + 1) % size;
+    }
+}
+BENCHMARK(BM_LinearScan_At)->Arg(8)->Arg(64)->Arg(4096);
+
+// ============================================================================
+// Dictionary: the Swiss table against a plain linear-probe table, up to 10M entries
+// ============================================================================
+
+namespace {
+
+// Open addressing with linear probing, load factor at most 1/2; the simplest table
+// the Swiss table has to beat. It grows by rehashing everything into a table of twice
+// the capacity at once.
+class LinearProbeTable {
+public:
+    explicit LinearProbeTable(size_t entries = 0) : count_(0) {
+        size_t capacity = 16;
+        while (capacity < 2 * entries) {
+            capacity *= 2;
+        }
+        allocate(capacity);
+    }
+
+    const TaggedValue* find(TaggedValue key) const {
+        for (size_t i = slotFor(key);; i = (i + 1) & mask_) {
+            if (keys_[i] == key) {
+                return &values_[i];
+            }
+            if (keys_[i].isNil()) {
+                return nullptr;
+            }
+        }
+    }
+
+    void atPut(TaggedValue key, TaggedValue value) {
+        size_t i = slotFor(key);
+        while (!keys_[i].isNil() && keys_[i] != key) {
+            i = (i + 1) & mask_;
+        }
+        if (keys_[i].isNil()) {
+            if (2 * (count_ + 1) > keys_.size()) {
+                grow();
+                atPut(key, value);
+                return;
+            }
+            count_++;
+        }
+        keys_[i] = key;
+        values_[i] = value;
+    }
+
+private:
+    size_t slotFor(TaggedValue key) const {
+        return static_cast<size_t>((key.value() * 0x9E3779B97F4A7C15ULL) >> 17) & mask_;
+    }
+
+    void allocate(size_t capacity) {
+        keys_.assign(capacity, TaggedValue::nil());
+        values_.assign(capacity, TaggedValue::nil());
+        mask_ = capacity - 1;
+    }
+
+    void grow() {
+        std::vector<TaggedValue> keys = std::move(keys_);
+        std::vector<TaggedValue> values = std::move(values_);
+        allocate(2 * keys.size());
+        count_ = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!keys[i].isNil()) {
+                atPut(keys[i], values[i]);
+            }
+        }
+    }
+
+    std::vector<TaggedValue> keys_;
+    std::vector<TaggedValue> values_;
+    size_t mask_;
+    size_t count_;
+};
+
+// A Smalltalk Dictionary, whose table lives in the object memory of a VM of its own
+class HeapDictionary {
+public:
+    HeapDictionary() : roots_{vm_.newDictionary()}, scoped_(vm_.memory(), roots_) {}
+
+    const TaggedValue* find(TaggedValue key) const { return dictionary_table::find(roots_[0], key); }
+    void atPut(TaggedValue key, TaggedValue value) { dictionary_table::atPut(vm_, roots_[0], key, value); }
+
+private:
+    VM vm_;
+    std::vector<TaggedValue> roots_;
+    MemoryManager::ScopedRoots scoped_;
+};
+
+template <typename Table>
+void fill(Table& table, int64_t size) {
+    for (int64_t i = 0; i < size; i++) {
+        table.atPut(TaggedValue::fromSmallInteger(i), TaggedValue::fromSmallInteger(i));
+    }
+}
+
+// The keys of a size-entry table in a fixed random order, so that consecutive lookups
+// touch unrelated parts of the table whichever hash function it uses
+std::vector<TaggedValue> shuffledKeys(int64_t size) {
+    std::vector<TaggedValue> keys;
+    keys.reserve(static_cast<size_t>(size));
+    for (int64_t i = 0; i < size; i++) {
+        keys.push_back(TaggedValue::fromSmallInteger(i));
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+    return keys;
+}
+
+} // namespace
+
+static void BM_Dictionary_At(benchmark::State& state) {
+    HeapDictionary dictionary;
+    int64_t size = state.range(0);
+    fill(dictionary, size);
+    std::vector<TaggedValue> keys = shuffledKeys(size);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dictionary.find(keys[next]));
+        next = next + 1 < keys.size() ? next + 1 : 0;
+    }
+}
+BENCHMARK(BM_Dictionary_At)->RangeMultiplier(10)->Range(1 << 10, 10'000'000);
+
+static void BM_Dictionary_AtPut(benchmark::State& state) {
+    HeapDictionary dictionary;
+    int64_t size = state.range(0);
+    fill(dictionary, size);
+    std::vector<TaggedValue> keys = shuffledKeys(size);
+    size_t next = 0;
+    for (auto _ : state) {
+        dictionary.atPut(keys[next], keys[next]);
+        next = next + 1 < keys.size() ? next + 1 : 0;
+    }
+}
+BENCHMARK(BM_Dictionary_AtPut)->RangeMultiplier(10)->Range(1 << 10, 10'000'000);
+
+static void BM_LinearProbe_At(benchmark::State& state) {
+    int64_t size = state.range(0);
+    LinearProbeTable table(static_cast<size_t>(size));
+    fill(table, size);
+    std::vector<TaggedValue> keys = shuffledKeys(size);
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.find(keys[next]));
+        next = next + 1 < keys.size() ? next + 1 : 0;
+    }
+}
+BENCHMARK(BM_LinearProbe_At)->RangeMultiplier(10)->Range(1 << 10, 10'000'000);
+
+static void BM_LinearProbe_AtPut(benchmark::State& state) {
+    int64_t size = state.range(0);
+    LinearProbeTable table(static_cast<size_t>(size));
+    fill(table, size);
+    std::vector<TaggedValue> keys = shuffledKeys(size);
+    size_t next = 0;
+    for (auto _ : state) {
+        table.atPut(keys[next], keys[next]);
+        next = next + 1 < keys.size() ? next + 1 : 0;
+    }
+}
+BENCHMARK(BM_LinearProbe_AtPut)->RangeMultiplier(10)->Range(1 << 10, 10'000'000);
+
+// Fills an empty table, so every growth on the way to size entries is included
+// (items/sec is inserts/sec)
+template <typename Table>
+void fillFromEmpty(benchmark::State& state) {
+    int64_t size = state.range(0);
+    std::vector<TaggedValue> keys = shuffledKeys(size);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto table = std::make_unique<Table>();
+        state.ResumeTiming();
+        for (TaggedValue key : keys) {
+            table->atPut(key, key);
+        }
+        state.PauseTiming();
+        table.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_Dictionary_Insert(benchmark::State& state) {
+    fillFromEmpty<HeapDictionary>(state);
+}
+BENCHMARK(BM_Dictionary_Insert)->RangeMultiplier(10)->Range(1 << 10, 10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_LinearProbe_Insert(benchmark::State& state) {
+    fillFromEmpty<LinearProbeTable>(state);
+}
+BENCHMARK(BM_LinearProbe_Insert)->RangeMultiplier(10)->Range(1 << 10, 10'000'000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,49 @@
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+
+// ============================================================================
+// Exceptions: signal-to-handler round trips and the cost of protected code
+// ============================================================================
+
+namespace {
+
+constexpr int64_t ROUNDS = 1000;
+
+void compileExceptionWorkloads(VM& vm) {
+    vm.compile("Object", "raise: n n = 0 ifTrue: [^Error new signal]. ^(self raise: n - 1) + 1");
+    vm.compile("Object", "catch: n ^[self raise: n] on: Error do: [:e | 0]");
+    vm.compile("Object", "plain: n | sum | sum := 0. 1 to: n do: [:i | sum := sum + i]. ^sum");
+    vm.compile("Object",
+               "handled: n | sum | sum := 0. 1 to: n do: [:i | [sum := sum + i] on: Error do: [:e | 0]]. ^sum");
+    vm.compile("Object", "ensured: n | sum | sum := 0. 1 to: n do: [:i | [sum := sum + i] ensure: [0]]. ^sum");
+}
+
+} // namespace
+
+// Error new signal from range(0) frames above its handler; items are signals caught
+static void BM_Exception_SignalAndCatch(benchmark::State& state) {
+    VM vm;
+    compileExceptionWorkloads(vm);
+    TaggedValue depth = TaggedValue::fromSmallInteger(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(vm.send(TaggedValue::nil(), "catch:", {depth}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Exception_SignalAndCatch)->Arg(1)->Arg(10)->Arg(100);
+
+// A loop body left bare (arg 0), inside on:do: (arg 1) or inside ensure: (arg 2) when
+// nothing signals; items are loop iterations
+static void BM_Exception_ProtectedLoop(benchmark::State& state) {
+    static const char* const selectors[] = {"plain:", "handled:", "ensured:"};
+    VM vm;
+    compileExceptionWorkloads(vm);
+    const char* selector = selectors[state.range(0)];
+    TaggedValue rounds = TaggedValue::fromSmallInteger(ROUNDS);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(vm.send(TaggedValue::nil(), selector, {rounds}));
+    }
+    state.SetItemsProcessed(state.iterations() * ROUNDS);
+}
+BENCHMARK(BM_Exception_ProtectedLoop)->Arg(0)->Arg(1)->Arg(2);
@@ -0,0 +1,236 @@
+#include "bytecode_test_helpers.hpp"
+#include "../src/assembler.hpp"
+#include "../src/classes/compiled_method.hpp"
+#include "../src/runtime/array.hpp"
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Interpreter: single step and the dispatch loop, per opcode
+// ============================================================================
+
+using namespace test_helpers;
+
+namespace {
+
+// One row per implemented opcode, and per kind of block for CREATE_BLOCK and
+// EXECUTE_BLOCK. Each row runs a straight-line method that repeats a short unit built
+// around its opcode; where the opcode alone would leave the stack unbalanced the unit
+// pairs it with POP or a push, and the row's ns/bytecode covers both.
+struct OpcodeCase {
+    const char* name;
+    std::function<void(VM&, Assembler&)> unit;
+};
+
+// Receiver of every benchmark method: slot holds a SmallInteger, block a clean block
+void defineBench(VM& vm) {
+    vm.defineClass("Bench", "Object", {"slot", "block"});
+    vm.compile("Bench", "setUp slot := 42. block := [nil]");
+    vm.compile("Bench", "noop ^self");
+    vm.compile("Bench", "captured: x ^[x]");
+}
+
+TaggedValue selector(VM& vm, const char* name) {
+    return vm.symbols().intern(name);
+}
+
+// Method of the block in Bench>>captured:, which copies one value
+TaggedValue capturedBlockMethod(VM& vm) {
+    TaggedValue method = vm.interpreter().lookup(vm.classIndexNamed("Bench"), selector(vm, "captured:"));
+    ObjectHeader* literals = ObjectHeader::fromTaggedValue(st::mirrorOf<st::CompiledMethod>(method)->getLiterals());
+    for (uint32_t i = 0; i < literals->size(); i++) {
+        if (ClassTable::classIndexOf(literals->slots()[i]) == vm.kernel().compiledMethod) {
+            return literals->slots()[i];
+        }
+    }
+    return TaggedValue::nil();
+}
+
+// Temporaries of every benchmark method: 0 is free, 1 and 2 hold a stack block's method
+// and copied value, 3 a temp vector of one slot, 4 that stack block
+constexpr uint32_t STACK_BLOCK_RECORD = 1;
+constexpr uint32_t TEMP_VECTOR = 3;
+constexpr uint32_t STACK_BLOCK = 4;
+constexpr uint32_t TEMPS = 5;
+
+const std::vector<OpcodeCase>& opcodeCases() {
+    static const std::vector<OpcodeCase> cases = {
+        {"PUSH_LITERAL", [](VM&, Assembler& a) { a.pushLiteral(TaggedValue::fromSmallInteger(42)); a.pop(); }},
+        {"PUSH_INSTANCE_VARIABLE", [](VM&, Assembler& a) { a.pushInstanceVariable(0); a.pop(); }},
+        {"PUSH_TEMPORARY_VARIABLE", [](VM&, Assembler& a) { a.pushTemporary(0); a.pop(); }},
+        {"PUSH_SELF", [](VM&, Assembler& a) { a.pushSelf(); a.pop(); }},
+        // The stored value stays on the stack for the next store
+        {"STORE_INSTANCE_VARIABLE", [](VM&, Assembler& a) { a.storeInstanceVariable(0); }},
+        {"STORE_TEMPORARY_VARIABLE", [](VM&, Assembler& a) { a.storeTemporary(0); }},
+        // A primitive send: SmallInteger>>+ answers without activating a method
+        {"SEND_MESSAGE",
+         [](VM& vm, Assembler& a) {
+             a.pushInstanceVariable(0);
+             a.pushLiteral(TaggedValue::fromSmallInteger(1));
+             a.send(selector(vm, "+"), 1);
+             a.pop();
+         }},
+        // A full activation of noop, whose own PUSH_SELF and return are counted too
+        {"RETURN_STACK_TOP",
+         [](VM& vm, Assembler& a) {
+             a.pushSelf();
+             a.send(selector(vm, "noop"), 0);
+             a.pop();
+         }},
+        {"JUMP",
+         [](VM&, Assembler& a) {
+             Assembler::Label next = a.newLabel();
+             a.jump(next);
+             a.bind(next);
+         }},
+        {"JUMP_IF_TRUE",
+         [](VM&, Assembler& a) {
+             Assembler::Label next = a.newLabel();
+             a.pushLiteral(TaggedValue::trueValue());
+             a.jumpIfTrue(next);
+             a.bind(next);
+         }},
+        {"JUMP_IF_FALSE",
+         [](VM&, Assembler& a) {
+             Assembler::Label next = a.newLabel();
+             a.pushLiteral(TaggedValue::falseValue());
+             a.jumpIfFalse(next);
+             a.bind(next);
+         }},
+        {"POP", [](VM&, Assembler& a) { a.duplicate(); a.pop(); }},
+        {"DUPLICATE", [](VM&, Assembler& a) { a.duplicate(); a.duplicate(); a.pop(); a.pop(); }},
+        // A block copying slot, on the heap or in the frame
+        {"CREATE_BLOCK",
+         [](VM& vm, Assembler& a) {
+             a.pushInstanceVariable(0);
+             a.createBlock(capturedBlockMethod(vm), 1, bytecode::NO_SLOT);
+             a.pop();
+         }},
+        {"CREATE_BLOCK/frame",
+         [](VM& vm, Assembler& a) {
+             a.pushInstanceVariable(0);
+             a.createBlock(capturedBlockMethod(vm), 1, STACK_BLOCK_RECORD);
+             a.pop();
+         }},
+        // value sent to a clean block: its method runs without a send
+        {"EXECUTE_BLOCK",
+         [](VM& vm, Assembler& a) {
+             a.pushInstanceVariable(1);
+             a.executeBlock(selector(vm, "value"), 0);
+             a.pop();
+         }},
+        // value sent to a stack block, whose copied value is moved into the activation
+        {"EXECUTE_BLOCK/frame",
+         [](VM& vm, Assembler& a) {
+             a.pushTemporary(STACK_BLOCK);
+             a.executeBlock(selector(vm, "value"), 0);
+             a.pop();
+         }},
+        {"PUSH_REMOTE_TEMPORARY", [](VM&, Assembler& a) { a.pushRemoteTemporary(0, TEMP_VECTOR); a.pop(); }},
+        {"STORE_REMOTE_TEMPORARY", [](VM&, Assembler& a) { a.storeRemoteTemporary(0, TEMP_VECTOR); }},
+        // Of a temporary that holds no stack block, as after the first one moved
+        {"PUSH_ESCAPING_TEMPORARY", [](VM&, Assembler& a) { a.pushEscapingTemporary(0); a.pop(); }},
+    };
+    return cases;
+}
+
+constexpr int UNITS_PER_METHOD = 1000;
+
+// Installs Bench>>run: UNITS_PER_METHOD copies of the case's unit between a push of
+// the slot (the value the stores and DUPLICATE work on) and ^self, after setting up
+// the temp vector and stack block
+void installRun(VM& vm, const OpcodeCase& c) {
+    Assembler assembler;
+    MemoryManager::ScopedRoots literals(vm.memory(), assembler.literals());
+    assembler.pushLiteral(vm.classes().classAt(vm.kernel().array));
+    assembler.pushLiteral(TaggedValue::fromSmallInteger(1));
+    assembler.send(selector(vm, "new:"), 1);
+    assembler.storeTemporary(TEMP_VECTOR);
+    assembler.pop();
+    assembler.pushInstanceVariable(0);
+    assembler.createBlock(capturedBlockMethod(vm), 1, STACK_BLOCK_RECORD);
+    assembler.storeTemporary(STACK_BLOCK);
+    assembler.pop();
+    assembler.pushInstanceVariable(0);
+    for (int i = 0; i < UNITS_PER_METHOD; i++) {
+        c.unit(vm, assembler);
+    }
+    assembler.pop();
+    assembler.pushSelf();
+    assembler.returnTop();
+    std::vector<TaggedValue> method = {vm.newMethod(assembler.bytecodes(), assembler.literals(), 0, TEMPS)};
+    MemoryManager::ScopedRoots rooted(vm.memory(), method);
+    vm.installMethod(vm.classIndexNamed("Bench"), selector(vm, "run"), method[0]);
+}
+
+// Bench>>run sent from C++ through VM::send, as the interpreter runs any method
+void BM_InterpreterLoop(benchmark::State& state, const OpcodeCase* c) {
+    VM vm;
+    defineBench(vm);
+    installRun(vm, *c);
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.classIndexNamed("Bench"))};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "setUp");
+
+    uint64_t bytecodes = vm.interpreter().bytecodesExecuted();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(vm.send(roots[0], "run"));
+    }
+    bytecodes = vm.interpreter().bytecodesExecuted() - bytecodes;
+    state.counters["bytecodes"] = benchmark::Counter(static_cast<double>(bytecodes), benchmark::Counter::kIsRate);
+    state.counters["ns/bytecode"] = benchmark::Counter(
+        static_cast<double>(bytecodes), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+// stepInstruction implements PUSH_LITERAL only, so this row has no siblings: a
+// straight-line method of PUSH_LITERALs stepped one instruction at a time
+std::vector<uint8_t> pushLiteralMethod() {
+    std::vector<uint8_t> bytecode;
+    for (int i = 0; i < UNITS_PER_METHOD; i++) {
+        std::vector<uint8_t> instruction = encodeInstruction(0, {0});
+        bytecode.insert(bytecode.end(), instruction.begin(), instruction.end());
+    }
+    return bytecode;
+}
+
+void rewind(st::Context* context) {
+    context->setInstructionPointer(TaggedValue::fromSmallInteger(0));
+    runtime::Array* stack = runtime::Array::fromTaggedValue(context->stack());
+    while (!stack->empty()) {
+        stack->pop();
+    }
+}
+
+// Time of one stepInstruction call; rewinding is excluded from the measurement
+void BM_StepInstruction(benchmark::State& state) {
+    auto method = createCompiledMethod(pushLiteralMethod(), {TaggedValue::fromSmallInteger(42)});
+    auto context = createContext(method.get(), TaggedValue::nil());
+    int executed = 0;
+    for (auto _ : state) {
+        if (executed == UNITS_PER_METHOD) {
+            state.PauseTiming();
+            rewind(context.get());
+            executed = 0;
+            state.ResumeTiming();
+        }
+        benchmark::DoNotOptimize(stepInstruction(context.get()));
+        executed++;
+    }
+    state.counters["bytecodes"] =
+        benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+const bool registered = [] {
+    benchmark::RegisterBenchmark("BM_StepInstruction/PUSH_LITERAL", BM_StepInstruction);
+    for (const OpcodeCase& c : opcodeCases()) {
+        benchmark::RegisterBenchmark((std::string("BM_InterpreterLoop/") + c.name).c_str(), BM_InterpreterLoop,
+                                     &c);
+    }
+    return true;
+}();
+
+} // namespace
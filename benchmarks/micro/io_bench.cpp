@@ -0,0 +1,71 @@
+#include "../src/histogram.hpp"
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// I/O: request/response over a loopback socket
+// ============================================================================
+
+namespace {
+
+// An echo server Process and a client connection to it, in one VM
+void compileEcho(VM& vm) {
+    vm.defineClass("EchoBench", "Object", {"listener", "connection", "reply"});
+    vm.compile("EchoBench",
+               "setUp: size\n"
+               "    listener := Socket new listenOn: 0.\n"
+               "    self fork: #serve at: 4.\n"
+               "    connection := Socket new connectTo: '127.0.0.1' port: listener port.\n"
+               "    reply := ByteArray new: size");
+    vm.compile("EchoBench",
+               "serve\n"
+               "    | socket buffer n |\n"
+               "    socket := listener accept.\n"
+               "    buffer := ByteArray new: 65536.\n"
+               "    n := socket read: buffer.\n"
+               "    [n > 0] whileTrue: [socket write: buffer startingAt: 1 count: n. n := socket read: buffer].\n"
+               "    socket close");
+    vm.compile("EchoBench",
+               "request: aMessage\n"
+               "    | got |\n"
+               "    connection write: aMessage.\n"
+               "    got := 0.\n"
+               "    [got < aMessage size] whileTrue: [\n"
+               "        got := got + (connection read: reply startingAt: got + 1 count: aMessage size - got)].\n"
+               "    ^got");
+    vm.compile("EchoBench", "tearDown connection close");
+}
+
+} // namespace
+
+// One request per iteration: the caller's Process writes a message of range(0) bytes
+// and waits for the echo while the server's Process reads and writes it back, both
+// parked in the scheduler's epoll loop whenever their socket is not ready. Items are
+// requests; p50_ns and p99_ns are per-request latencies.
+static void BM_IO_LoopbackEcho(benchmark::State& state) {
+    VM vm;
+    compileEcho(vm);
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.classIndexNamed("EchoBench"))};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "setUp:", {TaggedValue::fromSmallInteger(state.range(0))});
+    roots.push_back(vm.newString(std::string(static_cast<size_t>(state.range(0)), 'x')));
+
+    Histogram latency;
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(vm.send(roots[0], "request:", {roots[1]}));
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+    vm.send(roots[0], "tearDown");
+    vm.interpreter().runProcesses();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+    state.counters["p50_ns"] = static_cast<double>(latency.percentile(50));
+    state.counters["p99_ns"] = static_cast<double>(latency.percentile(99));
+}
+BENCHMARK(BM_IO_LoopbackEcho)->Arg(32)->Arg(4096)->UseRealTime();
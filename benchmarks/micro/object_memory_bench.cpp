@@ -0,0 +1,116 @@
+#include "../src/classes/array.hpp"
+#include "../src/classes/byte_array.hpp"
+#include "../src/memory_manager.hpp"
+#include "../src/runtime/array.hpp"
+#include "../src/runtime/byte_array.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// Array / ByteArray access
+// ============================================================================
+
+static void BM_RuntimeArray_Get(benchmark::State& state) {
+    runtime::Array array(static_cast<size_t>(1024));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(array.get(i++ & 1023));
+    }
+}
+BENCHMARK(BM_RuntimeArray_Get);
+
+static void BM_RuntimeByteArray_Get(benchmark::State& state) {
+    runtime::ByteArray bytes(std::vector<uint8_t>(1024, 7));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bytes.get(i++ & 1023));
+    }
+}
+BENCHMARK(BM_RuntimeByteArray_Get);
+
+static void BM_HeapArray_At(benchmark::State& state) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1024);
+    st::Array* array = st::mirrorOf<st::Array>(object);
+    uint32_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(array->at(i++ & 1023));
+    }
+}
+BENCHMARK(BM_HeapArray_At);
+
+static void BM_HeapArray_StorePointer(benchmark::State& state) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1024);
+    uint32_t i = 0;
+    for (auto _ : state) {
+        memory.storePointer(object, i & 1023, TaggedValue::fromSmallInteger(i));
+        i++;
+    }
+}
+BENCHMARK(BM_HeapArray_StorePointer);
+
+static void BM_HeapByteArray_At(benchmark::State& state) {
+    MemoryManager memory;
+    st::ByteArray* bytes =
+        st::mirrorOf<st::ByteArray>(memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 1024));
+    uint32_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(bytes->at(i++ & 1023));
+    }
+}
+BENCHMARK(BM_HeapByteArray_At);
+
+// ============================================================================
+// Allocation
+// ============================================================================
+
+// Small objects: nursery bump allocation, including the amortized scavenges
+static void BM_AllocateSlots(benchmark::State& state) {
+    MemoryManager memory;
+    uint32_t slots = static_cast<uint32_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(memory.allocateSlots(ObjectHeader::TYPE_ARRAY, slots));
+    }
+    state.counters["minorGCs"] = static_cast<double>(memory.minorCollections());
+}
+BENCHMARK(BM_AllocateSlots)->Arg(2)->Arg(16)->Arg(200);
+
+static void BM_AllocateBytes(benchmark::State& state) {
+    MemoryManager memory;
+    uint32_t bytes = static_cast<uint32_t>(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, bytes));
+    }
+}
+BENCHMARK(BM_AllocateBytes)->Arg(8)->Arg(256);
+
+// Large-object space: one mapping per object, swept by the major collections it triggers
+static void BM_AllocateLarge(benchmark::State& state) {
+    MemoryManager memory;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 64 * 1024));
+    }
+}
+BENCHMARK(BM_AllocateLarge);
+
+static void BM_MinorCollection(benchmark::State& state) {
+    MemoryManager memory;
+    std::vector<TaggedValue> live(static_cast<size_t>(state.range(0)));
+    memory.addRootProvider([&live](const MemoryManager::RootVisitor& visit) {
+        for (TaggedValue& value : live) {
+            visit(value);
+        }
+    });
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (TaggedValue& value : live) {
+            value = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 4)->toTaggedValue();
+        }
+        state.ResumeTiming();
+        memory.minorCollection();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MinorCollection)->Arg(1000)->Arg(10000);
@@ -0,0 +1,62 @@
+#include "../src/scheduler.hpp"
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// Process switching: Process yield round robin and Semaphore ping-pong
+// ============================================================================
+
+namespace {
+
+constexpr int64_t ROUNDS = 1000;
+
+void compileProcessWorkloads(VM& vm) {
+    vm.compile("Object", "yieldTimes: n 1 to: n do: [:i | Process yield]");
+    vm.compile("Object", "pingTimes: n to: mine from: theirs 1 to: n do: [:i | theirs signal. mine wait]");
+    vm.compile("Object", "pongTimes: n to: mine from: theirs 1 to: n do: [:i | mine wait. theirs signal]");
+}
+
+void forkWith(VM& vm, const char* selector, std::vector<TaggedValue> arguments) {
+    TaggedValue array = vm.newArray(std::move(arguments));
+    vm.send(TaggedValue::nil(), "fork:withArguments:at:",
+            {vm.symbols().intern(selector), array, TaggedValue::fromSmallInteger(Scheduler::USER_PRIORITY)});
+}
+
+} // namespace
+
+// Processes yielding to each other; items are switches
+static void BM_Process_Yield(benchmark::State& state) {
+    VM vm;
+    compileProcessWorkloads(vm);
+    int64_t processes = state.range(0);
+    Scheduler& scheduler = vm.interpreter().scheduler();
+    uint64_t switches = scheduler.switches();
+    for (auto _ : state) {
+        for (int64_t i = 0; i < processes; i++) {
+            forkWith(vm, "yieldTimes:", {TaggedValue::fromSmallInteger(ROUNDS)});
+        }
+        vm.interpreter().runProcesses();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(scheduler.switches() - switches));
+}
+BENCHMARK(BM_Process_Yield)->Arg(2)->Arg(100);
+
+// Two Processes handing control back and forth through a pair of Semaphores; items are
+// round trips (two signals, two waits, two switches)
+static void BM_Semaphore_PingPong(benchmark::State& state) {
+    VM vm;
+    compileProcessWorkloads(vm);
+    std::vector<TaggedValue> semaphores = {vm.instantiate(vm.kernel().semaphore),
+                                           vm.instantiate(vm.kernel().semaphore)};
+    MemoryManager::ScopedRoots roots(vm.memory(), semaphores);
+    TaggedValue rounds = TaggedValue::fromSmallInteger(ROUNDS);
+    for (auto _ : state) {
+        forkWith(vm, "pingTimes:to:from:", {rounds, semaphores[0], semaphores[1]});
+        forkWith(vm, "pongTimes:to:from:", {rounds, semaphores[1], semaphores[0]});
+        vm.interpreter().runProcesses();
+    }
+    state.SetItemsProcessed(state.iterations() * ROUNDS);
+}
+BENCHMARK(BM_Semaphore_PingPong);
@@ -0,0 +1,62 @@
+#include "../src/histogram.hpp"
+#include "../src/safepoint.hpp"
+#include "../src/vm.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Safepoints: stop-the-world round trips against a busy interpreter
+// ============================================================================
+
+namespace {
+
+void compileSpinner(VM& vm) {
+    vm.defineClass("Spinner", "Object", {"done"});
+    vm.compile("Spinner", "setUp done := false");
+    vm.compile("Spinner", "loop [done] whileFalse");
+    vm.compile("Spinner",
+               "recurse: n done ifTrue: [^0]. n < 2 ifTrue: [^1].\n"
+               "    ^(self recurse: n - 1) + (self recurse: n - 2)");
+}
+
+} // namespace
+
+// Another thread runs a loop that polls only at its backward jump (arg 0) or a
+// recursion that polls only at method entries (arg 1); each iteration stops it and lets
+// it go once it runs again. Items are stops; counters are time to safepoint percentiles.
+static void BM_Safepoint_StopBusyInterpreter(benchmark::State& state) {
+    VM vm;
+    compileSpinner(vm);
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.classIndexNamed("Spinner"))};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "setUp");
+    std::thread worker([&vm, &roots, recurse = state.range(0) == 1] {
+        if (recurse) {
+            vm.send(roots[0], "recurse:", {TaggedValue::fromSmallInteger(100)});
+        } else {
+            vm.send(roots[0], "loop");
+        }
+    });
+
+    Histogram timeToSafepoint;
+    const Safepoints::Participant& running = vm.interpreter().safepoint();
+    for (auto _ : state) {
+        // Until it runs again; a Stop finding it still parked would cost nothing
+        while (running.state.load() != Safepoints::Participant::RUNNING) {
+            std::this_thread::yield();
+        }
+        Safepoints::Stop stop(vm.interpreter());
+        timeToSafepoint.record(static_cast<uint64_t>(stop.timeToSafepoint().count()));
+    }
+    {
+        Safepoints::Stop stop(vm.interpreter());
+        vm.memory().storePointer(ObjectHeader::fromTaggedValue(roots[0]), 0, TaggedValue::trueValue());
+    }
+    worker.join();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["ttsp_p50_ns"] = static_cast<double>(timeToSafepoint.percentile(50));
+    state.counters["ttsp_p99_ns"] = static_cast<double>(timeToSafepoint.percentile(99));
+}
+BENCHMARK(BM_Safepoint_StopBusyInterpreter)->Arg(0)->Arg(1)->UseRealTime();
@@ -0,0 +1,55 @@
+#include "../src/tagged_value.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+
+// ============================================================================
+// TaggedValue encode / decode / type checks
+// ============================================================================
+
+static void BM_TaggedValue_FromSmallInteger(benchmark::State& state) {
+    int64_t n = 0;
+    for (auto _ : state) {
+        TaggedValue value = TaggedValue::fromSmallInteger(n++);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_TaggedValue_FromSmallInteger);
+
+static void BM_TaggedValue_ToSmallInteger(benchmark::State& state) {
+    TaggedValue value = TaggedValue::fromSmallInteger(123456789);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(value);
+        int64_t n = value.toSmallInteger();
+        benchmark::DoNotOptimize(n);
+    }
+}
+BENCHMARK(BM_TaggedValue_ToSmallInteger);
+
+static void BM_TaggedValue_PointerRoundTrip(benchmark::State& state) {
+    alignas(8) uint64_t cell = 0;
+    for (auto _ : state) {
+        TaggedValue value = TaggedValue::fromPointer(&cell);
+        benchmark::DoNotOptimize(value);
+        void* pointer = value.toPointer();
+        benchmark::DoNotOptimize(pointer);
+    }
+}
+BENCHMARK(BM_TaggedValue_PointerRoundTrip);
+
+// Mixed values so the branch predictor cannot learn a single answer
+static void BM_TaggedValue_TypeChecks(benchmark::State& state) {
+    alignas(8) static uint64_t cell = 0;
+    std::vector<TaggedValue> values = {
+        TaggedValue::fromSmallInteger(7), TaggedValue::nil(), TaggedValue::fromPointer(&cell),
+        TaggedValue::trueValue(), TaggedValue::fromSmallInteger(-3), TaggedValue::falseValue(),
+        TaggedValue::fromPointer(&cell), TaggedValue::fromSmallInteger(0),
+    };
+    size_t i = 0;
+    for (auto _ : state) {
+        TaggedValue value = values[i++ & 7];
+        int kind = value.isSmallInteger() ? 0 : value.isPointer() ? 1 : value.isNil() ? 2 : 3;
+        benchmark::DoNotOptimize(kind);
+    }
+}
+BENCHMARK(BM_TaggedValue_TypeChecks);
@@ -0,0 +1,64 @@
+#include "allocation_profiler.hpp"
+#include "bytecode.hpp"
+#include "classes/compiled_method.hpp"
+#include "vm.hpp"
+#include <algorithm>
+
+AllocationProfiler::AllocationProfiler(VM& vm, uint32_t sampleEvery)
+    : vm_(vm), sampleEvery_(std::max<uint32_t>(sampleEvery, 1)), untilSample_(sampleEvery_) {}
+
+void AllocationProfiler::sample(ObjectHeader* object) {
+    Interpreter& interpreter = vm_.interpreter();
+    uint64_t key = 0;
+    uint32_t ip = 0;
+    TaggedValue method = TaggedValue::nil();
+    if (interpreter.frameDepth() > 0) {
+        size_t innermost = interpreter.frameDepth() - 1;
+        method = interpreter.frameMethod(innermost);
+        key = st::CompiledMethod::stableKey(method);
+        uint32_t resumeIp = interpreter.frameIp(innermost);
+        uint32_t sendLength = bytecode::instructionLength(bytecode::SEND_MESSAGE);
+        ip = resumeIp >= sendLength ? resumeIp - sendLength : 0;
+    }
+
+    AllocationSite& site = sites_[{key, ip}];
+    if (site.method.empty()) {
+        site.method =
+            method.isNil() ? "(outside Smalltalk)" : st::mirrorOf<st::CompiledMethod>(method)->qualifiedName();
+        site.ip = ip;
+    }
+    site.samples++;
+    site.bytes += object->totalBytes();
+}
+
+std::vector<ClassTally> AllocationProfiler::byClass() const {
+    std::vector<ClassTally> result;
+    for (uint32_t index = 0; index < classes_.size(); index++) {
+        if (classes_[index].allocations != 0) {
+            result.push_back(ClassTally{index, vm_.className(index), classes_[index].allocations,
+                                        classes_[index].bytes});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const ClassTally& a, const ClassTally& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.classIndex < b.classIndex;
+    });
+    return result;
+}
+
+std::vector<AllocationSite> AllocationProfiler::bySite() const {
+    std::vector<AllocationSite> result;
+    result.reserve(sites_.size());
+    for (const auto& entry : sites_) {
+        result.push_back(entry.second);
+    }
+    std::sort(result.begin(), result.end(), [](const AllocationSite& a, const AllocationSite& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.method < b.method;
+    });
+    return result;
+}
+
+void AllocationProfiler::reset() {
+    classes_.clear();
+    sites_.clear();
+    untilSample_ = sampleEvery_;
+}
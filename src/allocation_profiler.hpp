@@ -0,0 +1,66 @@
+#pragma once
+
+#include "object_header.hpp"
+#include "vm_statistics.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+class VM;
+
+/**
+ * AllocationProfiler - attributes object memory allocations to classes and send sites
+ *
+ * Installed as the MemoryManager's allocation hook by VM::startAllocationProfiling().
+ * Every allocation is counted against its class index, which is two increments.
+ * Attributing one to its site means reading the interpreter's innermost frame and a
+ * map update, so only every sampleEvery-th allocation gets a site. A site is the
+ * method and send instruction that allocated: primitives allocate on behalf of the
+ * send that invoked them and do not get a frame of their own.
+ */
+class AllocationProfiler {
+public:
+    static constexpr uint32_t DEFAULT_SAMPLE_EVERY = 64;
+
+    AllocationProfiler(VM& vm, uint32_t sampleEvery = DEFAULT_SAMPLE_EVERY);
+
+    AllocationProfiler(const AllocationProfiler&) = delete;
+    AllocationProfiler& operator=(const AllocationProfiler&) = delete;
+
+    // The allocation hook
+    void allocated(ObjectHeader* object) {
+        uint32_t classIndex = object->classIndex();
+        if (classIndex >= classes_.size()) {
+            classes_.resize(classIndex + 1);
+        }
+        classes_[classIndex].allocations++;
+        classes_[classIndex].bytes += object->totalBytes();
+        if (--untilSample_ == 0) {
+            untilSample_ = sampleEvery_;
+            sample(object);
+        }
+    }
+
+    uint32_t sampleEvery() const { return sampleEvery_; }
+    // Classes with at least one allocation, most bytes first
+    std::vector<ClassTally> byClass() const;
+    // Sampled sites, most bytes first
+    std::vector<AllocationSite> bySite() const;
+    void reset();
+
+private:
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    void sample(ObjectHeader* object);
+
+    VM& vm_;
+    uint32_t sampleEvery_;
+    uint32_t untilSample_;
+    std::vector<Counts> classes_;  // By class index
+    std::map<std::pair<uint64_t, uint32_t>, AllocationSite> sites_;  // By method key and ip
+};
@@ -0,0 +1,143 @@
+#include "assembler.hpp"
+#include <stdexcept>
+
+Assembler::Label Assembler::newLabel() {
+    labels_.push_back(UNBOUND);
+    return labels_.size() - 1;
+}
+
+void Assembler::bind(Label label) {
+    labels_.at(label) = bytes_.size();
+}
+
+uint32_t Assembler::literalIndex(TaggedValue literal) {
+    for (size_t i = 0; i < literals_.size(); i++) {
+        if (literals_[i] == literal) {
+            return static_cast<uint32_t>(i);
+        }
+    }
+    literals_.push_back(literal);
+    return static_cast<uint32_t>(literals_.size() - 1);
+}
+
+void Assembler::emit(bytecode::Opcode opcode) {
+    bytes_.push_back(opcode);
+}
+
+void Assembler::emitOperand(uint32_t operand) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        bytes_.push_back(static_cast<uint8_t>((operand >> shift) & 0xFF));
+    }
+}
+
+void Assembler::emitJump(bytecode::Opcode opcode, Label target) {
+    emit(opcode);
+    fixups_.emplace_back(bytes_.size(), target);
+    emitOperand(0);
+}
+
+void Assembler::pushLiteral(TaggedValue literal) {
+    emit(bytecode::PUSH_LITERAL);
+    emitOperand(literalIndex(literal));
+}
+
+void Assembler::pushInstanceVariable(uint32_t index) {
+    emit(bytecode::PUSH_INSTANCE_VARIABLE);
+    emitOperand(index);
+}
+
+void Assembler::pushTemporary(uint32_t index) {
+    emit(bytecode::PUSH_TEMPORARY_VARIABLE);
+    emitOperand(index);
+}
+
+void Assembler::pushSelf() {
+    emit(bytecode::PUSH_SELF);
+}
+
+void Assembler::storeInstanceVariable(uint32_t index) {
+    emit(bytecode::STORE_INSTANCE_VARIABLE);
+    emitOperand(index);
+}
+
+void Assembler::storeTemporary(uint32_t index) {
+    emit(bytecode::STORE_TEMPORARY_VARIABLE);
+    emitOperand(index);
+}
+
+void Assembler::send(TaggedValue selector, uint32_t argCount) {
+    uint32_t index = literalIndex(selector);
+    emit(bytecode::SEND_MESSAGE);
+    emitOperand(index);
+    emitOperand(argCount);
+}
+
+void Assembler::executeBlock(TaggedValue selector, uint32_t argCount) {
+    uint32_t index = literalIndex(selector);
+    emit(bytecode::EXECUTE_BLOCK);
+    emitOperand(index);
+    emitOperand(argCount);
+}
+
+void Assembler::createBlock(TaggedValue method, uint32_t copiedCount, uint32_t slot) {
+    uint32_t index = literalIndex(method);
+    emit(bytecode::CREATE_BLOCK);
+    emitOperand(index);
+    emitOperand(copiedCount);
+    emitOperand(slot);
+}
+
+void Assembler::pushRemoteTemporary(uint32_t index, uint32_t vector) {
+    emit(bytecode::PUSH_REMOTE_TEMPORARY);
+    emitOperand(index);
+    emitOperand(vector);
+}
+
+void Assembler::storeRemoteTemporary(uint32_t index, uint32_t vector) {
+    emit(bytecode::STORE_REMOTE_TEMPORARY);
+    emitOperand(index);
+    emitOperand(vector);
+}
+
+void Assembler::pushEscapingTemporary(uint32_t index) {
+    emit(bytecode::PUSH_ESCAPING_TEMPORARY);
+    emitOperand(index);
+}
+
+void Assembler::returnTop() {
+    emit(bytecode::RETURN_STACK_TOP);
+}
+
+void Assembler::jump(Label target) {
+    emitJump(bytecode::JUMP, target);
+}
+
+void Assembler::jumpIfTrue(Label target) {
+    emitJump(bytecode::JUMP_IF_TRUE, target);
+}
+
+void Assembler::jumpIfFalse(Label target) {
+    emitJump(bytecode::JUMP_IF_FALSE, target);
+}
+
+void Assembler::pop() {
+    emit(bytecode::POP);
+}
+
+void Assembler::duplicate() {
+    emit(bytecode::DUPLICATE);
+}
+
+std::vector<uint8_t> Assembler::bytecodes() const {
+    std::vector<uint8_t> result = bytes_;
+    for (const auto& fixup : fixups_) {
+        size_t target = labels_.at(fixup.second);
+        if (target == UNBOUND) {
+            throw std::logic_error("Jump to unbound label");
+        }
+        for (int i = 0; i < 4; i++) {
+            result[fixup.first + i] = static_cast<uint8_t>((target >> (8 * i)) & 0xFF);
+        }
+    }
+    return result;
+}
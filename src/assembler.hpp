@@ -0,0 +1,66 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Assembler - builds the bytecodes and literal frame of one CompiledMethod
+ *
+ * Literals are deduplicated by identity. Jumps take labels that may be bound before or
+ * after use; every label must be bound by the time bytecodes() is called.
+ *
+ * The literals are plain TaggedValues: while an assembler holds heap literals across
+ * allocations, keep literals() registered as roots (see MemoryManager::ScopedRoots).
+ */
+class Assembler {
+public:
+    using Label = size_t;
+
+    Label newLabel();
+    void bind(Label label);
+
+    uint32_t literalIndex(TaggedValue literal);
+
+    void pushLiteral(TaggedValue literal);
+    void pushInstanceVariable(uint32_t index);
+    void pushTemporary(uint32_t index);
+    void pushSelf();
+    void storeInstanceVariable(uint32_t index);
+    void storeTemporary(uint32_t index);
+    void send(TaggedValue selector, uint32_t argCount);
+    void executeBlock(TaggedValue selector, uint32_t argCount);
+    // slot is bytecode::NO_SLOT for a block on the heap
+    void createBlock(TaggedValue method, uint32_t copiedCount, uint32_t slot);
+    void pushRemoteTemporary(uint32_t index, uint32_t vector);
+    void storeRemoteTemporary(uint32_t index, uint32_t vector);
+    void pushEscapingTemporary(uint32_t index);
+    void returnTop();
+    void jump(Label target);
+    void jumpIfTrue(Label target);
+    void jumpIfFalse(Label target);
+    void pop();
+    void duplicate();
+
+    // Byte offset of the next instruction
+    size_t position() const { return bytes_.size(); }
+
+    // Finished code with every jump resolved. Throws std::logic_error for unbound labels.
+    std::vector<uint8_t> bytecodes() const;
+    std::vector<TaggedValue>& literals() { return literals_; }
+
+private:
+    void emit(bytecode::Opcode opcode);
+    void emitOperand(uint32_t operand);
+    void emitJump(bytecode::Opcode opcode, Label target);
+
+    static constexpr size_t UNBOUND = static_cast<size_t>(-1);
+
+    std::vector<uint8_t> bytes_;
+    std::vector<TaggedValue> literals_;
+    std::vector<size_t> labels_;                        // label -> offset, or UNBOUND
+    std::vector<std::pair<size_t, Label>> fixups_;      // operand offset -> label
+};
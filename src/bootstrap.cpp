@@ -0,0 +1,328 @@
+#include "vm.hpp"
+#include "classes/class.hpp"
+#include <utility>
+
+// ============================================================================
+// Kernel classes
+// ============================================================================
+
+void VM::bootstrap() {
+    // Object and Class are created before Class has an index: patch their headers after.
+    kernel_.object = createClass("Object", ClassTable::INVALID_INDEX, {}, ObjectHeader::TYPE_OBJECT);
+    kernel_.classClass = createClass("Class", kernel_.object, {"superclass", "methods", "format", "name"},
+                                     ObjectHeader::TYPE_CLASS);
+    for (uint32_t index : {kernel_.object, kernel_.classClass}) {
+        ObjectHeader::fromTaggedValue(classes_.classAt(index))->setClassIndex(kernel_.classClass);
+    }
+
+    kernel_.undefinedObject = createClass("UndefinedObject", kernel_.object, {}, ObjectHeader::TYPE_OBJECT,
+                                          ClassTable::UNDEFINED_OBJECT_INDEX);
+    kernel_.boolean = createClass("Boolean", kernel_.object, {}, ObjectHeader::TYPE_OBJECT);
+    kernel_.trueClass = createClass("True", kernel_.boolean, {}, ObjectHeader::TYPE_OBJECT,
+                                    ClassTable::TRUE_INDEX);
+    kernel_.falseClass = createClass("False", kernel_.boolean, {}, ObjectHeader::TYPE_OBJECT,
+                                     ClassTable::FALSE_INDEX);
+    kernel_.number = createClass("Number", kernel_.object, {}, ObjectHeader::TYPE_OBJECT);
+    kernel_.smallInteger = createClass("SmallInteger", kernel_.number, {}, ObjectHeader::TYPE_IMMEDIATE,
+                                       ClassTable::SMALL_INTEGER_INDEX);
+    kernel_.floatClass = createClass("Float", kernel_.number, {}, ObjectHeader::TYPE_IMMEDIATE,
+                                     ClassTable::FLOAT_INDEX);
+
+    kernel_.arrayedCollection = createClass("ArrayedCollection", kernel_.object, {}, ObjectHeader::TYPE_OBJECT);
+    kernel_.array = createClass("Array", kernel_.arrayedCollection, {}, ObjectHeader::TYPE_ARRAY);
+    kernel_.byteArray = createClass("ByteArray", kernel_.arrayedCollection, {}, ObjectHeader::TYPE_BYTE_ARRAY);
+    kernel_.string = createClass("String", kernel_.arrayedCollection, {}, ObjectHeader::TYPE_BYTE_ARRAY);
+    kernel_.symbol = createClass("Symbol", kernel_.string, {}, ObjectHeader::TYPE_SYMBOL);
+
+    kernel_.compiledMethod = createClass("CompiledMethod", kernel_.object,
+                                         {"bytes", "literals", "numArgs", "numTemps", "primitiveNumber",
+                                          "selector", "methodClass", "handlers"},
+                                         ObjectHeader::TYPE_METHOD);
+    kernel_.dictionary = createClass("Dictionary", kernel_.object,
+                                     {"tally", "growthLeft", "control", "slots", "oldControl", "oldSlots", "migrated"},
+                                     ObjectHeader::TYPE_OBJECT);
+    kernel_.process = createClass("Process", kernel_.object, {"nextLink", "myList", "priority", "stackIndex"},
+                                  ObjectHeader::TYPE_OBJECT);
+    kernel_.semaphore = createClass("Semaphore", kernel_.object, {"firstLink", "lastLink", "excessSignals"},
+                                    ObjectHeader::TYPE_OBJECT);
+    kernel_.exception = createClass("Exception", kernel_.object, {"messageText"}, ObjectHeader::TYPE_OBJECT);
+    kernel_.error = createClass("Error", kernel_.exception, {}, ObjectHeader::TYPE_OBJECT);
+    // Carries a VM error (a failed primitive, doesNotUnderstand...) through the ensure:
+    // blocks it unwinds; no on:do: handler catches it
+    kernel_.vmError = createClass("VMError", kernel_.exception, {}, ObjectHeader::TYPE_OBJECT);
+    // Copied values follow the named slots (see block_closure.hpp)
+    kernel_.blockClosure = createClass("BlockClosure", kernel_.object, {"method", "numArgs", "receiver"},
+                                       ObjectHeader::TYPE_OBJECT);
+    kernel_.ioHandle = createClass("IOHandle", kernel_.object, {"handle", "readable", "writable"},
+                                   ObjectHeader::TYPE_OBJECT);
+    createClass("File", kernel_.ioHandle, {}, ObjectHeader::TYPE_OBJECT);
+    createClass("Socket", kernel_.ioHandle, {}, ObjectHeader::TYPE_OBJECT);
+
+    // Symbol exists now, so the classes created so far can get their names.
+    symbols_ = std::make_unique<SymbolTable>(memory_, kernel_.symbol);
+    for (const auto& entry : classIndices_) {
+        TaggedValue name = symbols_->intern(entry.first);
+        memory_.storePointer(ObjectHeader::fromTaggedValue(classes_.classAt(entry.second)),
+                             st::ClassSlots::NAME, name);
+    }
+}
+
+// ============================================================================
+// Kernel methods
+// ============================================================================
+
+namespace {
+
+// Class name and method source, compiled in order
+const std::pair<const char*, const char*> KERNEL_METHODS[] = {
+    // Object
+    {"Object", "== anObject <primitive: 110> ^self primitiveFailed"},
+    {"Object", "~~ anObject ^(self == anObject) not"},
+    {"Object", "= anObject ^self == anObject"},
+    {"Object", "~= anObject ^(self = anObject) not"},
+    {"Object", "hash ^self identityHash"},
+    {"Object", "identityHash <primitive: 75> ^self primitiveFailed"},
+    {"Object", "class <primitive: 111> ^self primitiveFailed"},
+    {"Object", "isNil ^false"},
+    {"Object", "notNil ^true"},
+    {"Object", "isNumber ^false"},
+    {"Object", "isString ^false"},
+    {"Object", "isSymbol ^false"},
+    {"Object", "yourself ^self"},
+    {"Object", "error: aString <primitive: 20> ^self primitiveFailed"},
+    {"Object", "primitiveFailed <primitive: 19> ^self"},
+
+    // UndefinedObject, Boolean
+    {"UndefinedObject", "isNil ^true"},
+    {"UndefinedObject", "notNil ^false"},
+    {"True", "not ^false"},
+    {"True", "& aBoolean ^aBoolean"},
+    {"True", "| aBoolean ^true"},
+    {"False", "not ^true"},
+    {"False", "& aBoolean ^false"},
+    {"False", "| aBoolean ^aBoolean"},
+
+    // Number
+    {"Number", "isNumber ^true"},
+    {"Number", "negated ^0 - self"},
+    {"Number", "abs ^self < 0 ifTrue: [self negated] ifFalse: [self]"},
+    {"Number", "squared ^self * self"},
+    {"Number", "isZero ^self = 0"},
+    {"Number", "max: aNumber ^self > aNumber ifTrue: [self] ifFalse: [aNumber]"},
+    {"Number", "min: aNumber ^self < aNumber ifTrue: [self] ifFalse: [aNumber]"},
+    {"Number", "between: min and: max ^self >= min and: [self <= max]"},
+    {"Number", "to: stop do: aBlock | i | i := self. [i <= stop] whileTrue: [aBlock value: i. i := i + 1]"},
+
+    // SmallInteger: primitives that fail for non-SmallInteger arguments or overflow retry in Float
+    {"SmallInteger", "+ aNumber <primitive: 1> ^self asFloat + aNumber"},
+    {"SmallInteger", "- aNumber <primitive: 2> ^self asFloat - aNumber"},
+    {"SmallInteger", "< aNumber <primitive: 3> ^self asFloat < aNumber"},
+    {"SmallInteger", "> aNumber <primitive: 4> ^self asFloat > aNumber"},
+    {"SmallInteger", "<= aNumber <primitive: 5> ^self asFloat <= aNumber"},
+    {"SmallInteger", ">= aNumber <primitive: 6> ^self asFloat >= aNumber"},
+    {"SmallInteger", "= aNumber <primitive: 7> ^aNumber isNumber and: [self asFloat = aNumber]"},
+    {"SmallInteger", "~= aNumber <primitive: 8> ^(self = aNumber) not"},
+    {"SmallInteger", "* aNumber <primitive: 9> ^self asFloat * aNumber"},
+    {"SmallInteger", "/ aNumber <primitive: 10> ^self asFloat / aNumber"},
+    {"SmallInteger", "// aNumber <primitive: 11> ^self primitiveFailed"},
+    {"SmallInteger", "\\\\ aNumber <primitive: 12> ^self primitiveFailed"},
+    {"SmallInteger", "bitAnd: anInteger <primitive: 14> ^self primitiveFailed"},
+    {"SmallInteger", "bitOr: anInteger <primitive: 15> ^self primitiveFailed"},
+    {"SmallInteger", "bitXor: anInteger <primitive: 16> ^self primitiveFailed"},
+    {"SmallInteger", "bitShift: anInteger <primitive: 17> ^self primitiveFailed"},
+    {"SmallInteger", "asFloat <primitive: 40> ^self primitiveFailed"},
+    {"SmallInteger", "truncated ^self"},
+    {"SmallInteger", "hash ^self"},
+    {"SmallInteger", "identityHash ^self"},
+
+    // Float
+    {"Float", "+ aNumber <primitive: 41> ^self primitiveFailed"},
+    {"Float", "- aNumber <primitive: 42> ^self primitiveFailed"},
+    {"Float", "< aNumber <primitive: 43> ^self primitiveFailed"},
+    {"Float", "> aNumber <primitive: 44> ^self primitiveFailed"},
+    {"Float", "<= aNumber <primitive: 45> ^self primitiveFailed"},
+    {"Float", ">= aNumber <primitive: 46> ^self primitiveFailed"},
+    {"Float", "= aNumber <primitive: 47> ^false"},
+    {"Float", "~= aNumber <primitive: 48> ^true"},
+    {"Float", "* aNumber <primitive: 49> ^self primitiveFailed"},
+    {"Float", "/ aNumber <primitive: 50> ^self primitiveFailed"},
+    {"Float", "truncated <primitive: 51> ^self primitiveFailed"},
+    {"Float", "sqrt <primitive: 55> ^self primitiveFailed"},
+    {"Float", "asFloat ^self"},
+    {"Float", "hash ^self truncated"},
+
+    // Collections
+    {"ArrayedCollection", "size <primitive: 62> ^self primitiveFailed"},
+    {"ArrayedCollection", "at: index <primitive: 60> ^self error: 'Index out of bounds'"},
+    {"ArrayedCollection", "at: index put: value <primitive: 61> ^self error: 'Index out of bounds'"},
+    {"ArrayedCollection", "isEmpty ^self size = 0"},
+    {"ArrayedCollection", "notEmpty ^self size > 0"},
+    {"ArrayedCollection", "do: aBlock 1 to: self size do: [:i | aBlock value: (self at: i)]"},
+    {"ArrayedCollection",
+     "collect: aBlock\n"
+     "    | result |\n"
+     "    result := Array new: self size.\n"
+     "    1 to: self size do: [:i | result at: i put: (aBlock value: (self at: i))].\n"
+     "    ^result"},
+    {"ArrayedCollection",
+     "inject: initialValue into: aBlock\n"
+     "    | value |\n"
+     "    value := initialValue.\n"
+     "    1 to: self size do: [:i | value := aBlock value: value value: (self at: i)].\n"
+     "    ^value"},
+    {"ArrayedCollection",
+     "detect: aBlock ifNone: exceptionBlock\n"
+     "    1 to: self size do: [:i | (aBlock value: (self at: i)) ifTrue: [^self at: i]].\n"
+     "    ^exceptionBlock value"},
+    {"String", "size <primitive: 66> ^self primitiveFailed"},
+    {"String", "at: index <primitive: 63> ^self error: 'Index out of bounds'"},
+    {"String", "at: index put: aCharacter <primitive: 64> ^self error: 'Index out of bounds'"},
+    {"String", ", aString <primitive: 65> ^self primitiveFailed"},
+    {"String", "asSymbol <primitive: 67> ^self primitiveFailed"},
+    {"String", "isString ^true"},
+    {"String",
+     "= aString\n"
+     "    | size |\n"
+     "    aString isString ifFalse: [^false].\n"
+     "    aString isSymbol ifTrue: [^false].\n"
+     "    size := self size.\n"
+     "    size = aString size ifFalse: [^false].\n"
+     "    1 to: size do: [:i | (self at: i) = (aString at: i) ifFalse: [^false]].\n"
+     "    ^true"},
+    {"String",
+     "hash\n"
+     "    | hash |\n"
+     "    hash := self size.\n"
+     "    1 to: self size do: [:i | hash := (hash * 31 + (self at: i)) bitAnd: 16r3FFFFFFF].\n"
+     "    ^hash"},
+    {"Symbol", "= anObject ^self == anObject"},
+    {"Symbol", "hash ^self identityHash"},
+    {"Symbol", "isSymbol ^true"},
+    {"Symbol", "asSymbol ^self"},
+    {"Symbol", "at: index put: aCharacter ^self error: 'Symbols are immutable'"},
+
+    // Class
+    {"Class", "new <primitive: 70> ^self primitiveFailed"},
+    {"Class", "basicNew <primitive: 71> ^self primitiveFailed"},
+    {"Class", "new: size <primitive: 72> ^self primitiveFailed"},
+    {"Class", "basicNew: size <primitive: 72> ^self primitiveFailed"},
+    {"Class", "name ^name"},
+    {"Class", "superclass ^superclass"},
+
+    // Dictionary
+    {"Dictionary", "at: key <primitive: 700> ^self error: 'Key not found'"},
+    {"Dictionary", "at: key put: value <primitive: 701> ^self primitiveFailed"},
+    {"Dictionary", "keys <primitive: 702> ^self primitiveFailed"},
+    {"Dictionary", "size <primitive: 703> ^self primitiveFailed"},
+    {"Dictionary", "includesKey: key <primitive: 704> ^self primitiveFailed"},
+    {"Dictionary", "at: key default: value ^(self includesKey: key) ifTrue: [self at: key] ifFalse: [value]"},
+    {"Dictionary", "isEmpty ^self size = 0"},
+
+    // Processes. Without metaclasses, Process activeProcess and Process yield are Class
+    // methods whose primitives fail for any other receiver.
+    {"Object", "fork: selector ^self fork: selector withArguments: (Array new: 0) at: Process activeProcess priority"},
+    {"Object", "fork: selector at: priority ^self fork: selector withArguments: (Array new: 0) at: priority"},
+    {"Object",
+     "fork: selector with: argument at: priority\n"
+     "    | arguments |\n"
+     "    arguments := Array new: 1.\n"
+     "    arguments at: 1 put: argument.\n"
+     "    ^self fork: selector withArguments: arguments at: priority"},
+    {"Object", "fork: selector withArguments: arguments at: priority <primitive: 91> ^self primitiveFailed"},
+    {"Class", "activeProcess <primitive: 92> ^self primitiveFailed"},
+    {"Class", "yield <primitive: 93> ^self primitiveFailed"},
+    {"Process", "priority ^priority"},
+    {"Process", "priority: anInteger <primitive: 90> ^self primitiveFailed"},
+    {"Process", "resume <primitive: 87> ^self primitiveFailed"},
+    {"Process", "suspend <primitive: 88> ^self primitiveFailed"},
+    {"Process", "terminate <primitive: 89> ^self primitiveFailed"},
+    {"Process", "isTerminated ^stackIndex isNil"},
+    {"Semaphore", "signal <primitive: 85> ^self primitiveFailed"},
+    {"Semaphore", "wait <primitive: 86> ^self primitiveFailed"},
+    {"Semaphore", "excessSignals ^excessSignals isNil ifTrue: [0] ifFalse: [excessSignals]"},
+
+    // Blocks. The compiler turns value sends into EXECUTE_BLOCK, which runs a block's
+    // method without a lookup; these methods serve perform-style sends from C++.
+    {"BlockClosure", "numArgs ^numArgs"},
+    {"BlockClosure", "value ^self value"},
+    {"BlockClosure", "value: a ^self value: a"},
+    {"BlockClosure", "value: a value: b ^self value: a value: b"},
+    {"BlockClosure", "value: a value: b value: c ^self value: a value: b value: c"},
+
+    // Exceptions. Handlers are inlined by the compiler (on:do:, ensure:); a handler's
+    // value is the value of its on:do:, there is no resumption.
+    {"Exception", "signal <primitive: 1001> ^self primitiveFailed"},
+    {"Exception", "signal: aString messageText := aString. ^self signal"},
+    {"Exception", "pass ^self signal"},
+    {"Exception", "messageText ^messageText"},
+    {"Exception", "messageText: aString messageText := aString"},
+
+    // Files and sockets. The primitives never block: a transfer that would answers nil,
+    // and only the Process that waits for the descriptor stops running.
+    {"IOHandle", "handle ^handle"},
+    {"IOHandle", "setHandle: anInteger handle := anInteger"},
+    {"IOHandle", "isOpen ^handle notNil"},
+    {"IOHandle", "close handle isNil ifFalse: [self primClose. handle := nil]"},
+    {"IOHandle",
+     "waitReadable\n"
+     "    readable isNil ifTrue: [readable := Semaphore new].\n"
+     "    self primWait: 1 signal: readable.\n"
+     "    readable wait"},
+    {"IOHandle",
+     "waitWritable\n"
+     "    writable isNil ifTrue: [writable := Semaphore new].\n"
+     "    self primWait: 2 signal: writable.\n"
+     "    writable wait"},
+    // Answers the number of bytes read into buffer, 0 at end of file or once closed
+    {"IOHandle",
+     "read: buffer startingAt: index count: count\n"
+     "    | result |\n"
+     "    [handle isNil ifTrue: [^0].\n"
+     "     result := self primRead: buffer startingAt: index count: count.\n"
+     "     result isNil] whileTrue: [self waitReadable].\n"
+     "    ^result"},
+    {"IOHandle", "read: buffer ^self read: buffer startingAt: 1 count: buffer size"},
+    {"IOHandle",
+     "write: buffer startingAt: index count: count\n"
+     "    | written result |\n"
+     "    written := 0.\n"
+     "    [written < count] whileTrue: [\n"
+     "        handle isNil ifTrue: [^self error: 'Closed'].\n"
+     "        result := self primWrite: buffer startingAt: index + written count: count - written.\n"
+     "        result isNil ifTrue: [self waitWritable] ifFalse: [written := written + result]].\n"
+     "    ^count"},
+    {"IOHandle", "write: buffer ^self write: buffer startingAt: 1 count: buffer size"},
+    {"IOHandle", "primRead: buffer startingAt: index count: count <primitive: 800> ^self error: 'Read failed'"},
+    {"IOHandle", "primWrite: buffer startingAt: index count: count <primitive: 801> ^self error: 'Write failed'"},
+    {"IOHandle", "primClose <primitive: 802> ^self primitiveFailed"},
+    {"IOHandle", "primWait: direction signal: aSemaphore <primitive: 803> ^self primitiveFailed"},
+    {"File", "openRead: path handle := self primOpen: path mode: 0"},
+    {"File", "openWrite: path handle := self primOpen: path mode: 1"},
+    {"File", "openAppend: path handle := self primOpen: path mode: 2"},
+    {"File", "primOpen: path mode: mode <primitive: 804> ^self error: 'Cannot open ', path"},
+    {"Socket", "listenOn: port handle := self primListenOn: '127.0.0.1' port: port"},
+    {"Socket", "port ^self primLocalPort"},
+    {"Socket",
+     "accept\n"
+     "    | accepted |\n"
+     "    [accepted := self primAccept. accepted isNil] whileTrue: [self waitReadable].\n"
+     "    ^Socket new setHandle: accepted"},
+    {"Socket",
+     "connectTo: host port: port\n"
+     "    handle := self primConnectTo: host port: port.\n"
+     "    self waitWritable.\n"
+     "    self primConnectionError = 0 ifFalse: [self close. ^self error: 'Connection refused']"},
+    {"Socket", "primListenOn: host port: port <primitive: 805> ^self error: 'Cannot listen'"},
+    {"Socket", "primAccept <primitive: 806> ^self error: 'Accept failed'"},
+    {"Socket", "primConnectTo: host port: port <primitive: 807> ^self error: 'Cannot connect'"},
+    {"Socket", "primLocalPort <primitive: 808> ^self primitiveFailed"},
+    {"Socket", "primConnectionError <primitive: 809> ^self primitiveFailed"},
+};
+
+} // namespace
+
+void VM::compileKernel() {
+    for (const auto& method : KERNEL_METHODS) {
+        compile(method.first, method.second);
+    }
+}
@@ -0,0 +1,29 @@
+#include "bytecode.hpp"
+
+namespace bytecode {
+
+const char* opcodeName(uint8_t opcode) {
+    static const char* const NAMES[OPCODE_COUNT] = {
+        "PUSH_LITERAL",
+        "PUSH_INSTANCE_VARIABLE",
+        "PUSH_TEMPORARY_VARIABLE",
+        "PUSH_SELF",
+        "STORE_INSTANCE_VARIABLE",
+        "STORE_TEMPORARY_VARIABLE",
+        "SEND_MESSAGE",
+        "RETURN_STACK_TOP",
+        "JUMP",
+        "JUMP_IF_TRUE",
+        "JUMP_IF_FALSE",
+        "POP",
+        "DUPLICATE",
+        "CREATE_BLOCK",
+        "EXECUTE_BLOCK",
+        "PUSH_REMOTE_TEMPORARY",
+        "STORE_REMOTE_TEMPORARY",
+        "PUSH_ESCAPING_TEMPORARY",
+    };
+    return opcode < OPCODE_COUNT ? NAMES[opcode] : "UNKNOWN";
+}
+
+} // namespace bytecode
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Bytecode set
+ *
+ * Every instruction is a one-byte opcode followed by zero or more 32-bit little-endian
+ * operands. Jump targets are absolute byte offsets into the method's bytecodes.
+ *
+ *   PUSH_LITERAL               index            ... -> ..., literals[index]
+ *   PUSH_INSTANCE_VARIABLE     index            ... -> ..., self.slots[index]
+ *   PUSH_TEMPORARY_VARIABLE    index            ... -> ..., temps[index] (args come first)
+ *   PUSH_SELF                                   ... -> ..., self
+ *   STORE_INSTANCE_VARIABLE    index            ..., v -> ..., v   (self.slots[index] := v)
+ *   STORE_TEMPORARY_VARIABLE   index            ..., v -> ..., v   (temps[index] := v)
+ *   SEND_MESSAGE               selector argc    ..., rcvr, args -> ..., result
+ *   RETURN_STACK_TOP                            returns the top of stack to the sender
+ *   JUMP                       target
+ *   JUMP_IF_TRUE               target           ..., bool -> ...
+ *   JUMP_IF_FALSE              target           ..., bool -> ...
+ *   POP                                         ..., v -> ...
+ *   DUPLICATE                                   ..., v -> ..., v, v
+ *   CREATE_BLOCK               method n slot    ..., v1..vn -> ..., block
+ *   EXECUTE_BLOCK              selector argc    ..., block, args -> ..., result
+ *   PUSH_REMOTE_TEMPORARY      index vector     ... -> ..., temps[vector].slots[index]
+ *   STORE_REMOTE_TEMPORARY     index vector     ..., v -> ..., v   (temps[vector].slots[index] := v)
+ *   PUSH_ESCAPING_TEMPORARY    index            ... -> ..., temps[index], a heap block
+ *
+ * SEND_MESSAGE's and EXECUTE_BLOCK's selector operand is a literal index. The compiler
+ * emits EXECUTE_BLOCK for value, value:, value:value: and value:value:value:; a
+ * BlockClosure receiver runs its block method directly, anything else gets the send.
+ *
+ * CREATE_BLOCK makes a block of the method at literal index method whose receiver is
+ * self and whose copied values v1..vn become the block method's temporaries after its
+ * arguments. With slot NO_SLOT the block is a BlockClosure on the heap. Otherwise it
+ * lives in the frame: the method and copied values are stored to temps[slot..slot+n]
+ * and the value pushed is a stack block, an immediate that refers to them. The compiler
+ * only hands stack blocks to EXECUTE_BLOCK; every other use of a temporary that may
+ * hold one goes through PUSH_ESCAPING_TEMPORARY, which first replaces a stack block in
+ * temps[index] by a BlockClosure with the same method and copied values.
+ *
+ * Temporaries that a block captures and that are assigned live in a temp vector, an
+ * Array held by temps[vector] and shared by every block that captures it; the remote
+ * temporary instructions access its slots.
+ */
+namespace bytecode {
+
+enum Opcode : uint8_t {
+    PUSH_LITERAL = 0,
+    PUSH_INSTANCE_VARIABLE = 1,
+    PUSH_TEMPORARY_VARIABLE = 2,
+    PUSH_SELF = 3,
+    STORE_INSTANCE_VARIABLE = 4,
+    STORE_TEMPORARY_VARIABLE = 5,
+    SEND_MESSAGE = 6,
+    RETURN_STACK_TOP = 7,
+    JUMP = 8,
+    JUMP_IF_TRUE = 9,
+    JUMP_IF_FALSE = 10,
+    POP = 11,
+    DUPLICATE = 12,
+    CREATE_BLOCK = 13,
+    EXECUTE_BLOCK = 14,
+    PUSH_REMOTE_TEMPORARY = 15,
+    STORE_REMOTE_TEMPORARY = 16,
+    PUSH_ESCAPING_TEMPORARY = 17,
+    OPCODE_COUNT = 18
+};
+
+// CREATE_BLOCK's slot operand for a block on the heap
+constexpr uint32_t NO_SLOT = 0xFFFFFFFF;
+
+// Number of 32-bit operands that follow the opcode
+constexpr uint32_t operandCount(uint8_t opcode) {
+    switch (opcode) {
+    case PUSH_LITERAL:
+    case PUSH_INSTANCE_VARIABLE:
+    case PUSH_TEMPORARY_VARIABLE:
+    case STORE_INSTANCE_VARIABLE:
+    case STORE_TEMPORARY_VARIABLE:
+    case JUMP:
+    case JUMP_IF_TRUE:
+    case JUMP_IF_FALSE:
+    case PUSH_ESCAPING_TEMPORARY:
+        return 1;
+    case SEND_MESSAGE:
+    case EXECUTE_BLOCK:
+    case PUSH_REMOTE_TEMPORARY:
+    case STORE_REMOTE_TEMPORARY:
+        return 2;
+    case CREATE_BLOCK:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// Total instruction length in bytes
+constexpr uint32_t instructionLength(uint8_t opcode) {
+    return 1 + 4 * operandCount(opcode);
+}
+
+// Reads the 32-bit little-endian operand at bytes (unaligned)
+inline uint32_t readOperand(const uint8_t* bytes) {
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+const char* opcodeName(uint8_t opcode);
+
+} // namespace bytecode
@@ -0,0 +1,59 @@
+#include "class_table.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+static_assert((TaggedValue::NIL & 0xF) == 0x1 && (TaggedValue::TRUE & 0xF) == 0x5 &&
+                  (TaggedValue::FALSE & 0xF) == 0x9,
+              "ClassTable::IMMEDIATE_INDICES assumes the special value encodings");
+
+ClassTable::ClassTable() : classes_(FIRST_FREE_INDEX, TaggedValue::nil()) {
+}
+
+uint32_t ClassTable::indexOfClass(TaggedValue classObject) {
+    if (!classObject.isPointer()) {
+        return INVALID_INDEX;
+    }
+    return ObjectHeader::fromTaggedValue(classObject)->hash();
+}
+
+uint32_t ClassTable::registerClass(ObjectHeader* classObject) {
+    uint32_t index = static_cast<uint32_t>(classes_.size());
+    if (index > ObjectHeader::MAX_CLASS_INDEX) {
+        throw std::length_error("Class table full");
+    }
+    classes_.push_back(TaggedValue::nil());
+    registerClassAt(index, classObject);
+    return index;
+}
+
+void ClassTable::registerClassAt(uint32_t index, ObjectHeader* classObject) {
+    if (index == INVALID_INDEX || index >= classes_.size()) {
+        throw std::out_of_range("Class index out of range");
+    }
+    if (classObject->hasIdentityHash() && classObject->hash() != index) {
+        throw std::logic_error("Class already has an identity hash");
+    }
+    classObject->setHash(index);
+    classes_[index] = classObject->toTaggedValue();
+}
+
+void ClassTable::share(const std::vector<TaggedValue>& classes) {
+    if (classes_.size() != FIRST_FREE_INDEX) {
+        throw std::logic_error("Class table already in use");
+    }
+    classes_ = classes;
+    classes_.resize(std::max<size_t>(classes_.size(), FIRST_FREE_INDEX), TaggedValue::nil());
+}
+
+TaggedValue ClassTable::classAt(uint32_t index) const {
+    if (index >= classes_.size()) {
+        return TaggedValue::nil();
+    }
+    return classes_[index];
+}
+
+void ClassTable::visitPointers(const std::function<void(TaggedValue&)>& visit) {
+    for (TaggedValue& classObject : classes_) {
+        visit(classObject);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "object_header.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * ClassTable - maps the compact class index in each ObjectHeader to a class object
+ *
+ * Objects carry a 22-bit class index instead of a class pointer, which saves a word per
+ * object and turns receiver-class checks into an integer compare. Immediates have no
+ * header; their tag bits map to reserved indices, so classIndexOf() answers an index
+ * for every TaggedValue without touching memory unless the value is a pointer.
+ *
+ * A registered class stores its own index in its identity-hash field (as in Spur), so
+ * finding the index of a class object needs no reverse map.
+ */
+class ClassTable {
+public:
+    // Reserved indices
+    static constexpr uint32_t INVALID_INDEX = 0;
+    static constexpr uint32_t SMALL_INTEGER_INDEX = 1;
+    static constexpr uint32_t FLOAT_INDEX = 2;
+    static constexpr uint32_t UNDEFINED_OBJECT_INDEX = 3;
+    static constexpr uint32_t TRUE_INDEX = 4;
+    static constexpr uint32_t FALSE_INDEX = 5;
+    static constexpr uint32_t FIRST_FREE_INDEX = 8;
+
+    ClassTable();
+
+    // Class index of any value: header field for objects, reserved index for immediates
+    static uint32_t classIndexOf(TaggedValue value) {
+        if (value.isPointer()) {
+            return ObjectHeader::fromTaggedValue(value)->classIndex();
+        }
+        return IMMEDIATE_INDICES[value.value() & 0xF];
+    }
+
+    // Index a registered class object answers for
+    static uint32_t indexOfClass(TaggedValue classObject);
+
+    // Registration. registerClass() answers the new index; registerClassAt() fills a
+    // reserved index (e.g. SmallInteger). The class must not have an identity hash yet.
+    uint32_t registerClass(ObjectHeader* classObject);
+    void registerClassAt(uint32_t index, ObjectHeader* classObject);
+    // Starts an empty table with the classes of an ImageSegment, whose headers already
+    // hold their indices
+    void share(const std::vector<TaggedValue>& classes);
+
+    // Lookup (nil for unused indices)
+    TaggedValue classAt(uint32_t index) const;
+    TaggedValue classOf(TaggedValue value) const { return classAt(classIndexOf(value)); }
+    size_t size() const { return classes_.size(); }
+
+    // Visit every class object so a moving collector can update them in place
+    void visitPointers(const std::function<void(TaggedValue&)>& visit);
+
+private:
+    // Indexed by the low 4 bits of an immediate: the 2-bit tag plus, for specials,
+    // the bits that tell nil, true and false apart. Pointer entries are never used.
+    static constexpr uint32_t IMMEDIATE_INDICES[16] = {
+        INVALID_INDEX, UNDEFINED_OBJECT_INDEX, FLOAT_INDEX, SMALL_INTEGER_INDEX,
+        INVALID_INDEX, TRUE_INDEX,             FLOAT_INDEX, SMALL_INTEGER_INDEX,
+        INVALID_INDEX, FALSE_INDEX,            FLOAT_INDEX, SMALL_INTEGER_INDEX,
+        INVALID_INDEX, INVALID_INDEX,          FLOAT_INDEX, SMALL_INTEGER_INDEX,
+    };
+
+    std::vector<TaggedValue> classes_;
+};
@@ -1,18 +1,25 @@
 #pragma once
 
 #include "mirror.hpp"
+#include "mirror_slots.hpp"
+#include <cstdint>
 
 namespace st {
 
-// Smalltalk-mirror handle for an Array object.
-// Note: The indexed elements are not C++ fields; they live in the object body in object memory.
+// Smalltalk-mirror view of an Array object (see mirrorOf in mirror.hpp).
+// Note: Array has no named slots; the indexed elements are the object body itself.
 class Array {
 public:
-    explicit Array(TaggedValue self) : self_(self) {}
-    TaggedValue self() const { return self_; }
+    using Slots = ArraySlots;
+
+    uint32_t size() const { return header()->size(); }
+    TaggedValue* elements() { return reinterpret_cast<TaggedValue*>(this); }
+    TaggedValue at(uint32_t index) const { return reinterpret_cast<const TaggedValue*>(this)[index]; }
 
 private:
-    ST_SLOT(self_);
+    const ObjectHeader* header() const { return reinterpret_cast<const ObjectHeader*>(this) - 1; }
+
+    friend struct MirrorLayout<Array>;
 };
 
 } // namespace st
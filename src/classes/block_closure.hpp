@@ -0,0 +1,38 @@
+#pragma once
+
+#include "mirror.hpp"
+#include "mirror_slots.hpp"
+
+/**
+ * BlockClosure - C++ view of a block the compiler could not inline
+ *
+ * Clean blocks, which use no self and no variables of the method around them, are built
+ * once by the compiler as a literal of their method, with a nil receiver. Other blocks
+ * are made by CREATE_BLOCK each time the block expression is evaluated (see
+ * bytecode.hpp): the values they copy from the frame that made them follow the named
+ * slots, and EXECUTE_BLOCK hands them to the block method as temporaries after its
+ * arguments.
+ *
+ * - method: CompiledMethod of the block body
+ * - numArgs: SmallInteger, the number of block arguments
+ * - receiver: self of the block method
+ */
+namespace st {
+
+class BlockClosure {
+public:
+    using Slots = BlockClosureSlots;
+
+    TaggedValue method() const { return method_; }
+    TaggedValue numArgs() const { return numArgs_; }
+    TaggedValue receiver() const { return receiver_; }
+
+private:
+    ST_SLOT(method_);   // CompiledMethod (object pointer)
+    ST_SLOT(numArgs_);  // SmallInteger
+    ST_SLOT(receiver_); // Any object
+
+    friend struct MirrorLayout<BlockClosure>;
+};
+
+} // namespace st
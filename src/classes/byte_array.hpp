@@ -1,18 +1,25 @@
 #pragma once
 
 #include "mirror.hpp"
+#include "mirror_slots.hpp"
+#include <cstdint>
 
 namespace st {
 
-// Smalltalk-mirror handle for a ByteArray object.
-// Note: The indexed bytes are not C++ fields; they live in the object body in object memory.
+// Smalltalk-mirror view of a ByteArray object (see mirrorOf in mirror.hpp).
+// Note: ByteArray has no named slots; the indexed bytes are the object body itself.
 class ByteArray {
 public:
-    explicit ByteArray(TaggedValue self) : self_(self) {}
-    TaggedValue self() const { return self_; }
+    using Slots = ByteArraySlots;
+
+    uint32_t size() const { return header()->size(); }
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(this); }
+    uint8_t at(uint32_t index) const { return reinterpret_cast<const uint8_t*>(this)[index]; }
 
 private:
-    ST_SLOT(self_);
+    const ObjectHeader* header() const { return reinterpret_cast<const ObjectHeader*>(this) - 1; }
+
+    friend struct MirrorLayout<ByteArray>;
 };
 
 } // namespace st
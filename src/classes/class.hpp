@@ -0,0 +1,46 @@
+#pragma once
+
+#include "mirror.hpp"
+#include "mirror_slots.hpp"
+#include <cstdint>
+
+/**
+ * Class - C++ view of a Smalltalk class object
+ *
+ * Structure matches Smalltalk Class:
+ * - superclass: Class (object pointer, nil for Object)
+ * - methods: method dictionary (runtime::IdentityDictionary backing store, Symbol -> CompiledMethod)
+ * - format: SmallInteger describing instances, see instanceType()/instanceSize()
+ * - name: Symbol
+ *
+ * A class's ClassTable index is its identity hash (see ClassTable).
+ */
+namespace st {
+
+class Class {
+public:
+    using Slots = ClassSlots;
+
+    // format = instanceType << 16 | named instance variable count
+    static TaggedValue makeFormat(ObjectHeader::Type instanceType, uint32_t instanceSize) {
+        return TaggedValue::fromSmallInteger(static_cast<int64_t>(instanceType) << 16 | instanceSize);
+    }
+
+    TaggedValue superclass() const { return superclass_; }
+    TaggedValue methods() const { return methods_; }
+    TaggedValue name() const { return name_; }
+    ObjectHeader::Type instanceType() const {
+        return static_cast<ObjectHeader::Type>(format_.toSmallInteger() >> 16);
+    }
+    uint32_t instanceSize() const { return static_cast<uint32_t>(format_.toSmallInteger() & 0xFFFF); }
+
+private:
+    ST_SLOT(superclass_);  // Class (object pointer)
+    ST_SLOT(methods_);     // runtime::IdentityDictionary (external pointer)
+    ST_SLOT(format_);      // SmallInteger
+    ST_SLOT(name_);        // Symbol
+
+    friend struct MirrorLayout<Class>;
+};
+
+} // namespace st
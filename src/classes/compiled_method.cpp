@@ -1,13 +1,29 @@
 #include "compiled_method.hpp"
+#include "class.hpp"
+#include "symbol_table.hpp"
 
 namespace st {
 
 CompiledMethod::CompiledMethod(TaggedValue bytes, TaggedValue literals,
-                               TaggedValue numArgs, TaggedValue numTemps, TaggedValue primitiveNumber)
+                               TaggedValue numArgs, TaggedValue numTemps, TaggedValue primitiveNumber,
+                               TaggedValue selector, TaggedValue methodClass, TaggedValue handlers)
     : bytes_(bytes), literals_(literals), numArgs_(numArgs), 
-      numTemps_(numTemps), primitiveNumber_(primitiveNumber) {
+      numTemps_(numTemps), primitiveNumber_(primitiveNumber),
+      selector_(selector), methodClass_(methodClass), handlers_(handlers) {
 }
 
-} // namespace st
+std::string CompiledMethod::qualifiedName() const {
+    std::string name =
+        methodClass_.isNil() ? "?" : std::string(SymbolTable::nameOf(mirrorOf<Class>(methodClass_)->name()));
+    name += ">>";
+    name += selector_.isNil() ? "unbound method" : std::string(SymbolTable::nameOf(selector_));
+    return name;
+}
 
+uint64_t CompiledMethod::stableKey(TaggedValue method) {
+    TaggedValue methodClass = mirrorOf<CompiledMethod>(method)->getMethodClass();
+    uint64_t classHash = methodClass.isNil() ? 0 : ObjectHeader::fromTaggedValue(methodClass)->identityHash();
+    return classHash << 32 | ObjectHeader::fromTaggedValue(method)->identityHash();
+}
 
+} // namespace st
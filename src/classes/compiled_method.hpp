@@ -1,6 +1,8 @@
 #pragma once
 
 #include "mirror.hpp"
+#include "mirror_slots.hpp"
+#include <string>
 
 /**
  * CompiledMethod - C++ representation of Smalltalk CompiledMethod object
@@ -11,13 +13,24 @@
  * - numArgs: SmallInteger (number of arguments)
  * - numTemps: SmallInteger (number of temporary variables)
  * - primitiveNumber: SmallInteger (primitive method number, 0 if none)
+ * - selector: Symbol the method is installed under (nil if not installed)
+ * - methodClass: Class the method is installed in (nil if not installed)
+ * - handlers: ByteArray of exception handler and ensure: ranges (nil if none; see
+ *   handler_table.hpp)
+ *
+ * Either a standalone value or a view over a heap CompiledMethod (see mirrorOf in
+ * mirror.hpp); slot indices are in CompiledMethodSlots.
  */
 namespace st {
 
 class CompiledMethod {
 public:
+    using Slots = CompiledMethodSlots;
+
     // Constructor
-    CompiledMethod(TaggedValue bytes, TaggedValue literals, TaggedValue numArgs, TaggedValue numTemps, TaggedValue primitiveNumber);
+    CompiledMethod(TaggedValue bytes, TaggedValue literals, TaggedValue numArgs, TaggedValue numTemps, TaggedValue primitiveNumber,
+                   TaggedValue selector = TaggedValue::nil(), TaggedValue methodClass = TaggedValue::nil(),
+                   TaggedValue handlers = TaggedValue::nil());
     
     // Accessors for Smalltalk object fields
     TaggedValue getBytes() const { return bytes_; }
@@ -25,6 +38,15 @@ public:
     TaggedValue getNumArgs() const { return numArgs_; }
     TaggedValue getNumTemps() const { return numTemps_; }
     TaggedValue getPrimitiveNumber() const { return primitiveNumber_; }
+    TaggedValue getSelector() const { return selector_; }
+    TaggedValue getMethodClass() const { return methodClass_; }
+    TaggedValue getHandlers() const { return handlers_; }
+
+    // "Class>>selector", with "?" and "unbound method" standing in for nil fields
+    std::string qualifiedName() const;
+
+    // Identifies a heap method across collections: its class's identity hash and its own
+    static uint64_t stableKey(TaggedValue method);
     
 private:
     ST_SLOT(bytes_);            // ByteArray (object pointer)
@@ -32,6 +54,11 @@ private:
     ST_SLOT(numArgs_);          // SmallInteger
     ST_SLOT(numTemps_);         // SmallInteger
     ST_SLOT(primitiveNumber_);  // SmallInteger
+    ST_SLOT(selector_);         // Symbol
+    ST_SLOT(methodClass_);      // Class (object pointer)
+    ST_SLOT(handlers_);         // ByteArray (object pointer) or nil
+
+    friend struct MirrorLayout<CompiledMethod>;
 };
 
 } // namespace st
@@ -1,13 +1,17 @@
 #pragma once
 
 #include "mirror.hpp"
+#include "mirror_slots.hpp"
 
 namespace st {
 
 // Smalltalk-mirror Context (slot-only).
 // Note: for now this mirrors only the fields our tests need. More slots will be added as we implement the real Context layout.
+// Either a standalone value or a view over a heap Context (see mirrorOf in mirror.hpp).
 class Context {
 public:
+    using Slots = ContextSlots;
+
     Context(TaggedValue method, TaggedValue receiver, TaggedValue stack, TaggedValue instructionPointer)
         : method_(method),
           receiver_(receiver),
@@ -27,6 +31,8 @@ private:
     ST_SLOT(receiver_);           // Object
     ST_SLOT(stack_);              // Array (object pointer)
     ST_SLOT(instructionPointer_); // SmallInteger
+
+    friend struct MirrorLayout<Context>;
 };
 
 } // namespace st
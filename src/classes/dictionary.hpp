@@ -0,0 +1,45 @@
+#pragma once
+
+#include "mirror.hpp"
+#include "mirror_slots.hpp"
+
+/**
+ * Dictionary - C++ view of a Smalltalk Dictionary, whose hash table lives in object
+ * memory (see dictionary_table.hpp)
+ *
+ * - tally: SmallInteger, the number of entries; nil (as from Dictionary new) counts as 0
+ * - growthLeft: SmallInteger, the inserts the current table takes before it grows
+ * - control: ByteArray of one control byte per slot followed by each slot's cached
+ *   64-bit hash (nil until the first at:put:)
+ * - slots: Array of every slot's key, followed by every slot's value
+ * - oldControl, oldSlots: the table being drained into the current one while the
+ *   Dictionary grows (nil otherwise)
+ * - migrated: SmallInteger, the next slot of the old table to move
+ */
+namespace st {
+
+class Dictionary {
+public:
+    using Slots = DictionarySlots;
+
+    int64_t tally() const { return tally_.isNil() ? 0 : tally_.toSmallInteger(); }
+    int64_t growthLeft() const { return growthLeft_.isNil() ? 0 : growthLeft_.toSmallInteger(); }
+    TaggedValue control() const { return control_; }
+    TaggedValue slots() const { return slots_; }
+    TaggedValue oldControl() const { return oldControl_; }
+    TaggedValue oldSlots() const { return oldSlots_; }
+    int64_t migrated() const { return migrated_.isNil() ? 0 : migrated_.toSmallInteger(); }
+
+private:
+    ST_SLOT(tally_);       // SmallInteger
+    ST_SLOT(growthLeft_);  // SmallInteger
+    ST_SLOT(control_);     // ByteArray (object pointer)
+    ST_SLOT(slots_);       // Array (object pointer)
+    ST_SLOT(oldControl_);  // ByteArray (object pointer)
+    ST_SLOT(oldSlots_);    // Array (object pointer)
+    ST_SLOT(migrated_);    // SmallInteger
+
+    friend struct MirrorLayout<Dictionary>;
+};
+
+} // namespace st
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "mirror.hpp"
+#include "mirror_slots.hpp"
+
+/**
+ * IOHandle - C++ view of a file or socket (and of Socket and File, its subclasses)
+ *
+ * - handle: SmallInteger descriptor from the Scheduler's IOLoop; nil before opening and
+ *   after close
+ * - readable, writable: Semaphores the IOLoop signals when the descriptor is ready;
+ *   created on the first wait and reused
+ */
+namespace st {
+
+class IOHandle {
+public:
+    using Slots = IOHandleSlots;
+
+    TaggedValue handle() const { return handle_; }
+    TaggedValue readable() const { return readable_; }
+    TaggedValue writable() const { return writable_; }
+
+private:
+    ST_SLOT(handle_);    // SmallInteger
+    ST_SLOT(readable_);  // Semaphore (object pointer)
+    ST_SLOT(writable_);  // Semaphore (object pointer)
+
+    friend struct MirrorLayout<IOHandle>;
+};
+
+} // namespace st
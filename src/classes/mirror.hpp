@@ -11,9 +11,39 @@
 //   };
 //
 // This is enforced by tools/check_mirror_layout.py (run via ctest).
+// tools/generate_mirror_slots.py turns the declarations into FooSlots::BAR/BAZ/COUNT
+// (mirror_slots.hpp) and into compile-time layout checks (mirror_slots.cpp).
 
+#include "../object_header.hpp"
 #include "../tagged_value.hpp"
 
 #define ST_SLOT(name) TaggedValue name
 
+namespace st {
 
+// Holds the generated layout checks for Mirror. Mirror classes befriend their
+// specialization so the checks can see private slots.
+template <typename Mirror>
+struct MirrorLayout;
+
+// View a heap object's body in place as Mirror. Slot i of the object is the i-th
+// ST_SLOT field, so field access is a fixed-offset load: nothing is constructed or
+// copied. Writes through a view skip the write barrier; store pointers into old
+// objects with MemoryManager::storePointer and the generated slot index.
+template <typename Mirror>
+inline Mirror* mirrorOf(ObjectHeader* object) {
+    return reinterpret_cast<Mirror*>(object->slots());
+}
+
+template <typename Mirror>
+inline Mirror* mirrorOf(TaggedValue object) {
+    return mirrorOf<Mirror>(ObjectHeader::fromTaggedValue(object));
+}
+
+// The header of the object a view lies over
+template <typename Mirror>
+inline ObjectHeader* headerOf(Mirror* mirror) {
+    return reinterpret_cast<ObjectHeader*>(mirror) - 1;
+}
+
+} // namespace st
@@ -0,0 +1,206 @@
+// Generated by tools/generate_mirror_slots.py from the ST_SLOT declarations in
+// src/classes/. Do not edit; rerun the generator after changing a mirror class.
+
+#include "array.hpp"
+#include "block_closure.hpp"
+#include "byte_array.hpp"
+#include "class.hpp"
+#include "compiled_method.hpp"
+#include "context.hpp"
+#include "dictionary.hpp"
+#include "io_handle.hpp"
+#include "process.hpp"
+#include <cstddef>
+#include <type_traits>
+
+namespace st {
+
+template <>
+struct MirrorLayout<Array> {
+    static_assert(std::is_standard_layout<Array>::value,
+                  "Array must be standard layout to overlay an object body");
+    static_assert(std::is_empty<Array>::value,
+                  "Array has no named slots");
+};
+
+template <>
+struct MirrorLayout<BlockClosure> {
+    static_assert(std::is_standard_layout<BlockClosure>::value,
+                  "BlockClosure must be standard layout to overlay an object body");
+    static_assert(sizeof(BlockClosure) == BlockClosureSlots::COUNT * sizeof(TaggedValue),
+                  "BlockClosure must contain only its ST_SLOT fields");
+    static_assert(offsetof(BlockClosure, method_) ==
+                      BlockClosureSlots::METHOD * sizeof(TaggedValue),
+                  "BlockClosure::method_ is not at slot BlockClosureSlots::METHOD");
+    static_assert(offsetof(BlockClosure, numArgs_) ==
+                      BlockClosureSlots::NUM_ARGS * sizeof(TaggedValue),
+                  "BlockClosure::numArgs_ is not at slot BlockClosureSlots::NUM_ARGS");
+    static_assert(offsetof(BlockClosure, receiver_) ==
+                      BlockClosureSlots::RECEIVER * sizeof(TaggedValue),
+                  "BlockClosure::receiver_ is not at slot BlockClosureSlots::RECEIVER");
+};
+
+template <>
+struct MirrorLayout<ByteArray> {
+    static_assert(std::is_standard_layout<ByteArray>::value,
+                  "ByteArray must be standard layout to overlay an object body");
+    static_assert(std::is_empty<ByteArray>::value,
+                  "ByteArray has no named slots");
+};
+
+template <>
+struct MirrorLayout<Class> {
+    static_assert(std::is_standard_layout<Class>::value,
+                  "Class must be standard layout to overlay an object body");
+    static_assert(sizeof(Class) == ClassSlots::COUNT * sizeof(TaggedValue),
+                  "Class must contain only its ST_SLOT fields");
+    static_assert(offsetof(Class, superclass_) ==
+                      ClassSlots::SUPERCLASS * sizeof(TaggedValue),
+                  "Class::superclass_ is not at slot ClassSlots::SUPERCLASS");
+    static_assert(offsetof(Class, methods_) ==
+                      ClassSlots::METHODS * sizeof(TaggedValue),
+                  "Class::methods_ is not at slot ClassSlots::METHODS");
+    static_assert(offsetof(Class, format_) ==
+                      ClassSlots::FORMAT * sizeof(TaggedValue),
+                  "Class::format_ is not at slot ClassSlots::FORMAT");
+    static_assert(offsetof(Class, name_) ==
+                      ClassSlots::NAME * sizeof(TaggedValue),
+                  "Class::name_ is not at slot ClassSlots::NAME");
+};
+
+template <>
+struct MirrorLayout<CompiledMethod> {
+    static_assert(std::is_standard_layout<CompiledMethod>::value,
+                  "CompiledMethod must be standard layout to overlay an object body");
+    static_assert(sizeof(CompiledMethod) == CompiledMethodSlots::COUNT * sizeof(TaggedValue),
+                  "CompiledMethod must contain only its ST_SLOT fields");
+    static_assert(offsetof(CompiledMethod, bytes_) ==
+                      CompiledMethodSlots::BYTES * sizeof(TaggedValue),
+                  "CompiledMethod::bytes_ is not at slot CompiledMethodSlots::BYTES");
+    static_assert(offsetof(CompiledMethod, literals_) ==
+                      CompiledMethodSlots::LITERALS * sizeof(TaggedValue),
+                  "CompiledMethod::literals_ is not at slot CompiledMethodSlots::LITERALS");
+    static_assert(offsetof(CompiledMethod, numArgs_) ==
+                      CompiledMethodSlots::NUM_ARGS * sizeof(TaggedValue),
+                  "CompiledMethod::numArgs_ is not at slot CompiledMethodSlots::NUM_ARGS");
+    static_assert(offsetof(CompiledMethod, numTemps_) ==
+                      CompiledMethodSlots::NUM_TEMPS * sizeof(TaggedValue),
+                  "CompiledMethod::numTemps_ is not at slot CompiledMethodSlots::NUM_TEMPS");
+    static_assert(offsetof(CompiledMethod, primitiveNumber_) ==
+                      CompiledMethodSlots::PRIMITIVE_NUMBER * sizeof(TaggedValue),
+                  "CompiledMethod::primitiveNumber_ is not at slot CompiledMethodSlots::PRIMITIVE_NUMBER");
+    static_assert(offsetof(CompiledMethod, selector_) ==
+                      CompiledMethodSlots::SELECTOR * sizeof(TaggedValue),
+                  "CompiledMethod::selector_ is not at slot CompiledMethodSlots::SELECTOR");
+    static_assert(offsetof(CompiledMethod, methodClass_) ==
+                      CompiledMethodSlots::METHOD_CLASS * sizeof(TaggedValue),
+                  "CompiledMethod::methodClass_ is not at slot CompiledMethodSlots::METHOD_CLASS");
+    static_assert(offsetof(CompiledMethod, handlers_) ==
+                      CompiledMethodSlots::HANDLERS * sizeof(TaggedValue),
+                  "CompiledMethod::handlers_ is not at slot CompiledMethodSlots::HANDLERS");
+};
+
+template <>
+struct MirrorLayout<Context> {
+    static_assert(std::is_standard_layout<Context>::value,
+                  "Context must be standard layout to overlay an object body");
+    static_assert(sizeof(Context) == ContextSlots::COUNT * sizeof(TaggedValue),
+                  "Context must contain only its ST_SLOT fields");
+    static_assert(offsetof(Context, method_) ==
+                      ContextSlots::METHOD * sizeof(TaggedValue),
+                  "Context::method_ is not at slot ContextSlots::METHOD");
+    static_assert(offsetof(Context, receiver_) ==
+                      ContextSlots::RECEIVER * sizeof(TaggedValue),
+                  "Context::receiver_ is not at slot ContextSlots::RECEIVER");
+    static_assert(offsetof(Context, stack_) ==
+                      ContextSlots::STACK * sizeof(TaggedValue),
+                  "Context::stack_ is not at slot ContextSlots::STACK");
+    static_assert(offsetof(Context, instructionPointer_) ==
+                      ContextSlots::INSTRUCTION_POINTER * sizeof(TaggedValue),
+                  "Context::instructionPointer_ is not at slot ContextSlots::INSTRUCTION_POINTER");
+};
+
+template <>
+struct MirrorLayout<Dictionary> {
+    static_assert(std::is_standard_layout<Dictionary>::value,
+                  "Dictionary must be standard layout to overlay an object body");
+    static_assert(sizeof(Dictionary) == DictionarySlots::COUNT * sizeof(TaggedValue),
+                  "Dictionary must contain only its ST_SLOT fields");
+    static_assert(offsetof(Dictionary, tally_) ==
+                      DictionarySlots::TALLY * sizeof(TaggedValue),
+                  "Dictionary::tally_ is not at slot DictionarySlots::TALLY");
+    static_assert(offsetof(Dictionary, growthLeft_) ==
+                      DictionarySlots::GROWTH_LEFT * sizeof(TaggedValue),
+                  "Dictionary::growthLeft_ is not at slot DictionarySlots::GROWTH_LEFT");
+    static_assert(offsetof(Dictionary, control_) ==
+                      DictionarySlots::CONTROL * sizeof(TaggedValue),
+                  "Dictionary::control_ is not at slot DictionarySlots::CONTROL");
+    static_assert(offsetof(Dictionary, slots_) ==
+                      DictionarySlots::SLOTS * sizeof(TaggedValue),
+                  "Dictionary::slots_ is not at slot DictionarySlots::SLOTS");
+    static_assert(offsetof(Dictionary, oldControl_) ==
+                      DictionarySlots::OLD_CONTROL * sizeof(TaggedValue),
+                  "Dictionary::oldControl_ is not at slot DictionarySlots::OLD_CONTROL");
+    static_assert(offsetof(Dictionary, oldSlots_) ==
+                      DictionarySlots::OLD_SLOTS * sizeof(TaggedValue),
+                  "Dictionary::oldSlots_ is not at slot DictionarySlots::OLD_SLOTS");
+    static_assert(offsetof(Dictionary, migrated_) ==
+                      DictionarySlots::MIGRATED * sizeof(TaggedValue),
+                  "Dictionary::migrated_ is not at slot DictionarySlots::MIGRATED");
+};
+
+template <>
+struct MirrorLayout<IOHandle> {
+    static_assert(std::is_standard_layout<IOHandle>::value,
+                  "IOHandle must be standard layout to overlay an object body");
+    static_assert(sizeof(IOHandle) == IOHandleSlots::COUNT * sizeof(TaggedValue),
+                  "IOHandle must contain only its ST_SLOT fields");
+    static_assert(offsetof(IOHandle, handle_) ==
+                      IOHandleSlots::HANDLE * sizeof(TaggedValue),
+                  "IOHandle::handle_ is not at slot IOHandleSlots::HANDLE");
+    static_assert(offsetof(IOHandle, readable_) ==
+                      IOHandleSlots::READABLE * sizeof(TaggedValue),
+                  "IOHandle::readable_ is not at slot IOHandleSlots::READABLE");
+    static_assert(offsetof(IOHandle, writable_) ==
+                      IOHandleSlots::WRITABLE * sizeof(TaggedValue),
+                  "IOHandle::writable_ is not at slot IOHandleSlots::WRITABLE");
+};
+
+template <>
+struct MirrorLayout<Process> {
+    static_assert(std::is_standard_layout<Process>::value,
+                  "Process must be standard layout to overlay an object body");
+    static_assert(sizeof(Process) == ProcessSlots::COUNT * sizeof(TaggedValue),
+                  "Process must contain only its ST_SLOT fields");
+    static_assert(offsetof(Process, nextLink_) ==
+                      ProcessSlots::NEXT_LINK * sizeof(TaggedValue),
+                  "Process::nextLink_ is not at slot ProcessSlots::NEXT_LINK");
+    static_assert(offsetof(Process, myList_) ==
+                      ProcessSlots::MY_LIST * sizeof(TaggedValue),
+                  "Process::myList_ is not at slot ProcessSlots::MY_LIST");
+    static_assert(offsetof(Process, priority_) ==
+                      ProcessSlots::PRIORITY * sizeof(TaggedValue),
+                  "Process::priority_ is not at slot ProcessSlots::PRIORITY");
+    static_assert(offsetof(Process, stackIndex_) ==
+                      ProcessSlots::STACK_INDEX * sizeof(TaggedValue),
+                  "Process::stackIndex_ is not at slot ProcessSlots::STACK_INDEX");
+};
+
+template <>
+struct MirrorLayout<Semaphore> {
+    static_assert(std::is_standard_layout<Semaphore>::value,
+                  "Semaphore must be standard layout to overlay an object body");
+    static_assert(sizeof(Semaphore) == SemaphoreSlots::COUNT * sizeof(TaggedValue),
+                  "Semaphore must contain only its ST_SLOT fields");
+    static_assert(offsetof(Semaphore, firstLink_) ==
+                      SemaphoreSlots::FIRST_LINK * sizeof(TaggedValue),
+                  "Semaphore::firstLink_ is not at slot SemaphoreSlots::FIRST_LINK");
+    static_assert(offsetof(Semaphore, lastLink_) ==
+                      SemaphoreSlots::LAST_LINK * sizeof(TaggedValue),
+                  "Semaphore::lastLink_ is not at slot SemaphoreSlots::LAST_LINK");
+    static_assert(offsetof(Semaphore, excessSignals_) ==
+                      SemaphoreSlots::EXCESS_SIGNALS * sizeof(TaggedValue),
+                  "Semaphore::excessSignals_ is not at slot SemaphoreSlots::EXCESS_SIGNALS");
+};
+
+} // namespace st
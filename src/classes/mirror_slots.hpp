@@ -0,0 +1,86 @@
+#pragma once
+
+// Generated by tools/generate_mirror_slots.py from the ST_SLOT declarations in
+// src/classes/. Do not edit; rerun the generator after changing a mirror class.
+
+#include <cstdint>
+
+namespace st {
+
+struct ArraySlots {
+    static constexpr uint32_t COUNT = 0;
+};
+
+struct BlockClosureSlots {
+    static constexpr uint32_t METHOD = 0;
+    static constexpr uint32_t NUM_ARGS = 1;
+    static constexpr uint32_t RECEIVER = 2;
+    static constexpr uint32_t COUNT = 3;
+};
+
+struct ByteArraySlots {
+    static constexpr uint32_t COUNT = 0;
+};
+
+struct ClassSlots {
+    static constexpr uint32_t SUPERCLASS = 0;
+    static constexpr uint32_t METHODS = 1;
+    static constexpr uint32_t FORMAT = 2;
+    static constexpr uint32_t NAME = 3;
+    static constexpr uint32_t COUNT = 4;
+};
+
+struct CompiledMethodSlots {
+    static constexpr uint32_t BYTES = 0;
+    static constexpr uint32_t LITERALS = 1;
+    static constexpr uint32_t NUM_ARGS = 2;
+    static constexpr uint32_t NUM_TEMPS = 3;
+    static constexpr uint32_t PRIMITIVE_NUMBER = 4;
+    static constexpr uint32_t SELECTOR = 5;
+    static constexpr uint32_t METHOD_CLASS = 6;
+    static constexpr uint32_t HANDLERS = 7;
+    static constexpr uint32_t COUNT = 8;
+};
+
+struct ContextSlots {
+    static constexpr uint32_t METHOD = 0;
+    static constexpr uint32_t RECEIVER = 1;
+    static constexpr uint32_t STACK = 2;
+    static constexpr uint32_t INSTRUCTION_POINTER = 3;
+    static constexpr uint32_t COUNT = 4;
+};
+
+struct DictionarySlots {
+    static constexpr uint32_t TALLY = 0;
+    static constexpr uint32_t GROWTH_LEFT = 1;
+    static constexpr uint32_t CONTROL = 2;
+    static constexpr uint32_t SLOTS = 3;
+    static constexpr uint32_t OLD_CONTROL = 4;
+    static constexpr uint32_t OLD_SLOTS = 5;
+    static constexpr uint32_t MIGRATED = 6;
+    static constexpr uint32_t COUNT = 7;
+};
+
+struct IOHandleSlots {
+    static constexpr uint32_t HANDLE = 0;
+    static constexpr uint32_t READABLE = 1;
+    static constexpr uint32_t WRITABLE = 2;
+    static constexpr uint32_t COUNT = 3;
+};
+
+struct ProcessSlots {
+    static constexpr uint32_t NEXT_LINK = 0;
+    static constexpr uint32_t MY_LIST = 1;
+    static constexpr uint32_t PRIORITY = 2;
+    static constexpr uint32_t STACK_INDEX = 3;
+    static constexpr uint32_t COUNT = 4;
+};
+
+struct SemaphoreSlots {
+    static constexpr uint32_t FIRST_LINK = 0;
+    static constexpr uint32_t LAST_LINK = 1;
+    static constexpr uint32_t EXCESS_SIGNALS = 2;
+    static constexpr uint32_t COUNT = 3;
+};
+
+} // namespace st
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "mirror.hpp"
+#include "mirror_slots.hpp"
+
+/**
+ * Process, Semaphore - C++ views of the Smalltalk objects the Scheduler works on
+ *
+ * Process:
+ * - nextLink: Process after this one in the Semaphore it waits on (nil if last or not waiting)
+ * - myList: Semaphore the process waits on (nil otherwise)
+ * - priority: SmallInteger (Scheduler::LOWEST_PRIORITY to HIGHEST_PRIORITY)
+ * - stackIndex: SmallInteger index of the Scheduler's record holding its native stack;
+ *   nil once terminated (or for a Process that was never forked)
+ *
+ * Semaphore:
+ * - firstLink, lastLink: waiting Processes, linked through nextLink, first to resume first
+ * - excessSignals: SmallInteger; nil (as from Semaphore new) counts as 0
+ */
+namespace st {
+
+class Process {
+public:
+    using Slots = ProcessSlots;
+
+    TaggedValue nextLink() const { return nextLink_; }
+    TaggedValue myList() const { return myList_; }
+    TaggedValue priority() const { return priority_; }
+    TaggedValue stackIndex() const { return stackIndex_; }
+
+private:
+    ST_SLOT(nextLink_);    // Process (object pointer)
+    ST_SLOT(myList_);      // Semaphore (object pointer)
+    ST_SLOT(priority_);    // SmallInteger
+    ST_SLOT(stackIndex_);  // SmallInteger
+
+    friend struct MirrorLayout<Process>;
+};
+
+class Semaphore {
+public:
+    using Slots = SemaphoreSlots;
+
+    TaggedValue firstLink() const { return firstLink_; }
+    TaggedValue lastLink() const { return lastLink_; }
+    int64_t excessSignals() const { return excessSignals_.isNil() ? 0 : excessSignals_.toSmallInteger(); }
+
+private:
+    ST_SLOT(firstLink_);      // Process (object pointer)
+    ST_SLOT(lastLink_);       // Process (object pointer)
+    ST_SLOT(excessSignals_);  // SmallInteger
+
+    friend struct MirrorLayout<Semaphore>;
+};
+
+} // namespace st
@@ -0,0 +1,1607 @@
+#include "compiler.hpp"
+#include "assembler.hpp"
+#include "classes/block_closure.hpp"
+#include "classes/compiled_method.hpp"
+#include "handler_table.hpp"
+#include "vm.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// ============================================================================
+// Lexer
+// ============================================================================
+
+enum class Token {
+    END,
+    IDENTIFIER,
+    KEYWORD,        // identifier followed by ':'
+    BINARY,         // binary selector, also '|' and '<' '>' around pragmas
+    INTEGER,
+    FLOAT,
+    STRING,
+    SYMBOL,
+    CHARACTER,
+    ASSIGN,
+    CARET,
+    COLON,
+    PERIOD,
+    SEMICOLON,
+    LEFT_PAREN,
+    RIGHT_PAREN,
+    LEFT_BRACKET,
+    RIGHT_BRACKET,
+    LITERAL_ARRAY,  // #(
+};
+
+struct Lexeme {
+    Token kind = Token::END;
+    std::string text;
+    int64_t integer = 0;
+    double number = 0.0;
+    int line = 1;
+};
+
+bool isBinaryChar(char c) {
+    switch (c) {
+    case '+': case '-': case '*': case '/': case '\\': case '<': case '>': case '=':
+    case '~': case '@': case '%': case '|': case '&': case '?': case ',':
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isIdentifierStart(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isDigit(char c) {
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+class Lexer {
+public:
+    explicit Lexer(std::string_view source) : source_(source) {}
+
+    Lexeme next() {
+        skipWhitespaceAndComments();
+        Lexeme token;
+        token.line = line_;
+        if (pos_ >= source_.size()) {
+            return token;
+        }
+        char c = peek();
+        if (isIdentifierStart(c)) {
+            size_t start = pos_;
+            while (isIdentifierChar(peek())) {
+                pos_++;
+            }
+            if (peek() == ':' && peek(1) != '=') {
+                pos_++;
+                token.kind = Token::KEYWORD;
+            } else {
+                token.kind = Token::IDENTIFIER;
+            }
+            token.text = std::string(source_.substr(start, pos_ - start));
+        } else if (isDigit(c)) {
+            number(token, false);
+        } else if (c == '-' && isDigit(peek(1)) && !followsOperand()) {
+            pos_++;
+            number(token, true);
+        } else if (c == '\'') {
+            token.kind = Token::STRING;
+            token.text = string();
+        } else if (c == '$') {
+            if (pos_ + 1 >= source_.size()) {
+                error("Character literal expected");
+            }
+            token.kind = Token::CHARACTER;
+            token.integer = static_cast<unsigned char>(source_[pos_ + 1]);
+            pos_ += 2;
+        } else if (c == '#') {
+            symbol(token);
+        } else if (c == ':') {
+            token.kind = peek(1) == '=' ? Token::ASSIGN : Token::COLON;
+            pos_ += token.kind == Token::ASSIGN ? 2 : 1;
+        } else if (c == '|') {
+            // Always a single character, so "||" reads as two bars around empty temporaries
+            token.kind = Token::BINARY;
+            token.text = "|";
+            pos_++;
+        } else if (isBinaryChar(c)) {
+            size_t start = pos_;
+            while (isBinaryChar(peek()) && peek() != '|') {
+                pos_++;
+            }
+            token.kind = Token::BINARY;
+            token.text = std::string(source_.substr(start, pos_ - start));
+        } else {
+            pos_++;
+            switch (c) {
+            case '^': token.kind = Token::CARET; break;
+            case '.': token.kind = Token::PERIOD; break;
+            case ';': token.kind = Token::SEMICOLON; break;
+            case '(': token.kind = Token::LEFT_PAREN; break;
+            case ')': token.kind = Token::RIGHT_PAREN; break;
+            case '[': token.kind = Token::LEFT_BRACKET; break;
+            case ']': token.kind = Token::RIGHT_BRACKET; break;
+            default: error(std::string("Unexpected character '") + c + "'");
+            }
+        }
+        last_ = token.kind;
+        return token;
+    }
+
+private:
+    char peek(size_t ahead = 0) const {
+        return pos_ + ahead < source_.size() ? source_[pos_ + ahead] : '\0';
+    }
+
+    [[noreturn]] void error(const std::string& message) const { throw CompileError(line_, message); }
+
+    // A '-' right after an operand is a binary minus, anywhere else it starts a literal
+    bool followsOperand() const {
+        switch (last_) {
+        case Token::IDENTIFIER: case Token::INTEGER: case Token::FLOAT: case Token::STRING:
+        case Token::SYMBOL: case Token::CHARACTER: case Token::RIGHT_PAREN: case Token::RIGHT_BRACKET:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void skipWhitespaceAndComments() {
+        while (pos_ < source_.size()) {
+            char c = peek();
+            if (c == '\n') {
+                line_++;
+                pos_++;
+            } else if (std::isspace(static_cast<unsigned char>(c))) {
+                pos_++;
+            } else if (c == '"') {
+                pos_++;
+                while (pos_ < source_.size() && peek() != '"') {
+                    line_ += peek() == '\n';
+                    pos_++;
+                }
+                if (pos_ >= source_.size()) {
+                    error("Unterminated comment");
+                }
+                pos_++;
+            } else {
+                break;
+            }
+        }
+    }
+
+    // Digits in base radix; answers false on overflow
+    static bool accumulate(int64_t& value, int digit, int64_t radix) {
+        return !__builtin_mul_overflow(value, radix, &value) && !__builtin_add_overflow(value, digit, &value);
+    }
+
+    static int digitValue(char c) {
+        if (isDigit(c)) {
+            return c - '0';
+        }
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A' + 10;
+        }
+        return 99;
+    }
+
+    void number(Lexeme& token, bool negative) {
+        size_t start = pos_;
+        int64_t value = 0;
+        while (isDigit(peek())) {
+            if (!accumulate(value, peek() - '0', 10)) {
+                error("Integer literal too large");
+            }
+            pos_++;
+        }
+        if (peek() == 'r' && value >= 2 && value <= 36 && digitValue(peek(1)) < value) {
+            int64_t radix = value;
+            value = 0;
+            pos_++;
+            while (digitValue(peek()) < radix) {
+                if (!accumulate(value, digitValue(peek()), radix)) {
+                    error("Integer literal too large");
+                }
+                pos_++;
+            }
+        } else if ((peek() == '.' && isDigit(peek(1))) ||
+                   (peek() == 'e' && (isDigit(peek(1)) || (peek(1) == '-' && isDigit(peek(2)))))) {
+            if (peek() == '.') {
+                pos_++;
+                while (isDigit(peek())) {
+                    pos_++;
+                }
+            }
+            if (peek() == 'e' && (isDigit(peek(1)) || (peek(1) == '-' && isDigit(peek(2))))) {
+                pos_ += 2;
+                while (isDigit(peek())) {
+                    pos_++;
+                }
+            }
+            std::string text(source_.substr(start, pos_ - start));
+            token.kind = Token::FLOAT;
+            token.number = std::strtod(text.c_str(), nullptr) * (negative ? -1.0 : 1.0);
+            return;
+        }
+        token.kind = Token::INTEGER;
+        token.integer = negative ? -value : value;
+    }
+
+    // Quoted string starting at the current quote; '' stands for one quote
+    std::string string() {
+        std::string text;
+        pos_++;
+        for (;;) {
+            if (pos_ >= source_.size()) {
+                error("Unterminated string");
+            }
+            char c = source_[pos_++];
+            if (c == '\'') {
+                if (peek() != '\'') {
+                    return text;
+                }
+                pos_++;
+            }
+            line_ += c == '\n';
+            text += c;
+        }
+    }
+
+    void symbol(Lexeme& token) {
+        char c = peek(1);
+        if (c == '(') {
+            token.kind = Token::LITERAL_ARRAY;
+            pos_ += 2;
+            return;
+        }
+        pos_++;
+        token.kind = Token::SYMBOL;
+        if (c == '\'') {
+            token.text = string();
+        } else if (isIdentifierStart(c)) {
+            size_t start = pos_;
+            while (isIdentifierChar(peek()) || peek() == ':') {
+                pos_++;
+            }
+            token.text = std::string(source_.substr(start, pos_ - start));
+        } else if (isBinaryChar(c)) {
+            size_t start = pos_;
+            while (isBinaryChar(peek())) {
+                pos_++;
+            }
+            token.text = std::string(source_.substr(start, pos_ - start));
+        } else {
+            error("Symbol expected after #");
+        }
+    }
+
+    std::string_view source_;
+    size_t pos_ = 0;
+    int line_ = 1;
+    Token last_ = Token::END;
+};
+
+// ============================================================================
+// Syntax tree
+// ============================================================================
+
+// Literal values stay in C++ form until code generation, so the tree holds no heap
+// objects a collection could move.
+struct Literal {
+    enum Kind { NIL, TRUE, FALSE, INTEGER, FLOAT, STRING, SYMBOL, ARRAY };
+
+    Kind kind = NIL;
+    int64_t integer = 0;
+    double number = 0.0;
+    std::string text;
+    std::vector<Literal> elements;
+};
+
+struct Node;
+using NodePtr = std::unique_ptr<Node>;
+
+struct Node {
+    enum Kind {
+        LITERAL,
+        VARIABLE,
+        ASSIGN,            // name := value
+        SEND,              // receiver name args
+        CASCADE,           // receiver, then each part sent to it
+        CASCADE_RECEIVER,  // stands for the cascade receiver inside a part
+        BLOCK,
+        RETURN,            // ^value
+    };
+
+    Node(Kind kind, int line) : kind(kind), line(line) {}
+
+    Kind kind;
+    int line;
+    Literal literal;
+    std::string name;
+    NodePtr value;                       // SEND/CASCADE receiver, ASSIGN/RETURN value
+    std::vector<NodePtr> args;           // SEND arguments, CASCADE parts
+    std::vector<std::string> parameters; // BLOCK
+    std::vector<std::string> temporaries;
+    std::vector<NodePtr> statements;
+};
+
+struct MethodNode {
+    std::string selector;
+    std::vector<std::string> parameters;
+    std::vector<std::string> temporaries;
+    uint32_t primitive = 0;
+    std::vector<NodePtr> statements;
+};
+
+// ============================================================================
+// Parser
+// ============================================================================
+
+class Parser {
+public:
+    explicit Parser(std::string_view source) : lexer_(source) {
+        current_ = lexer_.next();
+        next_ = lexer_.next();
+    }
+
+    MethodNode parseMethod() {
+        MethodNode method;
+        parsePattern(method);
+        parsePragma(method);
+        parseTemporaries(method.temporaries);
+        parsePragma(method);
+        parseStatements(method.statements);
+        if (current_.kind != Token::END) {
+            error("Unexpected token");
+        }
+        return method;
+    }
+
+private:
+    void advance() {
+        current_ = std::move(next_);
+        next_ = lexer_.next();
+    }
+
+    bool atBinary(const char* text) const {
+        return current_.kind == Token::BINARY && current_.text == text;
+    }
+
+    void expect(Token kind, const char* what) {
+        if (current_.kind != kind) {
+            error(std::string(what) + " expected");
+        }
+        advance();
+    }
+
+    std::string expectIdentifier() {
+        if (current_.kind != Token::IDENTIFIER) {
+            error("Identifier expected");
+        }
+        std::string name = current_.text;
+        advance();
+        return name;
+    }
+
+    [[noreturn]] void error(const std::string& message) const {
+        throw CompileError(current_.line, message);
+    }
+
+    NodePtr node(Node::Kind kind) const { return std::make_unique<Node>(kind, current_.line); }
+
+    void parsePattern(MethodNode& method) {
+        if (current_.kind == Token::IDENTIFIER) {
+            method.selector = current_.text;
+            advance();
+        } else if (current_.kind == Token::BINARY) {
+            method.selector = current_.text;
+            advance();
+            method.parameters.push_back(expectIdentifier());
+        } else if (current_.kind == Token::KEYWORD) {
+            while (current_.kind == Token::KEYWORD) {
+                method.selector += current_.text;
+                advance();
+                method.parameters.push_back(expectIdentifier());
+            }
+        } else {
+            error("Message pattern expected");
+        }
+    }
+
+    void parsePragma(MethodNode& method) {
+        if (!atBinary("<")) {
+            return;
+        }
+        advance();
+        if (current_.kind != Token::KEYWORD || current_.text != "primitive:") {
+            error("primitive: expected");
+        }
+        advance();
+        if (current_.kind != Token::INTEGER || current_.integer <= 0) {
+            error("Primitive number expected");
+        }
+        method.primitive = static_cast<uint32_t>(current_.integer);
+        advance();
+        if (!atBinary(">")) {
+            error("> expected");
+        }
+        advance();
+    }
+
+    void parseTemporaries(std::vector<std::string>& temporaries) {
+        if (!atBinary("|")) {
+            return;
+        }
+        advance();
+        while (current_.kind == Token::IDENTIFIER) {
+            temporaries.push_back(current_.text);
+            advance();
+        }
+        if (!atBinary("|")) {
+            error("| expected");
+        }
+        advance();
+    }
+
+    void parseStatements(std::vector<NodePtr>& statements) {
+        while (current_.kind != Token::END && current_.kind != Token::RIGHT_BRACKET) {
+            statements.push_back(parseStatement());
+            if (current_.kind != Token::PERIOD) {
+                break;
+            }
+            while (current_.kind == Token::PERIOD) {
+                advance();
+            }
+        }
+    }
+
+    NodePtr parseStatement() {
+        if (current_.kind == Token::CARET) {
+            NodePtr result = node(Node::RETURN);
+            advance();
+            result->value = parseExpression();
+            return result;
+        }
+        return parseExpression();
+    }
+
+    NodePtr parseExpression() {
+        if (current_.kind == Token::IDENTIFIER && next_.kind == Token::ASSIGN) {
+            NodePtr assign = node(Node::ASSIGN);
+            assign->name = current_.text;
+            advance();
+            advance();
+            assign->value = parseExpression();
+            return assign;
+        }
+        NodePtr expression = parseMessages(parsePrimary());
+        if (current_.kind != Token::SEMICOLON) {
+            return expression;
+        }
+        if (expression->kind != Node::SEND) {
+            error("Cascade needs a message send");
+        }
+        // The receiver of the last message is sent every part of the cascade.
+        NodePtr cascade = std::make_unique<Node>(Node::CASCADE, expression->line);
+        cascade->value = std::move(expression->value);
+        expression->value = std::make_unique<Node>(Node::CASCADE_RECEIVER, expression->line);
+        cascade->args.push_back(std::move(expression));
+        while (current_.kind == Token::SEMICOLON) {
+            advance();
+            NodePtr part = parseMessages(node(Node::CASCADE_RECEIVER));
+            if (part->kind != Node::SEND) {
+                error("Message expected in cascade");
+            }
+            cascade->args.push_back(std::move(part));
+        }
+        return cascade;
+    }
+
+    NodePtr send(NodePtr receiver, std::string selector, int line) {
+        NodePtr message = std::make_unique<Node>(Node::SEND, line);
+        message->value = std::move(receiver);
+        message->name = std::move(selector);
+        return message;
+    }
+
+    NodePtr parseUnaryMessages(NodePtr receiver) {
+        while (current_.kind == Token::IDENTIFIER) {
+            receiver = send(std::move(receiver), current_.text, current_.line);
+            advance();
+        }
+        return receiver;
+    }
+
+    NodePtr parseBinaryMessages(NodePtr receiver) {
+        while (current_.kind == Token::BINARY) {
+            NodePtr message = send(std::move(receiver), current_.text, current_.line);
+            advance();
+            message->args.push_back(parseUnaryMessages(parsePrimary()));
+            receiver = std::move(message);
+        }
+        return receiver;
+    }
+
+    NodePtr parseMessages(NodePtr receiver) {
+        receiver = parseBinaryMessages(parseUnaryMessages(std::move(receiver)));
+        if (current_.kind != Token::KEYWORD) {
+            return receiver;
+        }
+        NodePtr message = send(std::move(receiver), "", current_.line);
+        while (current_.kind == Token::KEYWORD) {
+            message->name += current_.text;
+            advance();
+            message->args.push_back(parseBinaryMessages(parseUnaryMessages(parsePrimary())));
+        }
+        return message;
+    }
+
+    NodePtr parsePrimary() {
+        NodePtr result;
+        switch (current_.kind) {
+        case Token::IDENTIFIER:
+            result = node(Node::VARIABLE);
+            result->name = current_.text;
+            advance();
+            return result;
+        case Token::LEFT_PAREN:
+            advance();
+            result = parseExpression();
+            expect(Token::RIGHT_PAREN, ")");
+            return result;
+        case Token::LEFT_BRACKET:
+            return parseBlock();
+        case Token::LITERAL_ARRAY:
+            result = node(Node::LITERAL);
+            advance();
+            result->literal = parseLiteralArray();
+            return result;
+        default:
+            result = node(Node::LITERAL);
+            if (!parseScalarLiteral(result->literal)) {
+                error("Expression expected");
+            }
+            return result;
+        }
+    }
+
+    // Number, string, symbol or character at the current token
+    bool parseScalarLiteral(Literal& literal) {
+        switch (current_.kind) {
+        case Token::INTEGER:
+        case Token::CHARACTER:
+            literal.kind = Literal::INTEGER;
+            literal.integer = current_.integer;
+            break;
+        case Token::FLOAT:
+            literal.kind = Literal::FLOAT;
+            literal.number = current_.number;
+            break;
+        case Token::STRING:
+            literal.kind = Literal::STRING;
+            literal.text = current_.text;
+            break;
+        case Token::SYMBOL:
+            literal.kind = Literal::SYMBOL;
+            literal.text = current_.text;
+            break;
+        default:
+            return false;
+        }
+        advance();
+        return true;
+    }
+
+    // Elements up to the closing parenthesis; the opening one has been consumed
+    Literal parseLiteralArray() {
+        Literal array;
+        array.kind = Literal::ARRAY;
+        while (current_.kind != Token::RIGHT_PAREN) {
+            Literal element;
+            if (current_.kind == Token::END) {
+                error(") expected");
+            } else if (current_.kind == Token::LEFT_PAREN || current_.kind == Token::LITERAL_ARRAY) {
+                advance();
+                element = parseLiteralArray();
+            } else if (current_.kind == Token::IDENTIFIER) {
+                const std::string& name = current_.text;
+                element.kind = name == "nil" ? Literal::NIL
+                             : name == "true" ? Literal::TRUE
+                             : name == "false" ? Literal::FALSE
+                             : Literal::SYMBOL;
+                element.text = name;
+                advance();
+            } else if (current_.kind == Token::KEYWORD || current_.kind == Token::BINARY) {
+                bool minus = current_.text == "-";
+                element.kind = Literal::SYMBOL;
+                element.text = current_.text;
+                advance();
+                if (minus && (current_.kind == Token::INTEGER || current_.kind == Token::FLOAT)) {
+                    parseScalarLiteral(element);
+                    element.integer = -element.integer;
+                    element.number = -element.number;
+                }
+            } else if (!parseScalarLiteral(element)) {
+                error("Literal expected");
+            }
+            array.elements.push_back(std::move(element));
+        }
+        advance();
+        return array;
+    }
+
+    NodePtr parseBlock() {
+        NodePtr block = node(Node::BLOCK);
+        advance();
+        while (current_.kind == Token::COLON) {
+            advance();
+            block->parameters.push_back(expectIdentifier());
+        }
+        if (!block->parameters.empty()) {
+            if (atBinary("|")) {
+                advance();
+            } else if (current_.kind != Token::RIGHT_BRACKET) {
+                error("| expected");
+            }
+        }
+        parseTemporaries(block->temporaries);
+        parseStatements(block->statements);
+        expect(Token::RIGHT_BRACKET, "]");
+        return block;
+    }
+
+    Lexer lexer_;
+    Lexeme current_;
+    Lexeme next_;
+};
+
+// ============================================================================
+// Inlining
+// ============================================================================
+
+bool isBlock(const NodePtr& node, size_t parameters) {
+    return node->kind == Node::BLOCK && node->parameters.size() == parameters;
+}
+
+bool isValueSelector(const std::string& selector) {
+    return selector == "value" || selector == "value:" || selector == "value:value:" ||
+           selector == "value:value:value:";
+}
+
+// Sends that compile to jumps instead of a send (see Compiler)
+enum class Inlining { NONE, IF, IF_ELSE, SHORT_CIRCUIT, WHILE, TIMES_REPEAT, ON_DO, ENSURE, VALUE, TO_DO };
+
+Inlining inliningOf(const Node& send) {
+    const std::string& selector = send.name;
+    const std::vector<NodePtr>& args = send.args;
+    if ((selector == "ifTrue:" || selector == "ifFalse:") && isBlock(args[0], 0)) {
+        return Inlining::IF;
+    }
+    if ((selector == "ifTrue:ifFalse:" || selector == "ifFalse:ifTrue:") && isBlock(args[0], 0) &&
+        isBlock(args[1], 0)) {
+        return Inlining::IF_ELSE;
+    }
+    if ((selector == "and:" || selector == "or:") && isBlock(args[0], 0)) {
+        return Inlining::SHORT_CIRCUIT;
+    }
+    bool whileSelector = selector == "whileTrue:" || selector == "whileFalse:" || selector == "whileTrue" ||
+                         selector == "whileFalse";
+    if (whileSelector && isBlock(send.value, 0) && (args.empty() || isBlock(args[0], 0))) {
+        return Inlining::WHILE;
+    }
+    if (selector == "timesRepeat:" && isBlock(args[0], 0)) {
+        return Inlining::TIMES_REPEAT;
+    }
+    if (selector == "on:do:" && isBlock(send.value, 0) && (isBlock(args[1], 1) || isBlock(args[1], 0))) {
+        return Inlining::ON_DO;
+    }
+    if (selector == "ensure:" && isBlock(send.value, 0) && isBlock(args[0], 0)) {
+        return Inlining::ENSURE;
+    }
+    if (isValueSelector(selector) && isBlock(send.value, args.size())) {
+        return Inlining::VALUE;
+    }
+    bool toDo = selector == "to:do:" && isBlock(args[1], 1);
+    bool toByDo = selector == "to:by:do:" && isBlock(args[2], 1) && args[1]->kind == Node::LITERAL &&
+                  args[1]->literal.kind == Literal::INTEGER && args[1]->literal.integer != 0;
+    if (toDo || toByDo) {
+        return Inlining::TO_DO;
+    }
+    return Inlining::NONE;
+}
+
+// The receiver and arguments of send that are inlined blocks
+std::vector<const Node*> inlinedBlocks(const Node& send) {
+    const std::vector<NodePtr>& args = send.args;
+    switch (inliningOf(send)) {
+    case Inlining::NONE:
+        break;
+    case Inlining::IF:
+    case Inlining::SHORT_CIRCUIT:
+    case Inlining::TIMES_REPEAT:
+        return {args[0].get()};
+    case Inlining::IF_ELSE:
+        return {args[0].get(), args[1].get()};
+    case Inlining::WHILE:
+        if (args.empty()) {
+            return {send.value.get()};
+        }
+        return {send.value.get(), args[0].get()};
+    case Inlining::ON_DO:
+        return {send.value.get(), args[1].get()};
+    case Inlining::ENSURE:
+        return {send.value.get(), args[0].get()};
+    case Inlining::VALUE:
+        return {send.value.get()};
+    case Inlining::TO_DO:
+        return {args.back().get()};
+    }
+    return {};
+}
+
+// A statement whose value is dropped and that assigns a block to a variable: the block
+// may live in the frame (see CodeGenerator::generateEffect)
+bool isBlockAssignment(const Node& statement) {
+    return statement.kind == Node::ASSIGN && statement.value->kind == Node::BLOCK;
+}
+
+// ============================================================================
+// Variable analysis
+// ============================================================================
+
+// How a method's blocks that are not inlined use the variables around them, found
+// before code generation so each variable can be laid out once: temporaries that such
+// a block captures and that are assigned move to a temp vector, the others are copied
+// into the block. Walks the tree with the same scopes the code generator declares.
+class VariableAnalysis {
+public:
+    struct Declaration {
+        bool captured = false;         // Used by a block that is not inlined
+        bool assigned = false;
+        bool holdsStackBlocks = false; // Assigned a block by a statement of its own
+    };
+
+    VariableAnalysis(const MethodNode& method, const std::vector<std::string>& instanceVariables)
+        : instanceVariables_(instanceVariables) {
+        enter(&method, nullptr, method.parameters, method.temporaries);
+        visitStatements(method.statements, false);
+    }
+
+    // The variable name declared by owner: the MethodNode, or the block Node whose
+    // argument or temporary it is
+    Declaration declaration(const void* owner, const std::string& name) const {
+        auto it = declarations_.find(Key{owner, name});
+        return it != declarations_.end() ? it->second : Declaration{};
+    }
+    // Variables of the methods and blocks around block that it uses, in order of first use
+    const std::vector<std::string>& captures(const Node& block) const {
+        static const std::vector<std::string> none;
+        auto it = captures_.find(&block);
+        return it != captures_.end() ? it->second : none;
+    }
+    // Uses no self, instance variables or captured variables, so one closure serves
+    // every evaluation
+    bool isClean(const Node& block) const { return captures(block).empty() && usesSelf_.count(&block) == 0; }
+
+private:
+    using Key = std::pair<const void*, std::string>;
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<const void*>()(key.first) ^ std::hash<std::string>()(key.second);
+        }
+    };
+    struct Scope {
+        const void* owner;
+        const Node* closure;  // The block, if this is a block that is not inlined
+        std::vector<std::string> names;
+    };
+
+    void enter(const void* owner, const Node* closure, const std::vector<std::string>& parameters,
+               const std::vector<std::string>& temporaries) {
+        scopes_.push_back(Scope{owner, closure, parameters});
+        scopes_.back().names.insert(scopes_.back().names.end(), temporaries.begin(), temporaries.end());
+    }
+
+    void visitStatements(const std::vector<NodePtr>& statements, bool lastIsValue) {
+        for (size_t i = 0; i < statements.size(); i++) {
+            if ((!lastIsValue || i + 1 < statements.size()) && isBlockAssignment(*statements[i])) {
+                if (Declaration* declaration = find(statements[i]->name, nullptr)) {
+                    declaration->holdsStackBlocks = true;
+                }
+            }
+            visit(*statements[i]);
+        }
+    }
+
+    void visitBlock(const Node& block, bool inlined) {
+        enter(&block, inlined ? nullptr : &block, block.parameters, block.temporaries);
+        visitStatements(block.statements, true);
+        scopes_.pop_back();
+    }
+
+    void visit(const Node& node) {
+        switch (node.kind) {
+        case Node::LITERAL:
+        case Node::CASCADE_RECEIVER:
+            break;
+        case Node::VARIABLE:
+            use(node.name, false);
+            break;
+        case Node::ASSIGN:
+            use(node.name, true);
+            visit(*node.value);
+            break;
+        case Node::SEND: {
+            std::vector<const Node*> inlined = inlinedBlocks(node);
+            auto visitOperand = [&](const Node& operand) {
+                if (std::find(inlined.begin(), inlined.end(), &operand) != inlined.end()) {
+                    visitBlock(operand, true);
+                } else {
+                    visit(operand);
+                }
+            };
+            visitOperand(*node.value);
+            for (const NodePtr& arg : node.args) {
+                visitOperand(*arg);
+            }
+            break;
+        }
+        case Node::CASCADE:
+            visit(*node.value);
+            for (const NodePtr& part : node.args) {
+                visit(*part);
+            }
+            break;
+        case Node::BLOCK:
+            visitBlock(node, false);
+            break;
+        case Node::RETURN:
+            visit(*node.value);
+            break;
+        }
+    }
+
+    // Declaration of name in scope, innermost first; collects the blocks that are not
+    // inlined between here and it into crossed, if given
+    Declaration* find(const std::string& name, std::vector<const Node*>* crossed) {
+        for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+            if (std::find(scope->names.begin(), scope->names.end(), name) != scope->names.end()) {
+                return &declarations_[Key{scope->owner, name}];
+            }
+            if (scope->closure != nullptr) {
+                if (crossed == nullptr) {
+                    return nullptr;
+                }
+                crossed->push_back(scope->closure);
+            }
+        }
+        return nullptr;
+    }
+
+    void use(const std::string& name, bool assigned) {
+        std::vector<const Node*> crossed;
+        if (Declaration* declaration = find(name, &crossed)) {
+            declaration->assigned = declaration->assigned || assigned;
+            declaration->captured = declaration->captured || !crossed.empty();
+            for (const Node* block : crossed) {
+                std::vector<std::string>& names = captures_[block];
+                if (std::find(names.begin(), names.end(), name) == names.end()) {
+                    names.push_back(name);
+                }
+            }
+        } else if (name == "self" ||
+                   std::find(instanceVariables_.begin(), instanceVariables_.end(), name) !=
+                       instanceVariables_.end()) {
+            // self reaches a nested block through every block around it
+            for (const Node* block : crossed) {
+                usesSelf_.insert(block);
+            }
+        }
+    }
+
+    const std::vector<std::string>& instanceVariables_;
+    std::vector<Scope> scopes_;
+    std::unordered_map<Key, Declaration, KeyHash> declarations_;
+    std::unordered_map<const Node*, std::vector<std::string>> captures_;
+    std::unordered_set<const Node*> usesSelf_;
+};
+
+// ============================================================================
+// Code generation
+// ============================================================================
+
+class CodeGenerator {
+public:
+    CodeGenerator(VM& vm, uint32_t classIndex, const VariableAnalysis& analysis,
+                  const CodeGenerator* outer = nullptr)
+        : vm_(vm), classIndex_(classIndex), instanceVariables_(vm.instanceVariableNames(classIndex)),
+          analysis_(analysis), outer_(outer), selector_(outer != nullptr ? outer->selector_ : "") {}
+
+    Compiler::Result generate(const MethodNode& method) {
+        MemoryManager::ScopedRoots literalRoots(vm_.memory(), assembler_.literals());
+        selector_ = method.selector;
+
+        scopes_.emplace_back();
+        for (const std::string& name : method.parameters) {
+            declare(name, Variable{newTemporary(), false}, 1);
+        }
+        declareTemporaries(&method, method.temporaries, 1, false);
+
+        bool returned = false;
+        for (const NodePtr& statement : method.statements) {
+            returned = statement->kind == Node::RETURN;
+            if (returned) {
+                generate(*statement);
+            } else {
+                generateEffect(*statement);
+            }
+        }
+        if (!returned) {
+            assembler_.pushSelf();
+            assembler_.returnTop();
+        }
+
+        std::vector<TaggedValue> result;
+        MemoryManager::ScopedRoots resultRoots(vm_.memory(), result);
+        result.push_back(vm_.symbols().intern(method.selector));
+        uint32_t numArgs = static_cast<uint32_t>(method.parameters.size());
+        result.push_back(vm_.newMethod(assembler_.bytecodes(), assembler_.literals(), numArgs,
+                                       tempCount_ - numArgs, method.primitive, handler_table::encode(handlers_)));
+        return Compiler::Result{result[0], result[1]};
+    }
+
+    // Method of a block that is not inlined, answering the value of its last statement
+    // and named "[] in selector" after the method. Its temporaries are the block's
+    // arguments, then the values CREATE_BLOCK copies into it, then the block's own
+    // temporaries. A captured variable that lives in a temp vector is reached through a
+    // copy of the vector. Adds the temporaries of this generator's outer generator the
+    // copied values come from to copied.
+    TaggedValue generateBlockMethod(const Node& block, std::vector<uint32_t>& copied) {
+        MemoryManager::ScopedRoots literalRoots(vm_.memory(), assembler_.literals());
+        scopes_.emplace_back();
+        for (const std::string& name : block.parameters) {
+            declare(name, Variable{newTemporary(), false}, block.line);
+        }
+        std::unordered_map<uint32_t, uint32_t> vectors;  // Outer temp vector -> copy
+        for (const std::string& name : analysis_.captures(block)) {
+            const Variable* outer = outer_->findTemporary(name);
+            if (outer == nullptr) {
+                error(block, "Undefined variable " + name);
+            }
+            if (outer->vector == NO_VECTOR) {
+                copied.push_back(outer->index);
+                declare(name, Variable{newTemporary(), outer->assignable}, block.line);
+                continue;
+            }
+            auto vector = vectors.find(outer->vector);
+            if (vector == vectors.end()) {
+                copied.push_back(outer->vector);
+                vector = vectors.emplace(outer->vector, newTemporary()).first;
+            }
+            declare(name, Variable{outer->index, outer->assignable, vector->second}, block.line);
+        }
+        declareTemporaries(&block, block.temporaries, block.line, false);
+        if (block.statements.empty()) {
+            assembler_.pushLiteral(TaggedValue::nil());
+        }
+        for (size_t i = 0; i < block.statements.size(); i++) {
+            if (i + 1 < block.statements.size()) {
+                generateEffect(*block.statements[i]);
+            } else {
+                generate(*block.statements[i]);
+            }
+        }
+        assembler_.returnTop();
+
+        std::vector<TaggedValue> result;
+        MemoryManager::ScopedRoots resultRoots(vm_.memory(), result);
+        result.push_back(symbol("[] in " + selector_));
+        uint32_t numArgs = static_cast<uint32_t>(block.parameters.size());
+        result.push_back(vm_.newMethod(assembler_.bytecodes(), assembler_.literals(), numArgs,
+                                       tempCount_ - numArgs, 0, handler_table::encode(handlers_)));
+        ObjectHeader* method = ObjectHeader::fromTaggedValue(result[1]);
+        vm_.memory().storePointer(method, st::CompiledMethodSlots::SELECTOR, result[0]);
+        vm_.memory().storePointer(method, st::CompiledMethodSlots::METHOD_CLASS,
+                                  vm_.classes().classAt(classIndex_));
+        return result[1];
+    }
+
+private:
+    static constexpr uint32_t NO_VECTOR = 0xFFFFFFFF;
+
+    struct Variable {
+        uint32_t index;                   // Of the temporary, or of the slot in the temp vector
+        bool assignable;
+        uint32_t vector = NO_VECTOR;      // Temporary holding the temp vector, if in one
+        bool holdsStackBlocks = false;    // May hold a stack block (see bytecode.hpp)
+    };
+
+    // An ensure: whose body is being generated. Its protected range is split around the
+    // copies of its cleanup that run before each ^ in the body.
+    struct EnsureScope {
+        const Node* cleanup;
+        uint32_t rangeStart;
+        uint32_t depth;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    };
+
+    [[noreturn]] static void error(const Node& node, const std::string& message) {
+        throw CompileError(node.line, message);
+    }
+
+    uint32_t newTemporary() { return tempCount_++; }
+
+    void declare(const std::string& name, const Variable& variable, int line) {
+        if (!scopes_.back().emplace(name, variable).second) {
+            throw CompileError(line, "Duplicate variable " + name);
+        }
+    }
+
+    // Declares the temporaries of owner (the MethodNode or a block Node). Those that
+    // blocks capture and that are assigned go into a temp vector, made here; with
+    // startNil the others are set to nil here.
+    void declareTemporaries(const void* owner, const std::vector<std::string>& names, int line, bool startNil) {
+        uint32_t vector = NO_VECTOR;
+        uint32_t remote = 0;
+        for (const std::string& name : names) {
+            VariableAnalysis::Declaration declaration = analysis_.declaration(owner, name);
+            if (declaration.captured && declaration.assigned) {
+                if (vector == NO_VECTOR) {
+                    vector = newTemporary();
+                }
+                declare(name, Variable{remote++, true, vector}, line);
+                continue;
+            }
+            declare(name, Variable{newTemporary(), true, NO_VECTOR, declaration.holdsStackBlocks}, line);
+            if (startNil) {
+                assembler_.pushLiteral(TaggedValue::nil());
+                assembler_.storeTemporary(scopes_.back().at(name).index);
+                assembler_.pop();
+            }
+        }
+        if (vector != NO_VECTOR) {
+            assembler_.pushLiteral(vm_.classes().classAt(vm_.kernel().array));
+            assembler_.pushLiteral(TaggedValue::fromSmallInteger(remote));
+            assembler_.send(symbol("new:"), 1);
+            assembler_.storeTemporary(vector);
+            assembler_.pop();
+        }
+    }
+
+    // Pushes a temporary. With escaping false the value may be a stack block, for
+    // EXECUTE_BLOCK.
+    void pushTemporary(const Variable& temp, bool escaping = true) {
+        if (temp.vector != NO_VECTOR) {
+            assembler_.pushRemoteTemporary(temp.index, temp.vector);
+        } else if (temp.holdsStackBlocks && escaping) {
+            assembler_.pushEscapingTemporary(temp.index);
+        } else {
+            assembler_.pushTemporary(temp.index);
+        }
+    }
+
+    const Variable* findTemporary(const std::string& name) const {
+        for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it != scope->end()) {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    int findInstanceVariable(const std::string& name) const {
+        for (size_t i = 0; i < instanceVariables_.size(); i++) {
+            if (instanceVariables_[i] == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    TaggedValue symbol(const std::string& name) { return vm_.symbols().intern(name); }
+
+    TaggedValue materialize(const Literal& literal, const Node& node) {
+        switch (literal.kind) {
+        case Literal::NIL:
+            return TaggedValue::nil();
+        case Literal::TRUE:
+            return TaggedValue::trueValue();
+        case Literal::FALSE:
+            return TaggedValue::falseValue();
+        case Literal::INTEGER:
+            if (literal.integer < -(int64_t(1) << 61) || literal.integer >= (int64_t(1) << 61)) {
+                error(node, "Integer literal out of SmallInteger range");
+            }
+            return TaggedValue::fromSmallInteger(literal.integer);
+        case Literal::FLOAT:
+            return vm_.newFloat(literal.number);
+        case Literal::STRING:
+            return vm_.newString(literal.text);
+        case Literal::SYMBOL:
+            return symbol(literal.text);
+        case Literal::ARRAY: {
+            std::vector<TaggedValue> elements;
+            MemoryManager::ScopedRoots roots(vm_.memory(), elements);
+            for (const Literal& element : literal.elements) {
+                TaggedValue value = materialize(element, node);
+                elements.push_back(value);
+            }
+            return vm_.newArray(elements);
+        }
+        }
+        return TaggedValue::nil();
+    }
+
+    void generate(const Node& node) {
+        switch (node.kind) {
+        case Node::LITERAL:
+            assembler_.pushLiteral(materialize(node.literal, node));
+            break;
+        case Node::VARIABLE:
+            generateVariable(node);
+            break;
+        case Node::ASSIGN:
+            generateAssign(node);
+            break;
+        case Node::SEND:
+            generateSend(node);
+            break;
+        case Node::CASCADE:
+            generate(*node.value);
+            for (size_t i = 0; i < node.args.size(); i++) {
+                bool last = i + 1 == node.args.size();
+                if (!last) {
+                    assembler_.duplicate();
+                    depth_++;  // The receiver stays below the duplicate each part consumes
+                }
+                generate(*node.args[i]);
+                if (!last) {
+                    depth_--;
+                    assembler_.pop();
+                }
+            }
+            break;
+        case Node::CASCADE_RECEIVER:
+            // Already on the stack, pushed (or duplicated) by the CASCADE
+            break;
+        case Node::BLOCK:
+            generateClosure(node);
+            break;
+        case Node::RETURN:
+            generateReturn(node);
+            break;
+        }
+    }
+
+    // A statement whose value is dropped. Where it assigns a block to a temporary that
+    // may hold stack blocks, the block is made in the frame.
+    void generateEffect(const Node& statement) {
+        const Variable* temp = isBlockAssignment(statement) ? findTemporary(statement.name) : nullptr;
+        if (temp != nullptr && temp->holdsStackBlocks) {
+            generateClosure(*statement.value, true);
+            assembler_.storeTemporary(temp->index);
+        } else {
+            generate(statement);
+        }
+        assembler_.pop();
+    }
+
+    void generateVariable(const Node& node) {
+        const std::string& name = node.name;
+        if (name == "self") {
+            assembler_.pushSelf();
+        } else if (name == "nil") {
+            assembler_.pushLiteral(TaggedValue::nil());
+        } else if (name == "true") {
+            assembler_.pushLiteral(TaggedValue::trueValue());
+        } else if (name == "false") {
+            assembler_.pushLiteral(TaggedValue::falseValue());
+        } else if (name == "super" || name == "thisContext") {
+            error(node, name + " is not supported");
+        } else if (const Variable* temp = findTemporary(name)) {
+            pushTemporary(*temp);
+        } else if (int index = findInstanceVariable(name); index >= 0) {
+            assembler_.pushInstanceVariable(static_cast<uint32_t>(index));
+        } else if (uint32_t cls = vm_.classIndexNamed(name); cls != ClassTable::INVALID_INDEX) {
+            assembler_.pushLiteral(vm_.classes().classAt(cls));
+        } else {
+            error(node, "Undefined variable " + name);
+        }
+    }
+
+    void generateAssign(const Node& node) {
+        generate(*node.value);
+        if (const Variable* temp = findTemporary(node.name)) {
+            if (!temp->assignable) {
+                error(node, "Cannot assign to argument " + node.name);
+            }
+            if (temp->vector != NO_VECTOR) {
+                assembler_.storeRemoteTemporary(temp->index, temp->vector);
+            } else {
+                assembler_.storeTemporary(temp->index);
+            }
+        } else if (int index = findInstanceVariable(node.name); index >= 0) {
+            assembler_.storeInstanceVariable(static_cast<uint32_t>(index));
+        } else {
+            error(node, "Cannot assign to " + node.name);
+        }
+    }
+
+    void generateSend(const Node& node) {
+        if (generateInlined(node)) {
+            return;
+        }
+        uint32_t depth = depth_;
+        const Variable* receiver = node.value->kind == Node::VARIABLE ? findTemporary(node.value->name) : nullptr;
+        if (receiver != nullptr && isValueSelector(node.name)) {
+            pushTemporary(*receiver, false);  // EXECUTE_BLOCK runs a stack block in place
+        } else {
+            generate(*node.value);
+        }
+        depth_++;
+        for (const NodePtr& arg : node.args) {
+            generate(*arg);
+            depth_++;
+        }
+        depth_ = depth;
+        if (isValueSelector(node.name)) {
+            assembler_.executeBlock(symbol(node.name), static_cast<uint32_t>(node.args.size()));
+        } else {
+            assembler_.send(symbol(node.name), static_cast<uint32_t>(node.args.size()));
+        }
+    }
+
+    // A block that is not inlined. A clean block is a BlockClosure built once, here, and
+    // pushed as a literal; any other is made by CREATE_BLOCK from the values it copies,
+    // in the frame if inFrame, else on the heap.
+    void generateClosure(const Node& block, bool inFrame = false) {
+        std::vector<TaggedValue> parts;  // method, closure
+        MemoryManager::ScopedRoots roots(vm_.memory(), parts);
+        std::vector<uint32_t> copied;
+        parts.push_back(CodeGenerator(vm_, classIndex_, analysis_, this).generateBlockMethod(block, copied));
+        if (!analysis_.isClean(block)) {
+            for (uint32_t temp : copied) {
+                assembler_.pushTemporary(temp);
+            }
+            uint32_t count = static_cast<uint32_t>(copied.size());
+            uint32_t slot = bytecode::NO_SLOT;
+            if (inFrame) {
+                slot = tempCount_;
+                tempCount_ += 1 + count;  // The method, then the copied values
+            }
+            assembler_.createBlock(parts[0], count, slot);
+            return;
+        }
+        parts.push_back(vm_.instantiate(vm_.kernel().blockClosure));
+        ObjectHeader* closure = ObjectHeader::fromTaggedValue(parts[1]);
+        vm_.memory().storePointer(closure, st::BlockClosureSlots::METHOD, parts[0]);
+        vm_.memory().storePointer(closure, st::BlockClosureSlots::NUM_ARGS,
+                                  TaggedValue::fromSmallInteger(static_cast<int64_t>(block.parameters.size())));
+        assembler_.pushLiteral(parts[1]);
+    }
+
+    uint32_t position() const { return static_cast<uint32_t>(assembler_.position()); }
+
+    // Cleanups of the enclosing ensure: blocks run before the method returns, innermost
+    // first, each outside its own protected range but inside the outer ones
+    void generateReturn(const Node& node) {
+        // Without Contexts a block that is not inlined cannot reach the frame of its method
+        if (outer_ != nullptr) {
+            error(node, "Blocks that are not inlined cannot use ^ yet");
+        }
+        generate(*node.value);
+        std::vector<EnsureScope*> enclosing = ensures_;
+        depth_++;
+        while (!ensures_.empty()) {
+            EnsureScope* ensure = ensures_.back();
+            ensures_.pop_back();
+            closeRange(*ensure);
+            generateBlock(*ensure->cleanup);
+            assembler_.pop();
+        }
+        depth_--;
+        assembler_.returnTop();
+        ensures_ = enclosing;
+        for (EnsureScope* ensure : ensures_) {
+            ensure->rangeStart = position();
+        }
+    }
+
+    void closeRange(EnsureScope& ensure) {
+        if (position() > ensure.rangeStart) {
+            ensure.ranges.emplace_back(ensure.rangeStart, position());
+        }
+    }
+
+    uint32_t exceptionClassLiteral(const Node& node) {
+        if (node.kind == Node::VARIABLE && findTemporary(node.name) == nullptr &&
+            findInstanceVariable(node.name) < 0) {
+            uint32_t cls = vm_.classIndexNamed(node.name);
+            if (cls != ClassTable::INVALID_INDEX) {
+                return assembler_.literalIndex(vm_.classes().classAt(cls));
+            }
+        }
+        error(node, "on:do: needs the name of an exception class");
+    }
+
+    // [body] on: ExceptionClass do: [:e | handler]: the body inline, the handler after a
+    // jump over it, and a HANDLER entry over the body (see handler_table.hpp)
+    void generateOnDo(const Node& node) {
+        const Node& handler = *node.args[1];
+        uint32_t literal = exceptionClassLiteral(*node.args[0]);
+        Assembler::Label end = assembler_.newLabel();
+        uint32_t start = position();
+        generateBlock(*node.value);
+        uint32_t bodyEnd = position();
+        assembler_.jump(end);
+        uint32_t temporary = handler_table::NO_TEMPORARY;
+        std::vector<uint32_t> parameters;
+        if (!handler.parameters.empty()) {
+            temporary = newTemporary();
+            parameters.push_back(temporary);
+        }
+        uint32_t target = position();
+        generateBlock(handler, parameters);
+        assembler_.bind(end);
+        handlers_.push_back(handler_table::Entry{handler_table::HANDLER, start, bodyEnd, target, literal,
+                                                 temporary, depth_});
+    }
+
+    // [body] ensure: [cleanup]: the body and then the cleanup inline, and for unwinding a
+    // second copy of the cleanup that signals the exception again when done
+    void generateEnsure(const Node& node) {
+        const Node& cleanup = *node.args[0];
+        EnsureScope scope{&cleanup, position(), depth_, {}};
+        ensures_.push_back(&scope);
+        generateBlock(*node.value);
+        ensures_.pop_back();
+        closeRange(scope);
+
+        Assembler::Label end = assembler_.newLabel();
+        depth_++;  // The body's value, or the exception being signalled
+        generateBlock(cleanup);
+        assembler_.pop();
+        assembler_.jump(end);
+        uint32_t target = position();
+        generateBlock(cleanup);
+        assembler_.pop();
+        assembler_.send(symbol("signal"), 0);
+        depth_--;
+        assembler_.bind(end);
+        for (const auto& range : scope.ranges) {
+            handlers_.push_back(handler_table::Entry{handler_table::ENSURE, range.first, range.second, target, 0,
+                                                     handler_table::NO_TEMPORARY, scope.depth});
+        }
+    }
+
+    // Body of an inlined block, leaving its value on the stack. parameters are the
+    // temporaries the block's arguments are bound to.
+    void generateBlock(const Node& block, const std::vector<uint32_t>& parameters = {}) {
+        scopes_.emplace_back();
+        for (size_t i = 0; i < parameters.size(); i++) {
+            if (!scopes_.back().emplace(block.parameters[i], Variable{parameters[i], false}).second) {
+                error(block, "Duplicate variable " + block.parameters[i]);
+            }
+        }
+        // Block temporaries start out nil on every evaluation, in a new temp vector if
+        // they need one.
+        declareTemporaries(&block, block.temporaries, block.line, true);
+        if (block.statements.empty()) {
+            assembler_.pushLiteral(TaggedValue::nil());
+        }
+        for (size_t i = 0; i < block.statements.size(); i++) {
+            if (i + 1 < block.statements.size()) {
+                generateEffect(*block.statements[i]);
+            } else {
+                generate(*block.statements[i]);
+            }
+        }
+        scopes_.pop_back();
+    }
+
+    bool generateInlined(const Node& node) {
+        const std::string& selector = node.name;
+        const std::vector<NodePtr>& args = node.args;
+
+        switch (inliningOf(node)) {
+        case Inlining::NONE:
+            return false;
+
+        case Inlining::IF: {
+            Assembler::Label skip = assembler_.newLabel();
+            Assembler::Label end = assembler_.newLabel();
+            generate(*node.value);
+            if (selector == "ifTrue:") {
+                assembler_.jumpIfFalse(skip);
+            } else {
+                assembler_.jumpIfTrue(skip);
+            }
+            generateBlock(*args[0]);
+            assembler_.jump(end);
+            assembler_.bind(skip);
+            assembler_.pushLiteral(TaggedValue::nil());
+            assembler_.bind(end);
+            return true;
+        }
+
+        case Inlining::IF_ELSE: {
+            Assembler::Label second = assembler_.newLabel();
+            Assembler::Label end = assembler_.newLabel();
+            generate(*node.value);
+            if (selector == "ifTrue:ifFalse:") {
+                assembler_.jumpIfFalse(second);
+            } else {
+                assembler_.jumpIfTrue(second);
+            }
+            generateBlock(*args[0]);
+            assembler_.jump(end);
+            assembler_.bind(second);
+            generateBlock(*args[1]);
+            assembler_.bind(end);
+            return true;
+        }
+
+        case Inlining::SHORT_CIRCUIT: {
+            Assembler::Label shortCircuit = assembler_.newLabel();
+            Assembler::Label end = assembler_.newLabel();
+            bool isAnd = selector == "and:";
+            generate(*node.value);
+            if (isAnd) {
+                assembler_.jumpIfFalse(shortCircuit);
+            } else {
+                assembler_.jumpIfTrue(shortCircuit);
+            }
+            generateBlock(*args[0]);
+            assembler_.jump(end);
+            assembler_.bind(shortCircuit);
+            assembler_.pushLiteral(isAnd ? TaggedValue::falseValue() : TaggedValue::trueValue());
+            assembler_.bind(end);
+            return true;
+        }
+
+        case Inlining::WHILE: {
+            bool whileTrue = selector.compare(0, 9, "whileTrue") == 0;
+            Assembler::Label top = assembler_.newLabel();
+            Assembler::Label end = assembler_.newLabel();
+            assembler_.bind(top);
+            generateBlock(*node.value);
+            if (args.empty()) {
+                if (whileTrue) {
+                    assembler_.jumpIfTrue(top);
+                } else {
+                    assembler_.jumpIfFalse(top);
+                }
+            } else {
+                if (whileTrue) {
+                    assembler_.jumpIfFalse(end);
+                } else {
+                    assembler_.jumpIfTrue(end);
+                }
+                generateBlock(*args[0]);
+                assembler_.pop();
+                assembler_.jump(top);
+            }
+            assembler_.bind(end);
+            assembler_.pushLiteral(TaggedValue::nil());
+            return true;
+        }
+
+        case Inlining::TIMES_REPEAT: {
+            uint32_t counter = newTemporary();
+            Assembler::Label top = assembler_.newLabel();
+            Assembler::Label end = assembler_.newLabel();
+            generate(*node.value);
+            assembler_.storeTemporary(counter);
+            assembler_.pop();
+            assembler_.bind(top);
+            assembler_.pushTemporary(counter);
+            assembler_.pushLiteral(TaggedValue::fromSmallInteger(1));
+            assembler_.send(symbol(">="), 1);
+            assembler_.jumpIfFalse(end);
+            generateBlock(*args[0]);
+            assembler_.pop();
+            assembler_.pushTemporary(counter);
+            assembler_.pushLiteral(TaggedValue::fromSmallInteger(1));
+            assembler_.send(symbol("-"), 1);
+            assembler_.storeTemporary(counter);
+            assembler_.pop();
+            assembler_.jump(top);
+            assembler_.bind(end);
+            assembler_.pushLiteral(TaggedValue::nil());
+            return true;
+        }
+
+        case Inlining::ON_DO:
+            generateOnDo(node);
+            return true;
+
+        case Inlining::ENSURE:
+            generateEnsure(node);
+            return true;
+
+        // [:a | ...] value: x with the block written out: evaluated in place
+        case Inlining::VALUE: {
+            std::vector<uint32_t> parameters;
+            for (const NodePtr& arg : args) {
+                generate(*arg);
+                parameters.push_back(newTemporary());
+                assembler_.storeTemporary(parameters.back());
+                assembler_.pop();
+            }
+            generateBlock(*node.value, parameters);
+            return true;
+        }
+
+        case Inlining::TO_DO: {
+            int64_t step = selector == "to:by:do:" ? args[1]->literal.integer : 1;
+            const Node& body = *args.back();
+            uint32_t index = newTemporary();
+            uint32_t limit = newTemporary();
+            Assembler::Label top = assembler_.newLabel();
+            Assembler::Label end = assembler_.newLabel();
+            generate(*node.value);
+            assembler_.storeTemporary(index);
+            assembler_.pop();
+            generate(*args[0]);
+            assembler_.storeTemporary(limit);
+            assembler_.pop();
+            assembler_.bind(top);
+            assembler_.pushTemporary(index);
+            assembler_.pushTemporary(limit);
+            assembler_.send(symbol(step > 0 ? "<=" : ">="), 1);
+            assembler_.jumpIfFalse(end);
+            generateBlock(body, {index});
+            assembler_.pop();
+            assembler_.pushTemporary(index);
+            assembler_.pushLiteral(TaggedValue::fromSmallInteger(step));
+            assembler_.send(symbol("+"), 1);
+            assembler_.storeTemporary(index);
+            assembler_.pop();
+            assembler_.jump(top);
+            assembler_.bind(end);
+            assembler_.pushLiteral(TaggedValue::nil());
+            return true;
+        }
+        }
+        return false;
+    }
+
+    VM& vm_;
+    uint32_t classIndex_;
+    const std::vector<std::string>& instanceVariables_;
+    const VariableAnalysis& analysis_;
+    const CodeGenerator* outer_;  // Generator of the method or block around a block
+    std::string selector_;
+    Assembler assembler_;
+    std::vector<std::unordered_map<std::string, Variable>> scopes_;
+    uint32_t tempCount_ = 0;
+    // Operands on the stack below the expression being generated
+    uint32_t depth_ = 0;
+    std::vector<EnsureScope*> ensures_;  // Innermost last
+    std::vector<handler_table::Entry> handlers_;  // In the order the constructs end: innermost first
+};
+
+} // namespace
+
+Compiler::Result Compiler::compile(uint32_t classIndex, std::string_view source) {
+    MethodNode method = Parser(source).parseMethod();
+    VariableAnalysis analysis(method, vm_.instanceVariableNames(classIndex));
+    return CodeGenerator(vm_, classIndex, analysis).generate(method);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+class VM;
+
+/**
+ * CompileError - syntax or semantic error in method source
+ */
+class CompileError : public std::runtime_error {
+public:
+    CompileError(int line, const std::string& message)
+        : std::runtime_error("line " + std::to_string(line) + ": " + message), line_(line) {}
+
+    int line() const { return line_; }
+
+private:
+    int line_;
+};
+
+/**
+ * Compiler - compiles Smalltalk method source to a CompiledMethod
+ *
+ * Accepts the usual method syntax: a message pattern, an optional <primitive: N>
+ * pragma, | temporaries |, and statements with assignments, returns, unary, binary and
+ * keyword sends and cascades. Literals are integers (including radix and negative
+ * ones), floats, strings, symbols, $characters (compiled to their SmallInteger code) and
+ * literal arrays.
+ *
+ * Blocks are inlined into jumps where they are the literal arguments of ifTrue:,
+ * ifFalse:, ifTrue:ifFalse:, ifFalse:ifTrue:, and:, or:, whileTrue:, whileFalse:,
+ * whileTrue, whileFalse, to:do:, to:by:do: (literal step), timesRepeat:, on:do: (with a
+ * class name for the exception class) and ensure:, or the literal receiver of value,
+ * value: etc. Their arguments and temporaries become temporaries of the method. on:do:
+ * and ensure: are recorded in the method's handler table (see handler_table.hpp).
+ *
+ * Any other block compiles to a method of its own ("[] in selector"). A clean block,
+ * one that uses no self, instance variables or variables around it, is a BlockClosure
+ * literal built once (see block_closure.hpp). The others are made by CREATE_BLOCK each
+ * time: variables around the block that it uses are copied into it, except those that
+ * are also assigned, which live in a temp vector shared with the block. A block assigned
+ * to a temporary by a statement of its own lives in the frame until the temporary is
+ * used other than by a value send (see bytecode.hpp). Sends of value, value:,
+ * value:value: and value:value:value: compile to EXECUTE_BLOCK. ^ in a block that is
+ * not inlined, super and thisContext are not supported yet.
+ *
+ * Identifiers that are not temporaries or instance variables name classes.
+ */
+class Compiler {
+public:
+    struct Result {
+        TaggedValue selector;
+        TaggedValue method;
+    };
+
+    explicit Compiler(VM& vm) : vm_(vm) {}
+
+    // Compiles source as a method of the class at classIndex (not installed).
+    // Throws CompileError.
+    Result compile(uint32_t classIndex, std::string_view source);
+
+private:
+    VM& vm_;
+};
@@ -0,0 +1,178 @@
+#include "dictionary_table.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace dictionary_table {
+
+namespace {
+
+using Slots = st::Dictionary::Slots;
+
+// Old-table slots moved into the new table per insert during incremental growth
+constexpr size_t MIGRATE_STEP = 32;
+
+// Control byte and cached hash bytes per slot
+constexpr size_t CONTROL_BYTES_PER_SLOT = 1 + sizeof(uint64_t);
+
+ObjectHeader* header(TaggedValue object) {
+    return ObjectHeader::fromTaggedValue(object);
+}
+
+int8_t* controlBytes(ObjectHeader* control) {
+    return reinterpret_cast<int8_t*>(control->bytes());
+}
+
+uint64_t cachedHash(ObjectHeader* control, size_t capacity, size_t index) {
+    uint64_t hash;
+    std::memcpy(&hash, control->bytes() + capacity + index * sizeof(hash), sizeof(hash));
+    return hash;
+}
+
+// Stores an entry whose key is known to be absent from the table (control, slots)
+void insertAbsent(MemoryManager& memory, ObjectHeader* control, ObjectHeader* slots, TaggedValue key,
+                  TaggedValue value, uint64_t hash) {
+    size_t capacity = slots->size() / 2;
+    size_t index = swiss_table::insertAbsent(controlBytes(control), capacity, hash);
+    std::memcpy(control->bytes() + capacity + index * sizeof(hash), &hash, sizeof(hash));
+    memory.storePointer(slots, static_cast<uint32_t>(index), key);
+    memory.storePointer(slots, static_cast<uint32_t>(capacity + index), value);
+}
+
+// Moves the next MIGRATE_STEP slots of the old table into the current one, and drops
+// the old table once it is empty
+void migrateSome(MemoryManager& memory, ObjectHeader* dictionary) {
+    st::Dictionary* d = st::mirrorOf<st::Dictionary>(dictionary);
+    ObjectHeader* oldControl = header(d->oldControl());
+    ObjectHeader* oldSlots = header(d->oldSlots());
+    ObjectHeader* control = header(d->control());
+    ObjectHeader* slots = header(d->slots());
+    size_t oldCapacity = oldSlots->size() / 2;
+    size_t cursor = static_cast<size_t>(d->migrated());
+    size_t end = std::min(cursor + MIGRATE_STEP, oldCapacity);
+    int8_t* ctrl = controlBytes(oldControl);
+    TaggedValue* entries = oldSlots->slots();
+    for (; cursor < end; cursor++) {
+        if (ctrl[cursor] < 0) {
+            continue;
+        }
+        insertAbsent(memory, control, slots, entries[cursor], entries[oldCapacity + cursor],
+                     cachedHash(oldControl, oldCapacity, cursor));
+        // Deleted (not empty) so probes for keys further along the chain keep going
+        ctrl[cursor] = swiss_table::DELETED;
+        entries[cursor] = TaggedValue::nil();
+        entries[oldCapacity + cursor] = TaggedValue::nil();
+    }
+    if (cursor == oldCapacity) {
+        memory.storePointer(dictionary, Slots::OLD_CONTROL, TaggedValue::nil());
+        memory.storePointer(dictionary, Slots::OLD_SLOTS, TaggedValue::nil());
+        cursor = 0;
+    }
+    memory.storePointer(dictionary, Slots::MIGRATED, TaggedValue::fromSmallInteger(static_cast<int64_t>(cursor)));
+}
+
+// Replaces the table with one of twice the capacity (the first with GROUP_WIDTH
+// slots) and starts draining the old one into it. dictionary must be rooted.
+void grow(VM& vm, TaggedValue& dictionary) {
+    MemoryManager& memory = vm.memory();
+    // A new growth cannot start until the previous one has drained.
+    while (!st::mirrorOf<st::Dictionary>(dictionary)->oldSlots().isNil()) {
+        migrateSome(memory, header(dictionary));
+    }
+    size_t oldCapacity = capacity(dictionary);
+    size_t newCapacity = oldCapacity == 0 ? swiss_table::GROUP_WIDTH : 2 * oldCapacity;
+    if (newCapacity * CONTROL_BYTES_PER_SLOT > ObjectHeader::MAX_SIZE) {
+        throw std::length_error("Dictionary too large");
+    }
+
+    ObjectHeader* control = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY,
+                                                 static_cast<uint32_t>(newCapacity * CONTROL_BYTES_PER_SLOT),
+                                                 vm.kernel().byteArray);
+    std::memset(control->bytes(), static_cast<uint8_t>(swiss_table::EMPTY), newCapacity);
+    std::vector<TaggedValue> table = {control->toTaggedValue(), TaggedValue::nil()};
+    MemoryManager::ScopedRoots rooted(memory, table);
+    table[1] = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, static_cast<uint32_t>(2 * newCapacity),
+                                    vm.kernel().array)->toTaggedValue();
+
+    ObjectHeader* object = header(dictionary);
+    st::Dictionary* d = st::mirrorOf<st::Dictionary>(object);
+    int64_t tally = d->tally();
+    if (tally != 0) {
+        memory.storePointer(object, Slots::OLD_CONTROL, d->control());
+        memory.storePointer(object, Slots::OLD_SLOTS, d->slots());
+        memory.storePointer(object, Slots::MIGRATED, TaggedValue::fromSmallInteger(0));
+    }
+    memory.storePointer(object, Slots::CONTROL, table[0]);
+    memory.storePointer(object, Slots::SLOTS, table[1]);
+    // Room for the entries still to come over from the old table is kept for them
+    int64_t growthLeft = static_cast<int64_t>(swiss_table::growthLimit(newCapacity)) - tally;
+    memory.storePointer(object, Slots::GROWTH_LEFT, TaggedValue::fromSmallInteger(growthLeft));
+}
+
+} // namespace
+
+void insert(VM& vm, TaggedValue dictionary, TaggedValue key, TaggedValue value, uint64_t hash) {
+    MemoryManager& memory = vm.memory();
+    ObjectHeader* object = header(dictionary);
+    st::Dictionary* d = st::mirrorOf<st::Dictionary>(object);
+
+    // A key still waiting in the old table is updated where it lives.
+    if (!d->oldSlots().isNil()) {
+        ObjectHeader* oldSlots = header(d->oldSlots());
+        size_t oldCapacity = oldSlots->size() / 2;
+        size_t index = indexOf(d->oldControl(), d->oldSlots(), key, hash);
+        if (index != oldCapacity) {
+            memory.storePointer(oldSlots, static_cast<uint32_t>(oldCapacity + index), value);
+            migrateSome(memory, object);
+            return;
+        }
+    }
+
+    if (d->growthLeft() == 0) {
+        std::vector<TaggedValue> roots = {dictionary, key, value};
+        MemoryManager::ScopedRoots rooted(memory, roots);
+        grow(vm, roots[0]);
+        object = header(roots[0]);
+        key = roots[1];
+        value = roots[2];
+        d = st::mirrorOf<st::Dictionary>(object);
+    }
+    insertAbsent(memory, header(d->control()), header(d->slots()), key, value, hash);
+    memory.storePointer(object, Slots::TALLY, TaggedValue::fromSmallInteger(d->tally() + 1));
+    memory.storePointer(object, Slots::GROWTH_LEFT, TaggedValue::fromSmallInteger(d->growthLeft() - 1));
+
+    if (!d->oldSlots().isNil()) {
+        migrateSome(memory, object);
+    }
+}
+
+void forEach(TaggedValue dictionary, const std::function<void(TaggedValue key, TaggedValue value)>& visit) {
+    const st::Dictionary* d = st::mirrorOf<st::Dictionary>(dictionary);
+    for (auto [control, slots] : {std::make_pair(d->control(), d->slots()),
+                                  std::make_pair(d->oldControl(), d->oldSlots())}) {
+        if (slots.isNil()) {
+            continue;
+        }
+        const int8_t* ctrl = controlBytes(header(control));
+        const TaggedValue* entries = header(slots)->slots();
+        size_t capacity = header(slots)->size() / 2;
+        for (size_t i = 0; i < capacity; i++) {
+            if (ctrl[i] >= 0) {
+                visit(entries[i], entries[capacity + i]);
+            }
+        }
+    }
+}
+
+size_t capacity(TaggedValue dictionary) {
+    TaggedValue slots = st::mirrorOf<st::Dictionary>(dictionary)->slots();
+    return slots.isNil() ? 0 : header(slots)->size() / 2;
+}
+
+bool isGrowing(TaggedValue dictionary) {
+    return !st::mirrorOf<st::Dictionary>(dictionary)->oldSlots().isNil();
+}
+
+} // namespace dictionary_table
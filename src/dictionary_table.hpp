@@ -0,0 +1,108 @@
+#pragma once
+
+#include "classes/dictionary.hpp"
+#include "swiss_table.hpp"
+#include "tagged_value.hpp"
+#include "vm.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+/**
+ * Dictionary tables - the hash table of a Smalltalk Dictionary, kept in object memory
+ *
+ * A Swiss table (see swiss_table.hpp) made of two objects that the Dictionary's slots
+ * point to (see classes/dictionary.hpp):
+ *
+ *   control   ByteArray: capacity control bytes, then capacity 64-bit hashes, the
+ *             cached EqualityKeys hash of each full slot's key
+ *   slots     Array of 2 * capacity elements: the keys of slots 0 to capacity - 1,
+ *             then their values, so the keys a probe compares lie side by side
+ *
+ * Keys compare by value (EqualityKeys). The collector sees a table as ordinary objects:
+ * it is traced from its Dictionary, stores into it go through the write barrier, and a
+ * Dictionary that nothing else reaches is reclaimed with its table, even when its own
+ * entries refer to it.
+ *
+ * Growth is incremental: when the table reaches 7/8 load a table of twice the capacity
+ * replaces it and the old one is drained MIGRATE_STEP slots per insert, so a large
+ * Dictionary never stalls on a full rehash. Lookups that miss the new table consult
+ * the old one while a migration is in progress.
+ */
+namespace dictionary_table {
+
+// Tables from this capacity on outgrow the caches: a lookup starts fetching the keys of
+// its first group while it waits for the control bytes, instead of after them
+constexpr size_t PREFETCH_CAPACITY = 64 * 1024;
+
+// Slot of the table (control, slots) holding key, or its capacity if there is none
+inline size_t indexOf(TaggedValue control, TaggedValue slots, TaggedValue key, uint64_t hash) {
+    const ObjectHeader* table = ObjectHeader::fromTaggedValue(slots);
+    size_t capacity = table->size() / 2;
+    const TaggedValue* keys = table->slots();
+    if (capacity >= PREFETCH_CAPACITY) {
+        const TaggedValue* group = &keys[swiss_table::probeStart(hash, capacity)];
+        swiss_table::prefetch(group);
+        swiss_table::prefetch(group + swiss_table::GROUP_WIDTH / 2);
+    }
+    const int8_t* ctrl = reinterpret_cast<const int8_t*>(ObjectHeader::fromTaggedValue(control)->bytes());
+    return swiss_table::find<swiss_table::EqualityKeys>(ctrl, capacity, key, hash,
+                                                        [keys](size_t i) { return keys[i]; });
+}
+
+// The value stored under key in the table (control, slots), or nullptr
+inline const TaggedValue* valueIn(TaggedValue control, TaggedValue slots, TaggedValue key, uint64_t hash) {
+    size_t index = indexOf(control, slots, key, hash);
+    const ObjectHeader* table = ObjectHeader::fromTaggedValue(slots);
+    size_t capacity = table->size() / 2;
+    return index != capacity ? &table->slots()[capacity + index] : nullptr;
+}
+
+// The value stored under key, or nullptr if there is none. It points into object
+// memory, so it is good until the next allocation.
+inline const TaggedValue* find(TaggedValue dictionary, TaggedValue key) {
+    const st::Dictionary* d = st::mirrorOf<st::Dictionary>(dictionary);
+    if (d->slots().isNil()) {
+        return nullptr;
+    }
+    uint64_t hash = swiss_table::EqualityKeys::hash(key);
+    const TaggedValue* value = valueIn(d->control(), d->slots(), key, hash);
+    if (value == nullptr && !d->oldSlots().isNil()) {
+        value = valueIn(d->oldControl(), d->oldSlots(), key, hash);
+    }
+    return value;
+}
+
+// Stores value under a key the current table does not hold: where it lives in the old
+// table, or else as a new entry. Growing the table allocates, and so may collect.
+void insert(VM& vm, TaggedValue dictionary, TaggedValue key, TaggedValue value, uint64_t hash);
+
+// Stores value under key. Replacing the value of a key in the current table is a lookup
+// and a store; everything else is left to insert.
+inline void atPut(VM& vm, TaggedValue dictionary, TaggedValue key, TaggedValue value) {
+    uint64_t hash = swiss_table::EqualityKeys::hash(key);
+    const st::Dictionary* d = st::mirrorOf<st::Dictionary>(dictionary);
+    if (!d->slots().isNil()) {
+        ObjectHeader* slots = ObjectHeader::fromTaggedValue(d->slots());
+        size_t capacity = slots->size() / 2;
+        size_t index = indexOf(d->control(), d->slots(), key, hash);
+        if (index != capacity) {
+            vm.memory().storePointer(slots, static_cast<uint32_t>(capacity + index), value);
+            return;
+        }
+    }
+    insert(vm, dictionary, key, value, hash);
+}
+
+inline size_t size(TaggedValue dictionary) {
+    return static_cast<size_t>(st::mirrorOf<st::Dictionary>(dictionary)->tally());
+}
+
+// Calls visit with every key and value; visit must not allocate
+void forEach(TaggedValue dictionary, const std::function<void(TaggedValue key, TaggedValue value)>& visit);
+
+// Introspection (for tests and benchmarks)
+size_t capacity(TaggedValue dictionary);
+bool isGrowing(TaggedValue dictionary);
+
+} // namespace dictionary_table
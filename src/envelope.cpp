@@ -0,0 +1,180 @@
+#include "envelope.hpp"
+#include "classes/class.hpp"
+#include "dictionary_table.hpp"
+#include "image_segment.hpp"
+#include "symbol_table.hpp"
+#include "vm.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+Envelope Envelope::copy(VM& from, const std::vector<TaggedValue>& roots) {
+    Envelope envelope;
+    envelope.image_ = from.image();
+    std::unordered_map<ObjectHeader*, uint32_t> indices;
+    std::unordered_map<uint32_t, uint32_t> classNames;  // Class index -> index into classNames_
+    std::vector<ObjectHeader*> pending;                  // Parallel to objects_
+
+    auto nameOf = [&](uint32_t classIndex) {
+        auto it = classNames.find(classIndex);
+        if (it != classNames.end()) {
+            return it->second;
+        }
+        uint32_t index = static_cast<uint32_t>(envelope.classNames_.size());
+        envelope.classNames_.push_back(from.className(classIndex));
+        classNames.emplace(classIndex, index);
+        return index;
+    };
+    auto encode = [&](TaggedValue value) {
+        if (!value.isPointer()) {
+            return Value{Value::IMMEDIATE, value.value()};
+        }
+        ObjectHeader* object = ObjectHeader::fromTaggedValue(value);
+        if (from.image() != nullptr && from.image()->contains(object)) {
+            return Value{Value::SHARED, value.value()};
+        }
+        if (!from.memory().contains(object)) {
+            throw std::invalid_argument("Cannot copy an external pointer");
+        }
+        auto it = indices.find(object);
+        if (it != indices.end()) {
+            return Value{Value::OBJECT, it->second};
+        }
+        uint32_t index = static_cast<uint32_t>(pending.size());
+        indices.emplace(object, index);
+        pending.push_back(object);
+        envelope.objects_.emplace_back();
+        return Value{Value::OBJECT, index};
+    };
+
+    for (TaggedValue root : roots) {
+        envelope.roots_.push_back(encode(root));
+    }
+    const VM::Kernel& kernel = from.kernel();
+    // encode() appends to objects_, so each entry is built aside and moved in
+    for (size_t next = 0; next < pending.size(); next++) {
+        ObjectHeader* source = pending[next];
+        uint32_t classIndex = source->classIndex();
+        Object object;
+        object.type = source->type();
+        object.size = source->size();
+        if (source->type() == ObjectHeader::TYPE_CLASS) {
+            object.kind = Object::CLASS;
+            object.className = nameOf(ClassTable::indexOfClass(source->toTaggedValue()));
+        } else if (classIndex == kernel.symbol) {
+            object.kind = Object::SYMBOL;
+            object.bytes.assign(source->bytes(), source->bytes() + source->size());
+        } else if (classIndex == kernel.dictionary) {
+            object.kind = Object::DICTIONARY;
+            object.className = nameOf(classIndex);
+            dictionary_table::forEach(source->toTaggedValue(), [&](TaggedValue key, TaggedValue value) {
+                object.slots.push_back(encode(key));
+                object.slots.push_back(encode(value));
+            });
+        } else if (source->type() == ObjectHeader::TYPE_METHOD || classIndex == kernel.process ||
+                   classIndex == kernel.semaphore) {
+            throw std::invalid_argument("Cannot copy " + from.printString(source->toTaggedValue()));
+        } else {
+            object.className = nameOf(classIndex);
+            if (source->isBytes()) {
+                object.bytes.assign(source->bytes(), source->bytes() + source->size());
+            } else {
+                for (uint32_t i = 0; i < source->size(); i++) {
+                    object.slots.push_back(encode(source->slots()[i]));
+                }
+            }
+        }
+        envelope.objects_[next] = std::move(object);
+    }
+    return envelope;
+}
+
+std::vector<TaggedValue> Envelope::open(VM& into) const {
+    if (image_ != nullptr && image_ != into.image()) {
+        throw std::invalid_argument("Envelope refers to an image segment the VM does not share");
+    }
+    std::vector<uint32_t> classIndices;
+    for (const std::string& name : classNames_) {
+        uint32_t classIndex = into.classIndexNamed(name);
+        if (classIndex == ClassTable::INVALID_INDEX) {
+            throw std::invalid_argument("Unknown class: " + name);
+        }
+        classIndices.push_back(classIndex);
+    }
+
+    MemoryManager& memory = into.memory();
+    std::vector<TaggedValue> created(objects_.size(), TaggedValue::nil());
+    MemoryManager::ScopedRoots roots(memory, created);
+    auto decode = [&created](const Value& value) {
+        return value.kind == Value::OBJECT ? created[value.bits] : TaggedValue(value.bits);
+    };
+
+    // Allocate everything first: allocation may move what is already created
+    for (size_t i = 0; i < objects_.size(); i++) {
+        const Object& object = objects_[i];
+        switch (object.kind) {
+        case Object::CLASS:
+            created[i] = into.classes().classAt(classIndices[object.className]);
+            break;
+        case Object::SYMBOL:
+            created[i] = into.symbols().intern(
+                std::string_view(reinterpret_cast<const char*>(object.bytes.data()), object.bytes.size()));
+            break;
+        case Object::DICTIONARY:
+            created[i] = into.newDictionary();
+            break;
+        case Object::INSTANCE: {
+            uint32_t classIndex = classIndices[object.className];
+            st::Class* cls = st::mirrorOf<st::Class>(into.classes().classAt(classIndex));
+            bool bytes = object.type == ObjectHeader::TYPE_BYTE_ARRAY || object.type == ObjectHeader::TYPE_SYMBOL;
+            bool indexable = bytes || object.type == ObjectHeader::TYPE_ARRAY;
+            if (cls->instanceType() != object.type ||
+                (indexable ? cls->instanceSize() > object.size : cls->instanceSize() != object.size)) {
+                throw std::invalid_argument(classNames_[object.className] + " has a different shape");
+            }
+            ObjectHeader* instance = bytes ? memory.allocateBytes(object.type, object.size, classIndex)
+                                           : memory.allocateSlots(object.type, object.size, classIndex);
+            created[i] = instance->toTaggedValue();
+            break;
+        }
+        }
+    }
+
+    for (size_t i = 0; i < objects_.size(); i++) {
+        const Object& object = objects_[i];
+        if (object.kind != Object::INSTANCE) {
+            continue;
+        }
+        ObjectHeader* target = ObjectHeader::fromTaggedValue(created[i]);
+        if (target->isBytes()) {
+            std::memcpy(target->bytes(), object.bytes.data(), object.bytes.size());
+        } else {
+            for (uint32_t slot = 0; slot < object.slots.size(); slot++) {
+                memory.storePointer(target, slot, decode(object.slots[slot]));
+            }
+        }
+    }
+    // Last, so keys that hash by contents have theirs
+    for (size_t i = 0; i < objects_.size(); i++) {
+        const Object& object = objects_[i];
+        if (object.kind == Object::DICTIONARY) {
+            for (size_t k = 0; k < object.slots.size(); k += 2) {
+                dictionary_table::atPut(into, created[i], decode(object.slots[k]), decode(object.slots[k + 1]));
+            }
+        }
+    }
+
+    std::vector<TaggedValue> result;
+    for (const Value& root : roots_) {
+        result.push_back(decode(root));
+    }
+    return result;
+}
+
+size_t Envelope::bodyBytes() const {
+    size_t total = 0;
+    for (const Object& object : objects_) {
+        total += ObjectHeader::bodyBytesFor(object.type, object.size);
+    }
+    return total;
+}
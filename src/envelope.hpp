@@ -0,0 +1,63 @@
+#pragma once
+
+#include "object_header.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ImageSegment;
+class VM;
+
+/**
+ * Envelope - a deep copy of an object graph, detached from any VM
+ *
+ * copy() records every object reachable from some roots in one VM; open() rebuilds the
+ * graph in another (or the same) VM and answers the new roots. Objects shared by
+ * several paths, and cycles, come out shared and cyclic again. An Envelope owns no
+ * object memory, so it can be handed to another thread: this is how isolates exchange
+ * messages.
+ *
+ * What is not copied:
+ * - Immediates travel as they are.
+ * - Objects in the ImageSegment the VM was built on travel by reference: nothing can
+ *   change them. open() requires the receiving VM to share that segment.
+ * - Symbols are re-interned by name, so they stay unique in the receiving VM.
+ * - Class objects are looked up by name, as are the classes of copied objects; the
+ *   receiving VM must define them with the same shape.
+ *
+ * Dictionaries travel with their contents. CompiledMethods that are not in the
+ * segment, Processes and Semaphores belong to their VM and cannot be copied; copy()
+ * throws std::invalid_argument for them, and open() throws it for a class that is
+ * missing or differs.
+ */
+class Envelope {
+public:
+    static Envelope copy(VM& from, const std::vector<TaggedValue>& roots);
+    std::vector<TaggedValue> open(VM& into) const;
+
+    size_t objectCount() const { return objects_.size(); }
+    size_t bodyBytes() const;  // Of the copied objects, as they were in the sender
+
+private:
+    // A slot: an immediate, a segment object, or one of objects_
+    struct Value {
+        enum Kind : uint8_t { IMMEDIATE, SHARED, OBJECT } kind = IMMEDIATE;
+        uint64_t bits = 0;  // Raw TaggedValue, or index into objects_
+    };
+
+    struct Object {
+        enum Kind : uint8_t { INSTANCE, SYMBOL, CLASS, DICTIONARY } kind = INSTANCE;
+        uint32_t className = 0;  // Index into classNames_
+        ObjectHeader::Type type = ObjectHeader::TYPE_OBJECT;
+        uint32_t size = 0;
+        std::vector<Value> slots;   // Pointer objects; keys and values for dictionaries
+        std::vector<uint8_t> bytes;  // Byte objects; the name for Symbols
+    };
+
+    const ImageSegment* image_ = nullptr;
+    std::vector<std::string> classNames_;
+    std::vector<Object> objects_;
+    std::vector<Value> roots_;
+};
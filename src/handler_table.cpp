@@ -0,0 +1,19 @@
+#include "handler_table.hpp"
+
+namespace handler_table {
+
+std::vector<uint8_t> encode(const std::vector<Entry>& entries) {
+    std::vector<uint8_t> bytes;
+    bytes.reserve(entries.size() * ENTRY_BYTES);
+    for (const Entry& entry : entries) {
+        for (uint32_t word : {static_cast<uint32_t>(entry.kind), entry.start, entry.end, entry.target, entry.literal,
+                              entry.temporary, entry.depth}) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                bytes.push_back(static_cast<uint8_t>((word >> shift) & 0xFF));
+            }
+        }
+    }
+    return bytes;
+}
+
+} // namespace handler_table
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Handler tables - where a CompiledMethod handles exceptions and runs ensure: blocks
+ *
+ * The compiler inlines [body] on: ExceptionClass do: [:e | handler] and
+ * [body] ensure: [cleanup] like the other control messages, and records each as an
+ * entry over the bytecode range of its body. The table is a ByteArray in the method's
+ * handlers slot (nil when the method has none), so code that never signals runs no
+ * extra instructions: a handler costs a jump over its code, an ensure: block nothing.
+ *
+ * Each entry is seven 32-bit little-endian words:
+ *
+ *   kind        HANDLER or ENSURE
+ *   start, end  the protected range; a frame is inside it when its saved ip (just past
+ *               its pending send) is in (start, end]
+ *   target      HANDLER: the handler code, which leaves the value of the on:do:
+ *               ENSURE: a copy of the cleanup code for unwinding. It expects the
+ *               exception on the stack and sends it #signal again when done.
+ *   literal     HANDLER: index of the exception class in the method's literals
+ *   temporary   HANDLER: temporary for the handler's argument, or NO_TEMPORARY
+ *   depth       operands on the frame's stack below the construct; unwinding into the
+ *               frame cuts its stack back to them
+ *
+ * Entries are ordered innermost first: for a given ip the first match is the innermost.
+ * An ensure: body that contains a ^ is split into several entries around the copies of
+ * the cleanup that run before each return.
+ */
+namespace handler_table {
+
+enum Kind : uint32_t { HANDLER = 0, ENSURE = 1 };
+
+constexpr uint32_t NO_TEMPORARY = 0xFFFFFFFFu;
+
+struct Entry {
+    Kind kind;
+    uint32_t start;
+    uint32_t end;
+    uint32_t target;
+    uint32_t literal;
+    uint32_t temporary;
+    uint32_t depth;
+
+    bool covers(uint32_t ip) const { return start < ip && ip <= end; }
+};
+
+constexpr size_t ENTRY_BYTES = 7 * 4;
+
+std::vector<uint8_t> encode(const std::vector<Entry>& entries);
+
+inline size_t count(size_t tableBytes) {
+    return tableBytes / ENTRY_BYTES;
+}
+
+inline Entry entryAt(const uint8_t* table, size_t index) {
+    const uint8_t* bytes = table + index * ENTRY_BYTES;
+    return Entry{static_cast<Kind>(bytecode::readOperand(bytes)), bytecode::readOperand(bytes + 4),
+                 bytecode::readOperand(bytes + 8),  bytecode::readOperand(bytes + 12),
+                 bytecode::readOperand(bytes + 16), bytecode::readOperand(bytes + 20),
+                 bytecode::readOperand(bytes + 24)};
+}
+
+} // namespace handler_table
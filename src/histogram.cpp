@@ -0,0 +1,54 @@
+#include "histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+size_t Histogram::bucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));  // >= 3
+    size_t sub = static_cast<size_t>(value >> (exponent - 3)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + (exponent - 3) * SUB_BUCKETS + sub;
+}
+
+uint64_t Histogram::bucketLowerBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned exponent = static_cast<unsigned>((bucket - SUB_BUCKETS) / SUB_BUCKETS) + 3;
+    uint64_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (exponent - 3);
+}
+
+uint64_t Histogram::bucketUpperBound(size_t bucket) {
+    return bucket + 1 < BUCKETS ? bucketLowerBound(bucket + 1) - 1 : UINT64_MAX;
+}
+
+uint64_t Histogram::percentile(double percent) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(count_)));
+    rank = std::max<uint64_t>(1, std::min(rank, count_));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += buckets_[bucket];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(bucket), max_);
+        }
+    }
+    return max_;
+}
+
+void Histogram::merge(const Histogram& other) {
+    if (other.count_ == 0) {
+        return;
+    }
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        buckets_[bucket] += other.buckets_[bucket];
+    }
+    min_ = count_ == 0 ? other.min_ : std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    count_ += other.count_;
+    sum_ += other.sum_;
+}
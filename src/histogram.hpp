@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Histogram - fixed-size log-linear histogram of non-negative integer samples
+ *
+ * Values below 8 get a bucket each; above that every power of two is split into 8
+ * equal buckets, so a bucket's bounds are within 12.5% of any value in it. Recording
+ * is a bit scan and an increment; nothing is allocated. Used for pause and latency
+ * distributions in nanoseconds.
+ */
+class Histogram {
+public:
+    static constexpr size_t SUB_BUCKETS = 8;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (64 - 3) * SUB_BUCKETS;
+
+    void record(uint64_t value) {
+        buckets_[bucketOf(value)]++;
+        count_++;
+        sum_ += value;
+        min_ = count_ == 1 || value < min_ ? value : min_;
+        max_ = value > max_ ? value : max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t min() const { return min_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_; }
+    // Upper bound of the bucket holding the sample at percent (0-100), capped at max();
+    // 0 when empty
+    uint64_t percentile(double percent) const;
+
+    uint64_t bucketCount(size_t bucket) const { return buckets_[bucket]; }
+    static size_t bucketOf(uint64_t value);
+    static uint64_t bucketLowerBound(size_t bucket);
+    static uint64_t bucketUpperBound(size_t bucket);  // Inclusive
+
+    void merge(const Histogram& other);
+    void reset() { *this = Histogram(); }
+
+private:
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+};
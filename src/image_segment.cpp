@@ -0,0 +1,122 @@
+#include "image_segment.hpp"
+#include "classes/class.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+ImageSegment::~ImageSegment() {
+    if (start_ != nullptr) {
+        munmap(start_, mapped_);
+    }
+}
+
+std::shared_ptr<const ImageSegment> ImageSegment::build(VM& vm) {
+    if (vm.image() != nullptr) {
+        throw std::invalid_argument("Cannot build an image segment from a VM that uses one");
+    }
+    MemoryManager& memory = vm.memory();
+    std::shared_ptr<ImageSegment> segment(new ImageSegment());
+
+    // Everything reachable from the classes, Symbols and methods, in discovery order
+    std::vector<ObjectHeader*> objects;
+    std::unordered_map<ObjectHeader*, ObjectHeader*> copies;  // Filled in once laid out
+    size_t total = 0;
+    auto reach = [&](TaggedValue value) {
+        if (!value.isPointer()) {
+            return;
+        }
+        ObjectHeader* object = ObjectHeader::fromTaggedValue(value);
+        if (copies.count(object) != 0) {
+            return;
+        }
+        if (!memory.contains(object)) {
+            throw std::invalid_argument("Cannot put an external pointer in an image segment");
+        }
+        if (object->classIndex() == vm.kernel().dictionary) {
+            throw std::invalid_argument("Cannot put a Dictionary in an image segment");
+        }
+        object->identityHash();  // Assigned now: the copy cannot be written to later
+        copies.emplace(object, nullptr);
+        objects.push_back(object);
+        total += object->totalBytes();
+    };
+    for (size_t index = 0; index < vm.classes().size(); index++) {
+        reach(vm.classes().classAt(static_cast<uint32_t>(index)));
+    }
+    vm.symbols().forEach([&](const std::string&, TaggedValue symbol) { reach(symbol); });
+    for (size_t next = 0; next < objects.size(); next++) {
+        ObjectHeader* object = objects[next];
+        if (object->isBytes()) {
+            continue;
+        }
+        for (uint32_t i = 0; i < object->size(); i++) {
+            if (object->type() == ObjectHeader::TYPE_CLASS && i == st::ClassSlots::METHODS) {
+                auto* methods = runtime::IdentityDictionary::fromTaggedValue(object->slots()[i]);
+                for (TaggedValue selector : methods->keys()) {
+                    reach(selector);
+                    reach(methods->at(selector));
+                }
+            } else {
+                reach(object->slots()[i]);
+            }
+        }
+    }
+
+    // Lay the copies out back to back, then write-protect them
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    segment->mapped_ = (total + page - 1) / page * page;
+    void* block = mmap(nullptr, segment->mapped_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        throw std::runtime_error("Cannot map an image segment");
+    }
+    segment->start_ = static_cast<uint8_t*>(block);
+    uint8_t* top = segment->start_;
+    for (ObjectHeader* object : objects) {
+        size_t bytes = object->totalBytes();
+        std::memcpy(top, object->objectStart(), bytes);
+        copies[object] = ObjectHeader::fromObjectStart(top);
+        top += bytes;
+    }
+    segment->used_ = total;
+    segment->objectCount_ = objects.size();
+
+    auto relocate = [&copies](TaggedValue value) {
+        return value.isPointer() ? copies.at(ObjectHeader::fromTaggedValue(value))->toTaggedValue() : value;
+    };
+    for (ObjectHeader* object : objects) {
+        ObjectHeader* copy = copies[object];
+        copy->clearFlag(ObjectHeader::FLAG_MARKED | ObjectHeader::FLAG_REMEMBERED);
+        copy->setFlag(ObjectHeader::FLAG_IMMUTABLE);
+        if (copy->isBytes()) {
+            continue;
+        }
+        for (uint32_t i = 0; i < copy->size(); i++) {
+            if (copy->type() == ObjectHeader::TYPE_CLASS && i == st::ClassSlots::METHODS) {
+                auto* methods = runtime::IdentityDictionary::fromTaggedValue(copy->slots()[i]);
+                auto shared = std::make_unique<runtime::IdentityDictionary>();
+                for (TaggedValue selector : methods->keys()) {
+                    shared->atPut(relocate(selector), relocate(methods->at(selector)));
+                }
+                copy->slots()[i] = runtime::IdentityDictionary::toTaggedValue(shared.get());
+                segment->methodDictionaries_.push_back(std::move(shared));
+            } else {
+                copy->slots()[i] = relocate(copy->slots()[i]);
+            }
+        }
+    }
+    if (mprotect(segment->start_, segment->mapped_, PROT_READ) != 0) {
+        throw std::runtime_error("Cannot write-protect an image segment");
+    }
+
+    segment->kernel_ = vm.kernel();
+    for (size_t index = 0; index < vm.classes().size(); index++) {
+        segment->classes_.push_back(relocate(vm.classes().classAt(static_cast<uint32_t>(index))));
+    }
+    segment->classIndices_ = vm.classIndices_;
+    segment->instanceVariableNames_ = vm.instanceVariableNames_;
+    vm.symbols().forEach([&](const std::string& name, TaggedValue symbol) {
+        segment->symbols_.emplace(name, relocate(symbol));
+    });
+    return segment;
+}
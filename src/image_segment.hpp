@@ -0,0 +1,70 @@
+#pragma once
+
+#include "object_header.hpp"
+#include "runtime/dictionary.hpp"
+#include "tagged_value.hpp"
+#include "vm.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * ImageSegment - read-only object memory shared by every VM built on it
+ *
+ * build() freezes a VM's image: its class objects, every interned Symbol, the
+ * CompiledMethods in the method dictionaries and everything they reach (bytecode
+ * ByteArrays, literal Arrays, literal Strings) are copied into one block that is then
+ * write-protected. Each copy is marked FLAG_IMMUTABLE and has its identity hash
+ * assigned, so nothing ever needs to write to it; the method dictionaries are copied
+ * too and never change afterwards.
+ *
+ * A VM constructed on a segment starts with the segment's classes at the same indices
+ * and its Symbols already interned, and compiles nothing. Its collector leaves segment
+ * objects alone, since they are not in its object memory and never point into it.
+ * Several VMs, on as many threads, can share one segment.
+ *
+ * Objects the segment cannot hold (Dictionaries, objects in another segment) make
+ * build() throw std::invalid_argument.
+ */
+class ImageSegment {
+public:
+    ~ImageSegment();
+
+    ImageSegment(const ImageSegment&) = delete;
+    ImageSegment& operator=(const ImageSegment&) = delete;
+
+    // Freezes vm's classes, Symbols and methods; vm itself is unchanged
+    static std::shared_ptr<const ImageSegment> build(VM& vm);
+
+    bool contains(const void* address) const {
+        auto p = static_cast<const uint8_t*>(address);
+        return p >= start_ && p < start_ + used_;
+    }
+    size_t bytes() const { return used_; }
+    size_t objectCount() const { return objectCount_; }
+
+    // What a VM built on the segment starts with
+    const VM::Kernel& kernel() const { return kernel_; }
+    const std::vector<TaggedValue>& classes() const { return classes_; }  // By class index
+    const std::unordered_map<std::string, uint32_t>& classIndices() const { return classIndices_; }
+    const std::vector<std::vector<std::string>>& instanceVariableNames() const { return instanceVariableNames_; }
+    const std::unordered_map<std::string, TaggedValue>& symbols() const { return symbols_; }
+
+private:
+    ImageSegment() = default;
+
+    uint8_t* start_ = nullptr;
+    size_t used_ = 0;
+    size_t mapped_ = 0;
+    size_t objectCount_ = 0;
+
+    VM::Kernel kernel_;
+    std::vector<TaggedValue> classes_;
+    std::unordered_map<std::string, uint32_t> classIndices_;
+    std::vector<std::vector<std::string>> instanceVariableNames_;
+    std::unordered_map<std::string, TaggedValue> symbols_;
+    std::vector<std::unique_ptr<runtime::IdentityDictionary>> methodDictionaries_;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "class_table.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+
+/**
+ * InlineCache - monomorphic send-site cache
+ *
+ * Remembers the receiver class index and the method found for it, so a send to a
+ * receiver of the same class skips method lookup. The check is an integer compare on
+ * the class index (a header load for objects, a table load for immediates) rather
+ * than a class-pointer load and compare.
+ */
+struct InlineCache {
+    uint32_t classIndex = ClassTable::INVALID_INDEX;
+    TaggedValue method;
+
+    bool matches(TaggedValue receiver) const {
+        return ClassTable::classIndexOf(receiver) == classIndex;
+    }
+
+    void fill(TaggedValue receiver, TaggedValue foundMethod) {
+        classIndex = ClassTable::classIndexOf(receiver);
+        method = foundMethod;
+    }
+
+    void flush() {
+        classIndex = ClassTable::INVALID_INDEX;
+        method = TaggedValue::nil();
+    }
+};
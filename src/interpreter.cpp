@@ -0,0 +1,745 @@
+#include "interpreter.hpp"
+#include "bytecode.hpp"
+#include "classes/block_closure.hpp"
+#include "classes/class.hpp"
+#include "classes/compiled_method.hpp"
+#include "handler_table.hpp"
+#include "primitives.hpp"
+#include "profiler.hpp"
+#include "runtime/dictionary.hpp"
+#include "scheduler.hpp"
+#include "symbol_table.hpp"
+#include "vm.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using bytecode::readOperand;
+
+Interpreter::Interpreter(VM& vm)
+    : vm_(vm), stack_(new TaggedValue[STACK_SLOTS]), stackCapacity_(STACK_SLOTS), sp_(0), mode_(0), entryDepth_(0),
+      interrupts_(0), safepoint_(*this), profiler_(nullptr), tracing_(false), bytecodes_(0), sends_(0) {
+    frames_.reserve(256);
+    flushMethodCache();
+    rootProvider_ = vm_.memory().addRootProvider([this](const MemoryManager::RootVisitor& visit) {
+        for (size_t i = 0; i < sp_; i++) {
+            visit(stack_[i]);
+        }
+        for (Frame& frame : frames_) {
+            visit(frame.method);
+        }
+        for (CacheEntry& entry : methodCache_) {
+            if (entry.classIndex != 0) {
+                visit(entry.selector);
+                visit(entry.method);
+            }
+        }
+        if (trace_) {
+            trace_->visitRoots(visit);
+        }
+    });
+    scheduler_ = std::make_unique<Scheduler>(vm_, *this);
+    Safepoints::global().add(safepoint_);
+}
+
+Interpreter::~Interpreter() {
+    Safepoints::global().remove(safepoint_);
+    scheduler_.reset();
+    vm_.memory().removeRootProvider(rootProvider_);
+}
+
+// ============================================================================
+// Method lookup
+// ============================================================================
+
+static size_t cacheIndex(uint32_t classIndex, TaggedValue selector) {
+    uint32_t hash = ObjectHeader::fromTaggedValue(selector)->identityHash();
+    return (hash ^ (classIndex * 0x9E3779B1u)) & (Interpreter::METHOD_CACHE_SIZE - 1);
+}
+
+TaggedValue Interpreter::lookup(uint32_t classIndex, TaggedValue selector) {
+    CacheEntry& entry = methodCache_[cacheIndex(classIndex, selector)];
+    if (entry.classIndex == classIndex && entry.selector == selector) {
+        return entry.method;
+    }
+
+    TaggedValue cls = vm_.classes().classAt(classIndex);
+    while (!cls.isNil()) {
+        if (const TaggedValue* method = vm_.methodsOf(cls)->find(selector)) {
+            entry = CacheEntry{classIndex, selector, *method};
+            return *method;
+        }
+        cls = st::mirrorOf<st::Class>(cls)->superclass();
+    }
+    return TaggedValue::nil();
+}
+
+void Interpreter::flushMethodCache() {
+    methodCache_.fill(CacheEntry{0, TaggedValue::nil(), TaggedValue::nil()});
+}
+
+// ============================================================================
+// Sends
+// ============================================================================
+
+TaggedValue Interpreter::send(TaggedValue receiver, TaggedValue selector,
+                              const std::vector<TaggedValue>& args) {
+    // Before the stacks are touched: a Stop may be looking at them
+    Safepoints::Running running(*this);
+    if (sp_ + args.size() + 1 > stackCapacity_) {
+        throw std::runtime_error("Stack overflow");
+    }
+    size_t entrySp = sp_;
+    size_t entryDepth = frames_.size();
+    push(receiver);
+    for (TaggedValue arg : args) {
+        push(arg);
+    }
+    guarded(entrySp, entryDepth, [&](unsigned mode) {
+        execute<0>(mode, static_cast<uint32_t>(args.size()), selector, entryDepth);
+    });
+    return pop();
+}
+
+void Interpreter::runProcesses() {
+    Safepoints::Running running(*this);
+    if (!scheduler_->idleUntilQuiet()) {
+        return;
+    }
+    size_t entryDepth = frames_.size();
+    guarded(sp_, entryDepth, [&](unsigned mode) { resume<0>(mode, entryDepth); });
+}
+
+template <typename Body>
+void Interpreter::guarded(size_t entrySp, size_t entryDepth, Body body) {
+    // The instrumentation state is read once per send so each loop variant stays branch-free.
+    unsigned mode = currentMode();
+    Profiler* profiler = profiler_;
+    size_t entryActivations = profiler != nullptr ? profiler->activeMethods() : 0;
+    unsigned outerMode = mode_;
+    size_t outerEntryDepth = entryDepth_;
+    mode_ = mode;
+    entryDepth_ = entryDepth;
+    // After an ensure: block has taken over from a VM error, the loop continues it
+    bool resuming = false;
+    for (;;) {
+        try {
+            if (resuming) {
+                resume<0>(mode, entryDepth);
+            } else {
+                body(mode);
+            }
+            mode_ = outerMode;
+            entryDepth_ = outerEntryDepth;
+            return;
+        } catch (...) {
+            // Its VMError comes back here once the ensure: blocks have run
+            if (unwindToEnsure(std::current_exception(), scheduler_->inCaller() ? entryDepth : 0)) {
+                resuming = true;
+                continue;
+            }
+            mode_ = outerMode;
+            entryDepth_ = outerEntryDepth;
+            if ((mode & TRACE_HOOK) != 0 && entryDepth == 0 && trace_->dumpsOnError()) {
+                std::ostream& out = trace_->output();
+                try {
+                    throw;
+                } catch (const std::exception& e) {
+                    out << "Error: " << e.what() << '\n';
+                } catch (...) {
+                    out << "Error: unknown exception\n";
+                }
+                dumpTrace(out);
+            }
+            scheduler_->returnToCaller();
+            sp_ = entrySp;
+            frames_.resize(entryDepth);
+            if ((mode & COUNT_HOOK) != 0) {
+                profiler->unwindTo(entryActivations);
+            }
+            throw;
+        }
+    }
+}
+
+unsigned Interpreter::currentMode() const {
+    unsigned mode = tracing_ ? static_cast<unsigned>(TRACE_HOOK) : 0u;
+    if (profiler_ != nullptr) {
+        mode |= (profiler_->counting() ? static_cast<unsigned>(COUNT_HOOK) : 0u) |
+                (profiler_->sampling() ? static_cast<unsigned>(SAMPLE_HOOK) : 0u);
+    }
+    return mode;
+}
+
+template <unsigned MODE>
+void Interpreter::execute(unsigned mode, uint32_t argCount, TaggedValue selector, size_t entryDepth) {
+    if constexpr (MODE + 1 < MODE_COUNT) {
+        if (mode != MODE) {
+            execute<MODE + 1>(mode, argCount, selector, entryDepth);
+            return;
+        }
+    }
+    dispatch<MODE>(selector, argCount);
+    // A primitive may have blocked the caller (Semaphore>>wait sent from C++)
+    if (frames_.size() > entryDepth || (interrupts_.load(std::memory_order_relaxed) & RESCHEDULE_INTERRUPT) != 0) {
+        run<MODE>(entryDepth);
+    }
+}
+
+template <unsigned MODE>
+void Interpreter::resume(unsigned mode, size_t entryDepth) {
+    if constexpr (MODE + 1 < MODE_COUNT) {
+        if (mode != MODE) {
+            resume<MODE + 1>(mode, entryDepth);
+            return;
+        }
+    }
+    run<MODE>(entryDepth);
+}
+
+template <unsigned MODE>
+bool Interpreter::switchProcess(size_t entryDepth) {
+    for (;;) {
+        uint32_t interrupts = interrupts_.exchange(0, std::memory_order_relaxed);
+        if ((interrupts & SAFEPOINT_INTERRUPT) != 0) {
+            Safepoints::global().park(safepoint_);
+        }
+        Scheduler::Switch next = scheduler_->reschedule((interrupts & PREEMPT_INTERRUPT) != 0);
+        if (next.start) {
+            // A new Process: its receiver and arguments are on its stack, the send is not done yet
+            dispatch<MODE>(next.selector, next.argCount);
+            if (!frames_.empty()) {
+                return false;
+            }
+            scheduler_->terminateActive();  // Its method was a primitive and has answered
+            continue;
+        }
+        return scheduler_->inCaller() && frames_.size() == entryDepth;
+    }
+}
+
+template <unsigned MODE>
+void Interpreter::dispatch(TaggedValue selector, uint32_t argCount) {
+    sends_++;
+    TaggedValue receiver = stackValue(argCount);
+    TaggedValue method = lookup(ClassTable::classIndexOf(receiver), selector);
+    if constexpr ((MODE & TRACE_HOOK) != 0) {
+        trace_->record(method.isNil() ? TraceBuffer::DOES_NOT_UNDERSTAND : TraceBuffer::SEND,
+                       method.isNil() ? selector : method, argCount, bytecode::SEND_MESSAGE, receiver);
+    }
+    if (method.isNil()) {
+        doesNotUnderstand(receiver, selector);
+    }
+    if constexpr ((MODE & COUNT_HOOK) != 0) {
+        profiler_->enterMethod(method);
+    }
+    int64_t primitive = st::mirrorOf<st::CompiledMethod>(method)->getPrimitiveNumber().toSmallInteger();
+    if (primitive != 0) {
+        primitives::Primitive function = primitives::lookup(static_cast<uint32_t>(primitive));
+        if (function != nullptr && function(*this, argCount)) {
+            if constexpr ((MODE & COUNT_HOOK) != 0) {
+                profiler_->exitMethod();
+            }
+            return;
+        }
+        // The primitive may have collected garbage; the method may have moved.
+        method = lookup(ClassTable::classIndexOf(stackValue(argCount)), selector);
+    }
+    activate(method, argCount);
+}
+
+template <unsigned MODE>
+void Interpreter::executeBlock(TaggedValue selector, uint32_t argCount) {
+    TaggedValue block = stackValue(argCount);
+    TaggedValue method;
+    TaggedValue receiver;
+    uint32_t count;
+    ObjectHeader* closure = nullptr;
+    size_t record = 0;  // Stack index of a stack block's method
+    if (isStackBlock(block)) {
+        // Only ever handed to EXECUTE_BLOCK in the frame that made it
+        record = frames_.back().base + 1 + stackBlockSlot(block);
+        method = stack_[record];
+        receiver = stack_[frames_.back().base];
+        count = stackBlockCount(block);
+    } else if (ClassTable::classIndexOf(block) == vm_.kernel().blockClosure) {
+        closure = ObjectHeader::fromTaggedValue(block);
+        method = closure->slots()[st::BlockClosureSlots::METHOD];
+        receiver = closure->slots()[st::BlockClosureSlots::RECEIVER];
+        count = closure->size() - st::BlockClosureSlots::COUNT;
+    } else {
+        dispatch<MODE>(selector, argCount);
+        return;
+    }
+    sends_++;
+    if constexpr ((MODE & TRACE_HOOK) != 0) {
+        trace_->record(TraceBuffer::SEND, method, argCount, bytecode::EXECUTE_BLOCK, block);
+    }
+    if constexpr ((MODE & COUNT_HOOK) != 0) {
+        profiler_->enterMethod(method);
+    }
+    stack_[sp_ - argCount - 1] = receiver;
+    activate(method, argCount);
+    // The copied values are the temporaries after the arguments. activate() may have
+    // moved the stack, so a stack block's record is read through its index.
+    const Frame& frame = frames_.back();
+    if (argCount + count > sp_ - frame.base - 1) {
+        throw std::runtime_error("Block has more copied values than its method has temporaries");
+    }
+    const TaggedValue* copied = closure != nullptr ? closure->slots() + st::BlockClosureSlots::COUNT
+                                                   : &stack_[record + 1];
+    std::copy(copied, copied + count, &stack_[frame.base + 1 + argCount]);
+}
+
+void Interpreter::activate(TaggedValue method, uint32_t argCount) {
+    st::CompiledMethod* mirror = st::mirrorOf<st::CompiledMethod>(method);
+    if (mirror->getNumArgs().toSmallInteger() != argCount) {
+        throw std::runtime_error("Wrong argument count for #" +
+                                 std::string(SymbolTable::nameOf(mirror->getSelector())));
+    }
+    uint32_t numTemps = static_cast<uint32_t>(mirror->getNumTemps().toSmallInteger());
+    if (sp_ + numTemps + OPERAND_HEADROOM > stackCapacity_ || frames_.size() >= MAX_FRAMES) {
+        growStack(sp_ + numTemps + OPERAND_HEADROOM);
+    }
+    uint32_t base = static_cast<uint32_t>(sp_ - argCount - 1);
+    for (uint32_t i = 0; i < numTemps; i++) {
+        push(TaggedValue::nil());
+    }
+    frames_.push_back(Frame{method, 0, base});
+}
+
+TaggedValue Interpreter::newClosure(size_t method, size_t copied, uint32_t count) {
+    MemoryManager& memory = vm_.memory();
+    ObjectHeader* closure = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, st::BlockClosureSlots::COUNT + count,
+                                                 vm_.kernel().blockClosure);
+    // Read only now: the allocation may have collected garbage
+    TaggedValue blockMethod = stack_[method];
+    memory.storePointer(closure, st::BlockClosureSlots::METHOD, blockMethod);
+    memory.storePointer(closure, st::BlockClosureSlots::NUM_ARGS,
+                        st::mirrorOf<st::CompiledMethod>(blockMethod)->getNumArgs());
+    memory.storePointer(closure, st::BlockClosureSlots::RECEIVER, stack_[frames_.back().base]);
+    for (uint32_t i = 0; i < count; i++) {
+        memory.storePointer(closure, st::BlockClosureSlots::COUNT + i, stack_[copied + i]);
+    }
+    return closure->toTaggedValue();
+}
+
+// ============================================================================
+// Exceptions
+// ============================================================================
+
+void Interpreter::signal(TaggedValue exception) {
+    using handler_table::Entry;
+    TaggedValue exceptionClass = vm_.classes().classAt(ClassTable::classIndexOf(exception));
+    auto handles = [exceptionClass](TaggedValue handlerClass) {
+        for (TaggedValue cls = exceptionClass; !cls.isNil(); cls = st::mirrorOf<st::Class>(cls)->superclass()) {
+            if (cls == handlerClass) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // A VMError only runs ensure: blocks on its way out
+    bool catchable = ClassTable::classIndexOf(exception) != vm_.kernel().vmError;
+
+    // Search without side effects first: the ensure: blocks between here and the handler
+    // run before anything is unwound
+    size_t floor = scheduler_->inCaller() ? entryDepth_ : 0;
+    size_t handlerFrame = frames_.size();
+    size_t handlerIndex = 0;
+    Entry handler{};
+    for (size_t frame = frames_.size(); catchable && frame-- > floor && handlerFrame == frames_.size();) {
+        st::CompiledMethod* method = st::mirrorOf<st::CompiledMethod>(frames_[frame].method);
+        if (method->getHandlers().isNil()) {
+            continue;
+        }
+        ObjectHeader* table = ObjectHeader::fromTaggedValue(method->getHandlers());
+        const TaggedValue* literals = ObjectHeader::fromTaggedValue(method->getLiterals())->slots();
+        for (size_t i = 0; i < handler_table::count(table->size()); i++) {
+            Entry entry = handler_table::entryAt(table->bytes(), i);
+            if (entry.kind == handler_table::HANDLER && entry.covers(frames_[frame].ip) &&
+                handles(literals[entry.literal])) {
+                handlerFrame = frame;
+                handlerIndex = i;
+                handler = entry;
+                break;
+            }
+        }
+    }
+    bool handled = handlerFrame != frames_.size();
+
+    // The innermost ensure: block on the way, to the handler or out of the Process or
+    // send for an unhandled exception, runs first; its unwinding copy signals the
+    // exception again to continue from there
+    size_t ensureFrame;
+    Entry ensure;
+    if (findEnsure(handled ? handlerFrame : floor, handled ? handlerIndex : SIZE_MAX, ensureFrame, ensure)) {
+        unwindTo(ensureFrame, ensure.target, ensure.depth);
+        push(exception);
+        return;
+    }
+    if (!handled) {
+        std::string message = catchable ? "Unhandled " + vm_.className(ClassTable::classIndexOf(exception)) : "";
+        TaggedValue text = ObjectHeader::fromTaggedValue(exception)->slots()[0];  // messageText
+        if (text.isPointer() && ClassTable::classIndexOf(text) == vm_.kernel().string) {
+            ObjectHeader* string = ObjectHeader::fromTaggedValue(text);
+            message += (catchable ? ": " : "") +
+                       std::string(reinterpret_cast<const char*>(string->bytes()), string->size());
+        }
+        throw std::runtime_error(message);
+    }
+    unwindTo(handlerFrame, handler.target, handler.depth);
+    if (handler.temporary != handler_table::NO_TEMPORARY) {
+        stack_[frames_.back().base + 1 + handler.temporary] = exception;
+    }
+}
+
+bool Interpreter::findEnsure(size_t floor, size_t floorLimit, size_t& frame, handler_table::Entry& entry) const {
+    for (frame = frames_.size(); frame-- > floor;) {
+        TaggedValue handlers = st::mirrorOf<st::CompiledMethod>(frames_[frame].method)->getHandlers();
+        if (handlers.isNil()) {
+            continue;
+        }
+        ObjectHeader* table = ObjectHeader::fromTaggedValue(handlers);
+        size_t limit = std::min(frame == floor ? floorLimit : SIZE_MAX, handler_table::count(table->size()));
+        for (size_t i = 0; i < limit; i++) {
+            entry = handler_table::entryAt(table->bytes(), i);
+            if (entry.kind == handler_table::ENSURE && entry.covers(frames_[frame].ip)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Interpreter::unwindToEnsure(std::exception_ptr error, size_t floor) {
+    std::string message;
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        message = e.what();
+    } catch (...) {
+        return false;
+    }
+    size_t frame;
+    handler_table::Entry entry;
+    if (!findEnsure(floor, SIZE_MAX, frame, entry)) {
+        return false;
+    }
+    // Unwound first, so the stack the allocations below may scavenge is consistent
+    unwindTo(frame, entry.target, entry.depth);
+    std::vector<TaggedValue> vmError = {vm_.instantiate(vm_.kernel().vmError)};
+    MemoryManager::ScopedRoots rooted(vm_.memory(), vmError);
+    TaggedValue text = vm_.newString(message);
+    vm_.memory().storePointer(ObjectHeader::fromTaggedValue(vmError[0]), 0, text);  // messageText
+    push(vmError[0]);
+    return true;
+}
+
+void Interpreter::unwindTo(size_t frame, uint32_t target, uint32_t depth) {
+    size_t popped = frames_.size() - 1 - frame;
+    frames_.resize(frame + 1);
+    if ((mode_ & COUNT_HOOK) != 0) {
+        profiler_->unwindTo(profiler_->activeMethods() - popped);
+    }
+    Frame& top = frames_.back();
+    st::CompiledMethod* method = st::mirrorOf<st::CompiledMethod>(top.method);
+    sp_ = top.base + 1 + static_cast<size_t>(method->getNumArgs().toSmallInteger()) +
+          static_cast<size_t>(method->getNumTemps().toSmallInteger()) + depth;
+    top.ip = target;
+}
+
+void Interpreter::growStack(size_t needed) {
+    if (needed > STACK_SLOTS || frames_.size() >= MAX_FRAMES) {
+        throw std::runtime_error("Stack overflow");
+    }
+    size_t capacity = std::min(std::max(stackCapacity_ * 2, needed), STACK_SLOTS);
+    std::unique_ptr<TaggedValue[]> slots(new TaggedValue[capacity]);
+    std::copy(stack_.get(), stack_.get() + sp_, slots.get());
+    stack_ = std::move(slots);
+    stackCapacity_ = capacity;
+}
+
+void Interpreter::swapStack(Stack& other) {
+    std::swap(stack_, other.slots);
+    std::swap(stackCapacity_, other.capacity);
+    std::swap(sp_, other.sp);
+    frames_.swap(other.frames);
+}
+
+void Interpreter::doesNotUnderstand(TaggedValue receiver, TaggedValue selector) {
+    throw std::runtime_error(vm_.className(ClassTable::classIndexOf(receiver)) +
+                             " doesNotUnderstand: #" +
+                             std::string(SymbolTable::nameOf(selector)));
+}
+
+void Interpreter::mustBeBoolean() {
+    throw std::runtime_error("NonBooleanReceiver: proceed for truth in " + currentSelector());
+}
+
+void Interpreter::startTracing(size_t capacity) {
+    if (!trace_ || trace_->capacity() < capacity) {
+        trace_ = std::make_unique<TraceBuffer>(capacity);
+    }
+    tracing_ = true;
+}
+
+void Interpreter::dumpTrace(std::ostream& out) {
+    if (!trace_) {
+        out << "Trace: not enabled\n";
+        return;
+    }
+    trace_->write(out, vm_);
+}
+
+std::string Interpreter::currentSelector() const {
+    if (frames_.empty()) {
+        return "";
+    }
+    TaggedValue selector = st::mirrorOf<st::CompiledMethod>(frames_.back().method)->getSelector();
+    return selector.isNil() ? "unbound method" : std::string(SymbolTable::nameOf(selector));
+}
+
+// ============================================================================
+// Dispatch loop
+// ============================================================================
+
+template <unsigned MODE>
+void Interpreter::run(size_t entryDepth) {
+    // Hot state of the active frame, reloaded whenever the frame changes or anything
+    // that can allocate (and therefore move the method) has run.
+    Frame* frame;
+    const uint8_t* code;
+    const TaggedValue* literals;
+    TaggedValue* temps;
+    uint32_t ip;
+
+    auto load = [&]() {
+        frame = &frames_.back();
+        st::CompiledMethod* method = st::mirrorOf<st::CompiledMethod>(frame->method);
+        code = ObjectHeader::fromTaggedValue(method->getBytes())->bytes();
+        literals = ObjectHeader::fromTaggedValue(method->getLiterals())->slots();
+        temps = &stack_[frame->base + 1];
+        ip = frame->ip;
+    };
+    auto leave = [&]() {
+        if constexpr ((MODE & COUNT_HOOK) != 0) {
+            profiler_->endOpcodes(Profiler::cycles());
+        }
+    };
+    if (pendingInterrupt() && switchProcess<MODE>(entryDepth)) {
+        leave();
+        return;
+    }
+    load();
+    TraceBuffer* const trace = trace_.get();
+
+    for (;;) {
+        uint8_t opcode = code[ip];
+        bytecodes_++;
+        if constexpr ((MODE & COUNT_HOOK) != 0) {
+            profiler_->countOpcode(opcode, Profiler::cycles());
+        }
+        if constexpr ((MODE & TRACE_HOOK) != 0) {
+            trace->record(TraceBuffer::INSTRUCTION, frame->method, ip, opcode, stack_[sp_ - 1]);
+            if (trace->dumpRequested()) {
+                trace->acknowledgeDump();
+                dumpTrace(trace->output());
+            }
+        }
+        if constexpr ((MODE & SAMPLE_HOOK) != 0) {
+            if (Profiler::sampleRequested()) {
+                profiler_->takeSample(*this);
+            }
+        }
+        switch (opcode) {
+        case bytecode::PUSH_LITERAL:
+            push(literals[readOperand(code + ip + 1)]);
+            ip += 5;
+            break;
+
+        case bytecode::PUSH_INSTANCE_VARIABLE: {
+            ObjectHeader* self = ObjectHeader::fromTaggedValue(stack_[frame->base]);
+            push(self->slots()[readOperand(code + ip + 1)]);
+            ip += 5;
+            break;
+        }
+
+        case bytecode::PUSH_TEMPORARY_VARIABLE:
+            push(temps[readOperand(code + ip + 1)]);
+            ip += 5;
+            break;
+
+        case bytecode::PUSH_SELF:
+            push(stack_[frame->base]);
+            ip += 1;
+            break;
+
+        case bytecode::STORE_INSTANCE_VARIABLE: {
+            ObjectHeader* self = ObjectHeader::fromTaggedValue(stack_[frame->base]);
+            vm_.memory().storePointer(self, readOperand(code + ip + 1), stackValue(0));
+            ip += 5;
+            break;
+        }
+
+        case bytecode::STORE_TEMPORARY_VARIABLE:
+            temps[readOperand(code + ip + 1)] = stackValue(0);
+            ip += 5;
+            break;
+
+        case bytecode::SEND_MESSAGE: {
+            TaggedValue selector = literals[readOperand(code + ip + 1)];
+            uint32_t argCount = readOperand(code + ip + 5);
+            frame->ip = ip + 9;
+            dispatch<MODE>(selector, argCount);
+            if (pendingInterrupt() && switchProcess<MODE>(entryDepth)) {
+                leave();
+                return;
+            }
+            load();
+            break;
+        }
+
+        case bytecode::EXECUTE_BLOCK: {
+            TaggedValue selector = literals[readOperand(code + ip + 1)];
+            uint32_t argCount = readOperand(code + ip + 5);
+            frame->ip = ip + 9;
+            executeBlock<MODE>(selector, argCount);
+            if (pendingInterrupt() && switchProcess<MODE>(entryDepth)) {
+                leave();
+                return;
+            }
+            load();
+            break;
+        }
+
+        case bytecode::CREATE_BLOCK: {
+            uint32_t count = readOperand(code + ip + 5);
+            uint32_t slot = readOperand(code + ip + 9);
+            if (slot == bytecode::NO_SLOT) {
+                frame->ip = ip + 13;
+                push(literals[readOperand(code + ip + 1)]);
+                TaggedValue closure = newClosure(sp_ - 1, sp_ - 1 - count, count);
+                popThenPush(count + 1, closure);
+                load();
+                break;
+            }
+            temps[slot] = literals[readOperand(code + ip + 1)];
+            std::copy(&stack_[sp_ - count], &stack_[sp_], temps + slot + 1);
+            popThenPush(count, stackBlock(slot, count));
+            ip += 13;
+            break;
+        }
+
+        case bytecode::PUSH_REMOTE_TEMPORARY: {
+            ObjectHeader* vector = ObjectHeader::fromTaggedValue(temps[readOperand(code + ip + 5)]);
+            push(vector->slots()[readOperand(code + ip + 1)]);
+            ip += 9;
+            break;
+        }
+
+        case bytecode::STORE_REMOTE_TEMPORARY: {
+            ObjectHeader* vector = ObjectHeader::fromTaggedValue(temps[readOperand(code + ip + 5)]);
+            vm_.memory().storePointer(vector, readOperand(code + ip + 1), stackValue(0));
+            ip += 9;
+            break;
+        }
+
+        case bytecode::PUSH_ESCAPING_TEMPORARY: {
+            uint32_t index = readOperand(code + ip + 1);
+            TaggedValue block = temps[index];
+            if (isStackBlock(block)) {
+                // Everything but EXECUTE_BLOCK gets the block on the heap, and so does
+                // every later use of the temporary
+                frame->ip = ip + 5;
+                size_t record = frame->base + 1 + stackBlockSlot(block);
+                TaggedValue closure = newClosure(record, record + 1, stackBlockCount(block));
+                load();
+                temps[index] = closure;
+            } else {
+                ip += 5;
+            }
+            push(temps[index]);
+            break;
+        }
+
+        case bytecode::RETURN_STACK_TOP: {
+            TaggedValue result = stackValue(0);
+            sp_ = frame->base;
+            push(result);
+            frames_.pop_back();
+            if constexpr ((MODE & COUNT_HOOK) != 0) {
+                profiler_->exitMethod();
+            }
+            if (frames_.size() == entryDepth || frames_.empty()) {
+                if (scheduler_->inCaller()) {
+                    leave();
+                    return;
+                }
+                if (frames_.empty()) {
+                    // Another Process returned from its first method: it is done
+                    scheduler_->terminateActive();
+                    if (switchProcess<MODE>(entryDepth)) {
+                        leave();
+                        return;
+                    }
+                }
+            }
+            load();
+            break;
+        }
+
+        case bytecode::JUMP: {
+            uint32_t target = readOperand(code + ip + 1);
+            if (target < ip && pendingInterrupt()) {
+                frame->ip = target;
+                if (switchProcess<MODE>(entryDepth)) {
+                    leave();
+                    return;
+                }
+                load();
+                break;
+            }
+            ip = target;
+            break;
+        }
+
+        case bytecode::JUMP_IF_TRUE:
+        case bytecode::JUMP_IF_FALSE: {
+            TaggedValue condition = pop();
+            if (!condition.isBoolean()) {
+                frame->ip = ip;
+                mustBeBoolean();
+            }
+            bool jumpWhen = opcode == bytecode::JUMP_IF_TRUE;
+            uint32_t target = condition.isTrue() == jumpWhen ? readOperand(code + ip + 1) : ip + 5;
+            if (target < ip && pendingInterrupt()) {
+                frame->ip = target;
+                if (switchProcess<MODE>(entryDepth)) {
+                    leave();
+                    return;
+                }
+                load();
+                break;
+            }
+            ip = target;
+            break;
+        }
+
+        case bytecode::POP:
+            sp_--;
+            ip += 1;
+            break;
+
+        case bytecode::DUPLICATE:
+            push(stackValue(0));
+            ip += 1;
+            break;
+
+        default:
+            frame->ip = ip;
+            throw std::runtime_error(std::string("Unimplemented bytecode ") +
+                                     bytecode::opcodeName(opcode) + " in " + currentSelector());
+        }
+    }
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "handler_table.hpp"
+#include "safepoint.hpp"
+#include "tagged_value.hpp"
+#include "trace_buffer.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Profiler;
+class Scheduler;
+class VM;
+
+/**
+ * Interpreter - executes CompiledMethods
+ *
+ * Activations live on a native frame stack rather than in heap Contexts: one value
+ * stack holds each activation's receiver, arguments, temporaries and operands, and a
+ * Frame records the method, instruction pointer and where its receiver sits. Nothing
+ * is allocated per send. Both stacks are GC roots.
+ *
+ * Sends look up the receiver's class index and selector in a global method cache
+ * before walking the superclass chain. A method with a primitive number runs the
+ * primitive first and only activates its bytecodes if the primitive fails.
+ *
+ * Profiling and tracing hooks are compiled into separate instantiations of the dispatch
+ * loop. send() picks the one matching the attached Profiler and tracing state, so with
+ * neither enabled the loop carries no instrumentation at all.
+ *
+ * Green-thread Processes (see Scheduler) each own such a pair of stacks; switching
+ * Process swaps the interpreter's stacks with the parked ones in O(1). Switches happen
+ * only where the dispatch loop polls its interrupt word: after each send (so at every
+ * method entry) and at backward jumps. Primitives such as Semaphore>>wait just request
+ * one. The same polls are the interpreter's safepoints, where other threads can stop
+ * it (see Safepoints).
+ *
+ * Exception>>signal unwinds the native frames straight to the handler, found through
+ * the handler tables of the methods on the stack (see handler_table.hpp); no Context
+ * is reified. Errors that Smalltalk code cannot handle (unhandled exceptions,
+ * doesNotUnderstand:, mustBeBoolean, primitive failures without fallback code) are
+ * thrown as std::runtime_error; the stacks are unwound to where the failed send()
+ * started. An error in another Process terminates that Process before it reaches the
+ * caller.
+ */
+class Interpreter {
+public:
+    static constexpr size_t STACK_SLOTS = 256 * 1024;
+    static constexpr size_t MAX_FRAMES = 64 * 1024;
+    static constexpr size_t METHOD_CACHE_SIZE = 1024;
+    // Free slots an activation needs beyond its temporaries; expressions never nest this deep
+    static constexpr size_t OPERAND_HEADROOM = 1024;
+
+    struct Frame {
+        TaggedValue method;
+        uint32_t ip;
+        uint32_t base;  // Stack index of the receiver; arguments and temporaries follow
+    };
+
+    // A value stack and its frames. The interpreter runs on one at a time; swapStack()
+    // parks it and takes over another, which is how Processes switch.
+    struct Stack {
+        std::unique_ptr<TaggedValue[]> slots;
+        size_t capacity = 0;
+        size_t sp = 0;
+        std::vector<Frame> frames;
+    };
+
+    // Reasons for the dispatch loop to stop at its next poll
+    enum Interrupt : uint32_t { PREEMPT_INTERRUPT = 1, RESCHEDULE_INTERRUPT = 2, SAFEPOINT_INTERRUPT = 4 };
+
+    explicit Interpreter(VM& vm);
+    ~Interpreter();
+
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
+
+    // Sends selector to receiver with args and runs until the send returns
+    TaggedValue send(TaggedValue receiver, TaggedValue selector,
+                     const std::vector<TaggedValue>& args = {});
+    // Runs other Processes until none is ready, with the caller's Process idle
+    void runProcesses();
+
+    // Method for selector in the class at classIndex or its superclasses; nil if none
+    TaggedValue lookup(uint32_t classIndex, TaggedValue selector);
+    void flushMethodCache();
+
+    // Value stack access for primitives. stackValue(0) is the top of stack.
+    TaggedValue stackValue(uint32_t depth) const { return stack_[sp_ - 1 - depth]; }
+    void push(TaggedValue value) { stack_[sp_++] = value; }
+    TaggedValue pop() { return stack_[--sp_]; }
+    void popThenPush(uint32_t count, TaggedValue value) {
+        sp_ -= count;
+        stack_[sp_++] = value;
+    }
+
+    // Continues at the innermost handler for exception in the running Process, first
+    // running the ensure: blocks of the frames in between. Throws std::runtime_error if
+    // no handler in the current send() catches it.
+    void signal(TaggedValue exception);
+
+    // Selector of the innermost active method ("" outside any method)
+    std::string currentSelector() const;
+    size_t frameDepth() const { return frames_.size(); }
+    // Method of the frame at index, 0 being the outermost
+    TaggedValue frameMethod(size_t index) const { return frames_[index].method; }
+    // Where the frame at index resumes; for callers, just past their pending send
+    uint32_t frameIp(size_t index) const { return frames_[index].ip; }
+
+    Scheduler& scheduler() { return *scheduler_; }
+    Safepoints::Participant& safepoint() { return safepoint_; }
+    // Safe from any thread; the dispatch loop acts on it at its next poll
+    void requestInterrupt(Interrupt reason) { interrupts_.fetch_or(reason, std::memory_order_relaxed); }
+    // Exchanges the running stacks with parked ones (only while no dispatch loop holds
+    // pointers into them, i.e. from the Scheduler)
+    void swapStack(Stack& other);
+
+    // Profiling takes effect from the next send(); nullptr detaches
+    void setProfiler(Profiler* profiler) { profiler_ = profiler; }
+    Profiler* profiler() const { return profiler_; }
+
+    // Execution tracing into a ring of at least the last capacity events (see
+    // TraceBuffer). Takes effect from the next send(); stopping keeps the buffer for
+    // dumpTrace().
+    void startTracing(size_t capacity = TraceBuffer::DEFAULT_CAPACITY);
+    void stopTracing() { tracing_ = false; }
+    bool tracing() const { return tracing_; }
+    TraceBuffer* trace() const { return trace_.get(); }
+    // Decodes the retained trace to out, newest events last
+    void dumpTrace(std::ostream& out);
+
+    VM& vm() { return vm_; }
+    uint64_t bytecodesExecuted() const { return bytecodes_; }
+    uint64_t sends() const { return sends_; }
+
+private:
+    struct CacheEntry {
+        uint32_t classIndex;
+        TaggedValue selector;
+        TaggedValue method;
+    };
+
+    // Instrumentation compiled into a dispatch loop variant; MODE is a set of these
+    enum Hook : unsigned { COUNT_HOOK = 1, SAMPLE_HOOK = 2, TRACE_HOOK = 4, MODE_COUNT = 8 };
+
+    unsigned currentMode() const;
+    // Runs body(mode) and, if it throws, runs the ensure: blocks the error passes, then
+    // dumps the trace if asked to, returns to the calling Process and unwinds the stacks
+    // to entrySp and entryDepth
+    template <typename Body>
+    void guarded(size_t entrySp, size_t entryDepth, Body body);
+    // Runs the send on the stack in the loop variant for mode, searching from MODE up
+    template <unsigned MODE>
+    void execute(unsigned mode, uint32_t argCount, TaggedValue selector, size_t entryDepth);
+    // Continues the stack's innermost frame in the loop variant for mode
+    template <unsigned MODE>
+    void resume(unsigned mode, size_t entryDepth);
+    template <unsigned MODE>
+    void run(size_t entryDepth);
+    // Clears the interrupt word, parks if a Stop asked for a safepoint, and switches to
+    // the Process the Scheduler picks, starting it if it is new. Answers true if that is the calling Process, back at
+    // entryDepth, so run() must return.
+    template <unsigned MODE>
+    bool switchProcess(size_t entryDepth);
+    bool pendingInterrupt() const { return interrupts_.load(std::memory_order_relaxed) != 0; }
+    // Runs a primitive or pushes a frame for the method selector finds
+    template <unsigned MODE>
+    void dispatch(TaggedValue selector, uint32_t argCount);
+    // EXECUTE_BLOCK: activates the method of a BlockClosure or stack block receiver,
+    // sends to anything else
+    template <unsigned MODE>
+    void executeBlock(TaggedValue selector, uint32_t argCount);
+    void activate(TaggedValue method, uint32_t argCount);
+    // A BlockClosure for the current frame's self with the method at stack index method
+    // and the count values from stack index copied on (see CREATE_BLOCK)
+    TaggedValue newClosure(size_t method, size_t copied, uint32_t count);
+
+    // A stack block is a special immediate (low bits 0xD, a pattern no other value uses)
+    // holding where CREATE_BLOCK stored its method and copied values in its frame's
+    // temporaries and how many copied values there are
+    static TaggedValue stackBlock(uint32_t slot, uint32_t count) {
+        return TaggedValue((static_cast<TaggedValue::Value>(slot) << 32) |
+                           (static_cast<TaggedValue::Value>(count) << 4) | 0xD);
+    }
+    static bool isStackBlock(TaggedValue value) { return (value.value() & 0xF) == 0xD; }
+    static uint32_t stackBlockSlot(TaggedValue block) { return static_cast<uint32_t>(block.value() >> 32); }
+    static uint32_t stackBlockCount(TaggedValue block) {
+        return static_cast<uint32_t>((block.value() >> 4) & 0xFFFFFFF);
+    }
+    // Innermost ensure: entry covering the ip of a frame from floor up, looking only at
+    // the entries before floorLimit in frame floor. Answers false if there is none.
+    bool findEnsure(size_t floor, size_t floorLimit, size_t& frame, handler_table::Entry& entry) const;
+    // Continues the innermost ensure: block covering a frame from floor up with a VMError
+    // for error on the stack. Answers false if no ensure: block covers one.
+    bool unwindToEnsure(std::exception_ptr error, size_t floor);
+    // Pops the frames above frame and continues it at a handler table entry's target,
+    // with its stack cut back to the entry's depth
+    void unwindTo(size_t frame, uint32_t target, uint32_t depth);
+    void growStack(size_t needed);
+    [[noreturn]] void doesNotUnderstand(TaggedValue receiver, TaggedValue selector);
+    [[noreturn]] void mustBeBoolean();
+
+    VM& vm_;
+    std::unique_ptr<TaggedValue[]> stack_;
+    size_t stackCapacity_;
+    size_t sp_;
+    std::vector<Frame> frames_;
+    // Loop variant and frame depth of the innermost send() or runProcesses() in progress
+    unsigned mode_;
+    size_t entryDepth_;
+    std::atomic<uint32_t> interrupts_;
+    Safepoints::Participant safepoint_;
+    std::unique_ptr<Scheduler> scheduler_;
+    std::array<CacheEntry, METHOD_CACHE_SIZE> methodCache_;
+    size_t rootProvider_;
+    Profiler* profiler_;
+    std::unique_ptr<TraceBuffer> trace_;
+    bool tracing_;
+
+    uint64_t bytecodes_;
+    uint64_t sends_;
+};
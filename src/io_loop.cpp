@@ -0,0 +1,243 @@
+#include "io_loop.hpp"
+#include "scheduler.hpp"
+#include "vm.hpp"
+#include <arpa/inet.h>
+#include <array>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+bool loopbackAddress(const std::string& host, uint16_t port, sockaddr_in& address) {
+    address = sockaddr_in{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    return inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1;
+}
+
+// Small messages go out at once: no Nagle delay on request/response traffic
+void noDelay(int socket) {
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+} // namespace
+
+IOLoop::IOLoop(VM& vm, Scheduler& scheduler)
+    : vm_(vm), scheduler_(scheduler), epoll_(epoll_create1(EPOLL_CLOEXEC)), waiting_(0), polls_(0),
+      wakeups_(0) {
+    if (epoll_ < 0) {
+        throw std::runtime_error("epoll_create1 failed");
+    }
+    rootProvider_ = vm_.memory().addRootProvider([this](const MemoryManager::RootVisitor& visit) {
+        for (auto& entry : descriptors_) {
+            for (TaggedValue& semaphore : entry.second.readable) {
+                visit(semaphore);
+            }
+            for (TaggedValue& semaphore : entry.second.writable) {
+                visit(semaphore);
+            }
+        }
+    });
+}
+
+IOLoop::~IOLoop() {
+    vm_.memory().removeRootProvider(rootProvider_);
+    for (const auto& entry : descriptors_) {
+        ::close(entry.first);
+    }
+    ::close(epoll_);
+}
+
+// ============================================================================
+// Descriptors
+// ============================================================================
+
+int IOLoop::adopt(int descriptor) {
+    if (descriptor < 0) {
+        return static_cast<int>(FAILED);
+    }
+    Descriptor entry;
+    struct stat status;
+    entry.pollable = fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode);
+    descriptors_[descriptor] = entry;
+    return descriptor;
+}
+
+int IOLoop::openFile(const std::string& path, FileMode mode) {
+    int flags = O_CLOEXEC | O_NONBLOCK;
+    switch (mode) {
+    case READ:
+        flags |= O_RDONLY;
+        break;
+    case WRITE:
+        flags |= O_WRONLY | O_CREAT | O_TRUNC;
+        break;
+    case APPEND:
+        flags |= O_WRONLY | O_CREAT | O_APPEND;
+        break;
+    default:
+        return static_cast<int>(FAILED);
+    }
+    return adopt(::open(path.c_str(), flags, 0644));
+}
+
+int IOLoop::listen(const std::string& host, uint16_t port) {
+    sockaddr_in address;
+    if (!loopbackAddress(host, port, address)) {
+        return static_cast<int>(FAILED);
+    }
+    int socket = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket < 0) {
+        return static_cast<int>(FAILED);
+    }
+    int on = 1;
+    setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(socket, SOMAXCONN) != 0) {
+        ::close(socket);
+        return static_cast<int>(FAILED);
+    }
+    return adopt(socket);
+}
+
+int IOLoop::accept(int listener) {
+    if (!isOpen(listener)) {
+        return static_cast<int>(FAILED);
+    }
+    int socket = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (socket < 0) {
+        return static_cast<int>(errno == EAGAIN || errno == EWOULDBLOCK ? WOULD_BLOCK : FAILED);
+    }
+    noDelay(socket);
+    return adopt(socket);
+}
+
+int IOLoop::connect(const std::string& host, uint16_t port) {
+    sockaddr_in address;
+    if (!loopbackAddress(host, port, address)) {
+        return static_cast<int>(FAILED);
+    }
+    int socket = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket < 0) {
+        return static_cast<int>(FAILED);
+    }
+    if (::connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 && errno != EINPROGRESS) {
+        ::close(socket);
+        return static_cast<int>(FAILED);
+    }
+    noDelay(socket);
+    return adopt(socket);
+}
+
+int IOLoop::localPort(int socket) const {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    if (!isOpen(socket) || getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) != 0 ||
+        address.sin_family != AF_INET) {
+        return static_cast<int>(FAILED);
+    }
+    return ntohs(address.sin_port);
+}
+
+int IOLoop::connectionError(int socket) const {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (!isOpen(socket) || getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+        return static_cast<int>(FAILED);
+    }
+    return error;
+}
+
+bool IOLoop::close(int descriptor) {
+    auto it = descriptors_.find(descriptor);
+    if (it == descriptors_.end()) {
+        return false;
+    }
+    Descriptor& entry = it->second;
+    if (entry.events != 0) {
+        epoll_ctl(epoll_, EPOLL_CTL_DEL, descriptor, nullptr);
+    }
+    signal(entry.readable);
+    signal(entry.writable);
+    descriptors_.erase(it);
+    ::close(descriptor);
+    return true;
+}
+
+// ============================================================================
+// Readiness
+// ============================================================================
+
+bool IOLoop::waitFor(int descriptor, Direction direction, TaggedValue semaphore) {
+    auto it = descriptors_.find(descriptor);
+    if (it == descriptors_.end()) {
+        return false;
+    }
+    Descriptor& entry = it->second;
+    if (!entry.pollable) {
+        scheduler_.signal(semaphore);
+        return true;
+    }
+    // Every Process waiting in a direction is woken; those that lose the race for the
+    // data wait again
+    (direction == READABLE ? entry.readable : entry.writable).push_back(semaphore);
+    waiting_++;
+    rearm(descriptor, entry);
+    return true;
+}
+
+void IOLoop::rearm(int descriptor, Descriptor& entry) {
+    uint32_t events = (entry.readable.empty() ? 0u : static_cast<uint32_t>(EPOLLIN)) |
+                      (entry.writable.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    if (events == entry.events) {
+        return;
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = descriptor;
+    int operation = entry.events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    epoll_ctl(epoll_, operation, descriptor, &event);
+    entry.events = events;
+}
+
+void IOLoop::signal(std::vector<TaggedValue>& semaphores) {
+    for (TaggedValue semaphore : semaphores) {
+        scheduler_.signal(semaphore);
+    }
+    waiting_ -= semaphores.size();
+    wakeups_ += semaphores.size();
+    semaphores.clear();
+}
+
+void IOLoop::poll(bool block) {
+    std::array<epoll_event, 64> events;
+    int ready;
+    do {
+        ready = epoll_wait(epoll_, events.data(), static_cast<int>(events.size()), block ? -1 : 0);
+    } while (ready < 0 && errno == EINTR);
+    polls_++;
+    for (int i = 0; i < ready; i++) {
+        auto it = descriptors_.find(events[i].data.fd);
+        if (it == descriptors_.end()) {
+            continue;
+        }
+        Descriptor& entry = it->second;
+        // Errors and hang-ups wake both directions: the retried transfer reports them
+        uint32_t happened = events[i].events;
+        if ((happened & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) {
+            signal(entry.readable);
+        }
+        if ((happened & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0) {
+            signal(entry.writable);
+        }
+        rearm(it->first, entry);
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+class Scheduler;
+class VM;
+
+/**
+ * IOLoop - non-blocking files and sockets for one Scheduler, driven by epoll
+ *
+ * The loop owns descriptors and their readiness; the transfers themselves are
+ * primitives::readInto and writeFrom (io_primitives.hpp), straight between the
+ * descriptor and a ByteArray's bytes without a copy. Every descriptor the loop opens is
+ * non-blocking, so a primitive never stalls the interpreter: a transfer that would
+ * block answers nil, and the Smalltalk side (IOHandle) asks waitFor() to signal a
+ * Semaphore once the descriptor is ready, then waits on it. Only that Process waits;
+ * the others keep running.
+ *
+ * The Scheduler polls the loop without blocking whenever a Process waits or the timer
+ * preempts one, and when no Process is ready it blocks in epoll_wait (as a Safepoints
+ * Blocked region) until a descriptor is. Readiness is level-triggered and one-shot per
+ * waitFor(): the loop disarms a direction when it signals it.
+ *
+ * Regular files cannot be polled and are always ready. Only descriptors the loop opened are accepted, and it closes those still
+ * open when it is destroyed.
+ */
+class IOLoop {
+public:
+    enum Direction : uint32_t { READABLE = 1, WRITABLE = 2 };
+    enum FileMode : int { READ = 0, WRITE = 1, APPEND = 2 };
+
+    static constexpr ssize_t FAILED = -1;
+    static constexpr ssize_t WOULD_BLOCK = -2;
+
+    IOLoop(VM& vm, Scheduler& scheduler);
+    ~IOLoop();
+
+    IOLoop(const IOLoop&) = delete;
+    IOLoop& operator=(const IOLoop&) = delete;
+
+    // Opening: a new descriptor, or FAILED. host is a dotted IPv4 address; port 0 listens
+    // on a free port (see localPort). A connect may still be in progress: wait for
+    // WRITABLE, then check connectionError.
+    int openFile(const std::string& path, FileMode mode);
+    int listen(const std::string& host, uint16_t port);
+    int accept(int listener);  // Or WOULD_BLOCK when no connection is pending
+    int connect(const std::string& host, uint16_t port);
+    int localPort(int socket) const;      // Or FAILED
+    int connectionError(int socket) const;  // errno of a failed connect, 0 once connected
+    bool close(int descriptor);  // Signals its waiters, whose retries then fail
+
+    bool isOpen(int descriptor) const { return descriptors_.count(descriptor) != 0; }
+    size_t openDescriptors() const { return descriptors_.size(); }
+
+    // Signals semaphore once descriptor is ready in direction (at once for regular files).
+    // Any number of waits may be armed on one descriptor and direction; readiness signals
+    // them all. False for descriptors the loop did not open.
+    bool waitFor(int descriptor, Direction direction, TaggedValue semaphore);
+    // Armed waits, over all descriptors
+    size_t waiting() const { return waiting_; }
+    // Signals the Semaphores of the ready descriptors; with block, first waits until at
+    // least one is ready
+    void poll(bool block);
+
+    uint64_t polls() const { return polls_; }
+    uint64_t wakeups() const { return wakeups_; }
+
+private:
+    struct Descriptor {
+        std::vector<TaggedValue> readable;  // Semaphores of the armed waits
+        std::vector<TaggedValue> writable;
+        uint32_t events = 0;   // epoll events registered
+        bool pollable = true;  // False for regular files
+    };
+
+    int adopt(int descriptor);
+    void rearm(int descriptor, Descriptor& entry);
+    void signal(std::vector<TaggedValue>& semaphores);
+
+    VM& vm_;
+    Scheduler& scheduler_;
+    int epoll_;
+    std::unordered_map<int, Descriptor> descriptors_;
+    size_t waiting_;
+    uint64_t polls_;
+    uint64_t wakeups_;
+    size_t rootProvider_;
+};
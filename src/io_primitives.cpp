@@ -0,0 +1,48 @@
+#include "io_primitives.hpp"
+#include "object_header.hpp"
+#include <cerrno>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace primitives {
+
+uint8_t* bufferBytes(TaggedValue buffer, size_t offset, size_t count, bool writable) {
+    if (!buffer.isPointer() || buffer.isNil()) {
+        throw std::invalid_argument("I/O buffer must be a ByteArray or String");
+    }
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(buffer);
+    if (object->type() != ObjectHeader::TYPE_BYTE_ARRAY) {
+        throw std::invalid_argument("I/O buffer must be a ByteArray or String");
+    }
+    if (writable && object->hasFlag(ObjectHeader::FLAG_IMMUTABLE)) {
+        throw std::invalid_argument("Cannot read into an immutable buffer");
+    }
+    if (offset > object->size() || count > object->size() - offset) {
+        throw std::out_of_range("I/O range outside buffer");
+    }
+    return object->bytes() + offset;
+}
+
+ssize_t readInto(int fd, TaggedValue buffer, size_t offset, size_t count) {
+    uint8_t* bytes = bufferBytes(buffer, offset, count, true);
+    ssize_t result;
+    do {
+        result = ::read(fd, bytes, count);
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+ssize_t writeFrom(int fd, TaggedValue buffer, size_t offset, size_t count) {
+    const uint8_t* bytes = bufferBytes(buffer, offset, count, false);
+    ssize_t result;
+    do {
+        result = ::send(fd, bytes, count, MSG_NOSIGNAL);
+        if (result < 0 && errno == ENOTSOCK) {
+            result = ::write(fd, bytes, count);
+        }
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+} // namespace primitives
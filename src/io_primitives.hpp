@@ -0,0 +1,36 @@
+#pragma once
+
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+/**
+ * I/O primitives over byte objects
+ *
+ * Reads and writes go straight between a file descriptor (file, pipe or socket) and
+ * the body of a ByteArray or String, with no intermediate buffer. Each transfer is
+ * over before the call returns and nothing allocates in between, so the collector
+ * cannot move the bytes while the kernel uses them and the buffer need not be pinned.
+ * Pinned buffers (see MemoryManager::allocatePinnedBytes) are for code that leaves an
+ * address with the kernel beyond one call.
+ *
+ * Invalid arguments throw (std::invalid_argument for a non-byte object, or an immutable
+ * one to read into; std::out_of_range for a range outside the body). A failed system
+ * call answers -1 with errno set, which the primitive reports as a primitive failure,
+ * or as "not ready" for EAGAIN on a non-blocking descriptor.
+ */
+namespace primitives {
+
+// Reads up to count bytes into buffer[offset, offset + count); answers bytes read
+ssize_t readInto(int fd, TaggedValue buffer, size_t offset, size_t count);
+
+// Writes buffer[offset, offset + count); answers bytes written. A socket whose peer has
+// gone fails with EPIPE instead of raising SIGPIPE.
+ssize_t writeFrom(int fd, TaggedValue buffer, size_t offset, size_t count);
+
+// Answers the address of buffer[offset] after checking its format and the bounds, and
+// with writable that it may be modified
+uint8_t* bufferBytes(TaggedValue buffer, size_t offset, size_t count, bool writable);
+
+} // namespace primitives
@@ -0,0 +1,76 @@
+#include "isolate.hpp"
+#include "image_segment.hpp"
+#include "safepoint.hpp"
+#include "vm.hpp"
+#include <utility>
+
+Isolate::Isolate(std::shared_ptr<const ImageSegment> image, size_t nurseryBytes, size_t oldSpaceBytes)
+    : vm_(std::make_unique<VM>(std::move(image), nurseryBytes, oldSpaceBytes)), stopping_(false), handled_(0) {
+    thread_ = std::thread([this] { run(); });
+}
+
+Isolate::~Isolate() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_one();
+    thread_.join();
+}
+
+std::future<void> Isolate::post(std::function<void(VM&)> task) {
+    auto work = std::make_shared<std::packaged_task<void()>>([this, task = std::move(task)] { task(*vm_); });
+    std::future<void> result = work->get_future();
+    enqueue([work] { (*work)(); });
+    return result;
+}
+
+std::future<Envelope> Isolate::send(std::string selector, Envelope message) {
+    auto work = std::make_shared<std::packaged_task<Envelope()>>(
+        [this, selector = std::move(selector), message = std::move(message)] {
+            std::vector<TaggedValue> values = message.open(*vm_);
+            if (values.empty()) {
+                throw std::invalid_argument("A message needs a receiver");
+            }
+            TaggedValue receiver = values.front();
+            values.erase(values.begin());
+            TaggedValue result = vm_->send(receiver, selector, std::move(values));
+            return Envelope::copy(*vm_, {result});
+        });
+    std::future<Envelope> result = work->get_future();
+    enqueue([work] { (*work)(); });
+    return result;
+}
+
+uint64_t Isolate::messagesHandled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return handled_;
+}
+
+void Isolate::enqueue(std::function<void()> work) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mailbox_.push_back(std::move(work));
+    }
+    wakeup_.notify_one();
+}
+
+void Isolate::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wakeup_.wait(lock, [this] { return stopping_ || !mailbox_.empty(); });
+        if (mailbox_.empty()) {
+            return;
+        }
+        std::function<void()> work = std::move(mailbox_.front());
+        mailbox_.pop_front();
+        lock.unlock();
+        {
+            // Plain C++ in a task has no polls: a Stop waits for the task or its next send
+            Safepoints::Running running(vm_->interpreter());
+            work();  // A packaged task: errors go to its future
+        }
+        lock.lock();
+        handled_++;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "envelope.hpp"
+#include "memory_manager.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class ImageSegment;
+class VM;
+
+/**
+ * Isolate - a VM on a thread of its own, sharing an ImageSegment with its siblings
+ *
+ * Each Isolate owns a VM built on the segment (its own interpreter, nursery and old
+ * space) and a thread that is the only one to touch it. Nothing mutable is shared
+ * between isolates, so they run in parallel without locks; the segment is read-only.
+ *
+ * Work reaches an Isolate only through its mailbox, in order. send() is
+ * message passing with copy-on-send: the message is an Envelope holding the receiver
+ * and arguments, opened in the isolate's VM, and the answer comes back as an Envelope
+ * too. post() runs C++ against the VM on the isolate's thread (e.g. to define classes
+ * or compile methods). Any thread may call either, including another isolate's.
+ */
+class Isolate {
+public:
+    explicit Isolate(std::shared_ptr<const ImageSegment> image,
+                     size_t nurseryBytes = MemoryManager::DEFAULT_NURSERY_BYTES,
+                     size_t oldSpaceBytes = MemoryManager::DEFAULT_OLD_SPACE_BYTES);
+    // Runs what is already in the mailbox, then stops the thread
+    ~Isolate();
+
+    Isolate(const Isolate&) = delete;
+    Isolate& operator=(const Isolate&) = delete;
+
+    // Runs task with the isolate's VM; an exception it throws goes to the future
+    std::future<void> post(std::function<void(VM&)> task);
+    // Sends selector to the first root of message with the others as arguments and
+    // answers the result, copied. An error in the send goes to the future.
+    std::future<Envelope> send(std::string selector, Envelope message);
+
+    uint64_t messagesHandled() const;
+
+private:
+    void enqueue(std::function<void()> work);
+    void run();
+
+    std::unique_ptr<VM> vm_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::deque<std::function<void()>> mailbox_;
+    bool stopping_;
+    uint64_t handled_;
+    std::thread thread_;
+};
@@ -0,0 +1,67 @@
+#include "large_object_space.hpp"
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+LargeObjectSpace::~LargeObjectSpace() {
+    for (const void* address : objects_) {
+        unmap(static_cast<ObjectHeader*>(const_cast<void*>(address)));
+    }
+}
+
+size_t LargeObjectSpace::pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+size_t LargeObjectSpace::mappingBytes(const ObjectHeader* object) {
+    // One page for the header, then the body rounded up to whole pages.
+    size_t page = pageSize();
+    return page + ((object->bodyBytes() + page - 1) / page) * page;
+}
+
+ObjectHeader* LargeObjectSpace::allocate(ObjectHeader::Type type, uint32_t size,
+                                         uint32_t classIndex) {
+    size_t page = pageSize();
+    size_t bodyBytes = ObjectHeader::bodyBytesFor(type, size);
+    size_t headerBytes = ObjectHeader::totalBytesFor(type, size) - bodyBytes;
+    size_t bytes = page + ((bodyBytes + page - 1) / page) * page;
+
+    void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+
+    // Anonymous mappings are zero-filled, which is already right for byte objects.
+    uint8_t* start = static_cast<uint8_t*>(mapping) + page - headerBytes;
+    ObjectHeader* object = ObjectHeader::initialize(start, type, size, classIndex);
+    object->setFlag(ObjectHeader::FLAG_PINNED);
+    if (object->containsPointers()) {
+        std::fill_n(object->slots(), bodyBytes / sizeof(TaggedValue), TaggedValue::nil());
+    }
+
+    objects_.insert(object);
+    bytesUsed_ += bytes;
+    return object;
+}
+
+void LargeObjectSpace::sweep() {
+    for (auto it = objects_.begin(); it != objects_.end();) {
+        auto object = static_cast<ObjectHeader*>(const_cast<void*>(*it));
+        if (object->hasFlag(ObjectHeader::FLAG_MARKED)) {
+            object->clearFlag(ObjectHeader::FLAG_MARKED);
+            ++it;
+            continue;
+        }
+        bytesUsed_ -= mappingBytes(object);
+        unmap(object);
+        it = objects_.erase(it);
+    }
+}
+
+void LargeObjectSpace::unmap(ObjectHeader* object) {
+    size_t bytes = mappingBytes(object);
+    uint8_t* mapping = reinterpret_cast<uint8_t*>(object->slots()) - pageSize();
+    munmap(mapping, bytes);
+}
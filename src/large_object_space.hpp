@@ -0,0 +1,56 @@
+#pragma once
+
+#include "object_header.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * LargeObjectSpace - non-moving space for large and pinned objects
+ *
+ * Each object gets its own page-aligned mapping laid out so that the body starts on a
+ * page boundary: the header (and overflow word) sit at the end of the first page.
+ * Objects here never move, so their bytes can be handed to the kernel for I/O without
+ * a copy. Every object in this space carries FLAG_PINNED.
+ *
+ * Collection is mark-sweep in place: the major collector marks reachable objects with
+ * FLAG_MARKED and sweep() unmaps the rest.
+ */
+class LargeObjectSpace {
+public:
+    LargeObjectSpace() = default;
+    ~LargeObjectSpace();
+
+    LargeObjectSpace(const LargeObjectSpace&) = delete;
+    LargeObjectSpace& operator=(const LargeObjectSpace&) = delete;
+
+    // Allocation. Slots start as nil, bytes as zero. Throws std::bad_alloc if the
+    // mapping fails.
+    ObjectHeader* allocate(ObjectHeader::Type type, uint32_t size, uint32_t classIndex);
+
+    // True if address is the header of an object in this space
+    bool contains(const void* address) const { return objects_.count(address) != 0; }
+
+    // Frees every object without FLAG_MARKED and clears the mark on the survivors
+    void sweep();
+
+    size_t bytesUsed() const { return bytesUsed_; }
+    size_t objectCount() const { return objects_.size(); }
+
+    template <typename Visitor>
+    void forEach(const Visitor& visit) const {
+        for (const void* address : objects_) {
+            visit(static_cast<ObjectHeader*>(const_cast<void*>(address)));
+        }
+    }
+
+    static size_t pageSize();
+
+private:
+    static size_t mappingBytes(const ObjectHeader* object);
+    static void unmap(ObjectHeader* object);
+
+    std::unordered_set<const void*> objects_;
+    size_t bytesUsed_ = 0;
+};
@@ -0,0 +1,366 @@
+#include "memory_manager.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// ============================================================================
+// Space
+// ============================================================================
+
+MemoryManager::Space::Space(size_t bytes)
+    : memory_(new uint64_t[(bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t)]) {
+    start_ = reinterpret_cast<uint8_t*>(memory_.get());
+    end_ = start_ + ((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t)) * sizeof(uint64_t);
+    top_ = start_;
+}
+
+uint8_t* MemoryManager::Space::bump(size_t bytes) {
+    if (bytes > available()) {
+        return nullptr;
+    }
+    uint8_t* result = top_;
+    top_ += bytes;
+    return result;
+}
+
+// ============================================================================
+// MemoryManager
+// ============================================================================
+
+MemoryManager::MemoryManager(size_t nurseryBytes, size_t oldSpaceBytes, size_t largeObjectBytes)
+    : nursery_(nurseryBytes),
+      oldSpaces_{Space(oldSpaceBytes), Space(oldSpaceBytes)},
+      activeOld_(0),
+      largeObjects_(),
+      largeObjectThreshold_(largeObjectBytes),
+      largeObjectBytesAfterMajor_(0),
+      markingLargeObjects_(false),
+      nextRootProviderId_(0),
+      minorCollections_(0),
+      majorCollections_(0),
+      allocations_(0),
+      bytesAllocated_(0),
+      collectionTime_(0) {
+}
+
+void MemoryManager::checkSlotType(ObjectHeader::Type type) {
+    if (type == ObjectHeader::TYPE_BYTE_ARRAY || type == ObjectHeader::TYPE_SYMBOL) {
+        throw std::invalid_argument("allocateSlots needs a pointer object type");
+    }
+}
+
+void MemoryManager::checkByteType(ObjectHeader::Type type) {
+    if (type != ObjectHeader::TYPE_BYTE_ARRAY && type != ObjectHeader::TYPE_SYMBOL) {
+        throw std::invalid_argument("allocateBytes needs a byte object type");
+    }
+}
+
+ObjectHeader* MemoryManager::allocateSlots(ObjectHeader::Type type, uint32_t numSlots,
+                                           uint32_t classIndex) {
+    checkSlotType(type);
+    return allocate(type, numSlots, classIndex);
+}
+
+ObjectHeader* MemoryManager::allocateBytes(ObjectHeader::Type type, uint32_t numBytes,
+                                           uint32_t classIndex) {
+    checkByteType(type);
+    return allocate(type, numBytes, classIndex);
+}
+
+ObjectHeader* MemoryManager::allocatePinnedSlots(ObjectHeader::Type type, uint32_t numSlots,
+                                                 uint32_t classIndex) {
+    checkSlotType(type);
+    return allocateLarge(type, numSlots, classIndex);
+}
+
+ObjectHeader* MemoryManager::allocatePinnedBytes(ObjectHeader::Type type, uint32_t numBytes,
+                                                 uint32_t classIndex) {
+    checkByteType(type);
+    return allocateLarge(type, numBytes, classIndex);
+}
+
+ObjectHeader* MemoryManager::allocate(ObjectHeader::Type type, uint32_t size,
+                                      uint32_t classIndex) {
+    size_t bytes = ObjectHeader::totalBytesFor(type, size);
+
+    if (bytes >= largeObjectThreshold_) {
+        return allocateLarge(type, size, classIndex);
+    }
+
+    // Objects too big to scavenge cheaply are created directly in old space.
+    if (bytes > nursery_.capacity() / 4) {
+        uint8_t* memory = oldSpace().bump(bytes);
+        if (memory == nullptr) {
+            majorCollection();
+            memory = oldSpace().bump(bytes);
+            if (memory == nullptr) {
+                throw std::runtime_error("Object memory exhausted");
+            }
+        }
+        return initializeObject(memory, type, size, classIndex);
+    }
+
+    uint8_t* memory = nursery_.bump(bytes);
+    if (memory == nullptr) {
+        minorCollection();
+        memory = nursery_.bump(bytes);
+    }
+    return initializeObject(memory, type, size, classIndex);
+}
+
+ObjectHeader* MemoryManager::allocateLarge(ObjectHeader::Type type, uint32_t size,
+                                           uint32_t classIndex) {
+    // Large objects are only reclaimed by a major collection; run one once the space
+    // has grown by half an old-space's worth since the last.
+    if (largeObjects_.bytesUsed() > largeObjectBytesAfterMajor_ + oldSpace().capacity() / 2) {
+        majorCollection();
+    }
+    ObjectHeader* object = largeObjects_.allocate(type, size, classIndex);
+    allocations_++;
+    bytesAllocated_ += object->totalBytes();
+    if (allocationHook_) {
+        allocationHook_(object);
+    }
+    return object;
+}
+
+ObjectHeader* MemoryManager::initializeObject(uint8_t* memory, ObjectHeader::Type type,
+                                              uint32_t size, uint32_t classIndex) {
+    ObjectHeader* object = ObjectHeader::initialize(memory, type, size, classIndex);
+    allocations_++;
+    bytesAllocated_ += object->totalBytes();
+    if (object->isBytes()) {
+        std::memset(object->bytes(), 0, object->bodyBytes());
+    } else {
+        std::fill_n(object->slots(), object->bodyBytes() / sizeof(TaggedValue), TaggedValue::nil());
+    }
+    if (allocationHook_) {
+        allocationHook_(object);
+    }
+    return object;
+}
+
+void MemoryManager::rejectStore(ObjectHeader* object, uint32_t index) {
+    if (index >= object->size() || object->isBytes()) {
+        throw std::out_of_range("Object slot index out of range");
+    }
+    throw std::runtime_error("Cannot store into an immutable object");
+}
+
+void MemoryManager::remember(ObjectHeader* object, TaggedValue* slot) {
+    if (object->hasFlag(ObjectHeader::FLAG_PINNED)) {
+        // A slot that already held a young object was remembered when it got it
+        if (!slot->isPointer() || !isYoung(slot->toPointer())) {
+            rememberedSlots_.push_back(slot);
+        }
+    } else if (!object->hasFlag(ObjectHeader::FLAG_REMEMBERED)) {
+        object->setFlag(ObjectHeader::FLAG_REMEMBERED);
+        rememberedSet_.push_back(object);
+    }
+}
+
+void MemoryManager::addRoot(TaggedValue* root) {
+    roots_.push_back(root);
+}
+
+void MemoryManager::removeRoot(TaggedValue* root) {
+    roots_.erase(std::remove(roots_.begin(), roots_.end(), root), roots_.end());
+}
+
+size_t MemoryManager::addRootProvider(RootProvider provider) {
+    size_t id = nextRootProviderId_++;
+    rootProviders_.emplace_back(id, std::move(provider));
+    return id;
+}
+
+void MemoryManager::removeRootProvider(size_t id) {
+    rootProviders_.erase(std::remove_if(rootProviders_.begin(), rootProviders_.end(),
+                                        [id](const auto& entry) { return entry.first == id; }),
+                         rootProviders_.end());
+}
+
+MemoryManager::ScopedRoots::ScopedRoots(MemoryManager& memory, std::vector<TaggedValue>& values)
+    : memory_(memory) {
+    id_ = memory_.addRootProvider([&values](const RootVisitor& visit) {
+        for (TaggedValue& value : values) {
+            visit(value);
+        }
+    });
+}
+
+MemoryManager::ScopedRoots::~ScopedRoots() {
+    memory_.removeRootProvider(id_);
+}
+
+bool MemoryManager::contains(const void* address) const {
+    return nursery_.contains(address) || oldSpace().contains(address) ||
+           largeObjects_.contains(address);
+}
+
+// ============================================================================
+// Collection
+// ============================================================================
+
+template <typename InFromSpace>
+TaggedValue MemoryManager::evacuate(TaggedValue value, Space& to,
+                                    const InFromSpace& inFromSpace) {
+    if (!value.isPointer()) {
+        return value;
+    }
+    if (!inFromSpace(value.toPointer())) {
+        if (markingLargeObjects_) {
+            markLargeObject(value);
+        }
+        return value;
+    }
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(value);
+    auto forwardingSlot = reinterpret_cast<ObjectHeader**>(object->slots());
+    if (object->hasFlag(ObjectHeader::FLAG_FORWARDED)) {
+        return (*forwardingSlot)->toTaggedValue();
+    }
+
+    // The header (and with it the class index and identity hash) is copied verbatim.
+    size_t bytes = object->totalBytes();
+    uint8_t* memory = to.bump(bytes);
+    if (memory == nullptr) {
+        throw std::runtime_error("Object memory exhausted");
+    }
+    std::memcpy(memory, object->objectStart(), bytes);
+    ObjectHeader* copy = ObjectHeader::fromObjectStart(memory);
+    copy->clearFlag(ObjectHeader::FLAG_REMEMBERED | ObjectHeader::FLAG_MARKED);
+
+    object->setFlag(ObjectHeader::FLAG_FORWARDED);
+    *forwardingSlot = copy;
+    return copy->toTaggedValue();
+}
+
+template <typename InFromSpace>
+void MemoryManager::forwardRoots(Space& to, const InFromSpace& inFromSpace) {
+    RootVisitor visit = [&](TaggedValue& root) { root = evacuate(root, to, inFromSpace); };
+    for (TaggedValue* root : roots_) {
+        visit(*root);
+    }
+    for (auto& entry : rootProviders_) {
+        entry.second(visit);
+    }
+}
+
+template <typename InFromSpace>
+void MemoryManager::scan(uint8_t* from, Space& to, const InFromSpace& inFromSpace) {
+    // Cheney scan: everything copied into [from, to.top) is grey until visited.
+    while (from < to.top()) {
+        ObjectHeader* object = ObjectHeader::fromObjectStart(from);
+        if (object->containsPointers()) {
+            TaggedValue* slots = object->slots();
+            uint32_t size = object->size();
+            for (uint32_t i = 0; i < size; i++) {
+                slots[i] = evacuate(slots[i], to, inFromSpace);
+            }
+        }
+        from += object->totalBytes();
+    }
+}
+
+void MemoryManager::markLargeObject(TaggedValue value) {
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(value);
+    if (!largeObjects_.contains(object) || object->hasFlag(ObjectHeader::FLAG_MARKED)) {
+        return;
+    }
+    object->setFlag(ObjectHeader::FLAG_MARKED);
+    if (object->containsPointers()) {
+        largeMarkStack_.push_back(object);
+    }
+}
+
+void MemoryManager::minorCollection() {
+    // Promotion must never fail half-way; fall back to a full collection instead.
+    if (oldSpace().available() < nursery_.used()) {
+        majorCollection();
+        return;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    Space& to = oldSpace();
+    uint8_t* scanStart = to.top();
+    auto inNursery = [this](const void* address) { return nursery_.contains(address); };
+
+    forwardRoots(to, inNursery);
+    for (ObjectHeader* object : rememberedSet_) {
+        TaggedValue* slots = object->slots();
+        for (uint32_t i = 0; i < object->size(); i++) {
+            slots[i] = evacuate(slots[i], to, inNursery);
+        }
+        object->clearFlag(ObjectHeader::FLAG_REMEMBERED);
+    }
+    rememberedSet_.clear();
+    for (TaggedValue* slot : rememberedSlots_) {
+        *slot = evacuate(*slot, to, inNursery);
+    }
+    rememberedSlots_.clear();
+    scan(scanStart, to, inNursery);
+
+    nursery_.reset();
+    minorCollections_++;
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    collectionTime_ += pause;
+    minorPauses_.record(static_cast<uint64_t>(pause.count()));
+}
+
+void MemoryManager::majorCollection() {
+    auto started = std::chrono::steady_clock::now();
+    Space& from = oldSpace();
+    Space& to = oldSpaces_[1 - activeOld_];
+    to.reset();
+    auto inFromSpace = [this, &from](const void* address) {
+        return nursery_.contains(address) || from.contains(address);
+    };
+
+    markingLargeObjects_ = true;
+    forwardRoots(to, inFromSpace);
+    // Alternate between the Cheney scan of copied objects and the slots of newly
+    // marked large objects until neither finds anything new.
+    uint8_t* scanned = to.start();
+    for (;;) {
+        scan(scanned, to, inFromSpace);
+        scanned = to.top();
+        if (largeMarkStack_.empty()) {
+            break;
+        }
+        ObjectHeader* large = largeMarkStack_.back();
+        largeMarkStack_.pop_back();
+        TaggedValue* slots = large->slots();
+        uint32_t size = large->size();
+        for (uint32_t i = 0; i < size; i++) {
+            slots[i] = evacuate(slots[i], to, inFromSpace);
+        }
+    }
+    markingLargeObjects_ = false;
+
+    // The nursery is empty afterwards, so no old object can point into it. Copied
+    // objects dropped the flag already.
+    for (ObjectHeader* object : rememberedSet_) {
+        object->clearFlag(ObjectHeader::FLAG_REMEMBERED);
+    }
+    rememberedSet_.clear();
+    rememberedSlots_.clear();
+    largeObjects_.sweep();
+    largeObjectBytesAfterMajor_ = largeObjects_.bytesUsed();
+    nursery_.reset();
+    from.reset();
+    activeOld_ = 1 - activeOld_;
+    majorCollections_++;
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started);
+    collectionTime_ += pause;
+    majorPauses_.record(static_cast<uint64_t>(pause.count()));
+}
+
+void MemoryManager::forEachObject(const ObjectVisitor& visit) {
+    for (const Space* space : {&nursery_, &oldSpace()}) {
+        for (uint8_t* p = space->start(); p < space->top();) {
+            ObjectHeader* object = ObjectHeader::fromObjectStart(p);
+            p += object->totalBytes();
+            visit(object);
+        }
+    }
+    largeObjects_.forEach(visit);
+}
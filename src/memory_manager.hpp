@@ -0,0 +1,212 @@
+#pragma once
+
+#include "class_table.hpp"
+#include "histogram.hpp"
+#include "large_object_space.hpp"
+#include "object_header.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * MemoryManager - object memory for heap-allocated Smalltalk objects
+ *
+ * Two generations:
+ * - Nursery: bump-allocated; a minor collection (scavenge) copies its live objects
+ *   into old space.
+ * - Old space: two semispaces; a major collection copies every live object from the
+ *   nursery and the active semispace into the other one, compacting it.
+ *
+ * Objects of at least the large-object threshold, and objects allocated pinned, live in a
+ * LargeObjectSpace instead. They never move; a major collection marks them and sweeps
+ * the unreachable ones in place.
+ *
+ * Other objects move on every collection, so anything that must stay stable across
+ * collections (identity hash, class index) lives in the ObjectHeader. Old objects that receive a
+ * pointer to a young object through storePointer() are remembered and treated as roots
+ * by the next scavenge; for a pinned object only the slots that received one are, so a
+ * large table with a few young entries costs a scavenge a few slots, not its size.
+ *
+ * Pointers that do not point into object memory (e.g. runtime:: backing stores, or an
+ * ImageSegment shared with other VMs) are left untouched by the collector.
+ *
+ * Every collection's pause is recorded in a histogram. An allocation hook, when set,
+ * sees each new object once it is initialized (see AllocationProfiler).
+ */
+class MemoryManager {
+public:
+    using RootVisitor = std::function<void(TaggedValue&)>;
+    using RootProvider = std::function<void(const RootVisitor&)>;
+    using ObjectVisitor = std::function<void(ObjectHeader*)>;
+
+    static constexpr size_t DEFAULT_NURSERY_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_OLD_SPACE_BYTES = 64 * 1024 * 1024;
+    static constexpr size_t DEFAULT_LARGE_OBJECT_BYTES = 16 * 1024;
+
+    explicit MemoryManager(size_t nurseryBytes = DEFAULT_NURSERY_BYTES,
+                           size_t oldSpaceBytes = DEFAULT_OLD_SPACE_BYTES,
+                           size_t largeObjectBytes = DEFAULT_LARGE_OBJECT_BYTES);
+
+    MemoryManager(const MemoryManager&) = delete;
+    MemoryManager& operator=(const MemoryManager&) = delete;
+
+    // Allocation. Slots start as nil, bytes as zero. May trigger a collection.
+    // classIndex is the ClassTable index of the new object's class.
+    ObjectHeader* allocateSlots(ObjectHeader::Type type, uint32_t numSlots,
+                                uint32_t classIndex = ClassTable::INVALID_INDEX);
+    ObjectHeader* allocateBytes(ObjectHeader::Type type, uint32_t numBytes,
+                                uint32_t classIndex = ClassTable::INVALID_INDEX);
+
+    // Pinned allocation: the object goes to the large-object space and never moves,
+    // so its body can be used directly as an I/O buffer.
+    ObjectHeader* allocatePinnedSlots(ObjectHeader::Type type, uint32_t numSlots,
+                                      uint32_t classIndex = ClassTable::INVALID_INDEX);
+    ObjectHeader* allocatePinnedBytes(ObjectHeader::Type type, uint32_t numBytes,
+                                      uint32_t classIndex = ClassTable::INVALID_INDEX);
+
+    // Slot store with the generational write barrier; throws std::runtime_error for
+    // FLAG_IMMUTABLE objects. Inline, since all but the stores of young pointers into
+    // older objects come down to the checks and the store itself.
+    void storePointer(ObjectHeader* object, uint32_t index, TaggedValue value) {
+        if (index >= object->size() || object->isBytes() || object->hasFlag(ObjectHeader::FLAG_IMMUTABLE)) {
+            rejectStore(object, index);
+        }
+        TaggedValue* slot = &object->slots()[index];
+        if (value.isPointer() && isYoung(value.toPointer()) && !isYoung(object)) {
+            remember(object, slot);
+        }
+        *slot = value;
+    }
+
+    // Roots: individual TaggedValue locations, or providers that enumerate many
+    void addRoot(TaggedValue* root);
+    void removeRoot(TaggedValue* root);
+    size_t addRootProvider(RootProvider provider);
+    void removeRootProvider(size_t id);
+
+    // Keeps a vector of values (e.g. literals being collected in C++) alive and up to
+    // date across collections for the lifetime of the scope
+    class ScopedRoots {
+    public:
+        ScopedRoots(MemoryManager& memory, std::vector<TaggedValue>& values);
+        ~ScopedRoots();
+
+        ScopedRoots(const ScopedRoots&) = delete;
+        ScopedRoots& operator=(const ScopedRoots&) = delete;
+
+    private:
+        MemoryManager& memory_;
+        size_t id_;
+    };
+
+    // Called with every new object; it must not allocate in object memory. An empty
+    // hook removes it.
+    void setAllocationHook(ObjectVisitor hook) { allocationHook_ = std::move(hook); }
+
+    // Collection
+    void minorCollection();
+    void majorCollection();
+
+    // Visits every object in the heap, live or not yet collected; after a major
+    // collection that is exactly the live ones. visit must not allocate.
+    void forEachObject(const ObjectVisitor& visit);
+
+    // Queries
+    bool isYoung(const void* address) const { return nursery_.contains(address); }
+    bool contains(const void* address) const;
+    bool isLarge(const void* address) const { return largeObjects_.contains(address); }
+    size_t nurseryBytesUsed() const { return nursery_.used(); }
+    size_t oldSpaceBytesUsed() const { return oldSpace().used(); }
+    size_t largeObjectBytesUsed() const { return largeObjects_.bytesUsed(); }
+    size_t minorCollections() const { return minorCollections_; }
+    size_t majorCollections() const { return majorCollections_; }
+
+    // Statistics since construction
+    uint64_t allocations() const { return allocations_; }
+    uint64_t bytesAllocated() const { return bytesAllocated_; }
+    std::chrono::nanoseconds collectionTime() const { return collectionTime_; }
+    // Pause times in nanoseconds. A minor collection that falls back to a major one
+    // counts as major.
+    const Histogram& minorPauses() const { return minorPauses_; }
+    const Histogram& majorPauses() const { return majorPauses_; }
+
+private:
+    class Space {
+    public:
+        explicit Space(size_t bytes);
+
+        bool contains(const void* address) const {
+            auto p = static_cast<const uint8_t*>(address);
+            return p >= start_ && p < end_;
+        }
+        size_t used() const { return static_cast<size_t>(top_ - start_); }
+        size_t available() const { return static_cast<size_t>(end_ - top_); }
+        size_t capacity() const { return static_cast<size_t>(end_ - start_); }
+
+        uint8_t* start() const { return start_; }
+        uint8_t* top() const { return top_; }
+        // Answers nullptr if the space cannot fit bytes
+        uint8_t* bump(size_t bytes);
+        void reset() { top_ = start_; }
+
+    private:
+        std::unique_ptr<uint64_t[]> memory_;
+        uint8_t* start_;
+        uint8_t* end_;
+        uint8_t* top_;
+    };
+
+    [[noreturn]] static void rejectStore(ObjectHeader* object, uint32_t index);
+    // Write barrier for a young pointer about to be stored into slot of an older object
+    void remember(ObjectHeader* object, TaggedValue* slot);
+
+    ObjectHeader* allocate(ObjectHeader::Type type, uint32_t size, uint32_t classIndex);
+    ObjectHeader* allocateLarge(ObjectHeader::Type type, uint32_t size, uint32_t classIndex);
+    static void checkSlotType(ObjectHeader::Type type);
+    static void checkByteType(ObjectHeader::Type type);
+    ObjectHeader* initializeObject(uint8_t* memory, ObjectHeader::Type type, uint32_t size,
+                                   uint32_t classIndex);
+
+    Space& oldSpace() { return oldSpaces_[activeOld_]; }
+    const Space& oldSpace() const { return oldSpaces_[activeOld_]; }
+
+    // Copying collector shared by minor and major collections
+    template <typename InFromSpace>
+    TaggedValue evacuate(TaggedValue value, Space& to, const InFromSpace& inFromSpace);
+    template <typename InFromSpace>
+    void forwardRoots(Space& to, const InFromSpace& inFromSpace);
+    template <typename InFromSpace>
+    void scan(uint8_t* from, Space& to, const InFromSpace& inFromSpace);
+    void markLargeObject(TaggedValue value);
+
+    Space nursery_;
+    Space oldSpaces_[2];
+    int activeOld_;
+    LargeObjectSpace largeObjects_;
+    size_t largeObjectThreshold_;
+    size_t largeObjectBytesAfterMajor_;
+    bool markingLargeObjects_;
+    std::vector<ObjectHeader*> largeMarkStack_;
+
+    std::vector<TaggedValue*> roots_;
+    std::vector<std::pair<size_t, RootProvider>> rootProviders_;
+    size_t nextRootProviderId_;
+    std::vector<ObjectHeader*> rememberedSet_;
+    // Pinned objects never move and can be large, so their young pointers are
+    // remembered one slot at a time instead
+    std::vector<TaggedValue*> rememberedSlots_;
+
+    size_t minorCollections_;
+    size_t majorCollections_;
+    uint64_t allocations_;
+    uint64_t bytesAllocated_;
+    std::chrono::nanoseconds collectionTime_;
+    Histogram minorPauses_;
+    Histogram majorPauses_;
+    ObjectVisitor allocationHook_;
+};
@@ -0,0 +1,103 @@
+#include "object_header.hpp"
+#include <atomic>
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+// Per-thread xorshift32 generator for identity hashes. Each thread seeds its own
+// state from a shared counter, so hashing never takes a lock.
+uint32_t nextIdentityHash() {
+    static std::atomic<uint32_t> seedCounter{0};
+    thread_local uint32_t state = 0;
+    if (state == 0) {
+        // Weyl-sequence seed, scrambled so neighbouring threads diverge immediately.
+        uint32_t seed = (seedCounter.fetch_add(1, std::memory_order_relaxed) + 1) * 0x9E3779B9u;
+        seed ^= seed >> 16;
+        seed *= 0x85EBCA6Bu;
+        seed ^= seed >> 13;
+        state = seed != 0 ? seed : 1;
+    }
+    // xorshift32 never reaches 0 from a non-zero state.
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+} // namespace
+
+ObjectHeader::ObjectHeader(Type type, uint32_t size, uint32_t classIndex) : header_(0) {
+    if (size > MAX_INLINE_SIZE) {
+        throw std::length_error("Object size needs an overflow word");
+    }
+    header_ = static_cast<uint64_t>(size) << SIZE_SHIFT;
+    setType(type);
+    setClassIndex(classIndex);
+}
+
+ObjectHeader* ObjectHeader::initialize(void* memory, Type type, uint32_t size,
+                                       uint32_t classIndex) {
+    auto words = static_cast<uint64_t*>(memory);
+    if (size <= MAX_INLINE_SIZE) {
+        return new (words) ObjectHeader(type, size, classIndex);
+    }
+    // Overflow word: its low byte is 0xFF, like the header's size field, so a heap
+    // walker landing on it knows the header is the next word.
+    words[0] = (static_cast<uint64_t>(size) << 8) | SIZE_OVERFLOW;
+    ObjectHeader* header = new (words + 1) ObjectHeader(type, 0, classIndex);
+    header->header_ |= static_cast<uint64_t>(SIZE_OVERFLOW) << SIZE_SHIFT;
+    return header;
+}
+
+ObjectHeader* ObjectHeader::fromObjectStart(void* start) {
+    auto words = static_cast<uint64_t*>(start);
+    bool overflow = (words[0] & SIZE_MASK) == SIZE_OVERFLOW;
+    return reinterpret_cast<ObjectHeader*>(overflow ? words + 1 : words);
+}
+
+void ObjectHeader::setType(Type type) {
+    header_ = (header_ & ~(TYPE_MASK << TYPE_SHIFT)) |
+              ((static_cast<uint64_t>(type) & TYPE_MASK) << TYPE_SHIFT);
+}
+
+void ObjectHeader::setFlags(uint8_t flags) {
+    header_ = (header_ & ~(FLAGS_MASK << FLAGS_SHIFT)) |
+              ((static_cast<uint64_t>(flags) & FLAGS_MASK) << FLAGS_SHIFT);
+}
+
+void ObjectHeader::setClassIndex(uint32_t classIndex) {
+    if (classIndex > MAX_CLASS_INDEX) {
+        throw std::length_error("Class index exceeds header class index field");
+    }
+    header_ = (header_ & ~(CLASS_INDEX_MASK << CLASS_INDEX_SHIFT)) |
+              (static_cast<uint64_t>(classIndex) << CLASS_INDEX_SHIFT);
+}
+
+void ObjectHeader::setHash(uint32_t hash) {
+    header_ = (header_ & ~(HASH_MASK << HASH_SHIFT)) |
+              ((static_cast<uint64_t>(hash) & HASH_MASK) << HASH_SHIFT);
+}
+
+size_t ObjectHeader::bodyBytesFor(Type type, uint32_t size) {
+    bool isBytes = type == TYPE_BYTE_ARRAY || type == TYPE_SYMBOL;
+    size_t bytes = isBytes ? size : static_cast<size_t>(size) * sizeof(TaggedValue);
+    // Round up to whole words; every object keeps at least one body word so a
+    // forwarding pointer fits when the collector moves it.
+    size_t words = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    return (words == 0 ? 1 : words) * sizeof(uint64_t);
+}
+
+size_t ObjectHeader::totalBytesFor(Type type, uint32_t size) {
+    size_t headerBytes = size > MAX_INLINE_SIZE ? 2 * sizeof(uint64_t) : sizeof(uint64_t);
+    return headerBytes + bodyBytesFor(type, size);
+}
+
+uint32_t ObjectHeader::assignIdentityHash() {
+    uint32_t h;
+    do {
+        h = nextIdentityHash() & static_cast<uint32_t>(HASH_MASK);
+    } while (h == 0);
+    setHash(h);
+    return h;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * ObjectHeader - 64-bit header at the start of every object in object memory
+ *
+ * Layout: [size:8][type:3][flags:5][classIndex:22][hash:26]
+ * - size: body length in slots (pointer objects) or bytes (byte objects). The value
+ *   255 means the real size lives in an overflow word directly before the header.
+ * - type: object format, see Type
+ * - flags: GC and VM state bits
+ * - classIndex: index of the object's class in the ClassTable (no class pointer)
+ * - hash: identity hash, 0 until first requested
+ *
+ * The body follows the header directly. A pointer TaggedValue addresses the header,
+ * never the overflow word.
+ */
+class ObjectHeader {
+public:
+    // Object types
+    enum Type : uint8_t {
+        TYPE_IMMEDIATE = 0,
+        TYPE_OBJECT = 1,
+        TYPE_ARRAY = 2,
+        TYPE_BYTE_ARRAY = 3,
+        TYPE_SYMBOL = 4,
+        TYPE_CONTEXT = 5,
+        TYPE_CLASS = 6,
+        TYPE_METHOD = 7
+    };
+
+    // Flags (5 bits; whether the body holds pointers follows from the type)
+    static constexpr uint8_t FLAG_MARKED = 1 << 0;
+    static constexpr uint8_t FLAG_REMEMBERED = 1 << 1;
+    static constexpr uint8_t FLAG_IMMUTABLE = 1 << 2;
+    static constexpr uint8_t FLAG_FORWARDED = 1 << 3;
+    static constexpr uint8_t FLAG_PINNED = 1 << 4;
+
+    static constexpr uint32_t SIZE_OVERFLOW = 0xFF;
+    static constexpr uint32_t MAX_INLINE_SIZE = SIZE_OVERFLOW - 1;
+    static constexpr uint32_t MAX_SIZE = 0xFFFFFFFF;
+    static constexpr uint32_t CLASS_INDEX_BITS = 22;
+    static constexpr uint32_t MAX_CLASS_INDEX = (1u << CLASS_INDEX_BITS) - 1;
+    static constexpr uint32_t HASH_BITS = 26;
+
+    ObjectHeader() : header_(0) {}
+    // Standalone header; sizes above MAX_INLINE_SIZE need initialize() and an overflow word
+    ObjectHeader(Type type, uint32_t size, uint32_t classIndex = 0);
+
+    // Writes a header (and overflow word, if needed) at the start of an object's memory
+    static ObjectHeader* initialize(void* memory, Type type, uint32_t size, uint32_t classIndex);
+    // Answers the header of the object whose memory starts at start
+    static ObjectHeader* fromObjectStart(void* start);
+
+    // Accessors
+    uint32_t size() const {
+        uint32_t inlineSize = static_cast<uint32_t>((header_ >> SIZE_SHIFT) & SIZE_MASK);
+        return inlineSize != SIZE_OVERFLOW ? inlineSize : overflowSize();
+    }
+    bool hasOverflowSize() const { return ((header_ >> SIZE_SHIFT) & SIZE_MASK) == SIZE_OVERFLOW; }
+
+    Type type() const { return static_cast<Type>((header_ >> TYPE_SHIFT) & TYPE_MASK); }
+    void setType(Type type);
+
+    uint8_t flags() const { return static_cast<uint8_t>((header_ >> FLAGS_SHIFT) & FLAGS_MASK); }
+    void setFlags(uint8_t flags);
+    bool hasFlag(uint8_t flag) const { return (flags() & flag) != 0; }
+    void setFlag(uint8_t flag) { setFlags(flags() | flag); }
+    void clearFlag(uint8_t flag) { setFlags(flags() & ~flag); }
+
+    uint32_t classIndex() const {
+        return static_cast<uint32_t>((header_ >> CLASS_INDEX_SHIFT) & CLASS_INDEX_MASK);
+    }
+    void setClassIndex(uint32_t classIndex);
+
+    uint32_t hash() const { return static_cast<uint32_t>((header_ >> HASH_SHIFT) & HASH_MASK); }
+    void setHash(uint32_t hash);
+
+    // Identity hash (primitive 75). Assigned lazily from a per-thread PRNG on first
+    // request and stored in the header, so it travels with the object when a moving
+    // collector copies it. Objects that are never hashed pay nothing.
+    uint32_t identityHash() {
+        uint32_t h = hash();
+        return h != 0 ? h : assignIdentityHash();
+    }
+    bool hasIdentityHash() const { return hash() != 0; }
+
+    // Object format
+    bool isBytes() const { return type() == TYPE_BYTE_ARRAY || type() == TYPE_SYMBOL; }
+    bool containsPointers() const { return !isBytes(); }
+    size_t bodyBytes() const { return bodyBytesFor(type(), size()); }
+    size_t headerBytes() const { return hasOverflowSize() ? 2 * sizeof(uint64_t) : sizeof(uint64_t); }
+    size_t totalBytes() const { return headerBytes() + bodyBytes(); }
+    uint8_t* objectStart() {
+        return reinterpret_cast<uint8_t*>(this) + sizeof(uint64_t) - headerBytes();
+    }
+
+    static size_t bodyBytesFor(Type type, uint32_t size);
+    static size_t totalBytesFor(Type type, uint32_t size);
+
+    // Body access
+    TaggedValue* slots() { return reinterpret_cast<TaggedValue*>(this + 1); }
+    const TaggedValue* slots() const { return reinterpret_cast<const TaggedValue*>(this + 1); }
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(this + 1); }
+    const uint8_t* bytes() const { return reinterpret_cast<const uint8_t*>(this + 1); }
+
+    // Convert to/from TaggedValue (as pointer)
+    TaggedValue toTaggedValue() { return TaggedValue::fromPointer(this); }
+    static ObjectHeader* fromTaggedValue(TaggedValue value) {
+        return static_cast<ObjectHeader*>(value.toPointer());
+    }
+
+private:
+    uint32_t overflowSize() const {
+        return static_cast<uint32_t>(reinterpret_cast<const uint64_t*>(this)[-1] >> 8);
+    }
+    uint32_t assignIdentityHash();
+
+    uint64_t header_;
+
+    // Layout: [size:8][type:3][flags:5][classIndex:22][hash:26]
+    static constexpr int SIZE_SHIFT = 0;
+    static constexpr int TYPE_SHIFT = 8;
+    static constexpr int FLAGS_SHIFT = 11;
+    static constexpr int CLASS_INDEX_SHIFT = 16;
+    static constexpr int HASH_SHIFT = 38;
+
+    static constexpr uint64_t SIZE_MASK = 0xFF;
+    static constexpr uint64_t TYPE_MASK = 0x7;
+    static constexpr uint64_t FLAGS_MASK = 0x1F;
+    static constexpr uint64_t CLASS_INDEX_MASK = MAX_CLASS_INDEX;
+    static constexpr uint64_t HASH_MASK = (1ULL << HASH_BITS) - 1;
+};
+
+static_assert(sizeof(ObjectHeader) == 8, "ObjectHeader must be 64 bits");
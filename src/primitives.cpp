@@ -0,0 +1,796 @@
+#include "primitives.hpp"
+#include "class_table.hpp"
+#include "classes/class.hpp"
+#include "classes/io_handle.hpp"
+#include "dictionary_table.hpp"
+#include "interpreter.hpp"
+#include "io_loop.hpp"
+#include "io_primitives.hpp"
+#include "scheduler.hpp"
+#include "symbol_table.hpp"
+#include "vm.hpp"
+#include <array>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace primitives {
+
+namespace {
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+constexpr int64_t SMALL_INTEGER_MIN = -(int64_t(1) << 61);
+constexpr int64_t SMALL_INTEGER_MAX = (int64_t(1) << 61) - 1;
+
+bool fitsSmallInteger(int64_t value) {
+    return value >= SMALL_INTEGER_MIN && value <= SMALL_INTEGER_MAX;
+}
+
+bool succeed(Interpreter& interpreter, uint32_t argCount, TaggedValue result) {
+    interpreter.popThenPush(argCount + 1, result);
+    return true;
+}
+
+TaggedValue boolean(bool value) {
+    return value ? TaggedValue::trueValue() : TaggedValue::falseValue();
+}
+
+bool integerOperands(Interpreter& interpreter, int64_t& receiver, int64_t& arg) {
+    TaggedValue a = interpreter.stackValue(1);
+    TaggedValue b = interpreter.stackValue(0);
+    if (!a.isSmallInteger() || !b.isSmallInteger()) {
+        return false;
+    }
+    receiver = a.toSmallInteger();
+    arg = b.toSmallInteger();
+    return true;
+}
+
+// Float receiver, immediate or boxed; Float or SmallInteger argument
+bool floatOperands(Interpreter& interpreter, double& receiver, double& arg) {
+    TaggedValue a = interpreter.stackValue(1);
+    TaggedValue b = interpreter.stackValue(0);
+    if (!VM::floatValue(a, receiver)) {
+        return false;
+    }
+    if (b.isSmallInteger()) {
+        arg = static_cast<double>(b.toSmallInteger());
+        return true;
+    }
+    return VM::floatValue(b, arg);
+}
+
+template <typename Op>
+bool integerArithmetic(Interpreter& interpreter, uint32_t argCount, Op op) {
+    int64_t a, b, result;
+    if (!integerOperands(interpreter, a, b) || !op(a, b, result) || !fitsSmallInteger(result)) {
+        return false;
+    }
+    return succeed(interpreter, argCount, TaggedValue::fromSmallInteger(result));
+}
+
+template <typename Op>
+bool integerComparison(Interpreter& interpreter, uint32_t argCount, Op op) {
+    int64_t a, b;
+    if (!integerOperands(interpreter, a, b)) {
+        return false;
+    }
+    return succeed(interpreter, argCount, boolean(op(a, b)));
+}
+
+template <typename Op>
+bool floatArithmetic(Interpreter& interpreter, uint32_t argCount, Op op) {
+    double a, b;
+    if (!floatOperands(interpreter, a, b)) {
+        return false;
+    }
+    return succeed(interpreter, argCount, interpreter.vm().newFloat(op(a, b)));
+}
+
+template <typename Op>
+bool floatComparison(Interpreter& interpreter, uint32_t argCount, Op op) {
+    double a, b;
+    if (!floatOperands(interpreter, a, b)) {
+        return false;
+    }
+    return succeed(interpreter, argCount, boolean(op(a, b)));
+}
+
+std::string receiverDescription(Interpreter& interpreter, uint32_t argCount) {
+    uint32_t classIndex = ClassTable::classIndexOf(interpreter.stackValue(argCount));
+    return interpreter.vm().className(classIndex) + ">>" + interpreter.currentSelector();
+}
+
+// ============================================================================
+// SmallInteger (1-17)
+// ============================================================================
+
+bool add(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) { r = a + b; return true; });
+}
+
+bool subtract(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) { r = a - b; return true; });
+}
+
+bool lessThan(Interpreter& in, uint32_t n) {
+    return integerComparison(in, n, [](int64_t a, int64_t b) { return a < b; });
+}
+
+bool greaterThan(Interpreter& in, uint32_t n) {
+    return integerComparison(in, n, [](int64_t a, int64_t b) { return a > b; });
+}
+
+bool lessOrEqual(Interpreter& in, uint32_t n) {
+    return integerComparison(in, n, [](int64_t a, int64_t b) { return a <= b; });
+}
+
+bool greaterOrEqual(Interpreter& in, uint32_t n) {
+    return integerComparison(in, n, [](int64_t a, int64_t b) { return a >= b; });
+}
+
+bool equal(Interpreter& in, uint32_t n) {
+    return integerComparison(in, n, [](int64_t a, int64_t b) { return a == b; });
+}
+
+bool notEqual(Interpreter& in, uint32_t n) {
+    return integerComparison(in, n, [](int64_t a, int64_t b) { return a != b; });
+}
+
+bool multiply(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) {
+        return !__builtin_mul_overflow(a, b, &r);
+    });
+}
+
+// Exact division only; anything with a remainder falls back to Float
+bool divide(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) {
+        if (b == 0 || a % b != 0) {
+            return false;
+        }
+        r = a / b;
+        return true;
+    });
+}
+
+// Quotient rounded toward negative infinity
+bool floorDivide(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) {
+        if (b == 0) {
+            return false;
+        }
+        r = a / b;
+        if (a % b != 0 && ((a < 0) != (b < 0))) {
+            r--;
+        }
+        return true;
+    });
+}
+
+// Remainder with the sign of the divisor
+bool floorModulo(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) {
+        if (b == 0) {
+            return false;
+        }
+        r = a % b;
+        if (r != 0 && ((r < 0) != (b < 0))) {
+            r += b;
+        }
+        return true;
+    });
+}
+
+bool bitAnd(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) { r = a & b; return true; });
+}
+
+bool bitOr(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) { r = a | b; return true; });
+}
+
+bool bitXor(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) { r = a ^ b; return true; });
+}
+
+bool bitShift(Interpreter& in, uint32_t n) {
+    return integerArithmetic(in, n, [](int64_t a, int64_t b, int64_t& r) {
+        if (b >= 0) {
+            if (b >= 62 || (a << b) >> b != a) {
+                return a == 0 ? (r = 0, true) : false;
+            }
+            r = a << b;
+        } else {
+            r = a >> (b < -63 ? 63 : -b);
+        }
+        return true;
+    });
+}
+
+// ============================================================================
+// Errors (19-20)
+// ============================================================================
+
+bool primitiveFailed(Interpreter& in, uint32_t n) {
+    throw std::runtime_error(receiverDescription(in, n) + ": primitive failed");
+}
+
+bool error(Interpreter& in, uint32_t n) {
+    TaggedValue message = in.stackValue(0);
+    std::string text = message.isPointer() && ObjectHeader::fromTaggedValue(message)->isBytes()
+                           ? std::string(SymbolTable::nameOf(message))
+                           : "error";
+    throw std::runtime_error(receiverDescription(in, n) + ": " + text);
+}
+
+// ============================================================================
+// Float (40-55)
+// ============================================================================
+
+bool asFloat(Interpreter& in, uint32_t n) {
+    TaggedValue receiver = in.stackValue(0);
+    if (!receiver.isSmallInteger()) {
+        return false;
+    }
+    return succeed(in, n, in.vm().newFloat(static_cast<double>(receiver.toSmallInteger())));
+}
+
+bool floatAdd(Interpreter& in, uint32_t n) {
+    return floatArithmetic(in, n, [](double a, double b) { return a + b; });
+}
+
+bool floatSubtract(Interpreter& in, uint32_t n) {
+    return floatArithmetic(in, n, [](double a, double b) { return a - b; });
+}
+
+bool floatLessThan(Interpreter& in, uint32_t n) {
+    return floatComparison(in, n, [](double a, double b) { return a < b; });
+}
+
+bool floatGreaterThan(Interpreter& in, uint32_t n) {
+    return floatComparison(in, n, [](double a, double b) { return a > b; });
+}
+
+bool floatLessOrEqual(Interpreter& in, uint32_t n) {
+    return floatComparison(in, n, [](double a, double b) { return a <= b; });
+}
+
+bool floatGreaterOrEqual(Interpreter& in, uint32_t n) {
+    return floatComparison(in, n, [](double a, double b) { return a >= b; });
+}
+
+bool floatEqual(Interpreter& in, uint32_t n) {
+    return floatComparison(in, n, [](double a, double b) { return a == b; });
+}
+
+bool floatNotEqual(Interpreter& in, uint32_t n) {
+    return floatComparison(in, n, [](double a, double b) { return a != b; });
+}
+
+bool floatMultiply(Interpreter& in, uint32_t n) {
+    return floatArithmetic(in, n, [](double a, double b) { return a * b; });
+}
+
+bool floatDivide(Interpreter& in, uint32_t n) {
+    double a, b;
+    if (!floatOperands(in, a, b) || b == 0.0) {
+        return false;
+    }
+    return succeed(in, n, in.vm().newFloat(a / b));
+}
+
+bool truncated(Interpreter& in, uint32_t n) {
+    double value;
+    if (!VM::floatValue(in.stackValue(0), value)) {
+        return false;
+    }
+    value = std::trunc(value);
+    if (!(value >= static_cast<double>(SMALL_INTEGER_MIN) && value <= static_cast<double>(SMALL_INTEGER_MAX))) {
+        return false;
+    }
+    return succeed(in, n, TaggedValue::fromSmallInteger(static_cast<int64_t>(value)));
+}
+
+bool squareRoot(Interpreter& in, uint32_t n) {
+    double value;
+    if (!VM::floatValue(in.stackValue(0), value) || value < 0.0) {
+        return false;
+    }
+    return succeed(in, n, in.vm().newFloat(std::sqrt(value)));
+}
+
+// ============================================================================
+// Indexable objects (60-67)
+// ============================================================================
+
+// Index (1-based) into receiver's indexable part, or nullptr
+ObjectHeader* indexable(TaggedValue receiver, TaggedValue index, uint32_t& offset) {
+    if (!receiver.isPointer() || !index.isSmallInteger()) {
+        return nullptr;
+    }
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(receiver);
+    if (!object->isBytes() && object->type() != ObjectHeader::TYPE_ARRAY) {
+        return nullptr;
+    }
+    int64_t i = index.toSmallInteger();
+    if (i < 1 || i > object->size()) {
+        return nullptr;
+    }
+    offset = static_cast<uint32_t>(i - 1);
+    return object;
+}
+
+bool at(Interpreter& in, uint32_t n) {
+    uint32_t offset;
+    ObjectHeader* object = indexable(in.stackValue(1), in.stackValue(0), offset);
+    if (object == nullptr) {
+        return false;
+    }
+    TaggedValue value = object->isBytes() ? TaggedValue::fromSmallInteger(object->bytes()[offset])
+                                          : object->slots()[offset];
+    return succeed(in, n, value);
+}
+
+bool atPut(Interpreter& in, uint32_t n) {
+    uint32_t offset;
+    ObjectHeader* object = indexable(in.stackValue(2), in.stackValue(1), offset);
+    TaggedValue value = in.stackValue(0);
+    if (object == nullptr || object->type() == ObjectHeader::TYPE_SYMBOL ||
+        object->hasFlag(ObjectHeader::FLAG_IMMUTABLE)) {
+        return false;
+    }
+    if (object->isBytes()) {
+        if (!value.isSmallInteger() || value.toSmallInteger() < 0 || value.toSmallInteger() > 255) {
+            return false;
+        }
+        object->bytes()[offset] = static_cast<uint8_t>(value.toSmallInteger());
+    } else {
+        in.vm().memory().storePointer(object, offset, value);
+    }
+    return succeed(in, n, value);
+}
+
+bool size(Interpreter& in, uint32_t n) {
+    TaggedValue receiver = in.stackValue(0);
+    if (!receiver.isPointer()) {
+        return false;
+    }
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(receiver);
+    if (!object->isBytes() && object->type() != ObjectHeader::TYPE_ARRAY) {
+        return false;
+    }
+    return succeed(in, n, TaggedValue::fromSmallInteger(object->size()));
+}
+
+bool isByteObject(TaggedValue value) {
+    return value.isPointer() && ObjectHeader::fromTaggedValue(value)->isBytes();
+}
+
+bool concatenate(Interpreter& in, uint32_t n) {
+    if (!isByteObject(in.stackValue(1)) || !isByteObject(in.stackValue(0))) {
+        return false;
+    }
+    VM& vm = in.vm();
+    uint32_t classIndex = ClassTable::classIndexOf(in.stackValue(1));
+    if (classIndex == vm.kernel().symbol) {
+        classIndex = vm.kernel().string;
+    }
+    uint32_t total = ObjectHeader::fromTaggedValue(in.stackValue(1))->size() +
+                     ObjectHeader::fromTaggedValue(in.stackValue(0))->size();
+    ObjectHeader* result = vm.memory().allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, total, classIndex);
+    ObjectHeader* first = ObjectHeader::fromTaggedValue(in.stackValue(1));
+    ObjectHeader* second = ObjectHeader::fromTaggedValue(in.stackValue(0));
+    std::memcpy(result->bytes(), first->bytes(), first->size());
+    std::memcpy(result->bytes() + first->size(), second->bytes(), second->size());
+    return succeed(in, n, result->toTaggedValue());
+}
+
+bool asSymbol(Interpreter& in, uint32_t n) {
+    if (!isByteObject(in.stackValue(0))) {
+        return false;
+    }
+    return succeed(in, n, in.vm().symbols().intern(SymbolTable::nameOf(in.stackValue(0))));
+}
+
+// ============================================================================
+// Instantiation and identity (70-111)
+// ============================================================================
+
+// Class index of a class object receiver, or INVALID_INDEX
+uint32_t receiverClass(TaggedValue receiver) {
+    if (!receiver.isPointer() || ObjectHeader::fromTaggedValue(receiver)->type() != ObjectHeader::TYPE_CLASS) {
+        return ClassTable::INVALID_INDEX;
+    }
+    return ClassTable::indexOfClass(receiver);
+}
+
+bool basicNew(Interpreter& in, uint32_t n) {
+    uint32_t classIndex = receiverClass(in.stackValue(0));
+    if (classIndex == ClassTable::INVALID_INDEX) {
+        return false;
+    }
+    return succeed(in, n, in.vm().instantiate(classIndex));
+}
+
+bool basicNewSized(Interpreter& in, uint32_t n) {
+    uint32_t classIndex = receiverClass(in.stackValue(1));
+    TaggedValue size = in.stackValue(0);
+    if (classIndex == ClassTable::INVALID_INDEX || !size.isSmallInteger() || size.toSmallInteger() < 0 ||
+        size.toSmallInteger() > UINT32_MAX / 2) {
+        return false;
+    }
+    st::Class* cls = st::mirrorOf<st::Class>(in.stackValue(1));
+    ObjectHeader::Type type = cls->instanceType();
+    if (type != ObjectHeader::TYPE_ARRAY && type != ObjectHeader::TYPE_BYTE_ARRAY &&
+        type != ObjectHeader::TYPE_SYMBOL) {
+        return false;
+    }
+    return succeed(in, n, in.vm().instantiate(classIndex, static_cast<uint32_t>(size.toSmallInteger())));
+}
+
+bool identityHash(Interpreter& in, uint32_t n) {
+    TaggedValue receiver = in.stackValue(0);
+    if (!receiver.isPointer()) {
+        return false;
+    }
+    return succeed(in, n, TaggedValue::fromSmallInteger(ObjectHeader::fromTaggedValue(receiver)->identityHash()));
+}
+
+bool identical(Interpreter& in, uint32_t n) {
+    return succeed(in, n, boolean(in.stackValue(1) == in.stackValue(0)));
+}
+
+bool classOf(Interpreter& in, uint32_t n) {
+    return succeed(in, n, in.vm().classes().classOf(in.stackValue(0)));
+}
+
+// ============================================================================
+// Processes (85-93)
+// ============================================================================
+
+// Answers the receiver if the Scheduler accepted the operation
+bool schedulerOperation(Interpreter& in, uint32_t n, bool accepted) {
+    return accepted && succeed(in, n, in.stackValue(n));
+}
+
+bool semaphoreSignal(Interpreter& in, uint32_t n) {
+    return schedulerOperation(in, n, in.scheduler().signal(in.stackValue(0)));
+}
+
+bool semaphoreWait(Interpreter& in, uint32_t n) {
+    return schedulerOperation(in, n, in.scheduler().wait(in.stackValue(0)));
+}
+
+bool processResume(Interpreter& in, uint32_t n) {
+    return schedulerOperation(in, n, in.scheduler().resume(in.stackValue(0)));
+}
+
+bool processSuspend(Interpreter& in, uint32_t n) {
+    return schedulerOperation(in, n, in.scheduler().suspend(in.stackValue(0)));
+}
+
+bool processTerminate(Interpreter& in, uint32_t n) {
+    return schedulerOperation(in, n, in.scheduler().terminate(in.stackValue(0)));
+}
+
+bool processSetPriority(Interpreter& in, uint32_t n) {
+    return schedulerOperation(in, n, in.scheduler().setPriority(in.stackValue(1), in.stackValue(0)));
+}
+
+bool fork(Interpreter& in, uint32_t n) {
+    TaggedValue process =
+        in.scheduler().fork(in.stackValue(3), in.stackValue(2), in.stackValue(1), in.stackValue(0));
+    return !process.isNil() && succeed(in, n, process);
+}
+
+bool activeProcess(Interpreter& in, uint32_t n) {
+    if (receiverClass(in.stackValue(0)) != in.vm().kernel().process) {
+        return false;
+    }
+    return succeed(in, n, in.scheduler().activeProcess());
+}
+
+bool yield(Interpreter& in, uint32_t n) {
+    if (receiverClass(in.stackValue(0)) != in.vm().kernel().process) {
+        return false;
+    }
+    in.scheduler().yield();
+    return succeed(in, n, in.stackValue(0));
+}
+
+// ============================================================================
+// Dictionary (700-704)
+// ============================================================================
+
+bool isDictionary(Interpreter& in, uint32_t argCount) {
+    return ClassTable::classIndexOf(in.stackValue(argCount)) == in.vm().kernel().dictionary;
+}
+
+bool dictionaryAt(Interpreter& in, uint32_t n) {
+    if (!isDictionary(in, n)) {
+        return false;
+    }
+    const TaggedValue* value = dictionary_table::find(in.stackValue(n), in.stackValue(0));
+    return value != nullptr && succeed(in, n, *value);
+}
+
+bool dictionaryAtPut(Interpreter& in, uint32_t n) {
+    if (!isDictionary(in, n)) {
+        return false;
+    }
+    dictionary_table::atPut(in.vm(), in.stackValue(n), in.stackValue(1), in.stackValue(0));
+    // Growing the table may have collected: read the value again
+    return succeed(in, n, in.stackValue(0));
+}
+
+bool dictionaryKeys(Interpreter& in, uint32_t n) {
+    if (!isDictionary(in, n)) {
+        return false;
+    }
+    VM& vm = in.vm();
+    ObjectHeader* keys = vm.memory().allocateSlots(ObjectHeader::TYPE_ARRAY,
+                                                   static_cast<uint32_t>(dictionary_table::size(in.stackValue(n))),
+                                                   vm.kernel().array);
+    // Read the receiver after allocating: the collection may have moved it.
+    uint32_t next = 0;
+    dictionary_table::forEach(in.stackValue(n), [&](TaggedValue key, TaggedValue) {
+        vm.memory().storePointer(keys, next++, key);
+    });
+    return succeed(in, n, keys->toTaggedValue());
+}
+
+bool dictionarySize(Interpreter& in, uint32_t n) {
+    if (!isDictionary(in, n)) {
+        return false;
+    }
+    int64_t size = static_cast<int64_t>(dictionary_table::size(in.stackValue(n)));
+    return succeed(in, n, TaggedValue::fromSmallInteger(size));
+}
+
+bool dictionaryIncludesKey(Interpreter& in, uint32_t n) {
+    if (!isDictionary(in, n)) {
+        return false;
+    }
+    return succeed(in, n, boolean(dictionary_table::find(in.stackValue(n), in.stackValue(0)) != nullptr));
+}
+
+// ============================================================================
+// Files and sockets (800-809)
+// ============================================================================
+
+// Descriptor in the IOHandle receiver's handle slot, or -1 if it has none
+int receiverHandle(Interpreter& in, uint32_t argCount) {
+    TaggedValue receiver = in.stackValue(argCount);
+    if (!receiver.isPointer() || receiver.isNil()) {
+        return -1;
+    }
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(receiver);
+    if (object->type() != ObjectHeader::TYPE_OBJECT || object->size() < st::IOHandleSlots::COUNT) {
+        return -1;
+    }
+    TaggedValue handle = st::mirrorOf<st::IOHandle>(receiver)->handle();
+    return handle.isSmallInteger() ? static_cast<int>(handle.toSmallInteger()) : -1;
+}
+
+bool stringOperand(TaggedValue value, std::string& result) {
+    if (!value.isPointer() || value.isNil() || !ObjectHeader::fromTaggedValue(value)->isBytes()) {
+        return false;
+    }
+    result = std::string(SymbolTable::nameOf(value));
+    return true;
+}
+
+// Moves bytes between the receiver's descriptor and the 1-based range [index, index +
+// count) of a ByteArray or String (see io_primitives.hpp); answers the bytes moved, or
+// nil when the descriptor is not ready
+bool transfer(Interpreter& in, uint32_t n, bool reading) {
+    int handle = receiverHandle(in, n);
+    TaggedValue index = in.stackValue(1);
+    TaggedValue count = in.stackValue(0);
+    if (handle < 0 || !in.scheduler().io().isOpen(handle) || !index.isSmallInteger() || index.toSmallInteger() < 1 ||
+        !count.isSmallInteger() || count.toSmallInteger() < 0) {
+        return false;
+    }
+    size_t offset = static_cast<size_t>(index.toSmallInteger() - 1);
+    size_t bytes = static_cast<size_t>(count.toSmallInteger());
+    ssize_t result;
+    try {
+        result = reading ? readInto(handle, in.stackValue(2), offset, bytes)
+                         : writeFrom(handle, in.stackValue(2), offset, bytes);
+    } catch (const std::logic_error&) {
+        return false;
+    }
+    if (result < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) && succeed(in, n, TaggedValue::nil());
+    }
+    return succeed(in, n, TaggedValue::fromSmallInteger(result));
+}
+
+// A new descriptor (nil when an accept would block)
+bool openResult(Interpreter& in, uint32_t n, int descriptor) {
+    if (descriptor == IOLoop::WOULD_BLOCK) {
+        return succeed(in, n, TaggedValue::nil());
+    }
+    return descriptor >= 0 && succeed(in, n, TaggedValue::fromSmallInteger(descriptor));
+}
+
+bool ioRead(Interpreter& in, uint32_t n) {
+    return transfer(in, n, true);
+}
+
+bool ioWrite(Interpreter& in, uint32_t n) {
+    return transfer(in, n, false);
+}
+
+bool ioClose(Interpreter& in, uint32_t n) {
+    int handle = receiverHandle(in, n);
+    return handle >= 0 && in.scheduler().io().close(handle) && succeed(in, n, in.stackValue(n));
+}
+
+bool ioWait(Interpreter& in, uint32_t n) {
+    int handle = receiverHandle(in, n);
+    TaggedValue direction = in.stackValue(1);
+    TaggedValue semaphore = in.stackValue(0);
+    if (handle < 0 || ClassTable::classIndexOf(semaphore) != in.vm().kernel().semaphore ||
+        (direction != TaggedValue::fromSmallInteger(IOLoop::READABLE) &&
+         direction != TaggedValue::fromSmallInteger(IOLoop::WRITABLE))) {
+        return false;
+    }
+    IOLoop::Direction which = static_cast<IOLoop::Direction>(direction.toSmallInteger());
+    return in.scheduler().io().waitFor(handle, which, semaphore) && succeed(in, n, in.stackValue(n));
+}
+
+bool ioOpen(Interpreter& in, uint32_t n) {
+    std::string path;
+    TaggedValue mode = in.stackValue(0);
+    if (!stringOperand(in.stackValue(1), path) || !mode.isSmallInteger() || mode.toSmallInteger() < IOLoop::READ ||
+        mode.toSmallInteger() > IOLoop::APPEND) {
+        return false;
+    }
+    IOLoop::FileMode which = static_cast<IOLoop::FileMode>(mode.toSmallInteger());
+    return openResult(in, n, in.scheduler().io().openFile(path, which));
+}
+
+// host and port operands of listen and connect
+bool addressOperands(Interpreter& in, std::string& host, uint16_t& port) {
+    TaggedValue portValue = in.stackValue(0);
+    if (!stringOperand(in.stackValue(1), host) || !portValue.isSmallInteger() || portValue.toSmallInteger() < 0 ||
+        portValue.toSmallInteger() > UINT16_MAX) {
+        return false;
+    }
+    port = static_cast<uint16_t>(portValue.toSmallInteger());
+    return true;
+}
+
+bool ioListen(Interpreter& in, uint32_t n) {
+    std::string host;
+    uint16_t port;
+    return addressOperands(in, host, port) && openResult(in, n, in.scheduler().io().listen(host, port));
+}
+
+bool ioAccept(Interpreter& in, uint32_t n) {
+    int handle = receiverHandle(in, n);
+    return handle >= 0 && openResult(in, n, in.scheduler().io().accept(handle));
+}
+
+bool ioConnect(Interpreter& in, uint32_t n) {
+    std::string host;
+    uint16_t port;
+    return addressOperands(in, host, port) && openResult(in, n, in.scheduler().io().connect(host, port));
+}
+
+bool ioLocalPort(Interpreter& in, uint32_t n) {
+    int handle = receiverHandle(in, n);
+    int port = handle < 0 ? -1 : in.scheduler().io().localPort(handle);
+    return port >= 0 && succeed(in, n, TaggedValue::fromSmallInteger(port));
+}
+
+bool ioConnectionError(Interpreter& in, uint32_t n) {
+    int handle = receiverHandle(in, n);
+    int error = handle < 0 ? -1 : in.scheduler().io().connectionError(handle);
+    return error >= 0 && succeed(in, n, TaggedValue::fromSmallInteger(error));
+}
+
+// ============================================================================
+// Exceptions (1001)
+// ============================================================================
+
+// Execution continues at a handler or at an ensure: block on the way to one, not after
+// the send, so there is no result to push
+bool exceptionSignal(Interpreter& in, uint32_t) {
+    in.signal(in.stackValue(0));
+    return true;
+}
+
+// ============================================================================
+// Table
+// ============================================================================
+
+std::array<Primitive, MAX_PRIMITIVE + 1> buildTable() {
+    std::array<Primitive, MAX_PRIMITIVE + 1> table{};
+    table[1] = add;
+    table[2] = subtract;
+    table[3] = lessThan;
+    table[4] = greaterThan;
+    table[5] = lessOrEqual;
+    table[6] = greaterOrEqual;
+    table[7] = equal;
+    table[8] = notEqual;
+    table[9] = multiply;
+    table[10] = divide;
+    table[11] = floorDivide;
+    table[12] = floorModulo;
+    table[14] = bitAnd;
+    table[15] = bitOr;
+    table[16] = bitXor;
+    table[17] = bitShift;
+    table[19] = primitiveFailed;
+    table[20] = error;
+    table[40] = asFloat;
+    table[41] = floatAdd;
+    table[42] = floatSubtract;
+    table[43] = floatLessThan;
+    table[44] = floatGreaterThan;
+    table[45] = floatLessOrEqual;
+    table[46] = floatGreaterOrEqual;
+    table[47] = floatEqual;
+    table[48] = floatNotEqual;
+    table[49] = floatMultiply;
+    table[50] = floatDivide;
+    table[51] = truncated;
+    table[55] = squareRoot;
+    table[60] = at;
+    table[61] = atPut;
+    table[62] = size;
+    table[63] = at;
+    table[64] = atPut;
+    table[65] = concatenate;
+    table[66] = size;
+    table[67] = asSymbol;
+    table[70] = basicNew;
+    table[71] = basicNew;
+    table[72] = basicNewSized;
+    table[75] = identityHash;
+    table[85] = semaphoreSignal;
+    table[86] = semaphoreWait;
+    table[87] = processResume;
+    table[88] = processSuspend;
+    table[89] = processTerminate;
+    table[90] = processSetPriority;
+    table[91] = fork;
+    table[92] = activeProcess;
+    table[93] = yield;
+    table[110] = identical;
+    table[111] = classOf;
+    table[700] = dictionaryAt;
+    table[701] = dictionaryAtPut;
+    table[702] = dictionaryKeys;
+    table[703] = dictionarySize;
+    table[704] = dictionaryIncludesKey;
+    table[800] = ioRead;
+    table[801] = ioWrite;
+    table[802] = ioClose;
+    table[803] = ioWait;
+    table[804] = ioOpen;
+    table[805] = ioListen;
+    table[806] = ioAccept;
+    table[807] = ioConnect;
+    table[808] = ioLocalPort;
+    table[809] = ioConnectionError;
+    table[1001] = exceptionSignal;
+    return table;
+}
+
+} // namespace
+
+Primitive lookup(uint32_t number) {
+    static const std::array<Primitive, MAX_PRIMITIVE + 1> table = buildTable();
+    return number <= MAX_PRIMITIVE ? table[number] : nullptr;
+}
+
+} // namespace primitives
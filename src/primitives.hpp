@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+class Interpreter;
+
+/**
+ * Primitive table
+ *
+ * A primitive runs with the receiver and arguments on the interpreter's stack. On
+ * success it replaces them with its result and answers true; on failure it answers
+ * false and leaves the stack untouched, and the method's bytecodes run instead.
+ * Exception>>signal is the exception: it succeeds by continuing at a handler.
+ *
+ * Numbering follows the implementation plan where it has one:
+ *   1-12    SmallInteger arithmetic and comparison (+ - < > <= >= = ~= * / // \\)
+ *   14-17   SmallInteger bitAnd: bitOr: bitXor: bitShift:
+ *   19-20   primitiveFailed, error: (raise a VM error; they never answer)
+ *   40-55   Float: asFloat, + - < > <= >= = ~= * /, truncated (51), sqrt (55)
+ *   60-67   at: at:put: size (60-62 indexable, 63/64/66 their String aliases), , (65),
+ *           asSymbol (67)
+ *   70-75   new basicNew new: (70-72), identityHash (75)
+ *   85-93   Semaphore signal wait (85-86), Process resume suspend terminate priority:
+ *           (87-90), fork:withArguments:at: (91), Process activeProcess yield (92-93);
+ *           see Scheduler
+ *   110-111 == class
+ *   700-704 Dictionary at: at:put: keys size includesKey:
+ *   800-809 IOHandle read write close wait (800-803), File open (804), Socket listen
+ *           accept connect localPort connectionError (805-809); see IOLoop. A
+ *           transfer or accept that would block answers nil.
+ *   1001    Exception signal (see Interpreter::signal). The plan's handler marker
+ *           primitive 1000 is not needed: handlers are found through handler tables.
+ *
+ * Primitives that allocate may trigger a collection: they read their operands from the
+ * stack again after allocating.
+ */
+namespace primitives {
+
+using Primitive = bool (*)(Interpreter& interpreter, uint32_t argCount);
+
+constexpr uint32_t MAX_PRIMITIVE = 1023;
+
+// Function for a primitive number, or nullptr if it is not implemented
+Primitive lookup(uint32_t number);
+
+} // namespace primitives
@@ -0,0 +1,212 @@
+#include "profiler.hpp"
+#include "classes/compiled_method.hpp"
+#include "interpreter.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <sys/time.h>
+
+volatile sig_atomic_t Profiler::sampleRequested_ = 0;
+Profiler* Profiler::sampler_ = nullptr;
+
+Profiler::Profiler(bool counting)
+    : counting_(counting), sampling_(false), lastOpcode_(NO_OPCODE), lastCycles_(0), samples_(0),
+      previousAction_() {}
+
+Profiler::~Profiler() {
+    stopSampling();
+}
+
+void Profiler::reset() {
+    opcodes_.fill(OpcodeStats{});
+    lastOpcode_ = NO_OPCODE;
+    // Methods still on the stack keep their stats objects; only the numbers restart.
+    for (auto& entry : methods_) {
+        MethodStats& stats = entry.second;
+        stats.invocations = stats.inclusiveCycles = stats.exclusiveCycles = 0;
+    }
+    uint64_t now = cycles();
+    for (Activation& activation : activations_) {
+        activation.started = now;
+        activation.children = 0;
+    }
+    stacks_.clear();
+    samples_ = 0;
+}
+
+// ============================================================================
+// Methods
+// ============================================================================
+
+Profiler::MethodStats& Profiler::statsFor(TaggedValue method) {
+    MethodStats& stats = methods_[st::CompiledMethod::stableKey(method)];
+    if (stats.name.empty()) {
+        stats.name = st::mirrorOf<st::CompiledMethod>(method)->qualifiedName();
+    }
+    return stats;
+}
+
+void Profiler::enterMethod(TaggedValue method) {
+    MethodStats& stats = statsFor(method);
+    stats.invocations++;
+    stats.activations++;
+    activations_.push_back(Activation{&stats, cycles(), 0});
+}
+
+void Profiler::exitMethod() {
+    Activation activation = activations_.back();
+    activations_.pop_back();
+    uint64_t elapsed = cycles() - activation.started;
+    MethodStats& stats = *activation.stats;
+    stats.exclusiveCycles += elapsed - std::min(elapsed, activation.children);
+    if (--stats.activations == 0) {
+        stats.inclusiveCycles += elapsed;
+    }
+    if (!activations_.empty()) {
+        activations_.back().children += elapsed;
+    }
+}
+
+void Profiler::unwindTo(size_t depth) {
+    while (activations_.size() > depth) {
+        exitMethod();
+    }
+    endOpcodes(cycles());
+}
+
+std::vector<Profiler::MethodStats> Profiler::methodStats() const {
+    std::vector<MethodStats> result;
+    result.reserve(methods_.size());
+    for (const auto& entry : methods_) {
+        result.push_back(entry.second);
+    }
+    std::sort(result.begin(), result.end(), [](const MethodStats& a, const MethodStats& b) {
+        return a.exclusiveCycles != b.exclusiveCycles ? a.exclusiveCycles > b.exclusiveCycles : a.name < b.name;
+    });
+    return result;
+}
+
+// ============================================================================
+// Sampling
+// ============================================================================
+
+void Profiler::handleSignal(int) {
+    sampleRequested_ = 1;
+}
+
+void Profiler::startSampling(std::chrono::microseconds interval) {
+    if (sampling_) {
+        return;
+    }
+    if (sampler_ != nullptr) {
+        throw std::logic_error("Another profiler is already sampling");
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = &Profiler::handleSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &previousAction_) != 0) {
+        throw std::runtime_error("Cannot install the SIGPROF handler");
+    }
+
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1000000);
+    timer.it_interval.tv_usec = static_cast<suseconds_t>(interval.count() % 1000000);
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        sigaction(SIGPROF, &previousAction_, nullptr);
+        throw std::runtime_error("Cannot start the profiling timer");
+    }
+    sampler_ = this;
+    sampling_ = true;
+}
+
+void Profiler::stopSampling() {
+    if (!sampling_) {
+        return;
+    }
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previousAction_, nullptr);
+    sampleRequested_ = 0;
+    sampler_ = nullptr;
+    sampling_ = false;
+}
+
+void Profiler::takeSample(const Interpreter& interpreter) {
+    sampleRequested_ = 0;
+    std::vector<uint64_t> stack;
+    stack.reserve(interpreter.frameDepth());
+    for (size_t i = 0; i < interpreter.frameDepth(); i++) {
+        TaggedValue method = interpreter.frameMethod(i);
+        statsFor(method);
+        stack.push_back(st::CompiledMethod::stableKey(method));
+    }
+    stacks_[std::move(stack)]++;
+    samples_++;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+void Profiler::writeCollapsedStacks(std::ostream& out, const std::string& rootFrame) const {
+    for (const auto& entry : stacks_) {
+        std::string line = rootFrame;
+        for (uint64_t key : entry.first) {
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += methods_.at(key).name;
+        }
+        if (line.empty()) {
+            continue;
+        }
+        out << line << ' ' << entry.second << '\n';
+    }
+}
+
+void Profiler::writeReport(std::ostream& out, size_t maxMethods) const {
+    char line[256];
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = 0;
+    for (const OpcodeStats& stats : opcodes_) {
+        totalCount += stats.count;
+        totalCycles += stats.cycles;
+    }
+
+    std::snprintf(line, sizeof(line), "%-26s %14s %16s %10s %7s\n", "opcode", "count", "cycles", "cycles/op",
+                  "time%");
+    out << line;
+    for (size_t opcode = 0; opcode < opcodes_.size(); opcode++) {
+        const OpcodeStats& stats = opcodes_[opcode];
+        if (stats.count == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "%-26s %14llu %16llu %10.1f %6.1f%%\n",
+                      bytecode::opcodeName(static_cast<uint8_t>(opcode)),
+                      static_cast<unsigned long long>(stats.count), static_cast<unsigned long long>(stats.cycles),
+                      static_cast<double>(stats.cycles) / stats.count,
+                      totalCycles > 0 ? 100.0 * stats.cycles / totalCycles : 0.0);
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "%-26s %14llu %16llu\n\n", "total",
+                  static_cast<unsigned long long>(totalCount), static_cast<unsigned long long>(totalCycles));
+    out << line;
+
+    std::vector<MethodStats> methods = methodStats();
+    std::snprintf(line, sizeof(line), "%-40s %12s %16s %16s\n", "method", "calls", "inclusive", "exclusive");
+    out << line;
+    for (size_t i = 0; i < methods.size() && i < maxMethods; i++) {
+        const MethodStats& stats = methods[i];
+        std::snprintf(line, sizeof(line), "%-40s %12llu %16llu %16llu\n", stats.name.c_str(),
+                      static_cast<unsigned long long>(stats.invocations),
+                      static_cast<unsigned long long>(stats.inclusiveCycles),
+                      static_cast<unsigned long long>(stats.exclusiveCycles));
+        out << line;
+    }
+    if (samples_ > 0) {
+        out << '\n' << samples_ << " samples in " << stacks_.size() << " distinct stacks\n";
+    }
+}
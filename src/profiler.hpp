@@ -0,0 +1,149 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "tagged_value.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+class Interpreter;
+
+/**
+ * Profiler - opt-in execution profiler for the Interpreter
+ *
+ * Attach one with Interpreter::setProfiler(). Two independent modes:
+ * - Counting: per-opcode execution counts and cycle totals, and per-CompiledMethod
+ *   invocation counts with inclusive and exclusive time. The cycles spent between
+ *   two bytecodes are charged to the first one, so a send's cycles include lookup,
+ *   primitive and activation. Inclusive time of a recursive method is counted once,
+ *   at its outermost activation.
+ * - Sampling: a SIGPROF interval timer sets a flag; the interpreter notices it at the
+ *   next bytecode and records the frame stack. Stacks are written in the collapsed
+ *   format ("outer;inner count") that flame graph tools read. Only one Profiler can
+ *   sample at a time.
+ *
+ * The interpreter picks its dispatch loop when a send() starts: without a profiler
+ * (or with both modes off) it runs the loop compiled without any profiling code.
+ *
+ * Methods are identified by their method class and their own identity hash, both of
+ * which survive collections; names are resolved the first time a method is seen.
+ * Cycles come from the time-stamp counter where there is one, nanoseconds otherwise.
+ */
+class Profiler {
+public:
+    struct OpcodeStats {
+        uint64_t count = 0;
+        uint64_t cycles = 0;
+    };
+
+    struct MethodStats {
+        std::string name;  // "Class>>selector"
+        uint64_t invocations = 0;
+        uint64_t inclusiveCycles = 0;
+        uint64_t exclusiveCycles = 0;
+        uint32_t activations = 0;  // Currently on the stack
+    };
+
+    explicit Profiler(bool counting = true);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    bool counting() const { return counting_; }
+    void setCounting(bool counting) { counting_ = counting; }
+
+    // Starts or stops the SIGPROF timer. Throws std::logic_error if another Profiler
+    // is sampling and std::runtime_error if the timer cannot be installed.
+    void startSampling(std::chrono::microseconds interval = std::chrono::microseconds(1000));
+    void stopSampling();
+    bool sampling() const { return sampling_; }
+
+    // Results
+    const OpcodeStats& opcodeStats(uint8_t opcode) const { return opcodes_[opcode]; }
+    // Every method seen, by exclusive cycles, highest first
+    std::vector<MethodStats> methodStats() const;
+    uint64_t samples() const { return samples_; }
+    // One line per distinct stack, outermost method first. A non-empty rootFrame is
+    // prepended to every stack.
+    void writeCollapsedStacks(std::ostream& out, const std::string& rootFrame = "") const;
+    // Opcode table and the maxMethods methods with the most exclusive cycles
+    void writeReport(std::ostream& out, size_t maxMethods = 20) const;
+    void reset();
+
+    static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+#endif
+    }
+
+    // Interpreter hooks, only called from the profiling dispatch loops
+    void countOpcode(uint8_t opcode, uint64_t now) {
+        if (lastOpcode_ != NO_OPCODE) {
+            opcodes_[lastOpcode_].cycles += now - lastCycles_;
+        }
+        opcodes_[opcode].count++;
+        lastOpcode_ = opcode;
+        lastCycles_ = now;
+    }
+    void endOpcodes(uint64_t now) {
+        if (lastOpcode_ != NO_OPCODE) {
+            opcodes_[lastOpcode_].cycles += now - lastCycles_;
+            lastOpcode_ = NO_OPCODE;
+        }
+    }
+    void enterMethod(TaggedValue method);
+    void exitMethod();
+    size_t activeMethods() const { return activations_.size(); }
+    // Exits activations until depth remain (the interpreter unwound after an error)
+    void unwindTo(size_t depth);
+
+    // A method activation being timed. Each Process has its own stack of them; the
+    // Scheduler swaps them in along with the Process's frames.
+    struct Activation {
+        MethodStats* stats;
+        uint64_t started;
+        uint64_t children;
+    };
+    void swapActivations(std::vector<Activation>& other) { activations_.swap(other); }
+
+    static bool sampleRequested() { return sampleRequested_ != 0; }
+    void takeSample(const Interpreter& interpreter);
+
+private:
+    static constexpr uint16_t NO_OPCODE = 256;
+
+    MethodStats& statsFor(TaggedValue method);
+    static void handleSignal(int);
+
+    static volatile sig_atomic_t sampleRequested_;
+    static Profiler* sampler_;
+
+    bool counting_;
+    bool sampling_;
+    std::array<OpcodeStats, 256> opcodes_;
+    uint16_t lastOpcode_;
+    uint64_t lastCycles_;
+
+    std::unordered_map<uint64_t, MethodStats> methods_;
+    std::vector<Activation> activations_;
+
+    std::map<std::vector<uint64_t>, uint64_t> stacks_;  // Method keys, outermost first
+    uint64_t samples_;
+    struct sigaction previousAction_;
+};
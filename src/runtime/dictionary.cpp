@@ -0,0 +1,150 @@
+#include "dictionary.hpp"
+
+namespace runtime {
+
+namespace {
+
+// Old-table slots moved into the new table per insert during incremental growth.
+constexpr size_t MIGRATE_STEP = 32;
+
+} // namespace
+
+// ============================================================================
+// Table
+// ============================================================================
+
+template <typename Keys>
+BasicDictionary<Keys>::Table::Table(size_t capacity)
+    : ctrl_(capacity, swiss_table::EMPTY), entries_(capacity), hashes_(capacity) {
+}
+
+template <typename Keys>
+void BasicDictionary<Keys>::Table::insertAbsent(TaggedValue key, TaggedValue value, uint64_t hash) {
+    size_t index = swiss_table::insertAbsent(ctrl_.data(), capacity(), hash);
+    entries_[index] = Entry{key, value};
+    hashes_[index] = hash;
+}
+
+// ============================================================================
+// BasicDictionary
+// ============================================================================
+
+template <typename Keys>
+BasicDictionary<Keys>::BasicDictionary()
+    : current_(), old_(), migrateCursor_(0), currentCount_(0), size_(0) {
+}
+
+template <typename Keys>
+void BasicDictionary<Keys>::atPut(TaggedValue key, TaggedValue value) {
+    uint64_t hash = Keys::hash(key);
+
+    TaggedValue* existing = current_.find(key, hash);
+    if (existing != nullptr) {
+        *existing = value;
+        return;
+    }
+    // A key still waiting in the old table is updated where it lives.
+    if (old_.capacity() != 0) {
+        existing = old_.find(key, hash);
+        if (existing != nullptr) {
+            *existing = value;
+            migrateSome();
+            return;
+        }
+    }
+
+    if (currentCount_ + 1 > swiss_table::growthLimit(current_.capacity())) {
+        startGrowth();
+    }
+    current_.insertAbsent(key, value, hash);
+    currentCount_++;
+    size_++;
+
+    if (old_.capacity() != 0) {
+        migrateSome();
+    }
+}
+
+template <typename Keys>
+std::vector<TaggedValue> BasicDictionary<Keys>::keys() const {
+    std::vector<TaggedValue> result;
+    result.reserve(size_);
+    for (const Table* table : {&current_, &old_}) {
+        for (size_t i = 0; i < table->capacity(); i++) {
+            if (table->isFull(i)) {
+                result.push_back(table->entry(i).key);
+            }
+        }
+    }
+    return result;
+}
+
+template <typename Keys>
+void BasicDictionary<Keys>::visitPointers(const std::function<void(TaggedValue&)>& visit) {
+    for (Table* table : {&current_, &old_}) {
+        for (size_t i = 0; i < table->capacity(); i++) {
+            if (table->isFull(i)) {
+                visit(table->entry(i).key);
+                visit(table->entry(i).value);
+            }
+        }
+    }
+}
+
+template <typename Keys>
+void BasicDictionary<Keys>::startGrowth() {
+    // A new growth cannot start until the previous one has drained.
+    while (old_.capacity() != 0) {
+        migrateSome();
+    }
+    size_t newCapacity = current_.capacity() == 0 ? swiss_table::GROUP_WIDTH : current_.capacity() * 2;
+    if (currentCount_ == 0) {
+        current_ = Table(newCapacity);
+        return;
+    }
+    old_ = std::move(current_);
+    current_ = Table(newCapacity);
+    currentCount_ = 0;
+    migrateCursor_ = 0;
+}
+
+template <typename Keys>
+void BasicDictionary<Keys>::migrateSome() {
+    size_t end = migrateCursor_ + MIGRATE_STEP;
+    if (end > old_.capacity()) {
+        end = old_.capacity();
+    }
+    for (; migrateCursor_ < end; migrateCursor_++) {
+        if (!old_.isFull(migrateCursor_)) {
+            continue;
+        }
+        const Entry& from = old_.entry(migrateCursor_);
+        current_.insertAbsent(from.key, from.value, old_.hash(migrateCursor_));
+        old_.markDeleted(migrateCursor_);
+        currentCount_++;
+    }
+    if (migrateCursor_ == old_.capacity()) {
+        old_ = Table();
+        migrateCursor_ = 0;
+    }
+}
+
+template <typename Keys>
+TaggedValue BasicDictionary<Keys>::toTaggedValue(BasicDictionary* dictionary) {
+    if (dictionary == nullptr) {
+        return TaggedValue::nil();
+    }
+    return TaggedValue::fromPointer(dictionary);
+}
+
+template <typename Keys>
+BasicDictionary<Keys>* BasicDictionary<Keys>::fromTaggedValue(TaggedValue value) {
+    if (value.isNil() || !value.isPointer()) {
+        return nullptr;
+    }
+    return reinterpret_cast<BasicDictionary*>(value.toPointer());
+}
+
+template class BasicDictionary<IdentityKeys>;
+
+} // namespace runtime
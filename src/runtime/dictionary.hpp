@@ -0,0 +1,129 @@
+#pragma once
+
+#include "../swiss_table.hpp"
+#include "../tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+namespace runtime {
+
+using swiss_table::IdentityKeys;
+
+/**
+ * BasicDictionary - open-addressing hash table backing the method dictionaries.
+ *
+ * A Swiss table (see swiss_table.hpp): control bytes probed a group at a time, keys and
+ * values in 16-byte entries, and each key's full hash cached in an array of its own so
+ * growth never rehashes a key and a probe never loads it.
+ *
+ * Growth is incremental: when the table passes 7/8 load a table of twice the capacity
+ * is allocated and the old one is drained a few slots per insert, so a large dictionary
+ * never stalls on a full rehash. Lookups that miss the new table consult the old one
+ * while a migration is in progress.
+ *
+ * Like runtime::Array this is a runtime backing store, not a mirror layout type. The
+ * Smalltalk Dictionary keeps the same kind of table in object memory instead (see
+ * dictionary_table.hpp).
+ */
+template <typename Keys>
+class BasicDictionary {
+public:
+    BasicDictionary();
+
+    // Throws std::out_of_range if the key is absent
+    TaggedValue at(TaggedValue key) const {
+        const TaggedValue* value = find(key);
+        if (value == nullptr) {
+            throw std::out_of_range("Dictionary key not found");
+        }
+        return *value;
+    }
+
+    void atPut(TaggedValue key, TaggedValue value);
+
+    std::vector<TaggedValue> keys() const;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Lookup without throwing; answers nullptr if the key is absent
+    const TaggedValue* find(TaggedValue key) const {
+        uint64_t hash = Keys::hash(key);
+        const TaggedValue* value = current_.find(key, hash);
+        if (value == nullptr && old_.capacity() != 0) {
+            value = old_.find(key, hash);
+        }
+        return value;
+    }
+    bool includesKey(TaggedValue key) const { return find(key) != nullptr; }
+
+    // Visit every key and value so a moving collector can update them in place.
+    // Cached hashes do not depend on addresses, so no rehash is needed afterwards.
+    void visitPointers(const std::function<void(TaggedValue&)>& visit);
+
+    // Introspection (for tests and benchmarks)
+    size_t capacity() const { return current_.capacity(); }
+    bool isGrowing() const { return old_.capacity() != 0; }
+
+    // Convert to/from TaggedValue (as pointer)
+    static TaggedValue toTaggedValue(BasicDictionary* dictionary);
+    static BasicDictionary* fromTaggedValue(TaggedValue value);
+
+private:
+    struct Entry {
+        TaggedValue key;
+        TaggedValue value;
+    };
+
+    class Table {
+    public:
+        Table() = default;
+        explicit Table(size_t capacity);
+
+        size_t capacity() const { return entries_.size(); }
+
+        // The value stored under key, or nullptr if absent
+        const TaggedValue* find(TaggedValue key, uint64_t hash) const {
+            if (entries_.empty()) {
+                return nullptr;
+            }
+            const Entry* entries = entries_.data();
+            size_t index = swiss_table::find<Keys>(ctrl_.data(), capacity(), key, hash,
+                                                   [entries](size_t i) { return entries[i].key; });
+            return index != capacity() ? &entries[index].value : nullptr;
+        }
+        TaggedValue* find(TaggedValue key, uint64_t hash) {
+            return const_cast<TaggedValue*>(static_cast<const Table*>(this)->find(key, hash));
+        }
+        // Stores an entry whose key is known to be absent
+        void insertAbsent(TaggedValue key, TaggedValue value, uint64_t hash);
+
+        bool isFull(size_t index) const { return ctrl_[index] >= 0; }
+        // Deleted (not empty) so probes for keys further along the chain keep going
+        void markDeleted(size_t index) { ctrl_[index] = swiss_table::DELETED; }
+        Entry& entry(size_t index) { return entries_[index]; }
+        const Entry& entry(size_t index) const { return entries_[index]; }
+        uint64_t hash(size_t index) const { return hashes_[index]; }
+
+    private:
+        std::vector<int8_t> ctrl_;
+        std::vector<Entry> entries_;
+        std::vector<uint64_t> hashes_;  // Cached Keys::hash of each full slot's key
+    };
+
+    void startGrowth();
+    void migrateSome();
+
+    Table current_;
+    Table old_;              // Non-empty only while a growth is in progress
+    size_t migrateCursor_;   // Next old_ slot to move into current_
+    size_t currentCount_;    // Entries held by current_
+    size_t size_;            // Entries held by both tables
+};
+
+using IdentityDictionary = BasicDictionary<IdentityKeys>;
+
+} // namespace runtime
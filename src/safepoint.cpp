@@ -0,0 +1,175 @@
+#include "safepoint.hpp"
+#include "interpreter.hpp"
+#include <algorithm>
+
+namespace {
+
+// The interpreter this thread is running a send in, if any
+thread_local Safepoints::Participant* runningHere = nullptr;
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+// Stops are rare and waiting is their whole point, so the interpreter side is kept to a
+// store and a load on the way in and out; the mutex is only taken when a Stop is pending.
+void acquire(Safepoints::Participant& participant, std::mutex& mutex, std::condition_variable& changed) {
+    participant.state.store(Safepoints::Participant::RUNNING);
+    if (!participant.stopRequested.load()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    while (participant.stopRequested.load()) {
+        participant.state.store(Safepoints::Participant::OUTSIDE);
+        changed.notify_all();
+        changed.wait(lock);
+    }
+    participant.state.store(Safepoints::Participant::RUNNING);
+}
+
+void release(Safepoints::Participant& participant, std::mutex& mutex, std::condition_variable& changed) {
+    participant.state.store(Safepoints::Participant::OUTSIDE);
+    if (participant.stopRequested.load()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        changed.notify_all();
+    }
+}
+
+} // namespace
+
+Safepoints& Safepoints::global() {
+    static Safepoints safepoints;
+    return safepoints;
+}
+
+size_t Safepoints::interpreters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return participants_.size();
+}
+
+uint64_t Safepoints::stops() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stops_;
+}
+
+Histogram Safepoints::timeToSafepoint() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return timeToSafepoint_;
+}
+
+Histogram Safepoints::timeToSafepoint(const Interpreter& interpreter) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Participant* participant : participants_) {
+        if (&participant->interpreter == &interpreter) {
+            return participant->timeToSafepoint;
+        }
+    }
+    return Histogram();
+}
+
+void Safepoints::add(Participant& participant) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    participants_.push_back(&participant);
+    if (stoppingAll_) {
+        participant.requestedAt = std::chrono::steady_clock::now();
+        participant.stopRequested.store(true);
+    }
+}
+
+void Safepoints::remove(Participant& participant) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    participants_.erase(std::find(participants_.begin(), participants_.end(), &participant));
+    changed_.notify_all();
+}
+
+void Safepoints::park(Participant& participant) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!participant.stopRequested.load()) {
+        return;  // The Stop ended before the poll
+    }
+    participant.timeToSafepoint.record(nanosecondsSince(participant.requestedAt));
+    participant.state.store(Participant::PARKED);
+    changed_.notify_all();
+    changed_.wait(lock, [&participant] { return !participant.stopRequested.load(); });
+    participant.state.store(Participant::RUNNING);
+}
+
+// ============================================================================
+// Stop
+// ============================================================================
+
+Safepoints::Stop::Stop() {
+    stop(nullptr);
+}
+
+Safepoints::Stop::Stop(Interpreter& only) {
+    stop(&only);
+}
+
+void Safepoints::Stop::stop(Interpreter* only) {
+    Safepoints& registry = global();
+    serialized_ = std::unique_lock<std::mutex>(registry.stopMutex_);
+    std::unique_lock<std::mutex> lock(registry.mutex_);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    registry.stoppingAll_ = only == nullptr;
+    for (Participant* participant : registry.participants_) {
+        if ((only == nullptr || &participant->interpreter == only) && participant != runningHere) {
+            participant->requestedAt = start;
+            // Before the state is read below; Running checks the two the other way round
+            participant->stopRequested.store(true);
+            participant->interpreter.requestInterrupt(Interpreter::SAFEPOINT_INTERRUPT);
+        }
+    }
+    registry.changed_.wait(lock, [&registry] {
+        return std::none_of(registry.participants_.begin(), registry.participants_.end(), [](Participant* p) {
+            return p->stopRequested.load() && p->state.load() == Participant::RUNNING;
+        });
+    });
+    timeToSafepoint_ = std::chrono::steady_clock::now() - start;
+    for (Participant* participant : registry.participants_) {
+        parked_ += participant->state.load() == Participant::PARKED ? 1 : 0;
+    }
+    registry.stops_++;
+    registry.timeToSafepoint_.record(static_cast<uint64_t>(timeToSafepoint_.count()));
+}
+
+Safepoints::Stop::~Stop() {
+    Safepoints& registry = global();
+    std::lock_guard<std::mutex> lock(registry.mutex_);
+    for (Participant* participant : registry.participants_) {
+        participant->stopRequested.store(false);
+    }
+    registry.stoppingAll_ = false;
+    registry.changed_.notify_all();
+}
+
+// ============================================================================
+// Running and Blocked
+// ============================================================================
+
+Safepoints::Running::Running(Interpreter& interpreter) : participant_(interpreter.safepoint()) {
+    if (participant_.depth++ == 0) {
+        Safepoints& registry = global();
+        acquire(participant_, registry.mutex_, registry.changed_);
+        runningHere = &participant_;
+    }
+}
+
+Safepoints::Running::~Running() {
+    if (--participant_.depth == 0) {
+        Safepoints& registry = global();
+        runningHere = nullptr;
+        release(participant_, registry.mutex_, registry.changed_);
+    }
+}
+
+Safepoints::Blocked::Blocked(Interpreter& interpreter) : participant_(interpreter.safepoint()) {
+    Safepoints& registry = global();
+    release(participant_, registry.mutex_, registry.changed_);
+}
+
+Safepoints::Blocked::~Blocked() {
+    Safepoints& registry = global();
+    acquire(participant_, registry.mutex_, registry.changed_);
+}
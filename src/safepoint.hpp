@@ -0,0 +1,130 @@
+#pragma once
+
+#include "histogram.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+class Interpreter;
+
+/**
+ * Safepoints - stopping interpreters at consistent points, from any thread
+ *
+ * An interpreter is at a safepoint where its dispatch loop polls the interrupt word,
+ * i.e. at method entry (after each send) and at backward jumps, and whenever it is not
+ * running Smalltalk at all. At a poll every frame has its instruction pointer saved and
+ * no primitive is halfway through, so another thread may walk the stacks, collect or
+ * snapshot the interpreter's VM. The poll is the relaxed load of the interrupt word the
+ * loop already makes for Process switches: straight-line code pays nothing more, and
+ * any loop or call chain reaches a poll within a bounded number of bytecodes.
+ *
+ * A Stop is the stop-the-world handshake. It asks every interpreter (or just one) to
+ * stop and returns once each is parked at a poll or outside any send. Until the Stop
+ * is destroyed the parked interpreters stay parked, and one that starts a send (or
+ * leaves a Blocked region) waits before running anything. Stops are serialized.
+ *
+ * Time to safepoint is recorded twice: per Stop here, from the request until the last
+ * interpreter is safe, and per interpreter, from the request until it reached a poll
+ * (see VMStatistics).
+ *
+ * Every Interpreter registers with global() while it exists.
+ */
+class Safepoints {
+public:
+    // An interpreter's side of the handshake, embedded in it
+    struct Participant {
+        enum State : uint8_t { OUTSIDE, RUNNING, PARKED };
+
+        explicit Participant(Interpreter& owner) : interpreter(owner) {}
+
+        Interpreter& interpreter;
+        std::atomic<uint8_t> state{OUTSIDE};
+        std::atomic<bool> stopRequested{false};
+        size_t depth = 0;  // Nested Running scopes, touched only by the interpreter's thread
+        // Guarded by the registry's mutex
+        std::chrono::steady_clock::time_point requestedAt;
+        Histogram timeToSafepoint;  // Nanoseconds
+    };
+
+    // Stops every registered interpreter, or only the given one, for its lifetime. The
+    // calling thread's own interpreter, if it is inside a send (a primitive stopping the
+    // world), is not waited for. Starting a send on the stopping thread itself while
+    // the Stop lasts would wait forever.
+    class Stop {
+    public:
+        Stop();
+        explicit Stop(Interpreter& only);
+        ~Stop();
+
+        Stop(const Stop&) = delete;
+        Stop& operator=(const Stop&) = delete;
+
+        std::chrono::nanoseconds timeToSafepoint() const { return timeToSafepoint_; }
+        // Interpreters that were running and parked at a poll for this Stop
+        size_t parked() const { return parked_; }
+
+    private:
+        void stop(Interpreter* only);
+
+        std::unique_lock<std::mutex> serialized_;
+        std::chrono::nanoseconds timeToSafepoint_{0};
+        size_t parked_ = 0;
+    };
+
+    // Marks the calling thread as running the interpreter, so a Stop waits for it to
+    // reach a poll; waits first while the interpreter is stopped. Held around every
+    // send, and by Isolates around each task. Nests.
+    class Running {
+    public:
+        explicit Running(Interpreter& interpreter);
+        ~Running();
+
+        Running(const Running&) = delete;
+        Running& operator=(const Running&) = delete;
+
+    private:
+        Participant& participant_;
+    };
+
+    // Marks a primitive that blocks (on I/O, a lock, a sleep) as safe while it blocks.
+    // Its interpreter's stacks must be consistent, as they are inside any primitive.
+    class Blocked {
+    public:
+        explicit Blocked(Interpreter& interpreter);
+        ~Blocked();
+
+        Blocked(const Blocked&) = delete;
+        Blocked& operator=(const Blocked&) = delete;
+
+    private:
+        Participant& participant_;
+    };
+
+    static Safepoints& global();
+
+    size_t interpreters() const;
+    uint64_t stops() const;
+    Histogram timeToSafepoint() const;  // Per Stop, nanoseconds
+    Histogram timeToSafepoint(const Interpreter& interpreter) const;
+
+    // Called by the Interpreter
+    void add(Participant& participant);
+    void remove(Participant& participant);
+    // At a poll that found SAFEPOINT_INTERRUPT set: parks until the Stop ends
+    void park(Participant& participant);
+
+private:
+    Safepoints() = default;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Participant*> participants_;
+    bool stoppingAll_ = false;
+    uint64_t stops_ = 0;
+    Histogram timeToSafepoint_;
+    std::mutex stopMutex_;  // Held by the current Stop
+};
@@ -0,0 +1,498 @@
+#include "scheduler.hpp"
+#include "classes/process.hpp"
+#include "vm.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using st::ProcessSlots;
+using st::SemaphoreSlots;
+
+Scheduler::Scheduler(VM& vm, Interpreter& interpreter)
+    : vm_(vm), interpreter_(interpreter), readyMask_(0), active_(CALLER), switches_(0), tickerStopping_(false) {
+    rootProvider_ = vm_.memory().addRootProvider([this](const MemoryManager::RootVisitor& visit) {
+        for (Record& record : records_) {
+            if (record.state == FREE) {
+                continue;
+            }
+            visit(record.process);
+            visit(record.startSelector);
+            for (size_t i = 0; i < record.stack.sp; i++) {
+                visit(record.stack.slots[i]);
+            }
+            for (Interpreter::Frame& frame : record.stack.frames) {
+                visit(frame.method);
+            }
+        }
+    });
+
+    // The caller's Process runs on the interpreter's own stacks.
+    ObjectHeader* process = vm_.memory().allocateSlots(ObjectHeader::TYPE_OBJECT, ProcessSlots::COUNT,
+                                                       vm_.kernel().process);
+    newRecord(process->toTaggedValue(), USER_PRIORITY);
+    records_[CALLER].state = RUNNING;
+}
+
+Scheduler::~Scheduler() {
+    stopPreemption();
+    io_.reset();
+    vm_.memory().removeRootProvider(rootProvider_);
+}
+
+// ============================================================================
+// Records
+// ============================================================================
+
+Scheduler::Record* Scheduler::recordOf(TaggedValue process, uint32_t& index) {
+    if (ClassTable::classIndexOf(process) != vm_.kernel().process) {
+        return nullptr;
+    }
+    // stackIndex is an ordinary slot Smalltalk code can write: trust it only if the
+    // record it names belongs to this Process
+    TaggedValue stackIndex = st::mirrorOf<st::Process>(process)->stackIndex();
+    if (!stackIndex.isSmallInteger() || stackIndex.toSmallInteger() < 0 ||
+        static_cast<uint64_t>(stackIndex.toSmallInteger()) >= records_.size()) {
+        return nullptr;
+    }
+    index = static_cast<uint32_t>(stackIndex.toSmallInteger());
+    Record& record = records_[index];
+    return record.process == process ? &record : nullptr;
+}
+
+bool Scheduler::isSemaphore(TaggedValue value) const {
+    return ClassTable::classIndexOf(value) == vm_.kernel().semaphore;
+}
+
+uint32_t Scheduler::newRecord(TaggedValue process, int64_t priority) {
+    uint32_t index;
+    if (freeRecords_.empty()) {
+        index = static_cast<uint32_t>(records_.size());
+        records_.emplace_back();
+    } else {
+        index = freeRecords_.back();
+        freeRecords_.pop_back();
+    }
+    Record& record = records_[index];
+    record.process = process;
+    record.priority = priority;
+    record.state = SUSPENDED;
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(process);
+    vm_.memory().storePointer(object, ProcessSlots::PRIORITY, TaggedValue::fromSmallInteger(priority));
+    vm_.memory().storePointer(object, ProcessSlots::STACK_INDEX, TaggedValue::fromSmallInteger(index));
+    return index;
+}
+
+void Scheduler::release(uint32_t index) {
+    Record& record = records_[index];
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(record.process);
+    vm_.memory().storePointer(object, ProcessSlots::STACK_INDEX, TaggedValue::nil());
+    if (record.stack.capacity == PROCESS_STACK_SLOTS && stackPool_.size() < STACK_POOL_SIZE) {
+        stackPool_.push_back(std::move(record.stack.slots));
+    }
+    record = Record();
+    freeRecords_.push_back(index);
+}
+
+// ============================================================================
+// Ready queues
+// ============================================================================
+
+void Scheduler::enqueue(uint32_t index, bool front) {
+    Record& record = records_[index];
+    record.state = READY;
+    std::deque<uint32_t>& queue = ready_[record.priority];
+    if (front) {
+        queue.push_front(index);
+    } else {
+        queue.push_back(index);
+    }
+    readyMask_ |= 1u << record.priority;
+}
+
+uint32_t Scheduler::dequeueHighest() {
+    int64_t priority = highestReady();
+    std::deque<uint32_t>& queue = ready_[priority];
+    uint32_t index = queue.front();
+    queue.pop_front();
+    if (queue.empty()) {
+        readyMask_ &= ~(1u << priority);
+    }
+    return index;
+}
+
+void Scheduler::removeReady(uint32_t index) {
+    int64_t priority = records_[index].priority;
+    std::deque<uint32_t>& queue = ready_[priority];
+    queue.erase(std::find(queue.begin(), queue.end(), index));
+    if (queue.empty()) {
+        readyMask_ &= ~(1u << priority);
+    }
+}
+
+void Scheduler::makeReady(uint32_t index) {
+    enqueue(index, false);
+    if (records_[index].priority > records_[active_].priority) {
+        interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+    }
+}
+
+size_t Scheduler::readyCount() const {
+    size_t count = 0;
+    for (const std::deque<uint32_t>& queue : ready_) {
+        count += queue.size();
+    }
+    return count;
+}
+
+IOLoop& Scheduler::io() {
+    if (io_ == nullptr) {
+        io_ = std::make_unique<IOLoop>(vm_, *this);
+    }
+    return *io_;
+}
+
+// ============================================================================
+// Semaphore lists
+// ============================================================================
+
+void Scheduler::appendWaiter(TaggedValue semaphore, TaggedValue process) {
+    MemoryManager& memory = vm_.memory();
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(process);
+    memory.storePointer(object, ProcessSlots::NEXT_LINK, TaggedValue::nil());
+    memory.storePointer(object, ProcessSlots::MY_LIST, semaphore);
+
+    ObjectHeader* list = ObjectHeader::fromTaggedValue(semaphore);
+    TaggedValue last = st::mirrorOf<st::Semaphore>(list)->lastLink();
+    if (last.isNil()) {
+        memory.storePointer(list, SemaphoreSlots::FIRST_LINK, process);
+    } else {
+        memory.storePointer(ObjectHeader::fromTaggedValue(last), ProcessSlots::NEXT_LINK, process);
+    }
+    memory.storePointer(list, SemaphoreSlots::LAST_LINK, process);
+}
+
+TaggedValue Scheduler::removeFirstWaiter(TaggedValue semaphore) {
+    TaggedValue first = st::mirrorOf<st::Semaphore>(semaphore)->firstLink();
+    if (!first.isNil()) {
+        removeWaiter(first);
+    }
+    return first;
+}
+
+void Scheduler::removeWaiter(TaggedValue process) {
+    MemoryManager& memory = vm_.memory();
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(process);
+    TaggedValue semaphore = st::mirrorOf<st::Process>(object)->myList();
+    if (semaphore.isNil()) {
+        return;
+    }
+    ObjectHeader* list = ObjectHeader::fromTaggedValue(semaphore);
+    TaggedValue next = st::mirrorOf<st::Process>(object)->nextLink();
+    TaggedValue previous = TaggedValue::nil();
+    for (TaggedValue link = st::mirrorOf<st::Semaphore>(list)->firstLink(); link != process;
+         link = st::mirrorOf<st::Process>(link)->nextLink()) {
+        previous = link;
+    }
+    if (previous.isNil()) {
+        memory.storePointer(list, SemaphoreSlots::FIRST_LINK, next);
+    } else {
+        memory.storePointer(ObjectHeader::fromTaggedValue(previous), ProcessSlots::NEXT_LINK, next);
+    }
+    if (st::mirrorOf<st::Semaphore>(list)->lastLink() == process) {
+        memory.storePointer(list, SemaphoreSlots::LAST_LINK, previous);
+    }
+    memory.storePointer(object, ProcessSlots::NEXT_LINK, TaggedValue::nil());
+    memory.storePointer(object, ProcessSlots::MY_LIST, TaggedValue::nil());
+}
+
+// ============================================================================
+// Primitives
+// ============================================================================
+
+TaggedValue Scheduler::fork(TaggedValue receiver, TaggedValue selector, TaggedValue arguments,
+                            TaggedValue priority) {
+    if (ClassTable::classIndexOf(selector) != vm_.kernel().symbol ||
+        ClassTable::classIndexOf(arguments) != vm_.kernel().array || !priority.isSmallInteger() ||
+        priority.toSmallInteger() < LOWEST_PRIORITY || priority.toSmallInteger() > HIGHEST_PRIORITY) {
+        return TaggedValue::nil();
+    }
+    uint32_t argCount = ObjectHeader::fromTaggedValue(arguments)->size();
+    if (argCount + 1 > PROCESS_STACK_SLOTS) {
+        return TaggedValue::nil();
+    }
+
+    std::vector<TaggedValue> operands = {receiver, selector, arguments};
+    MemoryManager::ScopedRoots roots(vm_.memory(), operands);
+    ObjectHeader* process = vm_.memory().allocateSlots(ObjectHeader::TYPE_OBJECT, ProcessSlots::COUNT,
+                                                       vm_.kernel().process);
+    uint32_t index = newRecord(process->toTaggedValue(), priority.toSmallInteger());
+
+    Record& record = records_[index];
+    if (stackPool_.empty()) {
+        record.stack.slots.reset(new TaggedValue[PROCESS_STACK_SLOTS]);
+    } else {
+        record.stack.slots = std::move(stackPool_.back());
+        stackPool_.pop_back();
+    }
+    record.stack.capacity = PROCESS_STACK_SLOTS;
+    record.stack.slots[0] = operands[0];
+    const TaggedValue* elements = ObjectHeader::fromTaggedValue(operands[2])->slots();
+    std::copy(elements, elements + argCount, &record.stack.slots[1]);
+    record.stack.sp = argCount + 1;
+    record.startSelector = operands[1];
+    record.startArgCount = argCount;
+    makeReady(index);
+    return record.process;
+}
+
+bool Scheduler::resume(TaggedValue process) {
+    uint32_t index;
+    Record* record = recordOf(process, index);
+    if (record == nullptr || record->state != SUSPENDED) {
+        return false;
+    }
+    makeReady(index);
+    return true;
+}
+
+bool Scheduler::suspend(TaggedValue process) {
+    uint32_t index;
+    Record* record = recordOf(process, index);
+    if (record == nullptr) {
+        return false;
+    }
+    switch (record->state) {
+    case RUNNING:
+        interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+        break;
+    case READY:
+        removeReady(index);
+        break;
+    case WAITING:
+        removeWaiter(process);
+        break;
+    case SUSPENDED:
+        break;
+    default:  // The idle caller, or terminating
+        return false;
+    }
+    record->state = SUSPENDED;
+    return true;
+}
+
+bool Scheduler::terminate(TaggedValue process) {
+    uint32_t index;
+    Record* record = recordOf(process, index);
+    if (record == nullptr || index == CALLER) {
+        return false;
+    }
+    switch (record->state) {
+    case RUNNING:
+        terminateActive();
+        return true;
+    case READY:
+        removeReady(index);
+        break;
+    case WAITING:
+        removeWaiter(process);
+        break;
+    default:
+        break;
+    }
+    if (record->state != TERMINATED) {
+        release(index);
+    }
+    return true;
+}
+
+bool Scheduler::setPriority(TaggedValue process, TaggedValue priority) {
+    if (ClassTable::classIndexOf(process) != vm_.kernel().process || !priority.isSmallInteger() ||
+        priority.toSmallInteger() < LOWEST_PRIORITY || priority.toSmallInteger() > HIGHEST_PRIORITY) {
+        return false;
+    }
+    uint32_t index;
+    Record* record = recordOf(process, index);
+    if (record == nullptr) {
+        // A terminated Process just keeps the new priority; any other stackIndex is corrupt
+        if (!st::mirrorOf<st::Process>(process)->stackIndex().isNil()) {
+            return false;
+        }
+        vm_.memory().storePointer(ObjectHeader::fromTaggedValue(process), ProcessSlots::PRIORITY, priority);
+        return true;
+    }
+    vm_.memory().storePointer(ObjectHeader::fromTaggedValue(process), ProcessSlots::PRIORITY, priority);
+    bool ready = record->state == READY;
+    if (ready) {
+        removeReady(index);
+    }
+    record->priority = priority.toSmallInteger();
+    if (ready) {
+        enqueue(index, false);
+    }
+    interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+    return true;
+}
+
+void Scheduler::yield() {
+    Record& current = records_[active_];
+    if (!ready_[current.priority].empty()) {
+        enqueue(active_, false);
+        interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+    }
+}
+
+bool Scheduler::signal(TaggedValue semaphore) {
+    if (!isSemaphore(semaphore)) {
+        return false;
+    }
+    TaggedValue waiter = st::mirrorOf<st::Semaphore>(semaphore)->firstLink();
+    uint32_t index;
+    if (!waiter.isNil() && recordOf(waiter, index) == nullptr) {
+        return false;
+    }
+    removeFirstWaiter(semaphore);
+    if (waiter.isNil()) {
+        int64_t excess = st::mirrorOf<st::Semaphore>(semaphore)->excessSignals();
+        vm_.memory().storePointer(ObjectHeader::fromTaggedValue(semaphore), SemaphoreSlots::EXCESS_SIGNALS,
+                                  TaggedValue::fromSmallInteger(excess + 1));
+        return true;
+    }
+    makeReady(index);
+    return true;
+}
+
+bool Scheduler::wait(TaggedValue semaphore) {
+    if (!isSemaphore(semaphore)) {
+        return false;
+    }
+    int64_t excess = st::mirrorOf<st::Semaphore>(semaphore)->excessSignals();
+    if (excess > 0) {
+        vm_.memory().storePointer(ObjectHeader::fromTaggedValue(semaphore), SemaphoreSlots::EXCESS_SIGNALS,
+                                  TaggedValue::fromSmallInteger(excess - 1));
+        return true;
+    }
+    appendWaiter(semaphore, records_[active_].process);
+    records_[active_].state = WAITING;
+    interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+    return true;
+}
+
+// ============================================================================
+// Preemption
+// ============================================================================
+
+void Scheduler::startPreemption(std::chrono::microseconds quantum) {
+    stopPreemption();
+    tickerStopping_ = false;
+    ticker_ = std::thread([this, quantum]() {
+        std::unique_lock<std::mutex> lock(tickerMutex_);
+        while (!tickerWakeup_.wait_for(lock, quantum, [this]() { return tickerStopping_; })) {
+            interpreter_.requestInterrupt(Interpreter::PREEMPT_INTERRUPT);
+        }
+    });
+}
+
+void Scheduler::stopPreemption() {
+    if (!ticker_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(tickerMutex_);
+        tickerStopping_ = true;
+    }
+    tickerWakeup_.notify_all();
+    ticker_.join();
+}
+
+// ============================================================================
+// Switching
+// ============================================================================
+
+Scheduler::Switch Scheduler::reschedule(bool preempt) {
+    Record& current = records_[active_];
+    if (waitingForIO() && (preempt || current.state != RUNNING)) {
+        io_->poll(false);
+    }
+    if (current.state == RUNNING) {
+        if (readyMask_ == 0) {
+            return Switch();
+        }
+        int64_t best = highestReady();
+        if (best < current.priority || (best == current.priority && !preempt)) {
+            return Switch();
+        }
+        // Preempted by a higher priority, it keeps its place at the head of its queue
+        enqueue(active_, best > current.priority);
+    }
+
+    // Nothing else to run, but a descriptor will wake someone: sleep in epoll_wait
+    while (readyMask_ == 0 && waitingForIO()) {
+        Safepoints::Blocked blocked(interpreter_);
+        io_->poll(true);
+    }
+    if (readyMask_ != 0) {
+        return switchTo(dequeueHighest());
+    }
+    if (records_[CALLER].state == IDLE) {
+        return switchTo(CALLER);
+    }
+    throw std::runtime_error("Deadlock: every Process is waiting or suspended");
+}
+
+Scheduler::Switch Scheduler::switchTo(uint32_t index) {
+    Record& next = records_[index];
+    if (index != active_) {
+        Record& previous = records_[active_];
+        interpreter_.swapStack(previous.stack);
+        interpreter_.swapStack(next.stack);
+        if (Profiler* profiler = interpreter_.profiler()) {
+            profiler->swapActivations(previous.activations);
+            profiler->swapActivations(next.activations);
+        }
+        if (previous.state == TERMINATED) {
+            release(active_);
+        }
+        active_ = index;
+        switches_++;
+    }
+    next.state = RUNNING;
+
+    Switch result;
+    if (!next.startSelector.isNil()) {
+        result.start = true;
+        result.selector = next.startSelector;
+        result.argCount = next.startArgCount;
+        next.startSelector = TaggedValue::nil();
+    }
+    return result;
+}
+
+void Scheduler::terminateActive() {
+    records_[active_].state = TERMINATED;
+    interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+}
+
+bool Scheduler::idleUntilQuiet() {
+    if (readyMask_ == 0 && !waitingForIO()) {
+        return false;
+    }
+    records_[CALLER].state = IDLE;
+    interpreter_.requestInterrupt(Interpreter::RESCHEDULE_INTERRUPT);
+    return true;
+}
+
+void Scheduler::returnToCaller() {
+    if (active_ != CALLER) {
+        // A Process that failed to reschedule (a deadlock) keeps waiting; one that raised the error ends
+        if (records_[active_].state == RUNNING) {
+            records_[active_].state = TERMINATED;
+        }
+        switchTo(CALLER);
+    }
+    Record& caller = records_[CALLER];
+    if (caller.state == WAITING) {
+        removeWaiter(caller.process);
+    } else if (caller.state == READY) {
+        removeReady(CALLER);
+    }
+    caller.state = RUNNING;
+}
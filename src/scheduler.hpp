@@ -0,0 +1,157 @@
+#pragma once
+
+#include "interpreter.hpp"
+#include "io_loop.hpp"
+#include "profiler.hpp"
+#include "tagged_value.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class VM;
+
+/**
+ * Scheduler - green-thread Processes and Semaphores for one Interpreter
+ *
+ * A Process is a Smalltalk object (see st::Process) plus a record here holding its
+ * parked Interpreter::Stack. No Context is reified: switching Process swaps the
+ * interpreter's value stack and frames with the record's. New stacks start at
+ * PROCESS_STACK_SLOTS and grow on demand, and the stacks of terminated Processes are
+ * reused, so forking thousands of Processes is cheap.
+ *
+ * Scheduling is by strict priority, round robin within a priority. The highest-priority
+ * ready Process runs until it waits, suspends, yields or terminates, or until a Process
+ * of higher priority becomes ready: Semaphore>>signal and Process>>resume preempt at the
+ * interpreter's next poll. With startPreemption() a timer thread also interrupts the
+ * interpreter every quantum, which moves the active Process behind the others of its
+ * priority. Each priority has a FIFO of record indices, and a bitmask marks the
+ * non-empty ones.
+ *
+ * Record 0 is the caller's Process, the one C++ code runs in: Interpreter::send()
+ * returns when that Process's send does. runProcesses() idles it, below every priority,
+ * until no other Process is ready. If it waits and nothing else can run, the deadlock
+ * is thrown as std::runtime_error. Suspended Processes stay alive until terminated.
+ *
+ * Processes waiting for a file or socket wait on a Semaphore the IOLoop signals. The
+ * loop is polled whenever the active Process stops running or is preempted; when no
+ * Process is ready but some wait for I/O, reschedule() blocks in the loop instead of
+ * idling or deadlocking, so runProcesses() returns once nothing is ready or waiting
+ * for I/O.
+ */
+class Scheduler {
+public:
+    static constexpr int64_t LOWEST_PRIORITY = 1;
+    static constexpr int64_t USER_PRIORITY = 4;
+    static constexpr int64_t HIGHEST_PRIORITY = 8;
+    static constexpr size_t PROCESS_STACK_SLOTS = 2 * Interpreter::OPERAND_HEADROOM;
+    static constexpr std::chrono::microseconds DEFAULT_QUANTUM{10000};
+
+    // What the interpreter must do after reschedule() switched stacks
+    struct Switch {
+        bool start = false;  // A new Process: send selector to the receiver and arguments on its stack
+        TaggedValue selector;
+        uint32_t argCount = 0;
+    };
+
+    Scheduler(VM& vm, Interpreter& interpreter);
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Primitives 85-93. Operands of the wrong kind answer false (nil for fork), and the
+    // primitive fails. Switches they cause happen at the interpreter's next poll.
+    // A ready Process that sends selector to receiver with the elements of arguments
+    TaggedValue fork(TaggedValue receiver, TaggedValue selector, TaggedValue arguments, TaggedValue priority);
+    TaggedValue activeProcess() const { return records_[active_].process; }
+    bool resume(TaggedValue process);
+    bool suspend(TaggedValue process);
+    bool terminate(TaggedValue process);  // Not the caller's Process
+    bool setPriority(TaggedValue process, TaggedValue priority);
+    void yield();
+    bool signal(TaggedValue semaphore);
+    bool wait(TaggedValue semaphore);
+
+    // Time slicing among Processes of equal priority
+    void startPreemption(std::chrono::microseconds quantum = DEFAULT_QUANTUM);
+    void stopPreemption();
+    bool preempting() const { return ticker_.joinable(); }
+
+    size_t processCount() const { return records_.size() - freeRecords_.size(); }  // Including the caller's
+    size_t readyCount() const;
+    uint64_t switches() const { return switches_; }
+
+    // Files and sockets, created on first use
+    IOLoop& io();
+    bool hasIO() const { return io_ != nullptr; }
+
+    // Interpreter hooks. reschedule() swaps in the Process to run next (possibly the
+    // active one); preempt is set when the timer interrupted.
+    Switch reschedule(bool preempt);
+    void terminateActive();
+    bool inCaller() const { return active_ == CALLER; }
+    // Idles the caller's Process if another one is ready; answers whether it did
+    bool idleUntilQuiet();
+    // After an error: terminates the Process it came from, unless that is the caller's,
+    // and makes the caller's Process active and running again
+    void returnToCaller();
+
+private:
+    static constexpr uint32_t CALLER = 0;
+    static constexpr size_t STACK_POOL_SIZE = 64;
+
+    enum State : uint8_t { FREE, RUNNING, READY, WAITING, SUSPENDED, IDLE, TERMINATED };
+
+    struct Record {
+        TaggedValue process;
+        Interpreter::Stack stack;  // Empty while the Process is active
+        std::vector<Profiler::Activation> activations;
+        TaggedValue startSelector;  // Until the Process first runs
+        uint32_t startArgCount = 0;
+        int64_t priority = USER_PRIORITY;
+        State state = FREE;
+    };
+
+    // Record of a Process object; CALLER is never answered for non-Processes
+    Record* recordOf(TaggedValue process, uint32_t& index);
+    bool isSemaphore(TaggedValue value) const;
+    uint32_t newRecord(TaggedValue process, int64_t priority);
+    void release(uint32_t index);
+
+    void enqueue(uint32_t index, bool front);
+    uint32_t dequeueHighest();
+    void removeReady(uint32_t index);
+    int64_t highestReady() const { return 31 - __builtin_clz(readyMask_); }  // readyMask_ != 0
+    void makeReady(uint32_t index);
+
+    void appendWaiter(TaggedValue semaphore, TaggedValue process);
+    TaggedValue removeFirstWaiter(TaggedValue semaphore);
+    void removeWaiter(TaggedValue process);
+
+    Switch switchTo(uint32_t index);
+    bool waitingForIO() const { return io_ != nullptr && io_->waiting() != 0; }
+
+    VM& vm_;
+    Interpreter& interpreter_;
+    std::vector<Record> records_;
+    std::vector<uint32_t> freeRecords_;
+    std::vector<std::unique_ptr<TaggedValue[]>> stackPool_;
+    std::array<std::deque<uint32_t>, HIGHEST_PRIORITY + 1> ready_;
+    uint32_t readyMask_;
+    uint32_t active_;
+    uint64_t switches_;
+    size_t rootProvider_;
+    std::unique_ptr<IOLoop> io_;
+
+    std::thread ticker_;
+    std::mutex tickerMutex_;
+    std::condition_variable tickerWakeup_;
+    bool tickerStopping_;
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "object_header.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LO_SWISS_TABLE_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * Swiss table probing - shared by the Dictionary tables in object memory
+ * (dictionary_table.hpp) and the runtime::BasicDictionary backing stores
+ *
+ * A table has a power-of-two capacity of at least GROUP_WIDTH slots and one control
+ * byte per slot: the low 7 bits of the key's hash (H2) when the slot is full, EMPTY or
+ * DELETED otherwise. A probe starts at the group of GROUP_WIDTH slots picked by the
+ * rest of the hash (H1) and compares all of the group's control bytes with H2 at once,
+ * with SSE2 (or, without it, 8 bytes at a time in a 64-bit word), so only slots whose
+ * byte matches have their key compared. Groups are visited in triangular order, which
+ * reaches every group of a power-of-two table.
+ *
+ * Hashes never depend on addresses (see IdentityKeys), so a table caches them and
+ * growth never hashes a key again. Everything here is inline: a lookup compiles into
+ * one loop with its hash and key compares.
+ */
+namespace swiss_table {
+
+// Control bytes: 0..127 is the H2 of a full slot. Empty and deleted have the high bit
+// set so they never match an H2.
+constexpr int8_t EMPTY = static_cast<int8_t>(0x80);
+constexpr int8_t DELETED = static_cast<int8_t>(0xFE);
+
+inline uint32_t lowestBitIndex(uint64_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+}
+
+#if defined(LO_SWISS_TABLE_SSE2)
+
+// One bit per control byte
+constexpr size_t GROUP_WIDTH = 16;
+constexpr uint32_t MASK_SHIFT = 0;
+
+class Group {
+public:
+    explicit Group(const int8_t* ctrl) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    uint64_t match(int8_t h2) const {
+        return static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+    }
+
+    uint64_t matchEmpty() const { return match(EMPTY); }
+
+private:
+    __m128i ctrl_;
+};
+
+#else
+
+// The high bit of each control byte's lane is set
+constexpr size_t GROUP_WIDTH = 8;
+constexpr uint32_t MASK_SHIFT = 3;
+
+class Group {
+public:
+    explicit Group(const int8_t* ctrl) { std::memcpy(&ctrl_, ctrl, sizeof(ctrl_)); }
+
+    // May report false positives; callers always confirm with a key compare
+    uint64_t match(int8_t h2) const {
+        uint64_t x = ctrl_ ^ (LSBS * static_cast<uint8_t>(h2));
+        return (x - LSBS) & ~x & MSBS;
+    }
+
+    // Exact: only EMPTY has the high bit set and bit 1 clear
+    uint64_t matchEmpty() const { return ctrl_ & ~(ctrl_ << 6) & MSBS; }
+
+private:
+    static constexpr uint64_t LSBS = 0x0101010101010101ULL;
+    static constexpr uint64_t MSBS = 0x8080808080808080ULL;
+    uint64_t ctrl_;
+};
+
+#endif
+
+inline size_t h1(uint64_t hash) {
+    return static_cast<size_t>(hash >> 7);
+}
+
+inline int8_t h2(uint64_t hash) {
+    return static_cast<int8_t>(hash & 0x7F);
+}
+
+// Slot at which the first group of hash's probe sequence starts
+inline size_t probeStart(uint64_t hash, size_t capacity) {
+    return (h1(hash) & (capacity / GROUP_WIDTH - 1)) * GROUP_WIDTH;
+}
+
+// Starts loading the cache line at address without waiting for it
+inline void prefetch(const void* address) {
+#if defined(LO_SWISS_TABLE_SSE2)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+// Fibonacci multiply, then fold the well-mixed high half into the low bits H2 and H1
+// are taken from
+inline uint64_t mix(uint64_t x) {
+    x *= 0x9E3779B97F4A7C15ULL;
+    return x ^ (x >> 32);
+}
+
+/**
+ * Key policies.
+ *
+ * IdentityKeys compares keys with == on the raw TaggedValue (IdentityDictionary).
+ * EqualityKeys compares keys by value (Dictionary): byte-array keys (String, ByteArray,
+ * boxed Float) of the same class compare by contents, every other key by identity.
+ *
+ * Pointer keys must be object-memory objects. Their hash comes from the identity hash
+ * in the ObjectHeader (or from the contents of a byte array), never from the address,
+ * so cached hashes stay valid when the collector moves the keys.
+ */
+struct IdentityKeys {
+    static uint64_t hash(TaggedValue key) {
+        return mix(key.isPointer() ? ObjectHeader::fromTaggedValue(key)->identityHash() : key.value());
+    }
+    static bool equal(TaggedValue a, TaggedValue b) { return a == b; }
+};
+
+struct EqualityKeys {
+    static uint64_t hash(TaggedValue key) {
+        if (!isBytes(key)) {
+            return IdentityKeys::hash(key);
+        }
+        // FNV-1a over the contents
+        const ObjectHeader* object = ObjectHeader::fromTaggedValue(key);
+        uint64_t h = 0xCBF29CE484222325ULL;
+        const uint8_t* bytes = object->bytes();
+        for (uint32_t i = 0; i < object->size(); i++) {
+            h = (h ^ bytes[i]) * 0x100000001B3ULL;
+        }
+        return mix(h);
+    }
+
+    static bool equal(TaggedValue a, TaggedValue b) {
+        if (a == b) {
+            return true;
+        }
+        // A String and a ByteArray with the same bytes are different keys
+        if (!isBytes(a) || !isBytes(b)) {
+            return false;
+        }
+        const ObjectHeader* x = ObjectHeader::fromTaggedValue(a);
+        const ObjectHeader* y = ObjectHeader::fromTaggedValue(b);
+        return x->classIndex() == y->classIndex() && x->size() == y->size() &&
+               std::memcmp(x->bytes(), y->bytes(), x->size()) == 0;
+    }
+
+private:
+    static bool isBytes(TaggedValue key) {
+        return key.isPointer() && ObjectHeader::fromTaggedValue(key)->type() == ObjectHeader::TYPE_BYTE_ARRAY;
+    }
+};
+
+// Index of the slot holding key, or capacity if there is none. keyAt(index) answers
+// the key in a slot whose control byte is full.
+template <typename Keys, typename KeyAt>
+inline size_t find(const int8_t* ctrl, size_t capacity, TaggedValue key, uint64_t hash, const KeyAt& keyAt) {
+    size_t groupMask = capacity / GROUP_WIDTH - 1;
+    size_t group = h1(hash) & groupMask;
+    for (size_t probe = 1; probe <= groupMask + 1; probe++) {
+        size_t base = group * GROUP_WIDTH;
+        Group g(ctrl + base);
+        for (uint64_t m = g.match(h2(hash)); m != 0; m &= m - 1) {
+            size_t index = base + (lowestBitIndex(m) >> MASK_SHIFT);
+            if (Keys::equal(keyAt(index), key)) {
+                return index;
+            }
+        }
+        if (g.matchEmpty() != 0) {
+            return capacity;
+        }
+        group = (group + probe) & groupMask;
+    }
+    return capacity;
+}
+
+// Claims the first empty slot on hash's probe sequence for a key known to be absent:
+// sets its control byte and answers its index. Tables stay below 7/8 load, so there
+// always is one.
+inline size_t insertAbsent(int8_t* ctrl, size_t capacity, uint64_t hash) {
+    size_t groupMask = capacity / GROUP_WIDTH - 1;
+    size_t group = h1(hash) & groupMask;
+    for (size_t probe = 1; probe <= groupMask + 1; probe++) {
+        size_t base = group * GROUP_WIDTH;
+        uint64_t empty = Group(ctrl + base).matchEmpty();
+        if (empty != 0) {
+            size_t index = base + (lowestBitIndex(empty) >> MASK_SHIFT);
+            ctrl[index] = h2(hash);
+            return index;
+        }
+        group = (group + probe) & groupMask;
+    }
+    throw std::runtime_error("Dictionary table full");
+}
+
+// Entries a table of capacity slots takes before it must grow
+inline size_t growthLimit(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+} // namespace swiss_table
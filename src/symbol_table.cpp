@@ -0,0 +1,58 @@
+#include "symbol_table.hpp"
+#include <cstring>
+#include <stdexcept>
+
+SymbolTable::SymbolTable(MemoryManager& memory, uint32_t symbolClassIndex,
+                         const std::unordered_map<std::string, TaggedValue>* shared)
+    : memory_(memory), symbolClassIndex_(symbolClassIndex), shared_(shared) {
+    rootProvider_ = memory_.addRootProvider([this](const MemoryManager::RootVisitor& visit) {
+        for (auto& entry : symbols_) {
+            visit(entry.second);
+        }
+    });
+}
+
+SymbolTable::~SymbolTable() {
+    memory_.removeRootProvider(rootProvider_);
+}
+
+TaggedValue SymbolTable::intern(std::string_view name) {
+    // Copy first: name may point into a heap object that the allocation below moves.
+    std::string key(name);
+    if (shared_ != nullptr) {
+        auto found = shared_->find(key);
+        if (found != shared_->end()) {
+            return found->second;
+        }
+    }
+    auto it = symbols_.find(key);
+    if (it != symbols_.end()) {
+        return it->second;
+    }
+    ObjectHeader* symbol = memory_.allocateBytes(ObjectHeader::TYPE_SYMBOL,
+                                                 static_cast<uint32_t>(key.size()),
+                                                 symbolClassIndex_);
+    std::memcpy(symbol->bytes(), key.data(), key.size());
+    TaggedValue value = symbol->toTaggedValue();
+    symbols_.emplace(std::move(key), value);
+    return value;
+}
+
+void SymbolTable::forEach(const std::function<void(const std::string&, TaggedValue)>& visit) const {
+    if (shared_ != nullptr) {
+        for (const auto& entry : *shared_) {
+            visit(entry.first, entry.second);
+        }
+    }
+    for (const auto& entry : symbols_) {
+        visit(entry.first, entry.second);
+    }
+}
+
+std::string_view SymbolTable::nameOf(TaggedValue symbol) {
+    if (!symbol.isPointer() || !ObjectHeader::fromTaggedValue(symbol)->isBytes()) {
+        throw std::invalid_argument("Not a byte object");
+    }
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(symbol);
+    return std::string_view(reinterpret_cast<const char*>(object->bytes()), object->size());
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "memory_manager.hpp"
+#include "tagged_value.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * SymbolTable - interns Symbols so equal names are the identical object
+ *
+ * Symbols are ordinary byte objects (TYPE_SYMBOL) in object memory; the table keeps a
+ * name -> Symbol map and registers it as a root provider, so interned Symbols are never
+ * collected and the map follows them when they move.
+ *
+ * A table can start from the Symbols of an ImageSegment. Those are found first and
+ * never move, so they are neither copied nor visited.
+ */
+class SymbolTable {
+public:
+    SymbolTable(MemoryManager& memory, uint32_t symbolClassIndex,
+                const std::unordered_map<std::string, TaggedValue>* shared = nullptr);
+    ~SymbolTable();
+
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // The unique Symbol named name, created on first use
+    TaggedValue intern(std::string_view name);
+
+    // Contents of any byte object (Symbol, String, ByteArray)
+    static std::string_view nameOf(TaggedValue symbol);
+
+    size_t size() const { return symbols_.size() + (shared_ != nullptr ? shared_->size() : 0); }
+    void forEach(const std::function<void(const std::string&, TaggedValue)>& visit) const;
+
+private:
+    MemoryManager& memory_;
+    uint32_t symbolClassIndex_;
+    const std::unordered_map<std::string, TaggedValue>* shared_;
+    std::unordered_map<std::string, TaggedValue> symbols_;
+    size_t rootProvider_;
+};
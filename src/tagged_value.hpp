@@ -8,8 +8,8 @@
  * 
  * Uses 2-bit tagging scheme:
  * - 00: Pointer (heap-allocated object)
- * - 01: Special (nil, true, false)
- * - 10: Float (simplified, limited support)
+ * - 01: Special (nil, true, false, and the interpreter's stack blocks)
+ * - 10: Float (a double of moderate magnitude, exactly; VM::newFloat boxes the rest)
  * - 11: SmallInteger (31-bit signed integer)
  */
 class TaggedValue {
@@ -36,6 +36,7 @@ public:
     bool isPointer() const { return (value_ & TAG_MASK) == TAG_POINTER; }
     bool isSmallInteger() const { return (value_ & TAG_MASK) == TAG_INTEGER; }
     bool isSpecial() const { return (value_ & TAG_MASK) == TAG_SPECIAL; }
+    bool isFloat() const { return (value_ & TAG_MASK) == TAG_FLOAT; }
     bool isNil() const { return value_ == NIL; }
     bool isTrue() const { return value_ == TRUE; }
     bool isFalse() const { return value_ == FALSE; }
@@ -43,16 +44,34 @@ public:
     
     // Encoding/decoding
     // SmallInteger uses 63-bit signed integers (64-bit TaggedValue with 2-bit tag = 62 bits value = 63-bit signed)
-    static TaggedValue fromSmallInteger(int64_t n);
-    int64_t toSmallInteger() const;
+    // The low 62 bits of n go above the tag; decoding sign-extends them. toSmallInteger
+    // answers 0 for anything but a SmallInteger.
+    static TaggedValue fromSmallInteger(int64_t n) {
+        return TaggedValue((static_cast<Value>(n) << 2) | TAG_INTEGER);
+    }
+    int64_t toSmallInteger() const { return isSmallInteger() ? static_cast<int64_t>(value_) >> 2 : 0; }
     
-    static TaggedValue fromPointer(void* ptr);
-    void* toPointer() const;
+    // Pointers are at least 4-byte aligned, so the tag bits of a pointer are 00;
+    // fromPointer answers nil for a misaligned one and toPointer nullptr for a non-pointer
+    static TaggedValue fromPointer(void* ptr) {
+        Value bits = static_cast<Value>(reinterpret_cast<uintptr_t>(ptr));
+        return TaggedValue((bits & TAG_MASK) == TAG_POINTER ? bits : NIL);
+    }
+    void* toPointer() const {
+        return isPointer() ? reinterpret_cast<void*>(static_cast<uintptr_t>(value_)) : nullptr;
+    }
+
+    // Immediate Floats are exact: [exponent:9][mantissa:52][sign:1][tag:2], the 11-bit
+    // IEEE exponent rebased to 9 bits. That holds zero and magnitudes from 2^-255 to just
+    // under 2^256; fromFloat() is only for doubles isImmediateFloat() accepts.
+    static bool isImmediateFloat(double d);
+    static TaggedValue fromFloat(double d);
+    double toFloat() const;
     
     // Special values
-    static TaggedValue nil();
-    static TaggedValue trueValue();
-    static TaggedValue falseValue();
+    static TaggedValue nil() { return TaggedValue(NIL); }
+    static TaggedValue trueValue() { return TaggedValue(TRUE); }
+    static TaggedValue falseValue() { return TaggedValue(FALSE); }
     
     // Access
     Value value() const { return value_; }
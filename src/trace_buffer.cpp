@@ -0,0 +1,241 @@
+#include "trace_buffer.hpp"
+#include "bytecode.hpp"
+#include "classes/compiled_method.hpp"
+#include "symbol_table.hpp"
+#include "vm.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+volatile sig_atomic_t TraceBuffer::dumpRequests_ = 0;
+std::atomic<TraceBuffer*> TraceBuffer::live_[MAX_LIVE_BUFFERS];
+
+TraceBuffer::TraceBuffer(size_t capacity)
+    : recorded_(0), dumpsSeen_(dumpRequests_), output_(&std::cerr), dumpOnError_(true) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    entries_.reset(new Entry[rounded]);
+    mask_ = rounded - 1;
+
+    // Register for crash dumps; a full table only means no crash dump for this buffer.
+    for (auto& slot : live_) {
+        TraceBuffer* expected = nullptr;
+        if (slot.compare_exchange_strong(expected, this)) {
+            break;
+        }
+    }
+}
+
+TraceBuffer::~TraceBuffer() {
+    for (auto& slot : live_) {
+        TraceBuffer* expected = this;
+        if (slot.compare_exchange_strong(expected, nullptr)) {
+            break;
+        }
+    }
+}
+
+size_t TraceBuffer::size() const {
+    uint64_t count = recorded();
+    return count < capacity() ? static_cast<size_t>(count) : capacity();
+}
+
+const TraceBuffer::Entry& TraceBuffer::at(size_t index) const {
+    uint64_t first = recorded() - size();
+    return entries_[(first + index) & mask_];
+}
+
+void TraceBuffer::visitRoots(const MemoryManager::RootVisitor& visit) {
+    for (size_t i = 0; i < size(); i++) {
+        Entry& entry = const_cast<Entry&>(at(i));
+        visit(entry.method);
+        visit(entry.value);
+    }
+}
+
+// ============================================================================
+// Decoder
+// ============================================================================
+
+namespace {
+
+// Operands of the instruction at ip, resolved against the method's literals
+std::string describeOperands(VM& vm, TaggedValue method, uint32_t ip) {
+    st::CompiledMethod* mirror = st::mirrorOf<st::CompiledMethod>(method);
+    ObjectHeader* bytes = ObjectHeader::fromTaggedValue(mirror->getBytes());
+    uint8_t opcode = bytes->bytes()[ip];
+    if (ip + bytecode::instructionLength(opcode) > bytes->size()) {
+        return "<truncated>";
+    }
+    const uint8_t* operands = bytes->bytes() + ip + 1;
+    const TaggedValue* literals = ObjectHeader::fromTaggedValue(mirror->getLiterals())->slots();
+
+    switch (opcode) {
+    case bytecode::PUSH_LITERAL:
+        return vm.printString(literals[bytecode::readOperand(operands)]);
+    case bytecode::PUSH_INSTANCE_VARIABLE:
+    case bytecode::STORE_INSTANCE_VARIABLE: {
+        uint32_t index = bytecode::readOperand(operands);
+        TaggedValue methodClass = mirror->getMethodClass();
+        if (!methodClass.isNil()) {
+            const auto& names = vm.instanceVariableNames(ClassTable::indexOfClass(methodClass));
+            if (index < names.size()) {
+                return names[index];
+            }
+        }
+        return "ivar " + std::to_string(index);
+    }
+    case bytecode::PUSH_TEMPORARY_VARIABLE:
+    case bytecode::STORE_TEMPORARY_VARIABLE:
+    case bytecode::PUSH_ESCAPING_TEMPORARY:
+        return "temp " + std::to_string(bytecode::readOperand(operands));
+    case bytecode::PUSH_REMOTE_TEMPORARY:
+    case bytecode::STORE_REMOTE_TEMPORARY:
+        return "temp " + std::to_string(bytecode::readOperand(operands)) + " in vector " +
+               std::to_string(bytecode::readOperand(operands + 4));
+    case bytecode::CREATE_BLOCK: {
+        uint32_t slot = bytecode::readOperand(operands + 8);
+        return vm.printString(literals[bytecode::readOperand(operands)]) + " (" +
+               std::to_string(bytecode::readOperand(operands + 4)) + " copied" +
+               (slot == bytecode::NO_SLOT ? ")" : ", in temp " + std::to_string(slot) + ")");
+    }
+    case bytecode::SEND_MESSAGE:
+    case bytecode::EXECUTE_BLOCK:
+        return vm.printString(literals[bytecode::readOperand(operands)]) + " (" +
+               std::to_string(bytecode::readOperand(operands + 4)) + " args)";
+    case bytecode::JUMP:
+    case bytecode::JUMP_IF_TRUE:
+    case bytecode::JUMP_IF_FALSE:
+        return "-> " + std::to_string(bytecode::readOperand(operands));
+    default:
+        return "";
+    }
+}
+
+} // namespace
+
+void TraceBuffer::write(std::ostream& out, VM& vm, size_t maxEntries) const {
+    size_t count = std::min(size(), maxEntries);
+    out << "Trace: last " << count << " of " << recorded() << " events, oldest first\n";
+
+    char line[512];
+    for (size_t i = size() - count; i < size(); i++) {
+        const Entry& entry = at(i);
+        switch (entry.kind) {
+        case INSTRUCTION: {
+            std::string method = st::mirrorOf<st::CompiledMethod>(entry.method)->qualifiedName();
+            std::string operands = describeOperands(vm, entry.method, entry.ip);
+            std::snprintf(line, sizeof(line), "  %-32s %5u  %-24s %-24s top: %s\n", method.c_str(), entry.ip,
+                          bytecode::opcodeName(entry.opcode), operands.c_str(),
+                          vm.printString(entry.value).c_str());
+            break;
+        }
+        case SEND: {
+            st::CompiledMethod* method = st::mirrorOf<st::CompiledMethod>(entry.method);
+            std::snprintf(line, sizeof(line), "  send %s to %s -> %s\n",
+                          vm.printString(method->getSelector()).c_str(), vm.printString(entry.value).c_str(),
+                          method->qualifiedName().c_str());
+            break;
+        }
+        case DOES_NOT_UNDERSTAND:
+            std::snprintf(line, sizeof(line), "  send %s to %s -> doesNotUnderstand:\n",
+                          vm.printString(entry.method).c_str(), vm.printString(entry.value).c_str());
+            break;
+        }
+        out << line;
+    }
+    out.flush();
+}
+
+// ============================================================================
+// Signals
+// ============================================================================
+
+void TraceBuffer::handleDumpSignal(int) {
+    dumpRequests_ = dumpRequests_ + 1;
+}
+
+void TraceBuffer::installDumpSignal(int signal) {
+    struct sigaction action = {};
+    action.sa_handler = &TraceBuffer::handleDumpSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(signal, &action, nullptr) != 0) {
+        throw std::runtime_error("Cannot install the trace dump signal handler");
+    }
+}
+
+void TraceBuffer::handleCrash(int signal) {
+    static const char header[] = "\nFatal signal; interpreter traces follow (raw)\n";
+    ssize_t ignored = ::write(STDERR_FILENO, header, sizeof(header) - 1);
+    (void)ignored;
+    for (auto& slot : live_) {
+        if (TraceBuffer* buffer = slot.load()) {
+            buffer->writeRaw(STDERR_FILENO);
+        }
+    }
+    // The handler was installed with SA_RESETHAND: this takes the default action.
+    raise(signal);
+}
+
+void TraceBuffer::installCrashHandler() {
+    struct sigaction action = {};
+    action.sa_handler = &TraceBuffer::handleCrash;
+    action.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    for (int signal : {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT}) {
+        if (sigaction(signal, &action, nullptr) != 0) {
+            throw std::runtime_error("Cannot install the crash handler");
+        }
+    }
+}
+
+namespace {
+
+// snprintf is not async-signal-safe; these append to a fixed buffer instead.
+char* appendText(char* out, const char* text) {
+    while (*text != '\0') {
+        *out++ = *text++;
+    }
+    return out;
+}
+
+char* appendNumber(char* out, uint64_t value, unsigned base) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value != 0);
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+} // namespace
+
+void TraceBuffer::writeRaw(int fd) const {
+    char line[160];
+    uint64_t count = recorded();
+    size_t retained = count < capacity() ? static_cast<size_t>(count) : capacity();
+    for (size_t i = 0; i < retained; i++) {
+        const Entry& entry = entries_[(count - retained + i) & mask_];
+        char* out = line;
+        out = appendText(out, entry.kind == INSTRUCTION ? "  " : entry.kind == SEND ? "  send " : "  dnu ");
+        out = appendText(out, entry.kind == INSTRUCTION ? bytecode::opcodeName(entry.opcode) : "");
+        out = appendText(out, entry.kind == INSTRUCTION ? " ip=" : " args=");
+        out = appendNumber(out, entry.ip, 10);
+        out = appendText(out, " method=0x");
+        out = appendNumber(out, entry.method.value(), 16);
+        out = appendText(out, " value=0x");
+        out = appendNumber(out, entry.value.value(), 16);
+        *out++ = '\n';
+        ssize_t ignored = ::write(fd, line, static_cast<size_t>(out - line));
+        (void)ignored;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "memory_manager.hpp"
+#include "tagged_value.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <signal.h>
+
+class VM;
+
+/**
+ * TraceBuffer - ring of the most recent instructions and sends of one Interpreter
+ *
+ * Each Interpreter, and therefore each interpreter thread, owns at most one (see
+ * Interpreter::startTracing()). While tracing, the dispatch loop records every bytecode
+ * as (method, ip, opcode, top of stack) and every send as (method found, argument
+ * count, receiver). There is a single writer, so recording is a few stores into a
+ * power-of-two array and a counter bump; the oldest entries are overwritten.
+ *
+ * Recorded methods and values are GC roots of the owning interpreter, so write() can
+ * always decode entries symbolically with the method's literals. The price is that
+ * the last capacity() top-of-stack values stay reachable.
+ *
+ * Dumps go to output() (stderr by default):
+ * - when an error escapes the outermost send, unless setDumpOnError(false)
+ * - after installDumpSignal(), every tracing interpreter dumps at its next bytecode
+ *   each time the signal arrives
+ * - on request through Interpreter::dumpTrace()
+ * After installCrashHandler(), a crash writes every live buffer to stderr undecoded,
+ * since nothing else is safe inside the signal handler.
+ */
+class TraceBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    enum Kind : uint8_t { INSTRUCTION, SEND, DOES_NOT_UNDERSTAND };
+
+    struct Entry {
+        TaggedValue method;  // Method executing, method found by a send, or the selector not understood
+        TaggedValue value;   // Top of stack before the instruction, or the receiver of a send
+        uint32_t ip;         // Offset of the instruction, or the argument count of a send
+        uint8_t opcode;
+        Kind kind;
+    };
+
+    // capacity is rounded up to a power of two
+    explicit TraceBuffer(size_t capacity = DEFAULT_CAPACITY);
+    ~TraceBuffer();
+
+    TraceBuffer(const TraceBuffer&) = delete;
+    TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+    void record(Kind kind, TaggedValue method, uint32_t ip, uint8_t opcode, TaggedValue value) {
+        uint64_t position = recorded_.load(std::memory_order_relaxed);
+        Entry& entry = entries_[position & mask_];
+        // Field stores: building a temporary Entry and copying it is measurably slower.
+        entry.method = method;
+        entry.value = value;
+        entry.ip = ip;
+        entry.opcode = opcode;
+        entry.kind = kind;
+        recorded_.store(position + 1, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+    // Entries recorded since construction or clear(), including overwritten ones
+    uint64_t recorded() const { return recorded_.load(std::memory_order_acquire); }
+    size_t size() const;
+    // Entry index of the retained ones, 0 being the oldest
+    const Entry& at(size_t index) const;
+    void clear() { recorded_.store(0, std::memory_order_release); }
+
+    void visitRoots(const MemoryManager::RootVisitor& visit);
+
+    // Decodes the last maxEntries entries, oldest first, one line each
+    void write(std::ostream& out, VM& vm, size_t maxEntries = SIZE_MAX) const;
+
+    std::ostream& output() const { return *output_; }
+    void setOutput(std::ostream& out) { output_ = &out; }
+    bool dumpsOnError() const { return dumpOnError_; }
+    void setDumpOnError(bool dump) { dumpOnError_ = dump; }
+
+    // On-demand dumps. Throws std::runtime_error if the handler cannot be installed.
+    static void installDumpSignal(int signal = SIGUSR2);
+    bool dumpRequested() const { return dumpRequests_ != dumpsSeen_; }
+    void acknowledgeDump() { dumpsSeen_ = dumpRequests_; }
+
+    // Raw dumps of every live buffer on SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT;
+    // the signal is then re-raised with its default action
+    static void installCrashHandler();
+    // Async-signal-safe undecoded dump to a file descriptor
+    void writeRaw(int fd) const;
+
+private:
+    static constexpr size_t MAX_LIVE_BUFFERS = 64;
+
+    static void handleDumpSignal(int);
+    static void handleCrash(int signal);
+
+    static volatile sig_atomic_t dumpRequests_;
+    static std::atomic<TraceBuffer*> live_[MAX_LIVE_BUFFERS];
+
+    std::unique_ptr<Entry[]> entries_;
+    size_t mask_;
+    std::atomic<uint64_t> recorded_;
+    sig_atomic_t dumpsSeen_;
+    std::ostream* output_;
+    bool dumpOnError_;
+};
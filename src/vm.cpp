@@ -0,0 +1,372 @@
+#include "vm.hpp"
+#include "classes/class.hpp"
+#include "classes/compiled_method.hpp"
+#include "compiler.hpp"
+#include "image_segment.hpp"
+#include "safepoint.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+VM::VM(size_t nurseryBytes, size_t oldSpaceBytes) : memory_(nurseryBytes, oldSpaceBytes) {
+    addRootProvider();
+    bootstrap();
+    interpreter_ = std::make_unique<Interpreter>(*this);
+    compileKernel();
+}
+
+VM::VM(std::shared_ptr<const ImageSegment> image, size_t nurseryBytes, size_t oldSpaceBytes)
+    : memory_(nurseryBytes, oldSpaceBytes), image_(std::move(image)) {
+    addRootProvider();
+    classes_.share(image_->classes());
+    kernel_ = image_->kernel();
+    classIndices_ = image_->classIndices();
+    instanceVariableNames_ = image_->instanceVariableNames();
+    symbols_ = std::make_unique<SymbolTable>(memory_, kernel_.symbol, &image_->symbols());
+    interpreter_ = std::make_unique<Interpreter>(*this);
+}
+
+void VM::addRootProvider() {
+    rootProvider_ = memory_.addRootProvider([this](const MemoryManager::RootVisitor& visit) {
+        classes_.visitPointers(visit);
+        for (auto& methods : methodDictionaries_) {
+            methods->visitPointers(visit);
+        }
+        for (auto& methods : ownMethods_) {
+            methods.second->visitPointers(visit);
+        }
+    });
+}
+
+VM::~VM() {
+    memory_.setAllocationHook(nullptr);
+    allocationProfiler_.reset();
+    interpreter_.reset();
+    symbols_.reset();
+    memory_.removeRootProvider(rootProvider_);
+}
+
+// ============================================================================
+// Classes
+// ============================================================================
+
+uint32_t VM::createClass(std::string_view name, uint32_t superclass,
+                         const std::vector<std::string>& instanceVariables,
+                         ObjectHeader::Type instanceType, uint32_t index) {
+    if (classIndices_.count(std::string(name)) != 0) {
+        throw std::invalid_argument("Class already defined: " + std::string(name));
+    }
+    std::vector<std::string> names;
+    if (superclass != ClassTable::INVALID_INDEX) {
+        names = instanceVariableNames_.at(superclass);
+    }
+    names.insert(names.end(), instanceVariables.begin(), instanceVariables.end());
+    bool indexable = instanceType == ObjectHeader::TYPE_ARRAY ||
+                     instanceType == ObjectHeader::TYPE_BYTE_ARRAY ||
+                     instanceType == ObjectHeader::TYPE_SYMBOL;
+    if (indexable && !names.empty()) {
+        throw std::invalid_argument("Indexable class cannot have instance variables: " +
+                                    std::string(name));
+    }
+
+    ObjectHeader* object = memory_.allocateSlots(ObjectHeader::TYPE_CLASS, st::ClassSlots::COUNT,
+                                                 kernel_.classClass);
+    if (index == ClassTable::INVALID_INDEX) {
+        index = classes_.registerClass(object);
+    } else {
+        classes_.registerClassAt(index, object);
+    }
+    methodDictionaries_.push_back(std::make_unique<runtime::IdentityDictionary>());
+    TaggedValue methods = runtime::IdentityDictionary::toTaggedValue(methodDictionaries_.back().get());
+    // The class table keeps the class alive; interning may move it, so fetch it afterwards.
+    TaggedValue nameSymbol = symbols_ ? symbols_->intern(name) : TaggedValue::nil();
+    object = ObjectHeader::fromTaggedValue(classes_.classAt(index));
+
+    memory_.storePointer(object, st::ClassSlots::SUPERCLASS, classes_.classAt(superclass));
+    memory_.storePointer(object, st::ClassSlots::METHODS, methods);
+    memory_.storePointer(object, st::ClassSlots::FORMAT,
+                         st::Class::makeFormat(instanceType, static_cast<uint32_t>(names.size())));
+    memory_.storePointer(object, st::ClassSlots::NAME, nameSymbol);
+
+    classIndices_.emplace(std::string(name), index);
+    if (instanceVariableNames_.size() <= index) {
+        instanceVariableNames_.resize(index + 1);
+    }
+    instanceVariableNames_[index] = std::move(names);
+    return index;
+}
+
+uint32_t VM::defineClass(std::string_view name, std::string_view superclass,
+                         const std::vector<std::string>& instanceVariables) {
+    uint32_t superIndex = classIndexNamed(superclass);
+    if (superIndex == ClassTable::INVALID_INDEX) {
+        throw std::invalid_argument("Unknown superclass: " + std::string(superclass));
+    }
+    ObjectHeader::Type type = st::mirrorOf<st::Class>(classes_.classAt(superIndex))->instanceType();
+    return createClass(name, superIndex, instanceVariables, type);
+}
+
+uint32_t VM::classIndexNamed(std::string_view name) const {
+    auto it = classIndices_.find(std::string(name));
+    return it == classIndices_.end() ? ClassTable::INVALID_INDEX : it->second;
+}
+
+std::string VM::className(uint32_t classIndex) const {
+    TaggedValue cls = classes_.classAt(classIndex);
+    if (cls.isNil() || st::mirrorOf<st::Class>(cls)->name().isNil()) {
+        return "class #" + std::to_string(classIndex);
+    }
+    return std::string(SymbolTable::nameOf(st::mirrorOf<st::Class>(cls)->name()));
+}
+
+const std::vector<std::string>& VM::instanceVariableNames(uint32_t classIndex) const {
+    return instanceVariableNames_.at(classIndex);
+}
+
+// ============================================================================
+// Methods
+// ============================================================================
+
+TaggedValue VM::compile(std::string_view className, std::string_view source) {
+    uint32_t classIndex = classIndexNamed(className);
+    if (classIndex == ClassTable::INVALID_INDEX) {
+        throw std::invalid_argument("Unknown class: " + std::string(className));
+    }
+    Compiler::Result result = Compiler(*this).compile(classIndex, source);
+    installMethod(classIndex, result.selector, result.method);
+    return result.method;
+}
+
+TaggedValue VM::newMethod(const std::vector<uint8_t>& bytecodes, std::vector<TaggedValue> literals,
+                          uint32_t numArgs, uint32_t numTemps, uint32_t primitive,
+                          const std::vector<uint8_t>& handlers) {
+    MemoryManager::ScopedRoots literalRoots(memory_, literals);
+    std::vector<TaggedValue> parts;  // bytes, literal array, handler table
+    MemoryManager::ScopedRoots partRoots(memory_, parts);
+
+    ObjectHeader* bytes = memory_.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY,
+                                                static_cast<uint32_t>(bytecodes.size()),
+                                                kernel_.byteArray);
+    std::memcpy(bytes->bytes(), bytecodes.data(), bytecodes.size());
+    parts.push_back(bytes->toTaggedValue());
+    parts.push_back(newArray(literals));
+    parts.push_back(TaggedValue::nil());
+    if (!handlers.empty()) {
+        ObjectHeader* table = memory_.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY,
+                                                    static_cast<uint32_t>(handlers.size()), kernel_.byteArray);
+        std::memcpy(table->bytes(), handlers.data(), handlers.size());
+        parts[2] = table->toTaggedValue();
+    }
+
+    ObjectHeader* method = memory_.allocateSlots(ObjectHeader::TYPE_METHOD,
+                                                 st::CompiledMethodSlots::COUNT,
+                                                 kernel_.compiledMethod);
+    memory_.storePointer(method, st::CompiledMethodSlots::BYTES, parts[0]);
+    memory_.storePointer(method, st::CompiledMethodSlots::LITERALS, parts[1]);
+    memory_.storePointer(method, st::CompiledMethodSlots::NUM_ARGS, TaggedValue::fromSmallInteger(numArgs));
+    memory_.storePointer(method, st::CompiledMethodSlots::NUM_TEMPS, TaggedValue::fromSmallInteger(numTemps));
+    memory_.storePointer(method, st::CompiledMethodSlots::PRIMITIVE_NUMBER,
+                         TaggedValue::fromSmallInteger(primitive));
+    memory_.storePointer(method, st::CompiledMethodSlots::HANDLERS, parts[2]);
+    return method->toTaggedValue();
+}
+
+void VM::installMethod(uint32_t classIndex, TaggedValue selector, TaggedValue method) {
+    TaggedValue cls = classes_.classAt(classIndex);
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(method);
+    memory_.storePointer(object, st::CompiledMethodSlots::SELECTOR, selector);
+    memory_.storePointer(object, st::CompiledMethodSlots::METHOD_CLASS, cls);
+    if (ObjectHeader::fromTaggedValue(cls)->hasFlag(ObjectHeader::FLAG_IMMUTABLE) &&
+        ownMethods_.count(classIndex) == 0) {
+        auto* shared = runtime::IdentityDictionary::fromTaggedValue(st::mirrorOf<st::Class>(cls)->methods());
+        auto own = std::make_unique<runtime::IdentityDictionary>();
+        for (TaggedValue key : shared->keys()) {
+            own->atPut(key, shared->at(key));
+        }
+        ownMethods_.emplace(classIndex, std::move(own));
+    }
+    methodsOf(cls)->atPut(selector, method);
+    if (interpreter_) {
+        interpreter_->flushMethodCache();
+    }
+}
+
+runtime::IdentityDictionary* VM::methodsOf(TaggedValue cls) {
+    if (!ownMethods_.empty()) {
+        auto it = ownMethods_.find(ClassTable::indexOfClass(cls));
+        if (it != ownMethods_.end()) {
+            return it->second.get();
+        }
+    }
+    return runtime::IdentityDictionary::fromTaggedValue(st::mirrorOf<st::Class>(cls)->methods());
+}
+
+// ============================================================================
+// Objects
+// ============================================================================
+
+TaggedValue VM::instantiate(uint32_t classIndex, uint32_t indexedSize) {
+    st::Class* cls = st::mirrorOf<st::Class>(classes_.classAt(classIndex));
+    ObjectHeader::Type type = cls->instanceType();
+    if (type == ObjectHeader::TYPE_BYTE_ARRAY || type == ObjectHeader::TYPE_SYMBOL) {
+        return memory_.allocateBytes(type, indexedSize, classIndex)->toTaggedValue();
+    }
+    if (type != ObjectHeader::TYPE_ARRAY && indexedSize != 0) {
+        throw std::invalid_argument(className(classIndex) + " is not indexable");
+    }
+    return memory_.allocateSlots(type, cls->instanceSize() + indexedSize, classIndex)->toTaggedValue();
+}
+
+TaggedValue VM::newString(std::string_view contents) {
+    ObjectHeader* string = memory_.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY,
+                                                 static_cast<uint32_t>(contents.size()),
+                                                 kernel_.string);
+    std::memcpy(string->bytes(), contents.data(), contents.size());
+    return string->toTaggedValue();
+}
+
+TaggedValue VM::newFloat(double d) {
+    if (TaggedValue::isImmediateFloat(d)) {
+        return TaggedValue::fromFloat(d);
+    }
+    ObjectHeader* box = memory_.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, sizeof(d), ClassTable::FLOAT_INDEX);
+    std::memcpy(box->bytes(), &d, sizeof(d));
+    box->setFlag(ObjectHeader::FLAG_IMMUTABLE);
+    return box->toTaggedValue();
+}
+
+TaggedValue VM::newArray(std::vector<TaggedValue> elements) {
+    MemoryManager::ScopedRoots roots(memory_, elements);
+    ObjectHeader* array = memory_.allocateSlots(ObjectHeader::TYPE_ARRAY,
+                                                static_cast<uint32_t>(elements.size()),
+                                                kernel_.array);
+    for (uint32_t i = 0; i < elements.size(); i++) {
+        memory_.storePointer(array, i, elements[i]);
+    }
+    return array->toTaggedValue();
+}
+
+TaggedValue VM::newDictionary() {
+    return instantiate(kernel_.dictionary);
+}
+
+std::string VM::printString(TaggedValue value) {
+    if (value.isSmallInteger()) {
+        return std::to_string(value.toSmallInteger());
+    }
+    double d;
+    if (floatValue(value, d)) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", d);
+        return buffer;
+    }
+    if (value.isNil()) {
+        return "nil";
+    }
+    if (value.isBoolean()) {
+        return value.isTrue() ? "true" : "false";
+    }
+    if (value.isSpecial()) {
+        return "<stack block>";  // See Interpreter::stackBlock()
+    }
+    if (!value.isPointer() ||
+        !(memory_.contains(value.toPointer()) || (image_ && image_->contains(value.toPointer())))) {
+        return "<external pointer>";
+    }
+
+    ObjectHeader* object = ObjectHeader::fromTaggedValue(value);
+    if (object->type() == ObjectHeader::TYPE_CLASS) {
+        return className(ClassTable::indexOfClass(value));
+    }
+    if (object->classIndex() == kernel_.symbol) {
+        return "#" + std::string(SymbolTable::nameOf(value));
+    }
+    if (object->classIndex() == kernel_.string) {
+        constexpr size_t MAX_CHARACTERS = 40;
+        std::string_view contents(reinterpret_cast<const char*>(object->bytes()), object->size());
+        std::string result = "'" + std::string(contents.substr(0, MAX_CHARACTERS));
+        return result + (contents.size() > MAX_CHARACTERS ? "...'" : "'");
+    }
+    std::string name = className(object->classIndex());
+    bool vowel = std::string_view("AEIOU").find(name[0]) != std::string_view::npos;
+    return (vowel ? "an " : "a ") + name;
+}
+
+TaggedValue VM::send(TaggedValue receiver, std::string_view selector, std::vector<TaggedValue> args) {
+    args.push_back(receiver);
+    TaggedValue symbol;
+    {
+        MemoryManager::ScopedRoots roots(memory_, args);
+        symbol = symbols_->intern(selector);
+    }
+    receiver = args.back();
+    args.pop_back();
+    return interpreter_->send(receiver, symbol, args);
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+void VM::startAllocationProfiling(uint32_t sampleEvery) {
+    if (!allocationProfiler_ || allocationProfiler_->sampleEvery() != std::max<uint32_t>(sampleEvery, 1)) {
+        allocationProfiler_ = std::make_unique<AllocationProfiler>(*this, sampleEvery);
+    }
+    AllocationProfiler* profiler = allocationProfiler_.get();
+    memory_.setAllocationHook([profiler](ObjectHeader* object) { profiler->allocated(object); });
+}
+
+void VM::stopAllocationProfiling() {
+    memory_.setAllocationHook(nullptr);
+}
+
+std::vector<ClassTally> VM::heapCensus() {
+    memory_.majorCollection();
+    std::vector<ClassTally> tallies;
+    memory_.forEachObject([&tallies](ObjectHeader* object) {
+        uint32_t classIndex = object->classIndex();
+        if (classIndex >= tallies.size()) {
+            tallies.resize(classIndex + 1);
+        }
+        tallies[classIndex].objects++;
+        tallies[classIndex].bytes += object->totalBytes();
+    });
+
+    std::vector<ClassTally> result;
+    for (uint32_t index = 0; index < tallies.size(); index++) {
+        if (tallies[index].objects != 0) {
+            result.push_back(ClassTally{index, className(index), tallies[index].objects, tallies[index].bytes});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const ClassTally& a, const ClassTally& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.classIndex < b.classIndex;
+    });
+    return result;
+}
+
+VMStatistics VM::statistics(bool census) {
+    VMStatistics statistics;
+    statistics.bytecodes = interpreter_->bytecodesExecuted();
+    statistics.sends = interpreter_->sends();
+    statistics.allocations = memory_.allocations();
+    statistics.bytesAllocated = memory_.bytesAllocated();
+    statistics.nurseryBytesUsed = memory_.nurseryBytesUsed();
+    statistics.oldSpaceBytesUsed = memory_.oldSpaceBytesUsed();
+    statistics.largeObjectBytesUsed = memory_.largeObjectBytesUsed();
+    statistics.minorCollections = memory_.minorCollections();
+    statistics.majorCollections = memory_.majorCollections();
+    statistics.minorPauses = memory_.minorPauses();
+    statistics.majorPauses = memory_.majorPauses();
+    statistics.safepoints = Safepoints::global().timeToSafepoint(*interpreter_);
+    if (allocationProfiler_) {
+        statistics.allocationSampleEvery = allocationProfiler_->sampleEvery();
+        statistics.allocationsByClass = allocationProfiler_->byClass();
+        statistics.allocationSites = allocationProfiler_->bySite();
+    }
+    // Last, so the census's own collection is not in the counters
+    if (census) {
+        statistics.census = heapCensus();
+    }
+    return statistics;
+}
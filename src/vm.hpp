@@ -0,0 +1,174 @@
+#pragma once
+
+#include "allocation_profiler.hpp"
+#include "class_table.hpp"
+#include "interpreter.hpp"
+#include "memory_manager.hpp"
+#include "object_header.hpp"
+#include "runtime/dictionary.hpp"
+#include "symbol_table.hpp"
+#include "tagged_value.hpp"
+#include "vm_statistics.hpp"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class ImageSegment;
+
+/**
+ * VM - one Smalltalk object world: object memory, classes, symbols and interpreter
+ *
+ * The constructor bootstraps the kernel classes (Object, Class, the immediate classes,
+ * Array, ByteArray, String, Symbol, CompiledMethod, Dictionary, Process, Semaphore,
+ * Exception, Error, BlockClosure, IOHandle with File and Socket) and compiles their
+ * methods from the kernel source in bootstrap.cpp. Every class object is an instance of
+ * Class; there are no metaclasses yet, so class-side behaviour is limited to Class's
+ * own methods (new, new:, ...).
+ *
+ * Method dictionaries are runtime:: backing stores owned by the VM and referenced from
+ * object memory through external pointers; their contents are GC roots and they live
+ * as long as the VM. A Dictionary keeps its hash table in object memory (see
+ * dictionary_table.hpp) and is collected like any other object.
+ *
+ * A VM can instead start from an ImageSegment: the kernel, and whatever else the VM the
+ * segment was built from had, is then shared rather than bootstrapped. Classes from the
+ * segment cannot change; compiling a method into one gives this VM a private copy of
+ * that class's method dictionary, which lookup() finds before the shared one.
+ */
+class VM {
+public:
+    // Class indices of the kernel classes
+    struct Kernel {
+        uint32_t object = 0;
+        uint32_t classClass = 0;
+        uint32_t undefinedObject = 0;
+        uint32_t boolean = 0;
+        uint32_t trueClass = 0;
+        uint32_t falseClass = 0;
+        uint32_t number = 0;
+        uint32_t smallInteger = 0;
+        uint32_t floatClass = 0;
+        uint32_t arrayedCollection = 0;
+        uint32_t array = 0;
+        uint32_t byteArray = 0;
+        uint32_t string = 0;
+        uint32_t symbol = 0;
+        uint32_t compiledMethod = 0;
+        uint32_t dictionary = 0;
+        uint32_t process = 0;
+        uint32_t semaphore = 0;
+        uint32_t exception = 0;
+        uint32_t error = 0;
+        uint32_t vmError = 0;
+        uint32_t blockClosure = 0;
+        uint32_t ioHandle = 0;
+    };
+
+    explicit VM(size_t nurseryBytes = MemoryManager::DEFAULT_NURSERY_BYTES,
+                size_t oldSpaceBytes = MemoryManager::DEFAULT_OLD_SPACE_BYTES);
+    // A VM whose classes, methods and Symbols start as those of image, shared
+    explicit VM(std::shared_ptr<const ImageSegment> image,
+                size_t nurseryBytes = MemoryManager::DEFAULT_NURSERY_BYTES,
+                size_t oldSpaceBytes = MemoryManager::DEFAULT_OLD_SPACE_BYTES);
+    ~VM();
+
+    VM(const VM&) = delete;
+    VM& operator=(const VM&) = delete;
+
+    MemoryManager& memory() { return memory_; }
+    ClassTable& classes() { return classes_; }
+    SymbolTable& symbols() { return *symbols_; }
+    Interpreter& interpreter() { return *interpreter_; }
+    const Kernel& kernel() const { return kernel_; }
+    const ImageSegment* image() const { return image_.get(); }
+
+    // Classes. A subclass inherits its superclass's instance variables and format.
+    // Throws std::invalid_argument for unknown superclasses or duplicate names.
+    uint32_t defineClass(std::string_view name, std::string_view superclass,
+                         const std::vector<std::string>& instanceVariables = {});
+    uint32_t classIndexNamed(std::string_view name) const;  // INVALID_INDEX if none
+    std::string className(uint32_t classIndex) const;
+    // All instance variable names, inherited ones first
+    const std::vector<std::string>& instanceVariableNames(uint32_t classIndex) const;
+
+    // Methods. compile() parses source (see Compiler), installs the method in the named
+    // class and answers it.
+    TaggedValue compile(std::string_view className, std::string_view source);
+    TaggedValue newMethod(const std::vector<uint8_t>& bytecodes, std::vector<TaggedValue> literals,
+                          uint32_t numArgs, uint32_t numTemps, uint32_t primitive = 0,
+                          const std::vector<uint8_t>& handlers = {});
+    void installMethod(uint32_t classIndex, TaggedValue selector, TaggedValue method);
+    // Method dictionary the interpreter searches for the class object cls
+    runtime::IdentityDictionary* methodsOf(TaggedValue cls);
+
+    // Objects
+    TaggedValue instantiate(uint32_t classIndex, uint32_t indexedSize = 0);
+    TaggedValue newString(std::string_view contents);
+    TaggedValue newArray(std::vector<TaggedValue> elements);
+    TaggedValue newDictionary();
+    // A Float for d: immediate when TaggedValue holds it exactly, otherwise an immutable
+    // 8-byte Float object (subnormals, infinities, NaNs and large or tiny magnitudes)
+    TaggedValue newFloat(double d);
+    // Value of either kind of Float; false for anything else
+    static bool floatValue(TaggedValue value, double& d) {
+        if (value.isFloat()) {
+            d = value.toFloat();
+            return true;
+        }
+        if (!value.isPointer() || ObjectHeader::fromTaggedValue(value)->classIndex() != ClassTable::FLOAT_INDEX) {
+            return false;
+        }
+        std::memcpy(&d, ObjectHeader::fromTaggedValue(value)->bytes(), sizeof(d));
+        return true;
+    }
+
+    // Short description of value for diagnostics ("42", "#foo", "'abc'", "a Point");
+    // never allocates or sends
+    std::string printString(TaggedValue value);
+
+    // Sends a message from C++ and answers the result
+    TaggedValue send(TaggedValue receiver, std::string_view selector,
+                     std::vector<TaggedValue> args = {});
+
+    // Allocation profiling (see AllocationProfiler). Starting again keeps the counts
+    // unless sampleEvery changes; stopping keeps them for statistics().
+    void startAllocationProfiling(uint32_t sampleEvery = AllocationProfiler::DEFAULT_SAMPLE_EVERY);
+    void stopAllocationProfiling();
+    AllocationProfiler* allocationProfiler() { return allocationProfiler_.get(); }
+
+    // Live objects by class, most bytes first. Runs a major collection first.
+    std::vector<ClassTally> heapCensus();
+    // Counters, pause histograms and allocation profile; census adds heapCensus(),
+    // taken after the counters are read
+    VMStatistics statistics(bool census = false);
+
+private:
+    uint32_t createClass(std::string_view name, uint32_t superclass,
+                         const std::vector<std::string>& instanceVariables,
+                         ObjectHeader::Type instanceType,
+                         uint32_t index = ClassTable::INVALID_INDEX);
+    void bootstrap();
+    void compileKernel();
+    void addRootProvider();
+
+    friend class ImageSegment;
+
+    MemoryManager memory_;
+    std::shared_ptr<const ImageSegment> image_;
+    ClassTable classes_;
+    Kernel kernel_;
+    std::unique_ptr<SymbolTable> symbols_;
+    std::unique_ptr<Interpreter> interpreter_;
+    std::unique_ptr<AllocationProfiler> allocationProfiler_;
+
+    std::unordered_map<std::string, uint32_t> classIndices_;
+    std::vector<std::vector<std::string>> instanceVariableNames_;  // by class index
+    std::vector<std::unique_ptr<runtime::IdentityDictionary>> methodDictionaries_;
+    // Private method dictionaries of classes shared from image_, by class index
+    std::unordered_map<uint32_t, std::unique_ptr<runtime::IdentityDictionary>> ownMethods_;
+    size_t rootProvider_;
+};
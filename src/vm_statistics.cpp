@@ -0,0 +1,180 @@
+#include "vm_statistics.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+std::string formatBytes(uint64_t bytes) {
+    char buffer[32];
+    if (bytes < 1024) {
+        std::snprintf(buffer, sizeof(buffer), "%llu B", static_cast<unsigned long long>(bytes));
+    } else if (bytes < 1024 * 1024) {
+        std::snprintf(buffer, sizeof(buffer), "%.1f KB", bytes / 1024.0);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / (1024.0 * 1024.0));
+    }
+    return buffer;
+}
+
+std::string formatNanoseconds(double nanoseconds) {
+    char buffer[32];
+    if (nanoseconds < 1e3) {
+        std::snprintf(buffer, sizeof(buffer), "%.0f ns", nanoseconds);
+    } else if (nanoseconds < 1e6) {
+        std::snprintf(buffer, sizeof(buffer), "%.1f us", nanoseconds / 1e3);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2f ms", nanoseconds / 1e6);
+    }
+    return buffer;
+}
+
+void writePausesText(std::ostream& out, const char* title, const Histogram& pauses, const char* what = "pauses") {
+    out << title << ": " << pauses.count() << ' ' << what;
+    if (pauses.count() == 0) {
+        out << '\n';
+        return;
+    }
+    out << ", total " << formatNanoseconds(static_cast<double>(pauses.sum())) << ", mean "
+        << formatNanoseconds(pauses.mean()) << ", p50 " << formatNanoseconds(pauses.percentile(50)) << ", p99 "
+        << formatNanoseconds(pauses.percentile(99)) << ", max " << formatNanoseconds(pauses.max()) << '\n';
+
+    uint64_t largest = 0;
+    for (size_t bucket = 0; bucket < Histogram::BUCKETS; bucket++) {
+        largest = std::max(largest, pauses.bucketCount(bucket));
+    }
+    char line[160];
+    for (size_t bucket = 0; bucket < Histogram::BUCKETS; bucket++) {
+        uint64_t count = pauses.bucketCount(bucket);
+        if (count == 0) {
+            continue;
+        }
+        std::string bar(static_cast<size_t>((count * 40 + largest - 1) / largest), '#');
+        std::snprintf(line, sizeof(line), "  %10s - %-10s %8llu %s\n",
+                      formatNanoseconds(static_cast<double>(Histogram::bucketLowerBound(bucket))).c_str(),
+                      formatNanoseconds(static_cast<double>(Histogram::bucketUpperBound(bucket))).c_str(),
+                      static_cast<unsigned long long>(count), bar.c_str());
+        out << line;
+    }
+}
+
+void writeTalliesText(std::ostream& out, const std::vector<ClassTally>& tallies, const char* objects,
+                      size_t maxRows) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "  %-32s %12s %12s\n", "class", objects, "bytes");
+    out << line;
+    for (size_t i = 0; i < tallies.size() && i < maxRows; i++) {
+        std::snprintf(line, sizeof(line), "  %-32s %12llu %12s\n", tallies[i].name.c_str(),
+                      static_cast<unsigned long long>(tallies[i].objects), formatBytes(tallies[i].bytes).c_str());
+        out << line;
+    }
+}
+
+std::string jsonString(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                result += escaped;
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result + "\"";
+}
+
+void writePausesJson(std::ostream& out, const Histogram& pauses) {
+    out << "{\"count\": " << pauses.count() << ", \"total_ns\": " << pauses.sum() << ", \"min_ns\": " << pauses.min()
+        << ", \"max_ns\": " << pauses.max() << ", \"p50_ns\": " << pauses.percentile(50)
+        << ", \"p90_ns\": " << pauses.percentile(90) << ", \"p99_ns\": " << pauses.percentile(99)
+        << ", \"buckets\": [";
+    const char* separator = "";
+    for (size_t bucket = 0; bucket < Histogram::BUCKETS; bucket++) {
+        if (pauses.bucketCount(bucket) != 0) {
+            out << separator << "{\"low_ns\": " << Histogram::bucketLowerBound(bucket)
+                << ", \"high_ns\": " << Histogram::bucketUpperBound(bucket)
+                << ", \"count\": " << pauses.bucketCount(bucket) << "}";
+            separator = ", ";
+        }
+    }
+    out << "]}";
+}
+
+void writeTalliesJson(std::ostream& out, const std::vector<ClassTally>& tallies) {
+    out << "[";
+    for (size_t i = 0; i < tallies.size(); i++) {
+        out << (i == 0 ? "" : ", ") << "{\"class\": " << jsonString(tallies[i].name)
+            << ", \"class_index\": " << tallies[i].classIndex << ", \"objects\": " << tallies[i].objects
+            << ", \"bytes\": " << tallies[i].bytes << "}";
+    }
+    out << "]";
+}
+
+} // namespace
+
+void VMStatistics::writeText(std::ostream& out, size_t maxRows) const {
+    out << "Interpreter: " << bytecodes << " bytecodes, " << sends << " sends\n";
+    out << "Allocated: " << allocations << " objects, " << formatBytes(bytesAllocated) << '\n';
+    out << "Heap: nursery " << formatBytes(nurseryBytesUsed) << ", old space " << formatBytes(oldSpaceBytesUsed)
+        << ", large objects " << formatBytes(largeObjectBytesUsed) << '\n';
+    writePausesText(out, "Minor collections", minorPauses);
+    writePausesText(out, "Major collections", majorPauses);
+    writePausesText(out, "Time to safepoint", safepoints, "stops");
+
+    if (allocationSampleEvery != 0) {
+        out << "Allocations by class:\n";
+        writeTalliesText(out, allocationsByClass, "objects", maxRows);
+        out << "Allocation sites (1 in " << allocationSampleEvery << " allocations sampled):\n";
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-32s %6s %10s %12s\n", "method", "ip", "samples", "bytes");
+        out << line;
+        for (size_t i = 0; i < allocationSites.size() && i < maxRows; i++) {
+            const AllocationSite& site = allocationSites[i];
+            std::snprintf(line, sizeof(line), "  %-32s %6u %10llu %12s\n", site.method.c_str(), site.ip,
+                          static_cast<unsigned long long>(site.samples), formatBytes(site.bytes).c_str());
+            out << line;
+        }
+    }
+    if (!census.empty()) {
+        out << "Heap census:\n";
+        writeTalliesText(out, census, "live", maxRows);
+    }
+}
+
+void VMStatistics::writeJson(std::ostream& out) const {
+    out << "{\n";
+    out << "  \"interpreter\": {\"bytecodes\": " << bytecodes << ", \"sends\": " << sends << "},\n";
+    out << "  \"memory\": {\"allocations\": " << allocations << ", \"bytes_allocated\": " << bytesAllocated
+        << ", \"nursery_bytes_used\": " << nurseryBytesUsed << ", \"old_space_bytes_used\": " << oldSpaceBytesUsed
+        << ", \"large_object_bytes_used\": " << largeObjectBytesUsed << "},\n";
+    out << "  \"minor_collections\": ";
+    writePausesJson(out, minorPauses);
+    out << ",\n  \"major_collections\": ";
+    writePausesJson(out, majorPauses);
+    out << ",\n  \"time_to_safepoint\": ";
+    writePausesJson(out, safepoints);
+    out << ",\n  \"allocation_sample_every\": " << allocationSampleEvery;
+    out << ",\n  \"allocations_by_class\": ";
+    writeTalliesJson(out, allocationsByClass);
+    out << ",\n  \"allocation_sites\": [";
+    for (size_t i = 0; i < allocationSites.size(); i++) {
+        const AllocationSite& site = allocationSites[i];
+        out << (i == 0 ? "" : ", ") << "{\"method\": " << jsonString(site.method) << ", \"ip\": " << site.ip
+            << ", \"samples\": " << site.samples << ", \"bytes\": " << site.bytes << "}";
+    }
+    out << "],\n  \"census\": ";
+    writeTalliesJson(out, census);
+    out << "\n}\n";
+}
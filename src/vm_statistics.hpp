@@ -0,0 +1,57 @@
+#pragma once
+
+#include "histogram.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Objects and bytes attributed to one class
+struct ClassTally {
+    uint32_t classIndex = 0;
+    std::string name;
+    uint64_t objects = 0;
+    uint64_t bytes = 0;
+};
+
+// Sampled allocations attributed to one send site
+struct AllocationSite {
+    std::string method;  // "Class>>selector", or "(outside Smalltalk)" for C++ callers
+    uint32_t ip = 0;     // Offset of the send that allocated
+    uint64_t samples = 0;
+    uint64_t bytes = 0;  // Bytes of the sampled allocations
+};
+
+/**
+ * VMStatistics - snapshot of a VM's execution and object memory counters
+ *
+ * Taken with VM::statistics(). Allocation profiles are filled in once allocation
+ * profiling has been started, the census only when requested. Both dumps list every
+ * field; the text one is for people, the JSON one for tools.
+ */
+struct VMStatistics {
+    uint64_t bytecodes = 0;
+    uint64_t sends = 0;
+
+    uint64_t allocations = 0;
+    uint64_t bytesAllocated = 0;
+    size_t nurseryBytesUsed = 0;
+    size_t oldSpaceBytesUsed = 0;
+    size_t largeObjectBytesUsed = 0;
+
+    size_t minorCollections = 0;
+    size_t majorCollections = 0;
+    Histogram minorPauses;  // Nanoseconds
+    Histogram majorPauses;
+    Histogram safepoints;  // Time to safepoint in nanoseconds, per Stop that parked the interpreter
+
+    uint32_t allocationSampleEvery = 0;        // 0: allocation profiling never started
+    std::vector<ClassTally> allocationsByClass;  // Most bytes first
+    std::vector<AllocationSite> allocationSites; // Most sampled bytes first
+    std::vector<ClassTally> census;              // Live objects by class, most bytes first
+
+    // Tables are cut to maxRows rows
+    void writeText(std::ostream& out, size_t maxRows = 20) const;
+    void writeJson(std::ostream& out) const;
+};
@@ -0,0 +1,256 @@
+#include "../src/classes/block_closure.hpp"
+#include "../src/classes/compiled_method.hpp"
+#include "../src/compiler.hpp"
+#include "../src/profiler.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace test_support;
+
+namespace {
+
+// Blocks that are not inlined, all clean, used through the collection protocol
+void defineBlockUsers(VM& vm) {
+    vm.defineClass("BlockUser", "Object", {"count"});
+    vm.compile("BlockUser", "adder ^[:a :b | a + b]");
+    vm.compile("BlockUser", "sum: anArray ^anArray inject: 0 into: [:sum :each | sum + each]");
+    vm.compile("BlockUser", "doubled: anArray ^anArray collect: [:each | each * 2]");
+    vm.compile("BlockUser", "firstOdd: anArray ^anArray detect: [:each | each \\\\ 2 = 1] ifNone: [0]");
+}
+
+TaggedValue elementAt(VM& vm, TaggedValue array, int64_t index) {
+    return vm.send(array, "at:", {integer(index)});
+}
+
+} // namespace
+
+// ============================================================================
+// Clean Block Tests
+// ============================================================================
+
+TEST(BlockClosures, CleanBlocksAreLiteralClosures) {
+    VM vm;
+    defineBlockUsers(vm);
+    TaggedValue user = vm.instantiate(vm.classIndexNamed("BlockUser"));
+    TaggedValue adder = vm.send(user, "adder");
+    ASSERT_EQ(ClassTable::classIndexOf(adder), vm.kernel().blockClosure);
+    ASSERT_EQ(vm.send(adder, "numArgs"), integer(2));
+    ASSERT_EQ(vm.send(adder, "value:value:", {integer(3), integer(4)}), integer(7));
+
+    // Built once by the compiler: every evaluation answers the same closure
+    uint64_t allocations = vm.memory().allocations();
+    ASSERT_EQ(vm.send(user, "adder"), adder);
+    ASSERT_EQ(vm.memory().allocations(), allocations);
+    TaggedValue method = st::mirrorOf<st::BlockClosure>(adder)->method();
+    ASSERT_EQ(st::mirrorOf<st::CompiledMethod>(method)->qualifiedName(), "BlockUser>>[] in adder");
+}
+
+TEST(BlockClosures, CollectionsIterateWithoutAllocating) {
+    VM vm;
+    defineBlockUsers(vm);
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.classIndexNamed("BlockUser"))};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    roots.push_back(vm.newArray({integer(2), integer(3), integer(4), integer(5)}));
+    TaggedValue user = roots[0];
+    TaggedValue numbers = roots[1];
+
+    uint64_t allocations = vm.memory().allocations();
+    ASSERT_EQ(vm.send(user, "sum:", {numbers}), integer(14));
+    ASSERT_EQ(vm.send(user, "firstOdd:", {numbers}), integer(3));
+    ASSERT_EQ(vm.memory().allocations(), allocations);
+
+    TaggedValue doubled = vm.send(user, "doubled:", {numbers});
+    ASSERT_EQ(vm.memory().allocations(), allocations + 1);  // Only the result
+    ASSERT_EQ(elementAt(vm, doubled, 1), integer(4));
+    ASSERT_EQ(elementAt(vm, doubled, 4), integer(10));
+
+    vm.memory().majorCollection();
+    ASSERT_EQ(vm.send(roots[0], "sum:", {roots[1]}), integer(14));
+}
+
+TEST(BlockClosures, ValueOfABlockWrittenOutIsInlined) {
+    VM vm;
+    vm.compile("Object", "twice: y ^[:x | x + y] value: y");
+    vm.compile("Object", "nothing ^[] value");
+    vm.compile("Object", "nested ^[[:x | x * 3]] value");
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "twice:", {integer(21)}), integer(42));
+    ASSERT_TRUE(vm.send(TaggedValue::nil(), "nothing").isNil());
+    TaggedValue tripler = vm.send(TaggedValue::nil(), "nested");
+    ASSERT_EQ(vm.send(tripler, "value:", {integer(5)}), integer(15));
+}
+
+TEST(BlockClosures, BlocksThatAreNotInlinedCannotReturn) {
+    VM vm;
+    ASSERT_THROW(vm.compile("Object", "foo ^[^1]"), CompileError);
+    ASSERT_THROW(vm.compile("Object", "foo ^[true ifTrue: [^1]. 2]"), CompileError);
+}
+
+// ============================================================================
+// CREATE_BLOCK Tests
+// ============================================================================
+
+TEST(BlockClosures, BlocksCaptureSelfAndTheVariablesAroundThem) {
+    VM vm;
+    defineBlockUsers(vm);
+    vm.compile("BlockUser", "setUp count := 5");
+    vm.compile("BlockUser", "me ^[self]");
+    vm.compile("BlockUser", "counter ^[count := count + 1]");
+    vm.compile("BlockUser", "adder: y ^[:x | x + y]");
+    vm.compile("BlockUser", "curried: y | z | z := 100. ^[:x | [x + y + z + count]]");
+    std::vector<TaggedValue> roots = {newInstance(vm, "BlockUser")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+
+    roots.push_back(vm.send(roots[0], "me"));
+    ASSERT_EQ(ClassTable::classIndexOf(roots[1]), vm.kernel().blockClosure);
+    ASSERT_EQ(vm.send(roots[1], "value"), roots[0]);
+    roots[1] = vm.send(roots[0], "counter");
+    vm.send(roots[1], "value");
+    ASSERT_EQ(vm.send(roots[1], "value"), integer(7));
+
+    // Each evaluation makes a closure of its own
+    roots[1] = vm.send(roots[0], "adder:", {integer(1)});
+    roots.push_back(vm.send(roots[0], "adder:", {integer(2)}));
+    ASSERT_EQ(vm.send(roots[1], "value:", {integer(40)}), integer(41));
+    ASSERT_EQ(vm.send(roots[2], "value:", {integer(40)}), integer(42));
+
+    roots[1] = vm.send(vm.send(roots[0], "curried:", {integer(20)}), "value:", {integer(3)});
+    vm.memory().majorCollection();
+    ASSERT_EQ(vm.send(roots[1], "value"), integer(130));
+    TaggedValue method = st::mirrorOf<st::BlockClosure>(roots[1])->method();
+    ASSERT_EQ(st::mirrorOf<st::CompiledMethod>(method)->qualifiedName(), "BlockUser>>[] in curried:");
+}
+
+TEST(BlockClosures, AssignedVariablesAreSharedWithTheirBlocks) {
+    VM vm;
+    vm.compile("Object",
+               "counters | n pair | n := 0. pair := Array new: 2.\n"
+               "    pair at: 1 put: [n := n + 1]. pair at: 2 put: [n].\n"
+               "    ^pair");
+    vm.compile("Object", "sum: anArray | total | total := 0. anArray do: [:each | total := total + each]. ^total");
+    // A block temporary is new on each evaluation of its block
+    vm.compile("Object",
+               "tens | blocks | blocks := Array new: 3.\n"
+               "    1 to: 3 do: [:i | | x | x := i * 10. blocks at: i put: [x]].\n"
+               "    ^blocks");
+    std::vector<TaggedValue> roots = {vm.send(TaggedValue::nil(), "counters")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+
+    TaggedValue increment = elementAt(vm, roots[0], 1);
+    vm.send(increment, "value");
+    vm.send(increment, "value");
+    ASSERT_EQ(vm.send(elementAt(vm, roots[0], 2), "value"), integer(2));
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "sum:", {vm.newArray({integer(1), integer(2), integer(3)})}),
+              integer(6));
+    roots[0] = vm.send(TaggedValue::nil(), "tens");
+    ASSERT_EQ(vm.send(elementAt(vm, roots[0], 1), "value"), integer(10));
+    ASSERT_EQ(vm.send(elementAt(vm, roots[0], 3), "value"), integer(30));
+}
+
+TEST(BlockClosures, BlocksThatDoNotEscapeLiveInTheFrame) {
+    VM vm;
+    vm.compile("Object",
+               "around: x | shift |\n"
+               "    shift := [:y | y + x].\n"
+               "    ^(shift value: 1) + (shift value: 2)");
+    vm.compile("Object",
+               "loop: x | sum step | sum := 0.\n"
+               "    1 to: 10 do: [:i | step := [i * x]. sum := sum + step value].\n"
+               "    ^sum");
+    uint64_t allocations = vm.memory().allocations();
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "around:", {integer(10)}), integer(23));
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "loop:", {integer(2)}), integer(110));
+    ASSERT_EQ(vm.memory().allocations(), allocations);
+}
+
+TEST(BlockClosures, StackBlocksMoveToTheHeapWhenTheyEscape) {
+    VM vm;
+    vm.compile("Object",
+               "escape: x | block |\n"
+               "    block := [x + 1].\n"
+               "    block value.\n"
+               "    ^block");
+    vm.compile("Object",
+               "mapped: anArray by: x | block | block := [:e | e * x]. ^anArray collect: block");
+    vm.compile("Object",
+               "both: x | block other |\n"
+               "    block := [x].\n"
+               "    other := block.\n"
+               "    ^(block value) + (other value) + (block == other ifTrue: [0] ifFalse: [1])");
+
+    uint64_t allocations = vm.memory().allocations();
+    std::vector<TaggedValue> roots = {vm.send(TaggedValue::nil(), "escape:", {integer(41)})};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    ASSERT_EQ(vm.memory().allocations(), allocations + 1);
+    ASSERT_EQ(ClassTable::classIndexOf(roots[0]), vm.kernel().blockClosure);
+    vm.memory().majorCollection();
+    ASSERT_EQ(vm.send(roots[0], "value"), integer(42));
+
+    roots.push_back(vm.send(TaggedValue::nil(), "mapped:by:", {vm.newArray({integer(1), integer(2)}), integer(3)}));
+    ASSERT_EQ(elementAt(vm, roots[1], 2), integer(6));
+    // Once moved, the temporary holds the heap block: both uses see one closure
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "both:", {integer(4)}), integer(8));
+}
+
+// ============================================================================
+// EXECUTE_BLOCK Tests
+// ============================================================================
+
+TEST(BlockClosures, ValueSendsToOtherObjectsAreSends) {
+    VM vm;
+    vm.defineClass("Holder", "Object", {});
+    vm.compile("Holder", "value ^42");
+    vm.compile("Object", "valueOf: anObject ^anObject value");
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "valueOf:", {vm.instantiate(vm.classIndexNamed("Holder"))}),
+              integer(42));
+    vm.compile("Object", "constant ^[7]");
+    TaggedValue block = vm.send(TaggedValue::nil(), "constant");
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "valueOf:", {block}), integer(7));
+    ASSERT_THROW(vm.send(block, "value:", {integer(1)}), std::runtime_error);
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+}
+
+TEST(BlockClosures, BlockFramesUnwindToHandlers) {
+    VM vm;
+    vm.compile("Object",
+               "guarded: anArray\n"
+               "    ^[anArray collect: [:x | x = 2 ifTrue: [Error new signal: 'two']. x]]\n"
+               "        on: Error do: [:e | e messageText]");
+    ASSERT_EQ(vm.printString(vm.send(TaggedValue::nil(), "guarded:", {vm.newArray({integer(1), integer(2)})})),
+              "'two'");
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+}
+
+TEST(BlockClosures, ProfilerCountsBlockActivations) {
+    VM vm;
+    defineBlockUsers(vm);
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.classIndexNamed("BlockUser"))};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    roots.push_back(vm.newArray({integer(1), integer(2), integer(3)}));
+    TaggedValue user = roots[0];
+    TaggedValue numbers = roots[1];
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    vm.send(user, "sum:", {numbers});
+    vm.interpreter().setProfiler(nullptr);
+    ASSERT_EQ(profiler.activeMethods(), 0u);
+    uint64_t invocations = 0;
+    for (const Profiler::MethodStats& stats : profiler.methodStats()) {
+        if (stats.name == "BlockUser>>[] in sum:") {
+            invocations = stats.invocations;
+        }
+    }
+    ASSERT_EQ(invocations, 3u);
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
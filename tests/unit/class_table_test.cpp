@@ -0,0 +1,121 @@
+#include "../src/class_table.hpp"
+#include "../src/inline_cache.hpp"
+#include "../src/memory_manager.hpp"
+#include "../src/object_header.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+
+// ============================================================================
+// Immediate Class Index Tests
+// ============================================================================
+
+TEST(ClassTable, ImmediatesMapToReservedIndices) {
+    ASSERT_EQ(ClassTable::classIndexOf(TaggedValue::fromSmallInteger(0)),
+              ClassTable::SMALL_INTEGER_INDEX);
+    ASSERT_EQ(ClassTable::classIndexOf(TaggedValue::fromSmallInteger(-12345)),
+              ClassTable::SMALL_INTEGER_INDEX);
+    ASSERT_EQ(ClassTable::classIndexOf(TaggedValue(TaggedValue::TAG_FLOAT)),
+              ClassTable::FLOAT_INDEX);
+    ASSERT_EQ(ClassTable::classIndexOf(TaggedValue::nil()), ClassTable::UNDEFINED_OBJECT_INDEX);
+    ASSERT_EQ(ClassTable::classIndexOf(TaggedValue::trueValue()), ClassTable::TRUE_INDEX);
+    ASSERT_EQ(ClassTable::classIndexOf(TaggedValue::falseValue()), ClassTable::FALSE_INDEX);
+}
+
+// ============================================================================
+// Registration Tests
+// ============================================================================
+
+TEST(ClassTable, RegisteredClassIndexIsStoredInObjects) {
+    MemoryManager memory;
+    ClassTable classes;
+    ObjectHeader* point = memory.allocateSlots(ObjectHeader::TYPE_CLASS, 4);
+
+    uint32_t index = classes.registerClass(point);
+    ASSERT_GE(index, ClassTable::FIRST_FREE_INDEX);
+    ASSERT_EQ(ClassTable::indexOfClass(point->toTaggedValue()), index);
+
+    ObjectHeader* instance = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 2, index);
+    ASSERT_EQ(ClassTable::classIndexOf(instance->toTaggedValue()), index);
+    ASSERT_EQ(classes.classOf(instance->toTaggedValue()), point->toTaggedValue());
+}
+
+TEST(ClassTable, ReservedIndicesHoldImmediateClasses) {
+    MemoryManager memory;
+    ClassTable classes;
+    ObjectHeader* smallInteger = memory.allocateSlots(ObjectHeader::TYPE_CLASS, 4);
+
+    classes.registerClassAt(ClassTable::SMALL_INTEGER_INDEX, smallInteger);
+    ASSERT_EQ(classes.classOf(TaggedValue::fromSmallInteger(3)), smallInteger->toTaggedValue());
+    ASSERT_TRUE(classes.classOf(TaggedValue::nil()).isNil()) << "Unregistered index answers nil";
+}
+
+TEST(ClassTable, ClassWithExistingHashCannotBeRegistered) {
+    MemoryManager memory;
+    ClassTable classes;
+    ObjectHeader* hashed = memory.allocateSlots(ObjectHeader::TYPE_CLASS, 4);
+    hashed->setHash(ClassTable::FIRST_FREE_INDEX + 100);
+
+    ASSERT_THROW(classes.registerClass(hashed), std::logic_error);
+    ASSERT_THROW(classes.registerClassAt(ClassTable::INVALID_INDEX, hashed), std::out_of_range);
+}
+
+TEST(ClassTable, ClassesSurviveMovingCollection) {
+    MemoryManager memory;
+    ClassTable classes;
+    memory.addRootProvider(
+        [&classes](const MemoryManager::RootVisitor& visit) { classes.visitPointers(visit); });
+    uint32_t index = classes.registerClass(memory.allocateSlots(ObjectHeader::TYPE_CLASS, 4));
+    TaggedValue instance = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 1, index)->toTaggedValue();
+    memory.addRoot(&instance);
+
+    memory.minorCollection();
+    memory.majorCollection();
+
+    ASSERT_EQ(ClassTable::classIndexOf(instance), index);
+    ASSERT_EQ(ClassTable::indexOfClass(classes.classAt(index)), index);
+}
+
+// ============================================================================
+// Memory Layout Tests
+// ============================================================================
+
+TEST(ClassTable, ObjectsNeedNoClassWord) {
+    // An empty object is one header word plus the minimum body word; a class pointer
+    // would make it three words.
+    ASSERT_EQ(ObjectHeader::totalBytesFor(ObjectHeader::TYPE_OBJECT, 0), 2 * sizeof(uint64_t));
+    ASSERT_EQ(ObjectHeader::totalBytesFor(ObjectHeader::TYPE_OBJECT, 3), 4 * sizeof(uint64_t));
+}
+
+// ============================================================================
+// Inline Cache Tests
+// ============================================================================
+
+TEST(ClassTable, InlineCacheHitsOnClassIndex) {
+    MemoryManager memory;
+    InlineCache cache;
+    TaggedValue method = TaggedValue::fromSmallInteger(99);
+
+    ASSERT_FALSE(cache.matches(TaggedValue::fromSmallInteger(1)));
+    cache.fill(TaggedValue::fromSmallInteger(1), method);
+    ASSERT_TRUE(cache.matches(TaggedValue::fromSmallInteger(2)));
+    ASSERT_FALSE(cache.matches(TaggedValue::nil()));
+    ASSERT_EQ(cache.method, method);
+
+    TaggedValue object = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 0, 20)->toTaggedValue();
+    cache.fill(object, method);
+    ASSERT_TRUE(cache.matches(memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 0, 20)->toTaggedValue()));
+    ASSERT_FALSE(cache.matches(memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 0, 21)->toTaggedValue()));
+
+    cache.flush();
+    ASSERT_FALSE(cache.matches(object));
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
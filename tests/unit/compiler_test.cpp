@@ -0,0 +1,131 @@
+#include "../src/compiler.hpp"
+#include "../src/symbol_table.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace test_support;
+
+namespace {
+
+// Compiles "doIt" + body on Object and answers the result of sending it to nil
+TaggedValue evaluate(VM& vm, const std::string& body) {
+    vm.compile("Object", "doIt " + body);
+    return vm.send(TaggedValue::nil(), "doIt");
+}
+
+} // namespace
+
+// ============================================================================
+// Literal Tests
+// ============================================================================
+
+TEST(Compiler, NumberLiterals) {
+    VM vm;
+    ASSERT_EQ(evaluate(vm, "^16rFF"), integer(255));
+    ASSERT_EQ(evaluate(vm, "^-12"), integer(-12));
+    ASSERT_EQ(evaluate(vm, "^3-1"), integer(2));
+    ASSERT_EQ(evaluate(vm, "^2.5").toFloat(), 2.5);
+    ASSERT_EQ(evaluate(vm, "^$a"), integer('a'));
+}
+
+TEST(Compiler, StringSymbolAndArrayLiterals) {
+    VM vm;
+    ASSERT_EQ(SymbolTable::nameOf(evaluate(vm, "^'it''s'")), "it's");
+    ASSERT_EQ(evaluate(vm, "^#foo:bar:"), vm.symbols().intern("foo:bar:"));
+    ASSERT_EQ(evaluate(vm, "^#(1 $a foo #(2 -3)) size"), integer(4));
+    ASSERT_EQ(evaluate(vm, "^(#(1 $a foo #(2 -3)) at: 4) at: 2"), integer(-3));
+    ASSERT_EQ(evaluate(vm, "^#(true nil) at: 1"), TaggedValue::trueValue());
+}
+
+// ============================================================================
+// Message Tests
+// ============================================================================
+
+TEST(Compiler, PrecedenceIsUnaryBinaryKeyword) {
+    VM vm;
+    ASSERT_EQ(evaluate(vm, "^3 + 4 * 2"), integer(14));
+    ASSERT_EQ(evaluate(vm, "^3 + (4 * 2)"), integer(11));
+    ASSERT_EQ(evaluate(vm, "^(Array new: 2 + 1) size"), integer(3));
+    ASSERT_EQ(evaluate(vm, "^-5 abs max: 2 squared"), integer(5));
+}
+
+TEST(Compiler, CascadesGoToTheSameReceiver) {
+    VM vm;
+    TaggedValue result = evaluate(vm, "^(Array new: 3) at: 1 put: 10; at: 2 put: 20; yourself");
+    ASSERT_EQ(vm.send(result, "at:", {integer(2)}), integer(20));
+}
+
+TEST(Compiler, InstanceVariablesAndGlobals) {
+    VM vm;
+    vm.defineClass("Counter", "Object", {"count"});
+    vm.compile("Counter", "increment count := (count isNil ifTrue: [0] ifFalse: [count]) + 1");
+    vm.compile("Counter", "count ^count");
+    ASSERT_EQ(evaluate(vm, "| c | c := Counter new. c increment; increment. ^c count"), integer(2));
+}
+
+TEST(Compiler, PrimitivePragmaWithFallback) {
+    VM vm;
+    vm.compile("SmallInteger", "plus: n <primitive: 1> ^#failed");
+    ASSERT_EQ(vm.send(integer(2), "plus:", {integer(3)}), integer(5));
+    ASSERT_EQ(vm.send(integer(2), "plus:", {TaggedValue::nil()}), vm.symbols().intern("failed"));
+}
+
+// ============================================================================
+// Inlined Control Structure Tests
+// ============================================================================
+
+TEST(Compiler, Conditionals) {
+    VM vm;
+    ASSERT_EQ(evaluate(vm, "^3 > 2 ifTrue: [#yes] ifFalse: [#no]"), vm.symbols().intern("yes"));
+    ASSERT_EQ(evaluate(vm, "^3 > 4 ifTrue: [#yes]"), TaggedValue::nil());
+    ASSERT_EQ(evaluate(vm, "^(3 > 4 or: [2 > 1]) and: [nil isNil]"), TaggedValue::trueValue());
+}
+
+TEST(Compiler, Loops) {
+    VM vm;
+    ASSERT_EQ(evaluate(vm, "| sum | sum := 0. 1 to: 10 do: [:i | sum := sum + i]. ^sum"), integer(55));
+    ASSERT_EQ(evaluate(vm, "| sum | sum := 0. 10 to: 1 by: -3 do: [:i | sum := sum + i]. ^sum"),
+              integer(22));
+    ASSERT_EQ(evaluate(vm, "| n | n := 0. [n < 7] whileTrue: [n := n + 1]. ^n"), integer(7));
+    ASSERT_EQ(evaluate(vm, "| n | n := 0. 5 timesRepeat: [n := n + 2]. ^n"), integer(10));
+}
+
+TEST(Compiler, ReturnFromInlinedBlockLeavesTheMethod) {
+    VM vm;
+    ASSERT_EQ(evaluate(vm, "1 to: 10 do: [:i | i = 4 ifTrue: [^i * 100]]. ^0"), integer(400));
+}
+
+TEST(Compiler, BlockTemporariesStartNilEachIteration) {
+    VM vm;
+    ASSERT_EQ(evaluate(vm, "| hits | hits := 0. 1 to: 3 do: [:i | | t | t isNil ifTrue: [hits := hits + 1]. t := i]. ^hits"),
+              integer(3));
+}
+
+// ============================================================================
+// Error Tests
+// ============================================================================
+
+TEST(Compiler, ReportsErrorsWithLineNumbers) {
+    VM vm;
+    try {
+        vm.compile("Object", "broken\n    ^1 +");
+        FAIL() << "expected CompileError";
+    } catch (const CompileError& e) {
+        ASSERT_EQ(e.line(), 2);
+    }
+    ASSERT_THROW(vm.compile("Object", "foo ^undefinedThing"), CompileError);
+    ASSERT_THROW(vm.compile("Object", "foo: x x := 3"), CompileError);
+    ASSERT_THROW(vm.compile("Object", "foo ^[^self]"), CompileError);
+    ASSERT_THROW(vm.compile("Object", "foo ^super foo"), CompileError);
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
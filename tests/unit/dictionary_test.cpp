@@ -0,0 +1,288 @@
+#include "../src/dictionary_table.hpp"
+#include "../src/runtime/dictionary.hpp"
+#include "../src/memory_manager.hpp"
+#include "../src/object_header.hpp"
+#include "../src/tagged_value.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using runtime::IdentityDictionary;
+using namespace test_support;
+
+namespace {
+
+// A Dictionary in vm's object memory, rooted for the life of the fixture
+class HeapDictionary : public ::testing::Test {
+protected:
+    HeapDictionary() : roots_{vm.newDictionary()}, scoped_(vm.memory(), roots_) {}
+
+    TaggedValue dictionary() { return roots_[0]; }
+    void atPut(TaggedValue key, TaggedValue value) { dictionary_table::atPut(vm, dictionary(), key, value); }
+    const TaggedValue* find(TaggedValue key) { return dictionary_table::find(dictionary(), key); }
+    size_t size() { return dictionary_table::size(dictionary()); }
+
+    VM vm;
+
+private:
+    std::vector<TaggedValue> roots_;
+    MemoryManager::ScopedRoots scoped_;
+};
+
+} // namespace
+
+// ============================================================================
+// Primitive 700/701: at: and at:put:
+// ============================================================================
+
+TEST_F(HeapDictionary, AtPutThenAt) {
+    atPut(integer(1), integer(100));
+    atPut(TaggedValue::nil(), TaggedValue::trueValue());
+
+    ASSERT_EQ(*find(integer(1)), integer(100));
+    ASSERT_EQ(*find(TaggedValue::nil()), TaggedValue::trueValue());
+}
+
+TEST_F(HeapDictionary, AtPutOverwritesExistingKey) {
+    atPut(integer(7), integer(1));
+    atPut(integer(7), integer(2));
+
+    ASSERT_EQ(size(), 1u);
+    ASSERT_EQ(*find(integer(7)), integer(2));
+}
+
+TEST_F(HeapDictionary, AtMissingKeyAnswersNothing) {
+    ASSERT_EQ(find(integer(3)), nullptr);
+
+    atPut(integer(4), TaggedValue::nil());
+    ASSERT_EQ(find(integer(3)), nullptr);
+}
+
+TEST(Dictionary, AtMissingKeyThrows) {
+    IdentityDictionary dict;
+    ASSERT_THROW(dict.at(TaggedValue::fromSmallInteger(3)), std::out_of_range);
+    ASSERT_EQ(dict.find(TaggedValue::fromSmallInteger(3)), nullptr);
+
+    dict.atPut(TaggedValue::fromSmallInteger(4), TaggedValue::nil());
+    ASSERT_THROW(dict.at(TaggedValue::fromSmallInteger(3)), std::out_of_range);
+}
+
+// ============================================================================
+// Primitive 702/703: keys and size
+// ============================================================================
+
+TEST(Dictionary, KeysAndSize) {
+    IdentityDictionary dict;
+    ASSERT_EQ(dict.size(), 0);
+    ASSERT_TRUE(dict.keys().empty());
+
+    for (int64_t i = 0; i < 10; i++) {
+        dict.atPut(TaggedValue::fromSmallInteger(i), TaggedValue::fromSmallInteger(i * i));
+    }
+
+    ASSERT_EQ(dict.size(), 10);
+    std::vector<TaggedValue> keys = dict.keys();
+    ASSERT_EQ(keys.size(), 10);
+    for (int64_t i = 0; i < 10; i++) {
+        TaggedValue key = TaggedValue::fromSmallInteger(i);
+        ASSERT_NE(std::find(keys.begin(), keys.end(), key), keys.end());
+    }
+}
+
+// ============================================================================
+// Incremental growth
+// ============================================================================
+
+TEST(Dictionary, IncrementalGrowthKeepsEveryEntryReachable) {
+    IdentityDictionary dict;
+    bool sawGrowth = false;
+    const int64_t count = 20000;
+
+    for (int64_t i = 0; i < count; i++) {
+        dict.atPut(TaggedValue::fromSmallInteger(i), TaggedValue::fromSmallInteger(-i));
+        sawGrowth = sawGrowth || dict.isGrowing();
+        // Entries must stay visible while they are split across both tables.
+        if (dict.isGrowing()) {
+            ASSERT_EQ(dict.at(TaggedValue::fromSmallInteger(i / 2)),
+                      TaggedValue::fromSmallInteger(-(i / 2)));
+        }
+    }
+
+    ASSERT_TRUE(sawGrowth) << "Growth should be spread over several inserts";
+    ASSERT_EQ(dict.size(), static_cast<size_t>(count));
+    ASSERT_EQ(dict.keys().size(), static_cast<size_t>(count));
+    for (int64_t i = 0; i < count; i++) {
+        ASSERT_EQ(dict.at(TaggedValue::fromSmallInteger(i)), TaggedValue::fromSmallInteger(-i));
+    }
+}
+
+TEST(Dictionary, OverwriteDuringGrowthDoesNotDuplicate) {
+    IdentityDictionary dict;
+    int64_t i = 0;
+    while (!dict.isGrowing()) {
+        dict.atPut(TaggedValue::fromSmallInteger(i), TaggedValue::fromSmallInteger(i));
+        i++;
+    }
+    size_t sizeBefore = dict.size();
+
+    // Key 0 may still be in the old table; updating it must not add a second entry.
+    dict.atPut(TaggedValue::fromSmallInteger(0), TaggedValue::falseValue());
+
+    ASSERT_EQ(dict.size(), sizeBefore);
+    ASSERT_EQ(dict.at(TaggedValue::fromSmallInteger(0)), TaggedValue::falseValue());
+}
+
+TEST_F(HeapDictionary, IncrementalGrowthKeepsEveryEntryReachable) {
+    bool sawGrowth = false;
+    const int64_t count = 20000;
+
+    for (int64_t i = 0; i < count; i++) {
+        atPut(integer(i), integer(-i));
+        sawGrowth = sawGrowth || dictionary_table::isGrowing(dictionary());
+        if (dictionary_table::isGrowing(dictionary())) {
+            ASSERT_EQ(*find(integer(i / 2)), integer(-(i / 2)));
+        }
+    }
+
+    ASSERT_TRUE(sawGrowth) << "Growth should be spread over several inserts";
+    ASSERT_EQ(size(), static_cast<size_t>(count));
+    size_t visited = 0;
+    dictionary_table::forEach(dictionary(), [&](TaggedValue key, TaggedValue value) {
+        ASSERT_EQ(value, integer(-key.toSmallInteger()));
+        visited++;
+    });
+    ASSERT_EQ(visited, static_cast<size_t>(count));
+    for (int64_t i = 0; i < count; i++) {
+        ASSERT_EQ(*find(integer(i)), integer(-i));
+    }
+}
+
+TEST_F(HeapDictionary, OverwriteDuringGrowthDoesNotDuplicate) {
+    int64_t i = 0;
+    while (!dictionary_table::isGrowing(dictionary())) {
+        atPut(integer(i), integer(i));
+        i++;
+    }
+    size_t sizeBefore = size();
+
+    // Key 0 may still be in the old table; updating it must not add a second entry.
+    atPut(integer(0), TaggedValue::falseValue());
+
+    ASSERT_EQ(size(), sizeBefore);
+    ASSERT_EQ(*find(integer(0)), TaggedValue::falseValue());
+}
+
+TEST(Dictionary, TaggedValueRoundTrip) {
+    IdentityDictionary dict;
+    TaggedValue tagged = IdentityDictionary::toTaggedValue(&dict);
+    ASSERT_TRUE(tagged.isPointer());
+    ASSERT_EQ(IdentityDictionary::fromTaggedValue(tagged), &dict);
+    ASSERT_EQ(IdentityDictionary::fromTaggedValue(TaggedValue::nil()), nullptr);
+}
+
+// ============================================================================
+// Object keys
+// ============================================================================
+
+static TaggedValue makeByteArray(MemoryManager& memory, const char* text, uint32_t classIndex = 0) {
+    ObjectHeader* object = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY,
+                                                static_cast<uint32_t>(std::strlen(text)), classIndex);
+    std::memcpy(object->bytes(), text, object->size());
+    return object->toTaggedValue();
+}
+
+TEST_F(HeapDictionary, EqualityComparesByteArrayContents) {
+    IdentityDictionary identity;
+    std::vector<TaggedValue> keys = {vm.newString("hello")};
+    MemoryManager::ScopedRoots rooted(vm.memory(), keys);
+    keys.push_back(vm.newString("hello"));
+
+    atPut(keys[0], integer(1));
+    identity.atPut(keys[0], integer(1));
+
+    ASSERT_EQ(*find(keys[1]), integer(1));
+    ASSERT_FALSE(identity.includesKey(keys[1])) << "Identity keys must not match by contents";
+    ASSERT_EQ(find(vm.newString("world")), nullptr);
+}
+
+TEST_F(HeapDictionary, EqualByteKeysMustShareAClass) {
+    // Same bytes, different classes (say a String and a ByteArray)
+    std::vector<TaggedValue> keys = {makeByteArray(vm.memory(), "hello", vm.kernel().string)};
+    MemoryManager::ScopedRoots rooted(vm.memory(), keys);
+    keys.push_back(makeByteArray(vm.memory(), "hello", vm.kernel().byteArray));
+
+    atPut(keys[0], integer(1));
+    atPut(keys[1], integer(2));
+
+    ASSERT_EQ(size(), 2u);
+    ASSERT_EQ(*find(makeByteArray(vm.memory(), "hello", vm.kernel().string)), integer(1));
+    ASSERT_EQ(*find(makeByteArray(vm.memory(), "hello", vm.kernel().byteArray)), integer(2));
+}
+
+TEST(Dictionary, ObjectKeysSurviveMovingCollection) {
+    MemoryManager memory;
+    IdentityDictionary dict;
+    size_t provider = memory.addRootProvider(
+        [&dict](const MemoryManager::RootVisitor& visit) { dict.visitPointers(visit); });
+
+    std::vector<TaggedValue> keys;
+    for (int64_t i = 0; i < 100; i++) {
+        TaggedValue key = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 1)->toTaggedValue();
+        dict.atPut(key, TaggedValue::fromSmallInteger(i));
+        keys.push_back(key);
+    }
+    for (TaggedValue& key : keys) {
+        memory.addRoot(&key);
+    }
+    TaggedValue before = keys[0];
+
+    memory.minorCollection();
+    memory.majorCollection();
+
+    // Keys moved, but the hashes cached in the table came from their headers.
+    ASSERT_NE(keys[0], before);
+    for (int64_t i = 0; i < 100; i++) {
+        ASSERT_EQ(dict.at(keys[i]), TaggedValue::fromSmallInteger(i));
+    }
+    memory.removeRootProvider(provider);
+}
+
+TEST_F(HeapDictionary, EntriesFollowTheirObjectsThroughCollections) {
+    std::vector<TaggedValue> keys;
+    MemoryManager::ScopedRoots rooted(vm.memory(), keys);
+    for (int64_t i = 0; i < 100; i++) {
+        keys.push_back(vm.newArray({integer(i)}));
+        TaggedValue value = vm.newString(std::to_string(i));
+        atPut(keys.back(), value);
+    }
+    vm.memory().majorCollection();
+    TaggedValue before = keys[0];
+    // Young values stored into the now old table are found through the remembered set.
+    for (int64_t i = 0; i < 100; i++) {
+        TaggedValue value = vm.newString(std::to_string(-i));
+        atPut(keys[i], value);
+    }
+
+    vm.memory().minorCollection();
+    vm.memory().majorCollection();
+
+    ASSERT_NE(keys[0], before);
+    for (int64_t i = 0; i < 100; i++) {
+        ASSERT_EQ(SymbolTable::nameOf(*find(keys[i])), std::to_string(-i));
+    }
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
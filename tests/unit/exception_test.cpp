@@ -0,0 +1,205 @@
+#include "../src/classes/compiled_method.hpp"
+#include "../src/compiler.hpp"
+#include "../src/profiler.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace test_support;
+
+namespace {
+
+// Thrower signals from a chain of frames and logs the digits its ensure: blocks note
+void defineThrower(VM& vm) {
+    vm.defineClass("ZeroDivide", "Error", {});
+    vm.defineClass("Thrower", "Object", {"log"});
+    vm.compile("Thrower", "setUp log := 0");
+    vm.compile("Thrower", "log ^log");
+    vm.compile("Thrower", "note: digit log := log * 10 + digit");
+    vm.compile("Thrower", "raise: n n = 0 ifTrue: [^Error new signal: 'deep']. ^(self raise: n - 1) + 1");
+    vm.compile("Thrower", "raiseZeroDivide ^ZeroDivide new signal: 'by zero'");
+    vm.compile("Thrower", "catch: n ^[self raise: n] on: Error do: [:e | 0 - n]");
+    vm.compile("Thrower",
+               "guard: n\n"
+               "    n = 0 ifTrue: [^Error new signal].\n"
+               "    ^[self guard: n - 1] ensure: [self note: n]");
+}
+
+int64_t logOf(VM& vm, TaggedValue thrower) {
+    return vm.send(thrower, "log").toSmallInteger();
+}
+
+} // namespace
+
+// ============================================================================
+// Handler Tests
+// ============================================================================
+
+TEST(Exceptions, HandlerValueIsTheValueOfOnDo) {
+    VM vm;
+    vm.compile("Object", "caught ^[Error new signal: 'boom'. 1] on: Error do: [:e | e messageText]");
+    vm.compile("Object", "normal ^[1 + 1] on: Error do: [:e | 0]");
+    vm.compile("Object", "withoutArgument ^[Error new signal] on: Error do: [7]");
+    ASSERT_EQ(vm.printString(vm.send(TaggedValue::nil(), "caught")), "'boom'");
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "normal"), integer(2));
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "withoutArgument"), integer(7));
+}
+
+TEST(Exceptions, SignalUnwindsNativeFramesToTheHandler) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue thrower = newInstance(vm, "Thrower");
+    for (int64_t depth : {0, 1, 10, 100, 1000}) {
+        ASSERT_EQ(vm.send(thrower, "catch:", {integer(depth)}), integer(-depth));
+        ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+    }
+    // Mid-expression: the operands below the on:do: survive the unwinding
+    vm.compile("Thrower", "sum ^3 + ([self raise: 5] on: Error do: [:e | 4]) + 10");
+    ASSERT_EQ(vm.send(thrower, "sum"), integer(17));
+    vm.compile("Object", "yourself ^self");
+    vm.compile("Thrower", "cascade ^(Array new: 2) at: 1 put: ([self raise: 2] on: Error do: [5]); yourself");
+    TaggedValue array = vm.send(thrower, "cascade");
+    ASSERT_EQ(vm.send(array, "at:", {integer(1)}), integer(5));
+    ASSERT_TRUE(vm.send(array, "at:", {integer(2)}).isNil());
+}
+
+TEST(Exceptions, HandlersMatchTheExceptionClassAndItsSubclasses) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue thrower = newInstance(vm, "Thrower");
+    vm.compile("Thrower", "bySuperclass ^[self raiseZeroDivide] on: Error do: [:e | e messageText]");
+    vm.compile("Thrower",
+               "byOuter ^[[self raise: 3] on: ZeroDivide do: [:e | #inner]] on: Exception do: [:e | #outer]");
+    vm.compile("Thrower", "byInner ^[[self raiseZeroDivide] on: ZeroDivide do: [:e | #inner]] on: Error do: [:e | #outer]");
+    vm.compile("Thrower", "passed ^[[self raise: 1] on: Error do: [:e | e pass]] on: Error do: [:e | #outer]");
+    vm.compile("Thrower", "inHandler ^[[self raise: 1] on: Error do: [:e | self raise: 2]] on: Error do: [:e | #outer]");
+    ASSERT_EQ(vm.printString(vm.send(thrower, "bySuperclass")), "'by zero'");
+    ASSERT_EQ(vm.send(thrower, "byOuter"), vm.symbols().intern("outer"));
+    ASSERT_EQ(vm.send(thrower, "byInner"), vm.symbols().intern("inner"));
+    ASSERT_EQ(vm.send(thrower, "passed"), vm.symbols().intern("outer"));
+    ASSERT_EQ(vm.send(thrower, "inHandler"), vm.symbols().intern("outer"));
+}
+
+TEST(Exceptions, UnhandledExceptionsAreErrors) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue thrower = newInstance(vm, "Thrower");
+    try {
+        vm.send(thrower, "raise:", {integer(5)});
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        ASSERT_EQ(std::string(e.what()), "Unhandled Error: deep");
+    }
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+    vm.compile("Thrower", "wrongClass ^[self raise: 1] on: ZeroDivide do: [:e | 0]");
+    ASSERT_THROW(vm.send(thrower, "wrongClass"), std::runtime_error);
+    ASSERT_EQ(vm.send(thrower, "catch:", {integer(2)}), integer(-2));
+}
+
+// ============================================================================
+// Ensure Tests
+// ============================================================================
+
+TEST(Exceptions, EnsureBlocksRunOnEveryExit) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue thrower = newInstance(vm, "Thrower");
+    vm.compile("Thrower", "normal ^[self note: 1. 2] ensure: [self note: 3]");
+    vm.compile("Thrower", "early [^self note: 1] ensure: [self note: 2]. ^self note: 3");
+    vm.compile("Thrower", "nestedEarly [[^1] ensure: [self note: 1]] ensure: [self note: 2]");
+
+    ASSERT_EQ(vm.send(thrower, "normal"), integer(2));
+    ASSERT_EQ(logOf(vm, thrower), 13);
+    vm.send(thrower, "setUp");
+    vm.send(thrower, "early");
+    ASSERT_EQ(logOf(vm, thrower), 12);
+    vm.send(thrower, "setUp");
+    ASSERT_EQ(vm.send(thrower, "nestedEarly"), integer(1));
+    ASSERT_EQ(logOf(vm, thrower), 12);
+}
+
+TEST(Exceptions, UnwindingRunsEnsureBlocksInnermostFirst) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue thrower = newInstance(vm, "Thrower");
+    vm.compile("Thrower",
+               "protected ^[[self guard: 3] ensure: [self note: 9]] on: Error do: [:e | #caught]");
+    ASSERT_EQ(vm.send(thrower, "protected"), vm.symbols().intern("caught"));
+    ASSERT_EQ(logOf(vm, thrower), 1239);
+
+    // An ensure: outside the handler is not unwound
+    vm.send(thrower, "setUp");
+    vm.compile("Thrower", "outside ^[[self guard: 1] on: Error do: [:e | #caught]] ensure: [self note: 8]");
+    ASSERT_EQ(vm.send(thrower, "outside"), vm.symbols().intern("caught"));
+    ASSERT_EQ(logOf(vm, thrower), 18);
+}
+
+TEST(Exceptions, UnhandledErrorsRunTheEnsureBlocksTheyPass) {
+    VM vm;
+    defineThrower(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Thrower")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    ASSERT_THROW(vm.send(roots[0], "guard:", {integer(3)}), std::runtime_error);
+    ASSERT_EQ(logOf(vm, roots[0]), 123);
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+
+    // A VM error keeps its message and is not caught by on:do: on the way
+    std::string message;
+    try {
+        vm.send(TaggedValue::nil(), "foo");
+    } catch (const std::runtime_error& e) {
+        message = e.what();
+    }
+    vm.send(roots[0], "setUp");
+    vm.compile("Thrower",
+               "vmError ^[[[nil foo] ensure: [self note: 1]] on: Exception do: [:e | 0]] ensure: [self note: 2]");
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    try {
+        vm.send(roots[0], "vmError");
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        ASSERT_EQ(std::string(e.what()), message);
+    }
+    vm.interpreter().setProfiler(nullptr);
+    ASSERT_EQ(logOf(vm, roots[0]), 12);
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+    ASSERT_EQ(profiler.activeMethods(), 0u);
+
+    // A return from an ensure: block abandons the error
+    vm.compile("Thrower", "abandon [nil foo] ensure: [^#abandoned]");
+    ASSERT_EQ(vm.send(roots[0], "abandon"), vm.symbols().intern("abandoned"));
+}
+
+TEST(Exceptions, HandlerTablesOnlyWhereNeeded) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue plain = vm.compile("Object", "plain ^1 + 2");
+    TaggedValue guarded = vm.interpreter().lookup(vm.classIndexNamed("Thrower"), vm.symbols().intern("guard:"));
+    ASSERT_TRUE(st::mirrorOf<st::CompiledMethod>(plain)->getHandlers().isNil());
+    ASSERT_FALSE(st::mirrorOf<st::CompiledMethod>(guarded)->getHandlers().isNil());
+    ASSERT_THROW(vm.compile("Object", "notAClass: x ^[1] on: x do: [:e | 2]"), CompileError);
+}
+
+TEST(Exceptions, ProfilerActivationsFollowTheUnwinding) {
+    VM vm;
+    defineThrower(vm);
+    TaggedValue thrower = newInstance(vm, "Thrower");
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    ASSERT_EQ(vm.send(thrower, "catch:", {integer(20)}), integer(-20));
+    vm.interpreter().setProfiler(nullptr);
+    ASSERT_EQ(profiler.activeMethods(), 0u);
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,205 @@
+#include "../src/assembler.hpp"
+#include "../src/interpreter.hpp"
+#include "../src/symbol_table.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace test_support;
+
+namespace {
+
+// Installs code assembled by build as selector in className
+void install(VM& vm, const char* className, const char* selector, uint32_t numArgs, uint32_t numTemps,
+             const std::function<void(Assembler&)>& build) {
+    Assembler assembler;
+    MemoryManager::ScopedRoots roots(vm.memory(), assembler.literals());
+    build(assembler);
+    TaggedValue method = vm.newMethod(assembler.bytecodes(), assembler.literals(), numArgs, numTemps);
+    std::vector<TaggedValue> rooted{method};
+    MemoryManager::ScopedRoots methodRoots(vm.memory(), rooted);
+    TaggedValue symbol = vm.symbols().intern(selector);
+    vm.installMethod(vm.classIndexNamed(className), symbol, rooted[0]);
+}
+
+} // namespace
+
+// ============================================================================
+// Assembled Method Tests
+// ============================================================================
+
+TEST(Interpreter, RunsAssembledMethod) {
+    VM vm;
+    // answer: x ^x + 1
+    install(vm, "SmallInteger", "incremented", 0, 0, [&](Assembler& a) {
+        a.pushSelf();
+        a.pushLiteral(integer(1));
+        a.send(vm.symbols().intern("+"), 1);
+        a.returnTop();
+    });
+    ASSERT_EQ(vm.send(integer(41), "incremented"), integer(42));
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+}
+
+TEST(Interpreter, ConditionalJumpsAndTemporaries) {
+    VM vm;
+    // countTo: n | i | i := 0. [i < n] whileTrue: [i := i + 1]. ^i
+    install(vm, "Object", "countTo:", 1, 1, [&](Assembler& a) {
+        Assembler::Label loop = a.newLabel();
+        Assembler::Label done = a.newLabel();
+        a.pushLiteral(integer(0));
+        a.storeTemporary(1);
+        a.pop();
+        a.bind(loop);
+        a.pushTemporary(1);
+        a.pushTemporary(0);
+        a.send(vm.symbols().intern("<"), 1);
+        a.jumpIfFalse(done);
+        a.pushTemporary(1);
+        a.pushLiteral(integer(1));
+        a.send(vm.symbols().intern("+"), 1);
+        a.storeTemporary(1);
+        a.pop();
+        a.jump(loop);
+        a.bind(done);
+        a.pushTemporary(1);
+        a.returnTop();
+    });
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "countTo:", {integer(1000)}), integer(1000));
+    ASSERT_GT(vm.interpreter().bytecodesExecuted(), 1000u);
+}
+
+TEST(Interpreter, UnboundLabelIsRejected) {
+    Assembler assembler;
+    assembler.jump(assembler.newLabel());
+    ASSERT_THROW(assembler.bytecodes(), std::logic_error);
+}
+
+// ============================================================================
+// Primitive Tests
+// ============================================================================
+
+TEST(Interpreter, SmallIntegerPrimitives) {
+    VM vm;
+    ASSERT_EQ(vm.send(integer(7), "//", {integer(-2)}), integer(-4));
+    ASSERT_EQ(vm.send(integer(7), "\\\\", {integer(-2)}), integer(-1));
+    ASSERT_EQ(vm.send(integer(6), "*", {integer(7)}), integer(42));
+    ASSERT_EQ(vm.send(integer(1), "bitShift:", {integer(10)}), integer(1024));
+    ASSERT_EQ(vm.send(integer(3), "<", {integer(4)}), TaggedValue::trueValue());
+}
+
+TEST(Interpreter, FailedPrimitiveRunsFallbackCode) {
+    VM vm;
+    // Inexact division fails primitive 10 and retries in Float
+    TaggedValue result = vm.send(integer(1), "/", {integer(4)});
+    ASSERT_TRUE(result.isFloat());
+    ASSERT_EQ(result.toFloat(), 0.25);
+}
+
+TEST(Interpreter, FloatsRoundTripExactly) {
+    VM vm;
+    for (double d : {0.1, 1.0 / 3.0, 1e300, -1e-300, 4.9e-324, std::numeric_limits<double>::infinity()}) {
+        std::vector<TaggedValue> value = {vm.newFloat(d)};
+        MemoryManager::ScopedRoots rooted(vm.memory(), value);
+        ASSERT_EQ(value[0].isPointer(), !TaggedValue::isImmediateFloat(d));
+        double decoded = 0.0;
+        ASSERT_TRUE(VM::floatValue(value[0], decoded));
+        ASSERT_EQ(decoded, d);
+        // Through the Float primitives, boxed and immediate alike
+        ASSERT_TRUE(VM::floatValue(vm.send(value[0], "*", {integer(1)}), decoded));
+        ASSERT_EQ(decoded, d);
+        ASSERT_EQ(vm.send(value[0], "=", {value[0]}), TaggedValue::trueValue());
+    }
+    vm.compile("Object", "sum ^0.1 + 0.2");
+    double sum = 0.0;
+    ASSERT_TRUE(VM::floatValue(vm.send(TaggedValue::nil(), "sum"), sum));
+    ASSERT_EQ(sum, 0.1 + 0.2);
+    vm.compile("Object", "huge ^1.0e300 * 10");
+    TaggedValue huge = vm.send(TaggedValue::nil(), "huge");
+    ASSERT_TRUE(huge.isPointer());
+    ASSERT_EQ(vm.printString(huge), vm.printString(vm.newFloat(1.0e300 * 10)));
+    ASSERT_FALSE(VM::floatValue(vm.newString("1.5"), sum));
+}
+
+TEST(Interpreter, PrimitiveFailureWithoutFallbackThrows) {
+    VM vm;
+    ASSERT_THROW(vm.send(integer(1), "//", {integer(0)}), std::runtime_error);
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+}
+
+// ============================================================================
+// Error Tests
+// ============================================================================
+
+TEST(Interpreter, DoesNotUnderstandUnwindsTheStacks) {
+    VM vm;
+    try {
+        vm.send(integer(3), "frobnicate");
+        FAIL() << "expected doesNotUnderstand";
+    } catch (const std::runtime_error& e) {
+        ASSERT_NE(std::string(e.what()).find("SmallInteger doesNotUnderstand: #frobnicate"),
+                  std::string::npos);
+    }
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+    ASSERT_EQ(vm.send(integer(3), "+", {integer(4)}), integer(7));
+}
+
+TEST(Interpreter, NonBooleanConditionThrows) {
+    VM vm;
+    vm.compile("Object", "test ^3 ifTrue: [1] ifFalse: [2]");
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "test"), std::runtime_error);
+}
+
+// ============================================================================
+// Garbage Collection Tests
+// ============================================================================
+
+TEST(Interpreter, CollectionsDuringExecutionKeepFramesValid) {
+    VM vm(64 * 1024);
+    vm.defineClass("Pair", "Object", {"first", "second"});
+    vm.compile("Pair", "first ^first");
+    vm.compile("Pair", "first: a second: b first := a. second := b");
+    vm.compile("Object",
+               "churn: n\n"
+               "    | keep |\n"
+               "    keep := Pair new first: 'kept' second: nil.\n"
+               "    1 to: n do: [:i | keep := Pair new first: keep first second: (Array new: 8)].\n"
+               "    ^keep first");
+    size_t minorBefore = vm.memory().minorCollections();
+    TaggedValue result = vm.send(TaggedValue::nil(), "churn:", {integer(20000)});
+    ASSERT_GT(vm.memory().minorCollections(), minorBefore);
+    ASSERT_EQ(SymbolTable::nameOf(result), "kept");
+}
+
+TEST(Interpreter, DictionariesThatOnlyReachThemselvesAreCollected) {
+    VM vm;
+    vm.compile("Object",
+               "fill: n\n"
+               "    | keep d |\n"
+               "    keep := Dictionary new.\n"
+               "    1 to: n do: [:i | d := Dictionary new. d at: #me put: d].\n"
+               "    keep at: #key put: 'kept'.\n"
+               "    ^keep");
+    std::vector<TaggedValue> roots = {vm.send(TaggedValue::nil(), "fill:", {integer(1000)})};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.memory().majorCollection();
+    size_t dictionaries = 0;
+    vm.memory().forEachObject([&](ObjectHeader* object) {
+        dictionaries += object->classIndex() == vm.kernel().dictionary ? 1 : 0;
+    });
+    // Only the Dictionary still referenced survives, with its contents
+    ASSERT_EQ(dictionaries, 1u);
+    ASSERT_EQ(SymbolTable::nameOf(vm.send(roots[0], "at:", {symbol(vm, "key")})), "kept");
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
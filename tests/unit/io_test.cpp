@@ -0,0 +1,231 @@
+#include "../src/io_loop.hpp"
+#include "../src/scheduler.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace test_support;
+
+namespace {
+
+// An echo server and its clients, all Processes of one VM
+void defineEcho(VM& vm) {
+    vm.defineClass("Echo", "Object", {"listener", "served", "log", "count"});
+    vm.compile("Echo", "setUp listener := Socket new listenOn: 0. served := 0. log := Array new: 100. count := 0");
+    vm.compile("Echo", "port ^listener port");
+    vm.compile("Echo", "served ^served");
+    vm.compile("Echo", "count ^count");
+    vm.compile("Echo", "log ^log");
+    vm.compile("Echo", "record: value count := count + 1. log at: count put: value");
+    vm.compile("Echo", "serve: clients clients timesRepeat: [self fork: #echo: with: listener accept at: 4]");
+    vm.compile("Echo",
+               "echo: socket\n"
+               "    | buffer n |\n"
+               "    buffer := ByteArray new: 64.\n"
+               "    n := socket read: buffer.\n"
+               "    [n > 0] whileTrue: [socket write: buffer startingAt: 1 count: n. n := socket read: buffer].\n"
+               "    socket close.\n"
+               "    served := served + 1");
+    vm.compile("Echo",
+               "request: aString\n"
+               "    | socket reply got n |\n"
+               "    socket := Socket new connectTo: '127.0.0.1' port: self port.\n"
+               "    socket write: aString.\n"
+               "    reply := String new: aString size.\n"
+               "    got := 0.\n"
+               "    [got < aString size] whileTrue: [\n"
+               "        n := socket read: reply startingAt: got + 1 count: aString size - got.\n"
+               "        n = 0 ifTrue: [^nil].\n"
+               "        got := got + n].\n"
+               "    socket close.\n"
+               "    ^reply");
+    vm.compile("Echo", "check: aString (self request: aString) = aString ifTrue: [self record: aString size]");
+    vm.compile("Echo", "readFrom: socket self record: (socket read: (ByteArray new: 8))");
+    vm.compile("Echo", "countThenWrite: socket 1 to: 3 do: [:i | self record: i. Process yield]. socket write: 'x'");
+    vm.compile("Echo", "closeLater: socket Process yield. socket close");
+    vm.compile("Echo", "writeThenClose: socket socket write: 'x'. Process yield. socket close");
+}
+
+std::vector<int64_t> logged(VM& vm, TaggedValue echo) {
+    std::vector<int64_t> result;
+    int64_t count = vm.send(echo, "count").toSmallInteger();
+    TaggedValue log = vm.send(echo, "log");
+    for (int64_t i = 1; i <= count; i++) {
+        result.push_back(vm.send(log, "at:", {integer(i)}).toSmallInteger());
+    }
+    return result;
+}
+
+std::string temporaryPath(const char* name) {
+    return "/tmp/io_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+// Two ends of one loopback connection: roots[first] connected, roots[first + 1] accepted
+void connectedPair(VM& vm, std::vector<TaggedValue>& roots) {
+    vm.compile("Object", "connectTo: port ^Socket new connectTo: '127.0.0.1' port: port");
+    vm.compile("Object", "acceptFrom: echo ^echo listener accept");
+    vm.compile("Echo", "listener ^listener");
+    roots.push_back(vm.send(TaggedValue::nil(), "connectTo:", {vm.send(roots[0], "port")}));
+    roots.push_back(vm.send(TaggedValue::nil(), "acceptFrom:", {roots[0]}));
+}
+
+} // namespace
+
+// ============================================================================
+// Socket Tests
+// ============================================================================
+
+TEST(IO, LoopbackEcho) {
+    VM vm;
+    defineEcho(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Echo")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    ASSERT_GT(vm.send(roots[0], "port").toSmallInteger(), 0);
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "serve:"), integer(1), integer(Scheduler::USER_PRIORITY)});
+
+    // The caller's Process waits for its reply while the server's Processes run
+    TaggedValue reply = vm.send(roots[0], "request:", {vm.newString("hello, world")});
+    ASSERT_EQ(vm.printString(reply), "'hello, world'");
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(vm.send(roots[0], "served"), integer(1));
+
+    IOLoop& io = vm.interpreter().scheduler().io();
+    ASSERT_EQ(io.openDescriptors(), 1u);  // The listener
+    ASSERT_EQ(io.waiting(), 0u);
+    ASSERT_GT(io.wakeups(), 0u);
+}
+
+TEST(IO, ManyConcurrentClients) {
+    VM vm;
+    defineEcho(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Echo")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    constexpr int64_t CLIENTS = 50;
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "serve:"), integer(CLIENTS), integer(Scheduler::USER_PRIORITY)});
+    for (int64_t i = 1; i <= CLIENTS; i++) {
+        vm.send(roots[0], "fork:with:at:",
+                {symbol(vm, "check:"), vm.newString(std::string(static_cast<size_t>(i), 'x')),
+                 integer(Scheduler::USER_PRIORITY)});
+    }
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(vm.send(roots[0], "served"), integer(CLIENTS));
+    ASSERT_EQ(vm.send(roots[0], "count"), integer(CLIENTS));
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 1u);
+    ASSERT_EQ(vm.interpreter().scheduler().io().openDescriptors(), 1u);
+}
+
+TEST(IO, OtherProcessesRunWhileOneWaits) {
+    VM vm;
+    defineEcho(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Echo")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    connectedPair(vm, roots);
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "readFrom:"), roots[2], integer(Scheduler::USER_PRIORITY)});
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "countThenWrite:"), roots[1], integer(Scheduler::USER_PRIORITY)});
+    vm.interpreter().runProcesses();
+    // The reader waited through the counting and read the one byte written after it
+    ASSERT_EQ(logged(vm, roots[0]), (std::vector<int64_t>{1, 2, 3, 1}));
+}
+
+TEST(IO, TwoReadersOnOneSocket) {
+    VM vm;
+    defineEcho(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Echo")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    connectedPair(vm, roots);
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "readFrom:"), roots[2], integer(Scheduler::USER_PRIORITY)});
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "readFrom:"), roots[2], integer(Scheduler::USER_PRIORITY)});
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "writeThenClose:"), roots[1], integer(Scheduler::USER_PRIORITY)});
+    vm.interpreter().runProcesses();
+    // Both waits were woken: one reader got the byte, the other waited again for the end
+    ASSERT_EQ(logged(vm, roots[0]), (std::vector<int64_t>{1, 0}));
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 1u);
+    ASSERT_EQ(vm.interpreter().scheduler().io().waiting(), 0u);
+}
+
+TEST(IO, CloseWakesWaiters) {
+    VM vm;
+    defineEcho(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Echo")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    connectedPair(vm, roots);
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "readFrom:"), roots[2], integer(Scheduler::USER_PRIORITY)});
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "closeLater:"), roots[2], integer(Scheduler::USER_PRIORITY)});
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(logged(vm, roots[0]), (std::vector<int64_t>{0}));
+    ASSERT_EQ(vm.interpreter().scheduler().io().waiting(), 0u);
+    ASSERT_FALSE(vm.send(roots[2], "isOpen").isTrue());
+}
+
+TEST(IO, ConnectionRefused) {
+    VM vm;
+    defineEcho(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Echo")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    TaggedValue port = vm.send(roots[0], "port");
+    vm.compile("Echo", "close listener close");
+    vm.send(roots[0], "close");
+    vm.compile("Object", "connectTo: port ^Socket new connectTo: '127.0.0.1' port: port");
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "connectTo:", {port}), std::runtime_error);
+    ASSERT_EQ(vm.interpreter().scheduler().io().openDescriptors(), 0u);
+}
+
+// ============================================================================
+// File Tests
+// ============================================================================
+
+TEST(IO, FileWriteThenRead) {
+    VM vm;
+    std::string path = temporaryPath("file");
+    vm.compile("Object",
+               "write: aString to: path | file | file := File new openWrite: path. file write: aString. file close");
+    vm.compile("Object",
+               "readFrom: path\n"
+               "    | file buffer n |\n"
+               "    file := File new openRead: path.\n"
+               "    buffer := String new: 11.\n"
+               "    n := file read: buffer.\n"
+               "    (file read: (ByteArray new: 4)) = 0 ifFalse: [^nil].\n"
+               "    file close.\n"
+               "    ^n = 11 ifTrue: [buffer] ifFalse: [nil]");
+    vm.send(TaggedValue::nil(), "write:to:", {vm.newString("hello world"), vm.newString(path)});
+    ASSERT_EQ(vm.printString(vm.send(TaggedValue::nil(), "readFrom:", {vm.newString(path)})), "'hello world'");
+    ASSERT_EQ(vm.interpreter().scheduler().io().openDescriptors(), 0u);
+    unlink(path.c_str());
+
+    vm.compile("Object", "open: path ^File new openRead: path");
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "open:", {vm.newString(path)}), std::runtime_error);
+}
+
+TEST(IO, TransfersCheckTheirBuffer) {
+    VM vm;
+    std::string path = temporaryPath("buffer");
+    vm.compile("Object", "create: path (File new openWrite: path) close");
+    vm.compile("Object",
+               "read: path into: buffer count: n\n"
+               "    | file |\n"
+               "    file := File new openRead: path.\n"
+               "    ^[file read: buffer startingAt: 1 count: n] ensure: [file close]");
+    std::vector<TaggedValue> roots = {vm.newString(path)};
+    vm.send(TaggedValue::nil(), "create:", {roots[0]});
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "read:into:count:", {roots[0], vm.newString("abc"), integer(3)}), integer(0));
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "read:into:count:", {roots[0], vm.newString("abc"), integer(4)}),
+                 std::runtime_error);
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "read:into:count:", {roots[0], vm.newArray({}), integer(0)}),
+                 std::runtime_error);
+    unlink(path.c_str());
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,247 @@
+#include "../src/envelope.hpp"
+#include "../src/image_segment.hpp"
+#include "../src/isolate.hpp"
+#include "../src/scheduler.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace test_support;
+
+namespace {
+
+void definePair(VM& vm) {
+    vm.defineClass("Pair", "Object", {"first", "second"});
+    vm.compile("Pair", "first ^first");
+    vm.compile("Pair", "second ^second");
+    vm.compile("Pair", "first: a second: b first := a. second := b");
+    vm.compile("Pair", "first: a first := a");
+    vm.compile("Pair", "sum ^first + second");
+}
+
+// A segment holding the kernel plus Pair and a few methods on Object
+std::shared_ptr<const ImageSegment> buildImage() {
+    VM vm;
+    definePair(vm);
+    vm.compile("Object", "fib: n n < 2 ifTrue: [^n]. ^(self fib: n - 1) + (self fib: n - 2)");
+    vm.compile("Object", "literals ^#(1 2 'text' #symbol)");
+    vm.compile("Object", "spoilLiterals ^self literals at: 1 put: 99");
+    vm.compile("Object",
+               "chain: n\n"
+               "    | head |\n"
+               "    1 to: n do: [:i | head := Pair new first: i second: head].\n"
+               "    ^head");
+    return ImageSegment::build(vm);
+}
+
+bool inSegment(const ImageSegment& image, TaggedValue value) {
+    return value.isPointer() && image.contains(value.toPointer());
+}
+
+} // namespace
+
+// ============================================================================
+// Image Segment Tests
+// ============================================================================
+
+TEST(ImageSegment, SharesClassesMethodsAndSymbols) {
+    std::shared_ptr<const ImageSegment> image = buildImage();
+    ASSERT_GT(image->objectCount(), 0u);
+    VM first(image);
+    VM second(image);
+
+    uint32_t pair = first.classIndexNamed("Pair");
+    ASSERT_NE(pair, ClassTable::INVALID_INDEX);
+    ASSERT_EQ(second.classIndexNamed("Pair"), pair);
+    ASSERT_EQ(first.classes().classAt(pair), second.classes().classAt(pair));
+    ASSERT_TRUE(inSegment(*image, first.classes().classAt(first.kernel().array)));
+    ASSERT_EQ(first.symbols().intern("fib:"), second.symbols().intern("fib:"));
+    ASSERT_TRUE(inSegment(*image, first.symbols().intern("fib:")));
+
+    TaggedValue method = first.interpreter().lookup(first.kernel().smallInteger, first.symbols().intern("fib:"));
+    ASSERT_TRUE(inSegment(*image, method));
+    ASSERT_TRUE(ObjectHeader::fromTaggedValue(method)->hasFlag(ObjectHeader::FLAG_IMMUTABLE));
+    ASSERT_EQ(first.send(TaggedValue::nil(), "fib:", {integer(20)}), integer(6765));
+    ASSERT_EQ(second.send(TaggedValue::nil(), "fib:", {integer(15)}), integer(610));
+}
+
+TEST(ImageSegment, SharedObjectsCannotChange) {
+    VM vm(buildImage());
+    TaggedValue literals = vm.send(TaggedValue::nil(), "literals");
+    ASSERT_TRUE(inSegment(*vm.image(), literals));
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "spoilLiterals"), std::runtime_error);
+    ASSERT_EQ(vm.send(literals, "at:", {integer(1)}), integer(1));
+    ASSERT_THROW(vm.memory().storePointer(ObjectHeader::fromTaggedValue(literals), 0, integer(2)),
+                 std::runtime_error);
+}
+
+TEST(ImageSegment, VMsExtendTheirImageIndependently) {
+    std::shared_ptr<const ImageSegment> image = buildImage();
+    VM first(image);
+    VM second(image);
+    first.compile("Object", "answer ^42");
+    first.compile("Pair", "sum ^0");
+    first.defineClass("Triple", "Pair", {"third"});
+    first.compile("Triple", "third ^third");
+
+    ASSERT_EQ(first.send(TaggedValue::nil(), "answer"), integer(42));
+    ASSERT_THROW(second.send(TaggedValue::nil(), "answer"), std::runtime_error);
+    ASSERT_EQ(second.classIndexNamed("Triple"), ClassTable::INVALID_INDEX);
+
+    TaggedValue pair = first.send(TaggedValue::nil(), "chain:", {integer(1)});
+    ASSERT_EQ(first.send(pair, "sum"), integer(0));
+    pair = second.send(TaggedValue::nil(), "chain:", {integer(1)});
+    ASSERT_EQ(second.send(pair, "first"), integer(1));
+    ASSERT_THROW(second.send(pair, "sum"), std::runtime_error);  // 1 + nil
+    // Inherited through the shared superclass, which now has a method only first sees
+    TaggedValue triple = first.instantiate(first.classIndexNamed("Triple"));
+    ASSERT_EQ(first.send(triple, "answer"), integer(42));
+}
+
+TEST(ImageSegment, CollectionsLeaveTheSegmentAlone) {
+    VM vm(buildImage(), 64 * 1024);
+    std::vector<TaggedValue> roots = {vm.send(TaggedValue::nil(), "chain:", {integer(20000)})};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.memory().majorCollection();
+    ASSERT_GT(vm.memory().minorCollections(), 0u);
+    ASSERT_EQ(vm.send(roots[0], "first"), integer(20000));
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "fib:", {integer(10)}), integer(55));
+    ASSERT_EQ(vm.printString(vm.symbols().intern("chain:")), "#chain:");
+}
+
+TEST(ImageSegment, IsBuiltOnlyFromBootstrappedVMs) {
+    VM shared(buildImage());
+    ASSERT_THROW(ImageSegment::build(shared), std::invalid_argument);
+}
+
+// ============================================================================
+// Envelope Tests
+// ============================================================================
+
+TEST(Envelope, CopiesGraphsWithSharingAndCycles) {
+    std::shared_ptr<const ImageSegment> image = buildImage();
+    VM from(image);
+    VM into(image);
+    std::vector<TaggedValue> roots = {from.send(TaggedValue::nil(), "chain:", {integer(3)})};
+    MemoryManager::ScopedRoots scoped(from.memory(), roots);
+    // A cycle through the tail, and the head shared by a second root
+    TaggedValue tail = from.send(from.send(roots[0], "second"), "second");
+    from.send(tail, "first:", {roots[0]});
+    roots.push_back(from.newArray({roots[0], from.newString("hello"), from.symbols().intern("notInImage"),
+                                   from.send(TaggedValue::nil(), "literals")}));
+
+    Envelope envelope = Envelope::copy(from, roots);
+    ASSERT_EQ(envelope.objectCount(), 6u);  // 3 Pairs, Array, String, Symbol
+    std::vector<TaggedValue> copies = envelope.open(into);
+    ASSERT_EQ(copies.size(), 2u);
+    ASSERT_TRUE(into.memory().contains(copies[0].toPointer()));
+    ASSERT_EQ(into.send(copies[1], "at:", {integer(1)}), copies[0]);
+    TaggedValue copiedTail = into.send(into.send(copies[0], "second"), "second");
+    ASSERT_EQ(into.send(copiedTail, "first"), copies[0]);
+    ASSERT_EQ(into.printString(into.send(copies[1], "at:", {integer(2)})), "'hello'");
+    ASSERT_EQ(into.send(copies[1], "at:", {integer(3)}), into.symbols().intern("notInImage"));
+    // Segment objects travel by reference
+    ASSERT_EQ(into.send(copies[1], "at:", {integer(4)}), from.send(TaggedValue::nil(), "literals"));
+
+    // A copy, not a view
+    into.send(copies[0], "first:", {integer(7)});
+    ASSERT_EQ(from.send(roots[0], "first"), integer(3));
+}
+
+TEST(Envelope, CopiesDictionaries) {
+    VM from;
+    VM into;
+    TaggedValue dictionary = from.newDictionary();
+    std::vector<TaggedValue> roots = {dictionary};
+    MemoryManager::ScopedRoots scoped(from.memory(), roots);
+    from.send(roots[0], "at:put:", {from.newString("key"), integer(1)});
+    from.send(roots[0], "at:put:", {from.symbols().intern("other"), from.newArray({integer(2)})});
+
+    std::vector<TaggedValue> copies = Envelope::copy(from, roots).open(into);
+    ASSERT_EQ(into.send(copies[0], "at:", {into.newString("key")}), integer(1));
+    TaggedValue array = into.send(copies[0], "at:", {into.symbols().intern("other")});
+    ASSERT_EQ(into.send(array, "at:", {integer(1)}), integer(2));
+}
+
+TEST(Envelope, ChecksClassesAndImages) {
+    VM from;
+    definePair(from);
+    std::vector<TaggedValue> roots = {from.instantiate(from.classIndexNamed("Pair"))};
+    Envelope envelope = Envelope::copy(from, roots);
+
+    VM missing;
+    ASSERT_THROW(envelope.open(missing), std::invalid_argument);
+    VM different;
+    different.defineClass("Pair", "Object", {"only"});
+    ASSERT_THROW(envelope.open(different), std::invalid_argument);
+
+    VM shared(buildImage());
+    Envelope fromImage = Envelope::copy(shared, {shared.send(TaggedValue::nil(), "literals")});
+    ASSERT_EQ(fromImage.objectCount(), 0u);
+    ASSERT_THROW(fromImage.open(from), std::invalid_argument);
+    std::vector<TaggedValue> process = {from.interpreter().scheduler().activeProcess()};
+    ASSERT_THROW(Envelope::copy(from, process), std::invalid_argument);
+}
+
+// ============================================================================
+// Isolate Tests
+// ============================================================================
+
+TEST(Isolate, RunsSendsInParallelIsolates) {
+    std::shared_ptr<const ImageSegment> image = buildImage();
+    VM local(image);
+    std::vector<std::unique_ptr<Isolate>> isolates;
+    for (int i = 0; i < 4; i++) {
+        isolates.push_back(std::make_unique<Isolate>(image));
+    }
+    std::vector<std::future<Envelope>> answers;
+    for (int64_t i = 0; i < 4; i++) {
+        answers.push_back(isolates[i]->send("fib:", Envelope::copy(local, {TaggedValue::nil(), integer(20 + i)})));
+    }
+    int64_t expected[] = {6765, 10946, 17711, 28657};
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(answers[i].get().open(local)[0], integer(expected[i]));
+    }
+    ASSERT_EQ(isolates[0]->messagesHandled(), 1u);
+}
+
+TEST(Isolate, MessagesCarryDeepGraphsBetweenIsolates) {
+    std::shared_ptr<const ImageSegment> image = buildImage();
+    Isolate producer(image);
+    Isolate consumer(image);
+    VM local(image);
+    consumer.post([](VM& vm) { vm.compile("Pair", "length ^second isNil ifTrue: [1] ifFalse: [second length + 1]"); })
+        .get();
+
+    Envelope chain = producer.send("chain:", Envelope::copy(local, {TaggedValue::nil(), integer(1000)})).get();
+    ASSERT_EQ(chain.objectCount(), 1000u);
+    Envelope length = consumer.send("length", chain).get();
+    ASSERT_EQ(length.open(local)[0], integer(1000));
+}
+
+TEST(Isolate, ErrorsGoToTheFuture) {
+    std::shared_ptr<const ImageSegment> image = buildImage();
+    Isolate isolate(image);
+    VM local(image);
+    std::future<Envelope> failed = isolate.send("noSuchMessage", Envelope::copy(local, {integer(3)}));
+    ASSERT_THROW(failed.get(), std::runtime_error);
+    std::future<void> task = isolate.post([](VM&) { throw std::logic_error("task failed"); });
+    ASSERT_THROW(task.get(), std::logic_error);
+    // Still serving
+    ASSERT_EQ(isolate.send("fib:", Envelope::copy(local, {TaggedValue::nil(), integer(10)})).get().open(local)[0],
+              integer(55));
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
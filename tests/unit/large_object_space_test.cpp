@@ -0,0 +1,180 @@
+#include "../src/io_primitives.hpp"
+#include "../src/large_object_space.hpp"
+#include "../src/memory_manager.hpp"
+#include "../src/object_header.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// ============================================================================
+// Placement Tests
+// ============================================================================
+
+TEST(LargeObjectSpace, LargeObjectsAreAllocatedPinnedAndPageAligned) {
+    MemoryManager memory;
+    ObjectHeader* buffer = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 64 * 1024);
+
+    ASSERT_TRUE(memory.isLarge(buffer));
+    ASSERT_FALSE(memory.isYoung(buffer));
+    ASSERT_TRUE(buffer->hasFlag(ObjectHeader::FLAG_PINNED));
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(buffer->bytes()) % LargeObjectSpace::pageSize(), 0);
+    ASSERT_EQ(buffer->size(), 64 * 1024);
+    ASSERT_EQ(buffer->bytes()[0], 0);
+    ASSERT_EQ(buffer->bytes()[64 * 1024 - 1], 0);
+}
+
+TEST(LargeObjectSpace, SmallObjectsCanBePinnedExplicitly) {
+    MemoryManager memory;
+    ObjectHeader* pinned = memory.allocatePinnedBytes(ObjectHeader::TYPE_BYTE_ARRAY, 16);
+    ObjectHeader* movable = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 16);
+
+    ASSERT_TRUE(memory.isLarge(pinned));
+    ASSERT_TRUE(pinned->hasFlag(ObjectHeader::FLAG_PINNED));
+    ASSERT_FALSE(memory.isLarge(movable));
+    ASSERT_FALSE(movable->hasFlag(ObjectHeader::FLAG_PINNED));
+}
+
+// ============================================================================
+// Collection Tests
+// ============================================================================
+
+TEST(LargeObjectSpace, ReachableObjectsDoNotMove) {
+    MemoryManager memory;
+    ObjectHeader* buffer = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 32 * 1024);
+    buffer->bytes()[100] = 7;
+    TaggedValue root = buffer->toTaggedValue();
+    memory.addRoot(&root);
+
+    memory.minorCollection();
+    memory.majorCollection();
+
+    ASSERT_EQ(ObjectHeader::fromTaggedValue(root), buffer);
+    ASSERT_EQ(buffer->bytes()[100], 7);
+    ASSERT_FALSE(buffer->hasFlag(ObjectHeader::FLAG_MARKED)) << "Sweep must clear marks";
+}
+
+TEST(LargeObjectSpace, UnreachableObjectsAreSwept) {
+    MemoryManager memory;
+    TaggedValue root = memory.allocatePinnedBytes(ObjectHeader::TYPE_BYTE_ARRAY, 8)->toTaggedValue();
+    memory.addRoot(&root);
+    for (int i = 0; i < 10; i++) {
+        memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 32 * 1024);
+    }
+    size_t before = memory.largeObjectBytesUsed();
+
+    memory.majorCollection();
+
+    ASSERT_LT(memory.largeObjectBytesUsed(), before);
+    ASSERT_EQ(memory.largeObjectBytesUsed(), 2 * LargeObjectSpace::pageSize());
+    ASSERT_TRUE(memory.isLarge(root.toPointer()));
+}
+
+TEST(LargeObjectSpace, PinnedSlotsKeepTheirReferentsAlive) {
+    MemoryManager memory;
+    ObjectHeader* pinned = memory.allocatePinnedSlots(ObjectHeader::TYPE_ARRAY, 2);
+    ObjectHeader* young = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 4);
+    young->bytes()[0] = 9;
+    memory.storePointer(pinned, 0, young->toTaggedValue());
+    ObjectHeader* large = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 32 * 1024);
+    memory.storePointer(pinned, 1, large->toTaggedValue());
+    TaggedValue root = pinned->toTaggedValue();
+    memory.addRoot(&root);
+
+    // Minor: the young object survives through the remembered pinned object.
+    memory.minorCollection();
+    ObjectHeader* promoted = ObjectHeader::fromTaggedValue(pinned->slots()[0]);
+    ASSERT_FALSE(memory.isYoung(promoted));
+    ASSERT_EQ(promoted->bytes()[0], 9);
+
+    // Major: marking traces through the pinned object into old and large space.
+    memory.majorCollection();
+    ObjectHeader* compacted = ObjectHeader::fromTaggedValue(pinned->slots()[0]);
+    ASSERT_TRUE(memory.contains(compacted));
+    ASSERT_EQ(compacted->bytes()[0], 9);
+    ASSERT_TRUE(memory.isLarge(large));
+    ASSERT_EQ(pinned->slots()[1], large->toTaggedValue());
+}
+
+TEST(LargeObjectSpace, RememberedSlotsCanDieBeforeTheNextScavenge) {
+    MemoryManager memory;
+    ObjectHeader* pinned = memory.allocatePinnedSlots(ObjectHeader::TYPE_ARRAY, 1);
+    memory.storePointer(pinned, 0, memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1)->toTaggedValue());
+    size_t before = memory.largeObjectBytesUsed();
+
+    // Swept while its slot is still remembered
+    memory.majorCollection();
+    memory.minorCollection();
+
+    ASSERT_LT(memory.largeObjectBytesUsed(), before);
+}
+
+// ============================================================================
+// I/O Primitive Tests
+// ============================================================================
+
+TEST(LargeObjectSpace, ReadAndWriteGoStraightToPinnedBytes) {
+    MemoryManager memory;
+    ObjectHeader* out = memory.allocatePinnedBytes(ObjectHeader::TYPE_BYTE_ARRAY, 5);
+    ObjectHeader* in = memory.allocatePinnedBytes(ObjectHeader::TYPE_BYTE_ARRAY, 8);
+    std::memcpy(out->bytes(), "hello", 5);
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ASSERT_EQ(primitives::writeFrom(fds[0], out->toTaggedValue(), 0, 5), 5);
+    ASSERT_EQ(primitives::readInto(fds[1], in->toTaggedValue(), 2, 5), 5);
+    close(fds[0]);
+    close(fds[1]);
+
+    ASSERT_EQ(std::memcmp(in->bytes() + 2, "hello", 5), 0);
+    ASSERT_EQ(in->bytes()[0], 0);
+}
+
+TEST(LargeObjectSpace, IoAcceptsMovableBuffers) {
+    // The transfer is over before anything can collect, so the bytes need not be pinned
+    MemoryManager memory;
+    ObjectHeader* out = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 3);
+    ObjectHeader* in = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 3);
+    std::memcpy(out->bytes(), "abc", 3);
+    out->setFlag(ObjectHeader::FLAG_IMMUTABLE);
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ASSERT_EQ(primitives::writeFrom(fds[0], out->toTaggedValue(), 0, 3), 3);
+    ASSERT_EQ(primitives::readInto(fds[1], in->toTaggedValue(), 0, 3), 3);
+    close(fds[0]);
+    close(fds[1]);
+    ASSERT_EQ(std::memcmp(in->bytes(), "abc", 3), 0);
+}
+
+TEST(LargeObjectSpace, IoRejectsUnsuitableOrOutOfRangeBuffers) {
+    MemoryManager memory;
+    ObjectHeader* pinned = memory.allocatePinnedBytes(ObjectHeader::TYPE_BYTE_ARRAY, 8);
+    ObjectHeader* immutable = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 8);
+    immutable->setFlag(ObjectHeader::FLAG_IMMUTABLE);
+    ObjectHeader* slots = memory.allocatePinnedSlots(ObjectHeader::TYPE_ARRAY, 1);
+
+    ASSERT_THROW(primitives::readInto(0, immutable->toTaggedValue(), 0, 8), std::invalid_argument);
+    ASSERT_THROW(primitives::readInto(0, slots->toTaggedValue(), 0, 8), std::invalid_argument);
+    ASSERT_THROW(primitives::readInto(0, TaggedValue::fromSmallInteger(1), 0, 8),
+                 std::invalid_argument);
+    ASSERT_THROW(primitives::readInto(0, pinned->toTaggedValue(), 4, 5), std::out_of_range);
+    ASSERT_THROW(primitives::writeFrom(0, pinned->toTaggedValue(), 9, 0), std::out_of_range);
+}
+
+TEST(LargeObjectSpace, FailedSystemCallAnswersMinusOne) {
+    MemoryManager memory;
+    ObjectHeader* pinned = memory.allocatePinnedBytes(ObjectHeader::TYPE_BYTE_ARRAY, 8);
+    ASSERT_EQ(primitives::readInto(-1, pinned->toTaggedValue(), 0, 8), -1);
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
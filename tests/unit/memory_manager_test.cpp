@@ -0,0 +1,176 @@
+#include "../src/memory_manager.hpp"
+#include "../src/object_header.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <stdexcept>
+
+// ============================================================================
+// Allocation Tests
+// ============================================================================
+
+TEST(MemoryManager, AllocateSlotsStartNil) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 4);
+
+    ASSERT_EQ(object->type(), ObjectHeader::TYPE_ARRAY);
+    ASSERT_EQ(object->size(), 4);
+    ASSERT_TRUE(memory.isYoung(object));
+    for (uint32_t i = 0; i < 4; i++) {
+        ASSERT_TRUE(object->slots()[i].isNil());
+    }
+}
+
+TEST(MemoryManager, AllocateBytesStartZero) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 5);
+
+    ASSERT_TRUE(object->isBytes());
+    ASSERT_EQ(object->size(), 5);
+    for (uint32_t i = 0; i < 5; i++) {
+        ASSERT_EQ(object->bytes()[i], 0);
+    }
+}
+
+TEST(MemoryManager, AllocationTypeMismatchThrows) {
+    MemoryManager memory;
+    ASSERT_THROW(memory.allocateSlots(ObjectHeader::TYPE_BYTE_ARRAY, 1), std::invalid_argument);
+    ASSERT_THROW(memory.allocateBytes(ObjectHeader::TYPE_ARRAY, 1), std::invalid_argument);
+}
+
+// ============================================================================
+// Collection Tests
+// ============================================================================
+
+TEST(MemoryManager, MinorCollectionPromotesReachableObjects) {
+    MemoryManager memory;
+    ObjectHeader* array = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1);
+    ObjectHeader* element = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 0);
+    memory.storePointer(array, 0, element->toTaggedValue());
+
+    TaggedValue root = array->toTaggedValue();
+    memory.addRoot(&root);
+    memory.minorCollection();
+
+    ObjectHeader* promoted = ObjectHeader::fromTaggedValue(root);
+    ASSERT_NE(promoted, array);
+    ASSERT_FALSE(memory.isYoung(promoted));
+    ASSERT_TRUE(memory.contains(promoted));
+    ObjectHeader* promotedElement = ObjectHeader::fromTaggedValue(promoted->slots()[0]);
+    ASSERT_FALSE(memory.isYoung(promotedElement));
+    ASSERT_EQ(promotedElement->type(), ObjectHeader::TYPE_OBJECT);
+    ASSERT_EQ(memory.nurseryBytesUsed(), 0);
+}
+
+TEST(MemoryManager, UnreachableObjectsAreReclaimed) {
+    MemoryManager memory;
+    TaggedValue root = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 2)->toTaggedValue();
+    memory.addRoot(&root);
+    for (int i = 0; i < 100; i++) {
+        memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 8);
+    }
+
+    memory.minorCollection();
+    memory.majorCollection();
+
+    ASSERT_EQ(memory.oldSpaceBytesUsed(), sizeof(ObjectHeader) + 2 * sizeof(TaggedValue));
+}
+
+TEST(MemoryManager, WriteBarrierRemembersOldToYoungStores) {
+    MemoryManager memory;
+    TaggedValue root = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1)->toTaggedValue();
+    memory.addRoot(&root);
+    memory.minorCollection();
+
+    ObjectHeader* old = ObjectHeader::fromTaggedValue(root);
+    ObjectHeader* young = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 3);
+    young->bytes()[0] = 42;
+    memory.storePointer(old, 0, young->toTaggedValue());
+    ASSERT_TRUE(old->hasFlag(ObjectHeader::FLAG_REMEMBERED));
+
+    // The young object is only reachable through the remembered old object.
+    memory.minorCollection();
+
+    ObjectHeader* promoted = ObjectHeader::fromTaggedValue(old->slots()[0]);
+    ASSERT_FALSE(memory.isYoung(promoted));
+    ASSERT_EQ(promoted->bytes()[0], 42);
+    ASSERT_FALSE(old->hasFlag(ObjectHeader::FLAG_REMEMBERED));
+}
+
+TEST(MemoryManager, NurseryExhaustionTriggersMinorCollection) {
+    MemoryManager memory(64 * 1024, 1024 * 1024);
+    for (int i = 0; i < 10000; i++) {
+        memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 4);
+    }
+    ASSERT_GT(memory.minorCollections(), 0);
+}
+
+TEST(MemoryManager, ExternalPointersAreLeftAlone) {
+    MemoryManager memory;
+    static uint64_t external = 0;
+    ObjectHeader* array = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1);
+    memory.storePointer(array, 0, TaggedValue::fromPointer(&external));
+    TaggedValue root = array->toTaggedValue();
+    memory.addRoot(&root);
+
+    memory.majorCollection();
+
+    ASSERT_EQ(ObjectHeader::fromTaggedValue(root)->slots()[0].toPointer(), &external);
+}
+
+TEST(MemoryManager, OverflowSizedObjectsSurviveCollection) {
+    MemoryManager memory;
+    ObjectHeader* big = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 1000, 12);
+    ObjectHeader* small = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 0);
+    memory.storePointer(big, 999, small->toTaggedValue());
+    TaggedValue root = big->toTaggedValue();
+    memory.addRoot(&root);
+
+    memory.minorCollection();
+    memory.majorCollection();
+
+    ObjectHeader* moved = ObjectHeader::fromTaggedValue(root);
+    ASSERT_TRUE(moved->hasOverflowSize());
+    ASSERT_EQ(moved->size(), 1000);
+    ASSERT_EQ(moved->classIndex(), 12);
+    ASSERT_TRUE(memory.contains(moved->slots()[999].toPointer()));
+}
+
+// ============================================================================
+// Identity Hash Tests
+// ============================================================================
+
+TEST(MemoryManager, IdentityHashSurvivesScavengeAndCompaction) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 1);
+    uint32_t hash = object->identityHash();
+    TaggedValue root = object->toTaggedValue();
+    memory.addRoot(&root);
+
+    memory.minorCollection();
+    ObjectHeader* promoted = ObjectHeader::fromTaggedValue(root);
+    ASSERT_NE(promoted, object);
+    ASSERT_EQ(promoted->identityHash(), hash);
+
+    memory.majorCollection();
+    ObjectHeader* compacted = ObjectHeader::fromTaggedValue(root);
+    ASSERT_NE(compacted, promoted);
+    ASSERT_EQ(compacted->identityHash(), hash);
+}
+
+TEST(MemoryManager, UnhashedObjectsStayUnhashed) {
+    MemoryManager memory;
+    TaggedValue root = memory.allocateSlots(ObjectHeader::TYPE_OBJECT, 1)->toTaggedValue();
+    memory.addRoot(&root);
+    memory.minorCollection();
+    memory.majorCollection();
+    ASSERT_FALSE(ObjectHeader::fromTaggedValue(root)->hasIdentityHash());
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+#include "../src/classes/array.hpp"
+#include "../src/classes/byte_array.hpp"
+#include "../src/classes/compiled_method.hpp"
+#include "../src/classes/context.hpp"
+#include "../src/memory_manager.hpp"
+#include <gtest/gtest.h>
+
+// ============================================================================
+// Slot Index Tests
+// ============================================================================
+
+TEST(MirrorView, SlotIndicesFollowDeclarationOrder) {
+    static_assert(st::Context::Slots::METHOD == 0, "");
+    static_assert(st::Context::Slots::INSTRUCTION_POINTER == 3, "");
+    static_assert(st::Context::Slots::COUNT == 4, "");
+    static_assert(st::CompiledMethod::Slots::PRIMITIVE_NUMBER == 4, "");
+    static_assert(st::CompiledMethod::Slots::METHOD_CLASS == 6, "");
+    static_assert(st::CompiledMethod::Slots::HANDLERS == 7, "");
+    static_assert(st::CompiledMethod::Slots::COUNT == 8, "");
+    static_assert(st::Array::Slots::COUNT == 0, "");
+    SUCCEED();
+}
+
+// ============================================================================
+// In-Place Access Tests
+// ============================================================================
+
+TEST(MirrorView, ContextViewReadsAndWritesTheObjectBody) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateSlots(ObjectHeader::TYPE_CONTEXT, st::ContextSlots::COUNT);
+    object->slots()[st::ContextSlots::RECEIVER] = TaggedValue::fromSmallInteger(42);
+
+    st::Context* context = st::mirrorOf<st::Context>(object->toTaggedValue());
+    ASSERT_EQ(reinterpret_cast<void*>(context), reinterpret_cast<void*>(object->slots()));
+    ASSERT_EQ(context->receiver(), TaggedValue::fromSmallInteger(42));
+    ASSERT_TRUE(context->method().isNil());
+
+    context->setInstructionPointer(TaggedValue::fromSmallInteger(5));
+    ASSERT_EQ(object->slots()[st::ContextSlots::INSTRUCTION_POINTER], TaggedValue::fromSmallInteger(5));
+    ASSERT_EQ(st::headerOf(context), object);
+}
+
+TEST(MirrorView, CompiledMethodViewSeesBarrieredStores) {
+    MemoryManager memory;
+    ObjectHeader* method = memory.allocateSlots(ObjectHeader::TYPE_METHOD, st::CompiledMethodSlots::COUNT);
+    ObjectHeader* bytes = memory.allocateBytes(ObjectHeader::TYPE_BYTE_ARRAY, 3);
+    bytes->bytes()[2] = 0x7F;
+    memory.storePointer(method, st::CompiledMethodSlots::BYTES, bytes->toTaggedValue());
+    memory.storePointer(method, st::CompiledMethodSlots::NUM_ARGS, TaggedValue::fromSmallInteger(2));
+    TaggedValue root = method->toTaggedValue();
+    memory.addRoot(&root);
+
+    memory.minorCollection();
+
+    // Views are re-derived from the (moved) object; nothing was copied out.
+    st::CompiledMethod* view = st::mirrorOf<st::CompiledMethod>(root);
+    ASSERT_EQ(view->getNumArgs(), TaggedValue::fromSmallInteger(2));
+    st::ByteArray* code = st::mirrorOf<st::ByteArray>(view->getBytes());
+    ASSERT_EQ(code->size(), 3u);
+    ASSERT_EQ(code->at(2), 0x7F);
+}
+
+TEST(MirrorView, IndexedViewsCoverTheWholeBody) {
+    MemoryManager memory;
+    ObjectHeader* object = memory.allocateSlots(ObjectHeader::TYPE_ARRAY, 300);
+    object->slots()[299] = TaggedValue::fromSmallInteger(299);
+
+    st::Array* array = st::mirrorOf<st::Array>(object);
+    ASSERT_EQ(array->size(), 300u);
+    ASSERT_EQ(array->at(299), TaggedValue::fromSmallInteger(299));
+    array->elements()[0] = TaggedValue::trueValue();
+    ASSERT_EQ(object->slots()[0], TaggedValue::trueValue());
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+#include "../src/object_header.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Layout Tests
+// ============================================================================
+
+TEST(ObjectHeader, SizeIs64Bits) {
+    ASSERT_EQ(sizeof(ObjectHeader), 8) << "ObjectHeader must be 64 bits (8 bytes)";
+}
+
+TEST(ObjectHeader, FieldsAreIndependent) {
+    ObjectHeader header(ObjectHeader::TYPE_ARRAY, 200, ObjectHeader::MAX_CLASS_INDEX);
+    header.setFlag(ObjectHeader::FLAG_PINNED);
+    header.setHash(0x2ABCDEF);
+
+    ASSERT_EQ(header.size(), 200);
+    ASSERT_EQ(header.type(), ObjectHeader::TYPE_ARRAY);
+    ASSERT_TRUE(header.hasFlag(ObjectHeader::FLAG_PINNED));
+    ASSERT_FALSE(header.hasFlag(ObjectHeader::FLAG_MARKED));
+    ASSERT_EQ(header.classIndex(), ObjectHeader::MAX_CLASS_INDEX);
+    ASSERT_EQ(header.hash(), 0x2ABCDEF);
+
+    header.clearFlag(ObjectHeader::FLAG_PINNED);
+    header.setClassIndex(42);
+    ASSERT_EQ(header.flags(), 0);
+    ASSERT_EQ(header.size(), 200);
+    ASSERT_EQ(header.classIndex(), 42);
+    ASSERT_EQ(header.hash(), 0x2ABCDEF);
+}
+
+TEST(ObjectHeader, ClassIndexOutOfRangeThrows) {
+    ObjectHeader header(ObjectHeader::TYPE_OBJECT, 0);
+    ASSERT_THROW(header.setClassIndex(ObjectHeader::MAX_CLASS_INDEX + 1), std::length_error);
+}
+
+TEST(ObjectHeader, BodyBytes) {
+    ASSERT_EQ(ObjectHeader(ObjectHeader::TYPE_ARRAY, 3).bodyBytes(), 24);
+    ASSERT_EQ(ObjectHeader(ObjectHeader::TYPE_BYTE_ARRAY, 9).bodyBytes(), 16);
+    // Empty objects still get one word for the forwarding pointer.
+    ASSERT_EQ(ObjectHeader(ObjectHeader::TYPE_OBJECT, 0).bodyBytes(), 8);
+}
+
+TEST(ObjectHeader, LargeSizesUseOverflowWord) {
+    const uint32_t size = 100000;
+    std::vector<uint64_t> memory(ObjectHeader::totalBytesFor(ObjectHeader::TYPE_ARRAY, size) /
+                                 sizeof(uint64_t));
+    ObjectHeader* header = ObjectHeader::initialize(memory.data(), ObjectHeader::TYPE_ARRAY, size, 9);
+
+    ASSERT_EQ(reinterpret_cast<uint64_t*>(header), memory.data() + 1);
+    ASSERT_TRUE(header->hasOverflowSize());
+    ASSERT_EQ(header->size(), size);
+    ASSERT_EQ(header->classIndex(), 9);
+    ASSERT_EQ(header->objectStart(), reinterpret_cast<uint8_t*>(memory.data()));
+    ASSERT_EQ(header->totalBytes(), memory.size() * sizeof(uint64_t));
+    ASSERT_EQ(ObjectHeader::fromObjectStart(memory.data()), header);
+}
+
+TEST(ObjectHeader, SmallSizesHaveNoOverflowWord) {
+    uint64_t memory[2] = {};
+    ObjectHeader* header = ObjectHeader::initialize(memory, ObjectHeader::TYPE_ARRAY, 1, 9);
+
+    ASSERT_EQ(reinterpret_cast<uint64_t*>(header), memory);
+    ASSERT_FALSE(header->hasOverflowSize());
+    ASSERT_EQ(header->totalBytes(), sizeof(memory));
+    ASSERT_EQ(ObjectHeader::fromObjectStart(memory), header);
+}
+
+// ============================================================================
+// Identity Hash Tests (primitive 75)
+// ============================================================================
+
+TEST(ObjectHeader, IdentityHashIsLazy) {
+    ObjectHeader header(ObjectHeader::TYPE_OBJECT, 0);
+    ASSERT_FALSE(header.hasIdentityHash());
+    ASSERT_EQ(header.hash(), 0);
+
+    uint32_t hash = header.identityHash();
+    ASSERT_NE(hash, 0);
+    ASSERT_TRUE(header.hasIdentityHash());
+    ASSERT_EQ(header.identityHash(), hash) << "Identity hash must be stable";
+}
+
+TEST(ObjectHeader, IdentityHashSurvivesCopy) {
+    ObjectHeader original(ObjectHeader::TYPE_ARRAY, 2);
+    uint32_t hash = original.identityHash();
+
+    ObjectHeader copy;
+    std::memcpy(&copy, &original, sizeof(ObjectHeader));
+    ASSERT_EQ(copy.identityHash(), hash);
+}
+
+TEST(ObjectHeader, IdentityHashesAreDistinct) {
+    std::set<uint32_t> seen;
+    for (int i = 0; i < 1000; i++) {
+        ObjectHeader header(ObjectHeader::TYPE_OBJECT, 0);
+        seen.insert(header.identityHash());
+    }
+    ASSERT_EQ(seen.size(), 1000);
+}
+
+TEST(ObjectHeader, IdentityHashPerThreadGenerator) {
+    uint32_t other = 0;
+    std::thread thread([&other] {
+        ObjectHeader header(ObjectHeader::TYPE_OBJECT, 0);
+        other = header.identityHash();
+    });
+    thread.join();
+
+    ObjectHeader header(ObjectHeader::TYPE_OBJECT, 0);
+    ASSERT_NE(other, 0);
+    ASSERT_NE(header.identityHash(), 0);
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+#include "../src/profiler.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+using namespace test_support;
+
+namespace {
+
+// Stats of the method called name; an empty name if the profiler never saw it
+Profiler::MethodStats findMethod(const Profiler& profiler, const std::string& name) {
+    for (const Profiler::MethodStats& stats : profiler.methodStats()) {
+        if (stats.name == name) {
+            return stats;
+        }
+    }
+    return Profiler::MethodStats{};
+}
+
+void compileFib(VM& vm) {
+    vm.compile("Object", "fib: n ^n < 2 ifTrue: [n] ifFalse: [(self fib: n - 1) + (self fib: n - 2)]");
+}
+
+} // namespace
+
+// ============================================================================
+// Counting Tests
+// ============================================================================
+
+TEST(Profiler, CountsEveryBytecodeByOpcode) {
+    VM vm;
+    compileFib(vm);
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+
+    uint64_t before = vm.interpreter().bytecodesExecuted();
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "fib:", {integer(10)}), integer(55));
+    uint64_t executed = vm.interpreter().bytecodesExecuted() - before;
+
+    uint64_t counted = 0;
+    for (int opcode = 0; opcode < bytecode::OPCODE_COUNT; opcode++) {
+        counted += profiler.opcodeStats(static_cast<uint8_t>(opcode)).count;
+    }
+    ASSERT_EQ(counted, executed);
+    // One return per fib: activation
+    ASSERT_EQ(profiler.opcodeStats(bytecode::RETURN_STACK_TOP).count, 177u);
+    ASSERT_GT(profiler.opcodeStats(bytecode::SEND_MESSAGE).cycles, 0u);
+}
+
+TEST(Profiler, CountsMethodInvocationsIncludingPrimitives) {
+    VM vm;
+    compileFib(vm);
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    vm.send(TaggedValue::nil(), "fib:", {integer(10)});
+
+    Profiler::MethodStats fib = findMethod(profiler, "Object>>fib:");
+    ASSERT_EQ(fib.name, "Object>>fib:");
+    ASSERT_EQ(fib.invocations, 177u);
+    ASSERT_EQ(fib.activations, 0u);
+    ASSERT_EQ(findMethod(profiler, "SmallInteger>><").invocations, 177u);
+    ASSERT_EQ(findMethod(profiler, "SmallInteger>>+").invocations, 88u);
+}
+
+TEST(Profiler, RecursiveInclusiveTimeIsCountedOnce) {
+    VM vm;
+    compileFib(vm);
+    vm.compile("Object", "outer ^self fib: 12");
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    vm.send(TaggedValue::nil(), "outer");
+
+    Profiler::MethodStats outer = findMethod(profiler, "Object>>outer");
+    Profiler::MethodStats fib = findMethod(profiler, "Object>>fib:");
+    ASSERT_EQ(outer.invocations, 1u);
+    ASSERT_GT(fib.inclusiveCycles, 0u);
+    ASSERT_LE(fib.inclusiveCycles, outer.inclusiveCycles);
+    ASSERT_LE(fib.exclusiveCycles, fib.inclusiveCycles);
+    ASSERT_LE(outer.exclusiveCycles, outer.inclusiveCycles - fib.inclusiveCycles);
+}
+
+TEST(Profiler, ErrorsUnwindActivations) {
+    VM vm;
+    vm.compile("Object", "fail ^self zork");
+    vm.compile("Object", "caller ^self fail");
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "caller"), std::runtime_error);
+    ASSERT_EQ(profiler.activeMethods(), 0u);
+    ASSERT_EQ(findMethod(profiler, "Object>>caller").activations, 0u);
+    ASSERT_EQ(findMethod(profiler, "Object>>fail").invocations, 1u);
+
+    // The profiler keeps working after the unwind
+    ASSERT_EQ(vm.send(integer(3), "+", {integer(4)}), integer(7));
+    ASSERT_EQ(findMethod(profiler, "SmallInteger>>+").invocations, 1u);
+}
+
+TEST(Profiler, DetachedProfilerSeesNothing) {
+    VM vm;
+    compileFib(vm);
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    vm.interpreter().setProfiler(nullptr);
+    vm.send(TaggedValue::nil(), "fib:", {integer(8)});
+    ASSERT_TRUE(profiler.methodStats().empty());
+    ASSERT_EQ(profiler.opcodeStats(bytecode::SEND_MESSAGE).count, 0u);
+}
+
+TEST(Profiler, ReportListsOpcodesAndMethods) {
+    VM vm;
+    compileFib(vm);
+    Profiler profiler;
+    vm.interpreter().setProfiler(&profiler);
+    vm.send(TaggedValue::nil(), "fib:", {integer(8)});
+
+    std::ostringstream report;
+    profiler.writeReport(report);
+    ASSERT_NE(report.str().find("SEND_MESSAGE"), std::string::npos);
+    ASSERT_NE(report.str().find("Object>>fib:"), std::string::npos);
+
+    profiler.reset();
+    ASSERT_EQ(profiler.opcodeStats(bytecode::SEND_MESSAGE).count, 0u);
+    ASSERT_EQ(findMethod(profiler, "Object>>fib:").invocations, 0u);
+}
+
+// ============================================================================
+// Sampling Tests
+// ============================================================================
+
+TEST(Profiler, SamplesCollapsedStacks) {
+    VM vm;
+    compileFib(vm);
+    vm.compile("Object", "outer ^self fib: 18");
+    Profiler profiler(false);
+    vm.interpreter().setProfiler(&profiler);
+    profiler.startSampling(std::chrono::microseconds(500));
+
+    // SIGPROF follows CPU time: keep the interpreter busy until a few samples land.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (profiler.samples() < 5 && std::chrono::steady_clock::now() < deadline) {
+        vm.send(TaggedValue::nil(), "outer");
+    }
+    profiler.stopSampling();
+    ASSERT_GE(profiler.samples(), 5u);
+
+    std::ostringstream collapsed;
+    profiler.writeCollapsedStacks(collapsed, "test");
+    std::string text = collapsed.str();
+    std::istringstream lines(text);
+    for (std::string line; std::getline(lines, line);) {
+        ASSERT_EQ(line.rfind("test;Object>>outer", 0), 0u) << line;
+    }
+    ASSERT_NE(text.find("Object>>outer;Object>>fib:;Object>>fib:"), std::string::npos) << text;
+    // Counting was off, so the sampled run has no invocation counts
+    ASSERT_EQ(findMethod(profiler, "Object>>fib:").invocations, 0u);
+}
+
+TEST(Profiler, OnlyOneProfilerSamplesAtATime) {
+    Profiler first;
+    Profiler second;
+    first.startSampling();
+    ASSERT_THROW(second.startSampling(), std::logic_error);
+    first.stopSampling();
+    second.startSampling();
+    ASSERT_TRUE(second.sampling());
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
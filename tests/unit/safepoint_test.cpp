@@ -0,0 +1,161 @@
+#include "../src/image_segment.hpp"
+#include "../src/isolate.hpp"
+#include "../src/safepoint.hpp"
+#include "../src/symbol_table.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace test_support;
+
+namespace {
+
+// Spinner loops until its done flag is set from outside
+void defineSpinner(VM& vm) {
+    vm.defineClass("Spinner", "Object", {"done"});
+    vm.compile("Spinner", "setUp done := false");
+    // Only a backward jump polls here: no sends in the loop
+    vm.compile("Spinner", "spin [done] whileFalse. ^#spun");
+    // Only method entries poll here: no loops
+    vm.compile("Spinner",
+               "churn: n done ifTrue: [^0]. n < 2 ifTrue: [^1]. ^(self churn: n - 1) + (self churn: n - 2)");
+}
+
+// Stops the interpreter until its thread is parked at a poll, rather than not yet started
+std::unique_ptr<Safepoints::Stop> stopWhenParked(Interpreter& interpreter) {
+    for (;;) {
+        auto stop = std::make_unique<Safepoints::Stop>(interpreter);
+        if (stop->parked() == 1) {
+            return stop;
+        }
+        stop.reset();
+        std::this_thread::yield();
+    }
+}
+
+// Sets done while the interpreter is stopped: the stopping thread may touch the VM
+void finish(VM& vm, TaggedValue spinner) {
+    vm.memory().storePointer(ObjectHeader::fromTaggedValue(spinner), 0, TaggedValue::trueValue());
+}
+
+} // namespace
+
+// ============================================================================
+// Stop Tests
+// ============================================================================
+
+TEST(Safepoints, StopsALoopAtItsBackwardJump) {
+    VM vm;
+    defineSpinner(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Spinner")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+
+    std::future<TaggedValue> result = std::async(std::launch::async, [&] { return vm.send(roots[0], "spin"); });
+    {
+        std::unique_ptr<Safepoints::Stop> stop = stopWhenParked(vm.interpreter());
+        // Parked inside spin, its ip saved at the loop head
+        ASSERT_EQ(vm.interpreter().frameDepth(), 1u);
+        ASSERT_EQ(vm.interpreter().currentSelector(), "spin");
+        uint64_t bytecodes = vm.interpreter().bytecodesExecuted();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ASSERT_EQ(vm.interpreter().bytecodesExecuted(), bytecodes);
+        finish(vm, roots[0]);
+    }
+    ASSERT_EQ(result.get(), vm.symbols().intern("spun"));
+    ASSERT_GE(vm.statistics().safepoints.count(), 1u);
+}
+
+TEST(Safepoints, StopsRecursionAtMethodEntry) {
+    VM vm;
+    defineSpinner(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Spinner")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+
+    std::future<TaggedValue> result =
+        std::async(std::launch::async, [&] { return vm.send(roots[0], "churn:", {integer(100)}); });
+    {
+        std::unique_ptr<Safepoints::Stop> stop = stopWhenParked(vm.interpreter());
+        ASSERT_GE(vm.interpreter().frameDepth(), 1u);
+        ASSERT_GT(stop->timeToSafepoint().count(), 0);
+        finish(vm, roots[0]);
+    }
+    ASSERT_TRUE(result.get().isSmallInteger());
+}
+
+TEST(Safepoints, IdleInterpretersAreSafeUntilTheyStartASend) {
+    VM vm;
+    uint64_t stops = Safepoints::global().stops();
+    std::atomic<bool> answered(false);
+    std::future<TaggedValue> result;
+    {
+        Safepoints::Stop stop(vm.interpreter());
+        ASSERT_EQ(stop.parked(), 0u);
+        result = std::async(std::launch::async, [&] {
+            TaggedValue sum = vm.send(integer(3), "+", {integer(4)});
+            answered = true;
+            return sum;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ASSERT_FALSE(answered);
+    }
+    ASSERT_EQ(result.get(), integer(7));
+    ASSERT_EQ(Safepoints::global().stops(), stops + 1);
+}
+
+TEST(Safepoints, StopsTheWorld) {
+    std::shared_ptr<const ImageSegment> image;
+    {
+        VM vm;
+        vm.compile("Object", "fib: n n < 2 ifTrue: [^n]. ^(self fib: n - 1) + (self fib: n - 2)");
+        image = ImageSegment::build(vm);
+    }
+    std::atomic<bool> quit(false);
+    std::atomic<int> started(0);
+    std::vector<std::unique_ptr<Isolate>> isolates;
+    std::vector<std::future<void>> busy;
+    for (int i = 0; i < 3; i++) {
+        isolates.push_back(std::make_unique<Isolate>(image));
+        busy.push_back(isolates.back()->post([&quit, &started](VM& vm) {
+            started++;
+            while (!quit) {
+                vm.send(TaggedValue::nil(), "fib:", {integer(15)});
+            }
+        }));
+    }
+    ASSERT_EQ(Safepoints::global().interpreters(), 3u);
+    while (started < 3) {
+        std::this_thread::yield();
+    }
+
+    Histogram before = Safepoints::global().timeToSafepoint();
+    {
+        // Each task holds its isolate as running, between sends too
+        Safepoints::Stop stop;
+        ASSERT_EQ(stop.parked(), 3u);
+    }
+    Histogram after = Safepoints::global().timeToSafepoint();
+    ASSERT_EQ(after.count(), before.count() + 1);
+
+    quit = true;
+    for (size_t i = 0; i < isolates.size(); i++) {
+        busy[i].get();
+        uint64_t safepoints = 0;
+        isolates[i]->post([&safepoints](VM& vm) { safepoints = vm.statistics().safepoints.count(); }).get();
+        ASSERT_EQ(safepoints, 1u);
+    }
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
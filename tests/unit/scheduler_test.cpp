@@ -0,0 +1,299 @@
+#include "../src/scheduler.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+using namespace test_support;
+
+namespace {
+
+// Recorder collects the values its Processes log, in order
+void defineRecorder(VM& vm) {
+    vm.defineClass("Recorder", "Object", {"entries", "count", "done"});
+    vm.compile("Recorder", "setUp entries := Array new: 100. count := 0. done := false");
+    vm.compile("Recorder", "record: value count := count + 1. entries at: count put: value");
+    vm.compile("Recorder", "entries ^entries");
+    vm.compile("Recorder", "count ^count");
+    vm.compile("Recorder", "done ^done");
+    vm.compile("Recorder", "finish done := true");
+    vm.compile("Recorder", "log: value ^self record: value");
+    vm.compile("Recorder", "log: value times: n 1 to: n do: [:i | self record: value. Process yield]");
+    vm.compile("Recorder", "waitOn: semaphore thenLog: value semaphore wait. self record: value");
+}
+
+std::vector<int64_t> entries(VM& vm, TaggedValue recorder) {
+    std::vector<int64_t> result;
+    int64_t count = vm.send(recorder, "count").toSmallInteger();
+    TaggedValue array = vm.send(recorder, "entries");
+    for (int64_t i = 1; i <= count; i++) {
+        result.push_back(vm.send(array, "at:", {integer(i)}).toSmallInteger());
+    }
+    return result;
+}
+
+} // namespace
+
+// ============================================================================
+// Scheduling Tests
+// ============================================================================
+
+TEST(Scheduler, ForkedProcessesRunWhenTheCallerIdles) {
+    VM vm;
+    defineRecorder(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    for (int64_t i = 1; i <= 3; i++) {
+        vm.send(roots[0], "fork:with:at:", {symbol(vm, "log:"), integer(i), integer(Scheduler::USER_PRIORITY)});
+    }
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 4u);
+    ASSERT_TRUE(entries(vm, roots[0]).empty());
+
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{1, 2, 3}));
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 1u);
+    ASSERT_TRUE(vm.interpreter().scheduler().inCaller());
+}
+
+TEST(Scheduler, HigherPrioritiesRunFirst) {
+    VM vm;
+    defineRecorder(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    for (int64_t priority : {2, 5, 3}) {
+        vm.send(roots[0], "fork:with:at:", {symbol(vm, "log:"), integer(priority), integer(priority)});
+    }
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{5, 3, 2}));
+}
+
+TEST(Scheduler, YieldRoundRobinsEqualPriorities) {
+    VM vm;
+    defineRecorder(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    TaggedValue args = vm.newArray({integer(1), integer(3)});
+    vm.send(roots[0], "fork:withArguments:at:", {symbol(vm, "log:times:"), args, integer(4)});
+    args = vm.newArray({integer(2), integer(3)});
+    vm.send(roots[0], "fork:withArguments:at:", {symbol(vm, "log:times:"), args, integer(4)});
+
+    uint64_t switches = vm.interpreter().scheduler().switches();
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{1, 2, 1, 2, 1, 2}));
+    ASSERT_GE(vm.interpreter().scheduler().switches() - switches, 6u);
+}
+
+TEST(Scheduler, SignalPreemptsForAHigherPriorityWaiter) {
+    VM vm;
+    defineRecorder(vm);
+    vm.compile("Recorder",
+               "preemptTest\n"
+               "    | semaphore arguments |\n"
+               "    semaphore := Semaphore new.\n"
+               "    arguments := Array new: 2.\n"
+               "    arguments at: 1 put: semaphore.\n"
+               "    arguments at: 2 put: 2.\n"
+               "    self fork: #waitOn:thenLog: withArguments: arguments at: 6.\n"
+               "    self record: 1.\n"
+               "    semaphore signal.\n"
+               "    self record: 3");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+
+    // The waiter runs at once (it outranks the caller), blocks, and takes over on the signal
+    vm.send(roots[0], "preemptTest");
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{1, 2, 3}));
+}
+
+TEST(Scheduler, CallerWaitsWhileOtherProcessesRun) {
+    VM vm;
+    defineRecorder(vm);
+    vm.compile("Recorder", "signal: semaphore self record: 7. semaphore signal");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder"), vm.instantiate(vm.kernel().semaphore)};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "signal:"), roots[1], integer(Scheduler::USER_PRIORITY)});
+
+    ASSERT_EQ(vm.send(roots[1], "wait"), roots[1]);
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{7}));
+    ASSERT_EQ(vm.send(roots[1], "excessSignals"), integer(0));
+}
+
+TEST(Scheduler, ExcessSignalsLetWaitersThrough) {
+    VM vm;
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.kernel().semaphore)};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "signal");
+    vm.send(roots[0], "signal");
+    ASSERT_EQ(vm.send(roots[0], "excessSignals"), integer(2));
+    vm.send(roots[0], "wait");
+    ASSERT_EQ(vm.send(roots[0], "excessSignals"), integer(1));
+}
+
+// ============================================================================
+// Process Control Tests
+// ============================================================================
+
+TEST(Scheduler, SuspendResumeAndTerminate) {
+    VM vm;
+    defineRecorder(vm);
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder"), vm.instantiate(vm.kernel().semaphore)};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    TaggedValue args = vm.newArray({roots[1], integer(1)});
+    roots.push_back(vm.send(roots[0], "fork:withArguments:at:", {symbol(vm, "waitOn:thenLog:"), args, integer(4)}));
+    roots.push_back(vm.send(roots[0], "fork:with:at:", {symbol(vm, "log:"), integer(2), integer(4)}));
+    vm.send(roots[3], "suspend");
+    vm.interpreter().runProcesses();  // The first one now waits on the semaphore
+    ASSERT_TRUE(entries(vm, roots[0]).empty());
+
+    vm.send(roots[3], "resume");
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{2}));
+    ASSERT_THROW(vm.send(roots[3], "resume"), std::runtime_error);  // Terminated
+
+    vm.send(roots[2], "terminate");
+    ASSERT_EQ(vm.send(roots[2], "isTerminated"), TaggedValue::trueValue());
+    vm.send(roots[1], "signal");
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{2}));
+    ASSERT_EQ(vm.send(roots[1], "excessSignals"), integer(1));
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 1u);
+}
+
+TEST(Scheduler, CallerCannotBeTerminated) {
+    VM vm;
+    vm.compile("Object", "terminateCaller Process activeProcess terminate");
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "terminateCaller"), std::runtime_error);
+    // Class-side Process primitives fail for other classes
+    ASSERT_THROW(vm.send(vm.classes().classAt(vm.kernel().array), "yield"), std::runtime_error);
+    TaggedValue processClass = vm.classes().classAt(vm.kernel().process);
+    ASSERT_EQ(vm.send(processClass, "yield"), processClass);  // Nothing else ready: a no-op
+}
+
+TEST(Scheduler, CorruptStackIndexFailsThePrimitives) {
+    VM vm;
+    defineRecorder(vm);
+    vm.compile("Process", "stackIndex ^stackIndex");
+    vm.compile("Process", "stackIndex: anObject stackIndex := anObject");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    roots.push_back(vm.send(roots[0], "fork:with:at:", {symbol(vm, "log:"), integer(1), integer(4)}));
+    roots.push_back(vm.send(roots[0], "fork:with:at:", {symbol(vm, "log:"), integer(2), integer(4)}));
+    TaggedValue first = vm.send(roots[1], "stackIndex");
+    TaggedValue second = vm.send(roots[2], "stackIndex");
+
+    for (TaggedValue bad : {integer(-1), integer(1000000), second}) {
+        vm.send(roots[1], "stackIndex:", {bad});
+        ASSERT_THROW(vm.send(roots[1], "suspend"), std::runtime_error);
+        ASSERT_THROW(vm.send(roots[1], "resume"), std::runtime_error);
+        ASSERT_THROW(vm.send(roots[1], "terminate"), std::runtime_error);
+        ASSERT_THROW(vm.send(roots[1], "priority:", {integer(3)}), std::runtime_error);
+    }
+    // The other Process's record was left alone
+    vm.send(roots[1], "stackIndex:", {first});
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{1, 2}));
+}
+
+// ============================================================================
+// Error Tests
+// ============================================================================
+
+TEST(Scheduler, DeadlockIsReportedAndRecovered) {
+    VM vm;
+    std::vector<TaggedValue> roots = {vm.instantiate(vm.kernel().semaphore)};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    ASSERT_THROW(vm.send(roots[0], "wait"), std::runtime_error);
+    ASSERT_TRUE(vm.interpreter().scheduler().inCaller());
+    ASSERT_EQ(vm.send(integer(3), "+", {integer(4)}), integer(7));
+    ASSERT_EQ(vm.interpreter().frameDepth(), 0u);
+}
+
+TEST(Scheduler, ErrorInAProcessTerminatesOnlyThatProcess) {
+    VM vm;
+    defineRecorder(vm);
+    vm.compile("Recorder", "fail self record: 1. ^nil foo");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "fork:at:", {symbol(vm, "fail"), integer(4)});
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "log:"), integer(2), integer(4)});
+
+    ASSERT_THROW(vm.interpreter().runProcesses(), std::runtime_error);
+    ASSERT_TRUE(vm.interpreter().scheduler().inCaller());
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 2u);
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{1, 2}));
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 1u);
+}
+
+// ============================================================================
+// Preemption Tests
+// ============================================================================
+
+TEST(Scheduler, TimerPreemptsBusyLoops) {
+    VM vm;
+    defineRecorder(vm);
+    vm.compile("Recorder", "spin | n | n := 0. [done] whileFalse: [n := n + 1]. self record: 1");
+    vm.compile("Recorder", "stop self record: 2. done := true");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "fork:at:", {symbol(vm, "spin"), integer(4)});
+    vm.send(roots[0], "fork:at:", {symbol(vm, "stop"), integer(4)});
+
+    vm.interpreter().scheduler().startPreemption(std::chrono::milliseconds(1));
+    vm.interpreter().runProcesses();
+    vm.interpreter().scheduler().stopPreemption();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{2, 1}));
+}
+
+// ============================================================================
+// Stack Tests
+// ============================================================================
+
+TEST(Scheduler, ThousandsOfProcessesAndCollections) {
+    VM vm(64 * 1024);
+    defineRecorder(vm);
+    vm.compile("Recorder",
+               "churn: semaphore\n"
+               "    | keep |\n"
+               "    semaphore wait.\n"
+               "    1 to: 20 do: [:i | keep := Array new: 8. Process yield].\n"
+               "    count := count + 1");
+    vm.compile("Recorder", "release: semaphore times: n 1 to: n do: [:i | semaphore signal]");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder"), vm.instantiate(vm.kernel().semaphore)};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    const int64_t processes = 5000;
+    for (int64_t i = 0; i < processes; i++) {
+        vm.send(roots[0], "fork:with:at:", {symbol(vm, "churn:"), roots[1], integer(4)});
+    }
+    TaggedValue args = vm.newArray({roots[1], integer(processes)});
+    vm.send(roots[0], "fork:withArguments:at:", {symbol(vm, "release:times:"), args, integer(3)});
+
+    size_t minorBefore = vm.memory().minorCollections();
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(vm.send(roots[0], "count"), integer(processes));
+    ASSERT_GT(vm.memory().minorCollections(), minorBefore);
+    ASSERT_EQ(vm.interpreter().scheduler().processCount(), 1u);
+}
+
+TEST(Scheduler, ProcessStacksGrowWithDeepRecursion) {
+    VM vm;
+    defineRecorder(vm);
+    vm.compile("Object", "depth: n ^n = 0 ifTrue: [0] ifFalse: [(self depth: n - 1) + 1]");
+    vm.compile("Recorder", "recurse: n self record: (nil depth: n)");
+    std::vector<TaggedValue> roots = {newInstance(vm, "Recorder")};
+    MemoryManager::ScopedRoots scoped(vm.memory(), roots);
+    vm.send(roots[0], "fork:with:at:", {symbol(vm, "recurse:"), integer(10000), integer(4)});
+    vm.interpreter().runProcesses();
+    ASSERT_EQ(entries(vm, roots[0]), (std::vector<int64_t>{10000}));
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,7 +1,9 @@
 #include "../src/tagged_value.hpp"
 #include <gtest/gtest.h>
+#include <cmath>
 #include <cstdint>
 #include <cstddef>
+#include <limits>
 
 // ============================================================================
 // Size and Layout Tests
@@ -104,6 +106,43 @@ TEST(TaggedValue, PointerEncoding64Bit) {
     ASSERT_EQ(storedValue, expectedValue) << "Pointer value must be stored as 64-bit";
 }
 
+// ============================================================================
+// Float Tests
+// ============================================================================
+
+TEST(TaggedValue, FloatRoundTrip) {
+    for (double d : {0.0, -0.0, 1.0, -2.5, 0.125, 0x1p255, -0x1p-255, 4.0 * 1024 * 1024}) {
+        ASSERT_TRUE(TaggedValue::isImmediateFloat(d));
+        TaggedValue value = TaggedValue::fromFloat(d);
+        ASSERT_TRUE(value.isFloat());
+        ASSERT_FALSE(value.isPointer());
+        ASSERT_FALSE(value.isSmallInteger());
+        ASSERT_FALSE(value.isSpecial());
+        ASSERT_EQ(value.toFloat(), d);
+        ASSERT_EQ(std::signbit(value.toFloat()), std::signbit(d));
+    }
+}
+
+TEST(TaggedValue, FloatKeepsEveryMantissaBit) {
+    for (double d : {0.1, 0.1 + 0.2, 1.0 / 3.0, -2.0 / 3.0, 3.141592653589793, 0x1.fffffffffffffp255}) {
+        ASSERT_TRUE(TaggedValue::isImmediateFloat(d));
+        ASSERT_EQ(TaggedValue::fromFloat(d).toFloat(), d);
+    }
+}
+
+TEST(TaggedValue, FloatOutsideTheImmediateRangeIsNotImmediate) {
+    for (double d : {0x1p256, -0x1p-256, 1e300, 1e-300, 4.9e-324, std::numeric_limits<double>::infinity(),
+                     std::numeric_limits<double>::quiet_NaN()}) {
+        ASSERT_FALSE(TaggedValue::isImmediateFloat(d)) << d;
+    }
+}
+
+TEST(TaggedValue, FloatIsNotAnotherTag) {
+    ASSERT_FALSE(TaggedValue::fromSmallInteger(3).isFloat());
+    ASSERT_FALSE(TaggedValue::nil().isFloat());
+    ASSERT_EQ(TaggedValue::fromSmallInteger(3).toFloat(), 0.0);
+}
+
 // ============================================================================
 // Test Runner Main
 // ============================================================================
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../src/memory_manager.hpp"
+#include "../src/tagged_value.hpp"
+#include "../src/vm.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace test_support {
+
+/**
+ * Create a TaggedValue from a SmallInteger
+ */
+inline TaggedValue integer(int64_t value) {
+    return TaggedValue::fromSmallInteger(value);
+}
+
+/**
+ * Intern name in the VM's symbol table
+ */
+inline TaggedValue symbol(VM& vm, const char* name) {
+    return vm.symbols().intern(name);
+}
+
+/**
+ * Create an instance of the named class and send it setUp. The instance stays rooted
+ * while setUp runs; root the answer before allocating again.
+ */
+inline TaggedValue newInstance(VM& vm, const char* className) {
+    std::vector<TaggedValue> instance = {vm.instantiate(vm.classIndexNamed(className))};
+    MemoryManager::ScopedRoots rooted(vm.memory(), instance);
+    vm.send(instance[0], "setUp");
+    return instance[0];
+}
+
+} // namespace test_support
@@ -0,0 +1,186 @@
+#include "../src/bytecode.hpp"
+#include "../src/trace_buffer.hpp"
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace test_support;
+
+namespace {
+
+void compileFib(VM& vm) {
+    vm.compile("Object", "fib: n ^n < 2 ifTrue: [n] ifFalse: [(self fib: n - 1) + (self fib: n - 2)]");
+}
+
+std::string decoded(VM& vm) {
+    std::ostringstream out;
+    vm.interpreter().dumpTrace(out);
+    return out.str();
+}
+
+} // namespace
+
+// ============================================================================
+// Recording Tests
+// ============================================================================
+
+TEST(TraceBuffer, CapacityIsRoundedToAPowerOfTwo) {
+    TraceBuffer buffer(100);
+    ASSERT_EQ(buffer.capacity(), 128u);
+    ASSERT_EQ(buffer.size(), 0u);
+}
+
+TEST(TraceBuffer, KeepsOnlyTheMostRecentEntries) {
+    TraceBuffer buffer(4);
+    for (uint32_t i = 0; i < 10; i++) {
+        buffer.record(TraceBuffer::INSTRUCTION, TaggedValue::nil(), i, bytecode::POP, integer(i));
+    }
+    ASSERT_EQ(buffer.recorded(), 10u);
+    ASSERT_EQ(buffer.size(), 4u);
+    ASSERT_EQ(buffer.at(0).ip, 6u);
+    ASSERT_EQ(buffer.at(3).ip, 9u);
+    ASSERT_EQ(buffer.at(3).value, integer(9));
+    buffer.clear();
+    ASSERT_EQ(buffer.size(), 0u);
+}
+
+TEST(TraceBuffer, RecordsInstructionsAndSends) {
+    VM vm;
+    compileFib(vm);
+    vm.interpreter().startTracing(1024);
+    ASSERT_EQ(vm.send(TaggedValue::nil(), "fib:", {integer(3)}), integer(2));
+
+    TraceBuffer& trace = *vm.interpreter().trace();
+    uint64_t bytecodes = 0;
+    uint64_t sends = 0;
+    for (size_t i = 0; i < trace.size(); i++) {
+        (trace.at(i).kind == TraceBuffer::INSTRUCTION ? bytecodes : sends)++;
+    }
+    ASSERT_EQ(sends, vm.interpreter().sends());
+    ASSERT_EQ(bytecodes, vm.interpreter().bytecodesExecuted());
+    ASSERT_EQ(trace.at(0).kind, TraceBuffer::SEND);
+    ASSERT_EQ(trace.at(0).value, TaggedValue::nil());
+    ASSERT_EQ(trace.at(trace.size() - 1).opcode, bytecode::RETURN_STACK_TOP);
+    ASSERT_EQ(trace.at(trace.size() - 1).value, integer(2));
+
+    vm.interpreter().stopTracing();
+    uint64_t recorded = trace.recorded();
+    vm.send(TaggedValue::nil(), "fib:", {integer(3)});
+    ASSERT_EQ(trace.recorded(), recorded);
+}
+
+// ============================================================================
+// Decoder Tests
+// ============================================================================
+
+TEST(TraceBuffer, PrintsValuesForDiagnostics) {
+    VM vm;
+    vm.defineClass("Account", "Object", {"balance"});
+    ASSERT_EQ(vm.printString(integer(-7)), "-7");
+    ASSERT_EQ(vm.printString(TaggedValue::fromFloat(0.5)), "0.5");
+    ASSERT_EQ(vm.printString(TaggedValue::nil()), "nil");
+    ASSERT_EQ(vm.printString(TaggedValue::trueValue()), "true");
+    ASSERT_EQ(vm.printString(vm.symbols().intern("at:put:")), "#at:put:");
+    ASSERT_EQ(vm.printString(vm.newString("it")), "'it'");
+    ASSERT_EQ(vm.printString(vm.instantiate(vm.classIndexNamed("Account"))), "an Account");
+    ASSERT_EQ(vm.printString(vm.newArray({})), "an Array");
+    ASSERT_EQ(vm.printString(vm.classes().classAt(vm.kernel().dictionary)), "Dictionary");
+}
+
+TEST(TraceBuffer, DecodesWithMethodLiteralsAndNames) {
+    VM vm;
+    vm.defineClass("Account", "Object", {"balance"});
+    vm.compile("Account", "deposit: amount balance := amount + 10. ^self note: 'deposited'");
+    vm.compile("Account", "note: aString ^aString size");
+    TaggedValue account = vm.instantiate(vm.classIndexNamed("Account"));
+    vm.interpreter().startTracing();
+    vm.send(account, "deposit:", {integer(5)});
+
+    std::string text = decoded(vm);
+    EXPECT_NE(text.find("send #deposit: to an Account -> Account>>deposit:"), std::string::npos) << text;
+    EXPECT_NE(text.find("PUSH_LITERAL             10"), std::string::npos) << text;
+    EXPECT_NE(text.find("STORE_INSTANCE_VARIABLE  balance"), std::string::npos) << text;
+    EXPECT_NE(text.find("SEND_MESSAGE             #note: (1 args)"), std::string::npos) << text;
+    EXPECT_NE(text.find("top: 'deposited'"), std::string::npos) << text;
+    EXPECT_NE(text.find("-> String>>size"), std::string::npos) << text;
+}
+
+TEST(TraceBuffer, EntriesSurviveCollections) {
+    VM vm(64 * 1024);
+    vm.compile("Object", "churn | s | 1 to: 20000 do: [:i | s := 'abc' , 'def']. ^s");
+    vm.interpreter().startTracing(256);
+    vm.send(TaggedValue::nil(), "churn");
+    ASSERT_GT(vm.memory().minorCollections(), 0u);
+
+    std::string text = decoded(vm);
+    EXPECT_NE(text.find("Object>>churn"), std::string::npos);
+    EXPECT_NE(text.find("top: 'abcdef'"), std::string::npos) << text;
+}
+
+// ============================================================================
+// Dump Tests
+// ============================================================================
+
+TEST(TraceBuffer, DumpsWhenAnErrorEscapes) {
+    VM vm;
+    vm.compile("Object", "broken ^3 zork");
+    vm.interpreter().startTracing();
+    std::ostringstream out;
+    vm.interpreter().trace()->setOutput(out);
+
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "broken"), std::runtime_error);
+    EXPECT_NE(out.str().find("Error: SmallInteger doesNotUnderstand: #zork"), std::string::npos) << out.str();
+    EXPECT_NE(out.str().find("send #zork to 3 -> doesNotUnderstand:"), std::string::npos) << out.str();
+
+    out.str("");
+    vm.interpreter().trace()->setDumpOnError(false);
+    ASSERT_THROW(vm.send(TaggedValue::nil(), "broken"), std::runtime_error);
+    ASSERT_TRUE(out.str().empty());
+}
+
+TEST(TraceBuffer, DumpsOnSignal) {
+    VM vm;
+    compileFib(vm);
+    vm.interpreter().startTracing();
+    std::ostringstream out;
+    vm.interpreter().trace()->setOutput(out);
+    TraceBuffer::installDumpSignal(SIGUSR2);
+
+    vm.send(TaggedValue::nil(), "fib:", {integer(3)});
+    ASSERT_TRUE(out.str().empty());
+    raise(SIGUSR2);
+    vm.send(TaggedValue::nil(), "fib:", {integer(3)});
+    EXPECT_NE(out.str().find("Trace: last"), std::string::npos);
+    // One dump per signal
+    size_t length = out.str().size();
+    vm.send(TaggedValue::nil(), "fib:", {integer(3)});
+    ASSERT_EQ(out.str().size(), length);
+    signal(SIGUSR2, SIG_DFL);
+}
+
+TEST(TraceBuffer, WritesRawEntriesToAFileDescriptor) {
+    TraceBuffer buffer(8);
+    buffer.record(TraceBuffer::INSTRUCTION, TaggedValue::nil(), 42, bytecode::SEND_MESSAGE, integer(1));
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    buffer.writeRaw(fds[1]);
+    close(fds[1]);
+    char text[256] = {};
+    ssize_t length = read(fds[0], text, sizeof(text) - 1);
+    close(fds[0]);
+    ASSERT_GT(length, 0);
+    EXPECT_NE(std::string(text).find("SEND_MESSAGE ip=42 method=0x"), std::string::npos) << text;
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,210 @@
+#include "../src/vm.hpp"
+#include "test_support.hpp"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+using namespace test_support;
+
+namespace {
+
+// Tally of the class called name; zero objects if there is none
+ClassTally findClass(const std::vector<ClassTally>& tallies, const std::string& name) {
+    for (const ClassTally& tally : tallies) {
+        if (tally.name == name) {
+            return tally;
+        }
+    }
+    return ClassTally{};
+}
+
+void compileChurn(VM& vm) {
+    vm.defineClass("Pair", "Object", {"first", "second"});
+    vm.compile("Pair", "first ^first");
+    vm.compile("Pair", "first: a second: b first := a. second := b");
+    vm.compile("Object",
+               "churn: n\n"
+               "    | keep |\n"
+               "    1 to: n do: [:i | keep := Pair new first: keep second: (Array new: 8)].\n"
+               "    ^keep");
+}
+
+} // namespace
+
+// ============================================================================
+// Histogram Tests
+// ============================================================================
+
+TEST(Histogram, SmallValuesGetABucketEach) {
+    for (uint64_t value = 0; value < Histogram::SUB_BUCKETS; value++) {
+        ASSERT_EQ(Histogram::bucketOf(value), value);
+        ASSERT_EQ(Histogram::bucketLowerBound(value), value);
+        ASSERT_EQ(Histogram::bucketUpperBound(value), value);
+    }
+}
+
+TEST(Histogram, BucketsCoverEveryValueWithinAnEighth) {
+    for (uint64_t value : {uint64_t{8}, uint64_t{9}, uint64_t{15}, uint64_t{16}, uint64_t{100}, uint64_t{1000},
+                           uint64_t{123456789}, uint64_t{1} << 40, UINT64_MAX}) {
+        size_t bucket = Histogram::bucketOf(value);
+        ASSERT_LT(bucket, Histogram::BUCKETS);
+        ASSERT_LE(Histogram::bucketLowerBound(bucket), value);
+        ASSERT_GE(Histogram::bucketUpperBound(bucket), value);
+        ASSERT_LE(Histogram::bucketUpperBound(bucket) - Histogram::bucketLowerBound(bucket), value / 8);
+    }
+    ASSERT_EQ(Histogram::bucketOf(UINT64_MAX), Histogram::BUCKETS - 1);
+}
+
+TEST(Histogram, PercentilesAreBucketUpperBounds) {
+    Histogram histogram;
+    ASSERT_EQ(histogram.percentile(99), 0u);
+    for (uint64_t value = 1; value <= 100; value++) {
+        histogram.record(value * 1000);
+    }
+    ASSERT_EQ(histogram.count(), 100u);
+    ASSERT_EQ(histogram.min(), 1000u);
+    ASSERT_EQ(histogram.max(), 100000u);
+    ASSERT_DOUBLE_EQ(histogram.mean(), 50500.0);
+    ASSERT_GE(histogram.percentile(50), 50000u);
+    ASSERT_LE(histogram.percentile(50), 50000u + 50000u / 8);
+    ASSERT_GE(histogram.percentile(99), 99000u);
+    ASSERT_EQ(histogram.percentile(100), 100000u);
+
+    Histogram other;
+    other.record(7);
+    histogram.merge(other);
+    ASSERT_EQ(histogram.count(), 101u);
+    ASSERT_EQ(histogram.min(), 7u);
+    ASSERT_EQ(histogram.percentile(0), 7u);
+}
+
+// ============================================================================
+// Allocation Profiling Tests
+// ============================================================================
+
+TEST(AllocationProfiler, CountsEveryAllocationByClass) {
+    VM vm;
+    compileChurn(vm);
+    vm.startAllocationProfiling();
+    vm.send(TaggedValue::nil(), "churn:", {integer(1000)});
+    vm.stopAllocationProfiling();
+
+    std::vector<ClassTally> byClass = vm.allocationProfiler()->byClass();
+    ClassTally pairs = findClass(byClass, "Pair");
+    ClassTally arrays = findClass(byClass, "Array");
+    ASSERT_EQ(pairs.objects, 1000u);
+    ASSERT_EQ(arrays.objects, 1000u);
+    ASSERT_GT(arrays.bytes, pairs.bytes);
+
+    // Stopped: nothing more is counted
+    vm.send(TaggedValue::nil(), "churn:", {integer(10)});
+    ASSERT_EQ(findClass(vm.allocationProfiler()->byClass(), "Pair").objects, 1000u);
+}
+
+TEST(AllocationProfiler, SamplesSitesByMethodAndSend) {
+    VM vm;
+    compileChurn(vm);
+    vm.startAllocationProfiling(1);
+    vm.send(TaggedValue::nil(), "churn:", {integer(100)});
+
+    std::vector<AllocationSite> sites = vm.allocationProfiler()->bySite();
+    uint64_t churnSamples = 0;
+    std::vector<uint32_t> churnIps;
+    for (const AllocationSite& site : sites) {
+        if (site.method == "Object>>churn:") {
+            churnSamples += site.samples;
+            churnIps.push_back(site.ip);
+        }
+    }
+    // Pair new and Array new: are two different sends
+    ASSERT_EQ(churnSamples, 200u);
+    ASSERT_EQ(churnIps.size(), 2u);
+    ASSERT_NE(churnIps[0], churnIps[1]);
+
+    vm.allocationProfiler()->reset();
+    vm.newString("from C++");
+    sites = vm.allocationProfiler()->bySite();
+    ASSERT_EQ(sites.size(), 1u);
+    ASSERT_EQ(sites[0].method, "(outside Smalltalk)");
+}
+
+TEST(AllocationProfiler, SamplesOneAllocationInN) {
+    VM vm;
+    compileChurn(vm);
+    vm.startAllocationProfiling(10);
+    vm.send(TaggedValue::nil(), "churn:", {integer(1000)});
+
+    uint64_t samples = 0;
+    for (const AllocationSite& site : vm.allocationProfiler()->bySite()) {
+        samples += site.samples;
+    }
+    ASSERT_EQ(samples, 200u);
+}
+
+// ============================================================================
+// Statistics Tests
+// ============================================================================
+
+TEST(VMStatistics, CensusCountsOnlyLiveObjects) {
+    VM vm(64 * 1024);
+    compileChurn(vm);
+    std::vector<TaggedValue> kept = {vm.send(TaggedValue::nil(), "churn:", {integer(5000)})};
+    MemoryManager::ScopedRoots roots(vm.memory(), kept);
+
+    std::vector<ClassTally> census = vm.heapCensus();
+    ASSERT_EQ(findClass(census, "Pair").objects, 5000u);
+    for (size_t i = 1; i < census.size(); i++) {
+        ASSERT_GE(census[i - 1].bytes, census[i].bytes);
+    }
+
+    kept[0] = TaggedValue::nil();
+    ASSERT_EQ(findClass(vm.heapCensus(), "Pair").objects, 0u);
+}
+
+TEST(VMStatistics, RecordsPausePerCollection) {
+    VM vm(64 * 1024);
+    compileChurn(vm);
+    vm.send(TaggedValue::nil(), "churn:", {integer(20000)});
+    vm.memory().majorCollection();
+
+    VMStatistics statistics = vm.statistics();
+    ASSERT_GT(statistics.minorCollections, 0u);
+    ASSERT_EQ(statistics.minorPauses.count(), statistics.minorCollections);
+    ASSERT_EQ(statistics.majorPauses.count(), statistics.majorCollections);
+    ASSERT_GT(statistics.minorPauses.sum(), 0u);
+    ASSERT_GT(statistics.sends, 0u);
+    ASSERT_EQ(statistics.allocationSampleEvery, 0u);
+}
+
+TEST(VMStatistics, DumpsTextAndJson) {
+    VM vm(64 * 1024);
+    compileChurn(vm);
+    vm.startAllocationProfiling(1);
+    vm.send(TaggedValue::nil(), "churn:", {integer(5000)});
+    VMStatistics statistics = vm.statistics(true);
+    ASSERT_FALSE(statistics.census.empty());
+
+    std::ostringstream text;
+    statistics.writeText(text);
+    ASSERT_NE(text.str().find("Minor collections: "), std::string::npos);
+    ASSERT_NE(text.str().find("Allocations by class:"), std::string::npos);
+    ASSERT_NE(text.str().find("Object>>churn:"), std::string::npos);
+    ASSERT_NE(text.str().find("Heap census:"), std::string::npos);
+
+    std::ostringstream json;
+    statistics.writeJson(json);
+    ASSERT_NE(json.str().find("\"minor_collections\": {\"count\": "), std::string::npos);
+    ASSERT_NE(json.str().find("{\"class\": \"Pair\""), std::string::npos);
+    ASSERT_NE(json.str().find("{\"method\": \"Object>>churn:\""), std::string::npos);
+    ASSERT_EQ(json.str().front(), '{');
+    ASSERT_EQ(json.str().substr(json.str().size() - 2), "}\n");
+}
+
+// ============================================================================
+// Test Runner Main
+// ============================================================================
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Compare a Google Benchmark JSON run against a stored baseline.
+
+usage: compare_benchmarks.py <baseline.json> <current.json> [--threshold 0.10]
+
+Benchmarks are matched by name and compared on cpu_time (normalised to ns). The exit
+status is 1 if any benchmark is slower than baseline * (1 + threshold), 0 otherwise.
+Benchmarks present in only one file are listed but never fail the comparison.
+"""
+
+import json
+import sys
+
+
+UNIT_TO_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path: str) -> dict[str, float]:
+    with open(path, "r", encoding="utf-8") as f:
+        data = json.load(f)
+    times: dict[str, float] = {}
+    for entry in data.get("benchmarks", []):
+        # With --benchmark_repetitions, compare the medians and skip the raw runs.
+        if entry.get("run_type") == "aggregate" and entry.get("aggregate_name") != "median":
+            continue
+        name = entry.get("run_name", entry["name"])
+        if entry.get("run_type") == "iteration" and name in times:
+            continue
+        times[name] = entry["cpu_time"] * UNIT_TO_NS[entry.get("time_unit", "ns")]
+    return times
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    threshold = 0.10
+    if "--threshold" in args:
+        i = args.index("--threshold")
+        try:
+            threshold = float(args[i + 1])
+        except (IndexError, ValueError):
+            print("error: --threshold needs a number, e.g. 0.10 for 10%", file=sys.stderr)
+            return 2
+        del args[i:i + 2]
+    if len(args) != 2:
+        print("usage: compare_benchmarks.py <baseline.json> <current.json> [--threshold 0.10]",
+              file=sys.stderr)
+        return 2
+
+    try:
+        baseline = load(args[0])
+        current = load(args[1])
+    except FileNotFoundError as e:
+        print(f"error: {e.filename} not found (record one with the benchmark_baseline target)",
+              file=sys.stderr)
+        return 2
+
+    regressions = []
+    width = max((len(name) for name in baseline.keys() | current.keys()), default=10)
+    print(f"{'benchmark':<{width}}  {'baseline ns':>12}  {'current ns':>12}  {'change':>8}")
+    for name in sorted(baseline.keys() | current.keys()):
+        if name not in current:
+            print(f"{name:<{width}}  {baseline[name]:>12.2f}  {'missing':>12}")
+            continue
+        if name not in baseline:
+            print(f"{name:<{width}}  {'new':>12}  {current[name]:>12.2f}")
+            continue
+        change = (current[name] - baseline[name]) / baseline[name] if baseline[name] else 0.0
+        marker = ""
+        if change > threshold:
+            regressions.append(name)
+            marker = "  REGRESSION"
+        print(f"{name:<{width}}  {baseline[name]:>12.2f}  {current[name]:>12.2f}  {change:>+7.1%}{marker}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) slower than baseline by more than {threshold:.0%}",
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Generate slot-index tables and layout checks from the ST_SLOT declarations in src/classes.
+
+Writes two files next to the mirror headers:
+- mirror_slots.hpp: one <Class>Slots struct per mirror class with a constexpr index per
+  slot and COUNT, the number of named slots.
+- mirror_slots.cpp: static_asserts that each mirror class is standard layout and that
+  every slot sits at index * sizeof(TaggedValue), so a mirror can be laid over a heap
+  object's body.
+
+With --check, nothing is written; the exit status is 1 if either file is out of date.
+"""
+
+import os
+import re
+import sys
+
+
+SKIP_FILES = {"mirror.hpp", "mirror_slots.hpp"}
+HEADER_NAME = "mirror_slots.hpp"
+SOURCE_NAME = "mirror_slots.cpp"
+
+CLASS_RE = re.compile(r"^\s*(?:class|struct)\s+(\w+)\s*(?:final\s*)?(?:[:{]|$)")
+SLOT_RE = re.compile(r"ST_SLOT\(\s*(\w+)\s*\)")
+
+BANNER = (
+    "// Generated by tools/generate_mirror_slots.py from the ST_SLOT declarations in\n"
+    "// src/classes/. Do not edit; rerun the generator after changing a mirror class.\n"
+)
+
+
+def strip_comment(line: str) -> str:
+    index = line.find("//")
+    return line if index < 0 else line[:index]
+
+
+def parse_file(path: str) -> list[tuple[str, list[str]]]:
+    """Answer (class name, [slot field names]) for each top-level class in path, in order."""
+    classes: list[tuple[str, list[str]]] = []
+    with open(path, "r", encoding="utf-8") as f:
+        lines = f.readlines()
+
+    current: tuple[str, list[str]] | None = None
+    depth = 0
+    entered = False
+    for raw in lines:
+        line = strip_comment(raw)
+        if current is None:
+            match = CLASS_RE.match(line)
+            if not match or ";" in line:
+                continue
+            current = (match.group(1), [])
+            depth = 0
+            entered = False
+
+        # Slots of nested classes (depth > 1) belong to those classes, not this one.
+        if depth == 1:
+            current[1].extend(SLOT_RE.findall(line))
+        depth += line.count("{") - line.count("}")
+        entered = entered or "{" in line
+        if entered and depth <= 0:
+            classes.append(current)
+            current = None
+    return classes
+
+
+def constant_name(field: str) -> str:
+    """bytes_ -> BYTES, instructionPointer_ -> INSTRUCTION_POINTER"""
+    name = field.rstrip("_")
+    return re.sub(r"(?<=[a-z0-9])([A-Z])", r"_\1", name).upper()
+
+
+def collect(root: str) -> list[tuple[str, str, list[str]]]:
+    result = []
+    for filename in sorted(os.listdir(root)):
+        if not filename.endswith(".hpp") or filename in SKIP_FILES:
+            continue
+        for name, slots in parse_file(os.path.join(root, filename)):
+            result.append((filename, name, slots))
+    return sorted(result, key=lambda entry: entry[1])
+
+
+def render_header(classes) -> str:
+    out = ["#pragma once", "", BANNER.rstrip("\n"), "", "#include <cstdint>", "", "namespace st {", ""]
+    for _, name, slots in classes:
+        out.append(f"struct {name}Slots {{")
+        for index, field in enumerate(slots):
+            out.append(f"    static constexpr uint32_t {constant_name(field)} = {index};")
+        out.append(f"    static constexpr uint32_t COUNT = {len(slots)};")
+        out.append("};")
+        out.append("")
+    out.append("} // namespace st")
+    return "\n".join(out) + "\n"
+
+
+def render_source(classes) -> str:
+    includes = sorted({filename for filename, _, _ in classes})
+    out = [BANNER.rstrip("\n"), ""]
+    out.extend(f'#include "{filename}"' for filename in includes)
+    out.extend(["#include <cstddef>", "#include <type_traits>", "", "namespace st {", ""])
+    for _, name, slots in classes:
+        out.append("template <>")
+        out.append(f"struct MirrorLayout<{name}> {{")
+        out.append(f"    static_assert(std::is_standard_layout<{name}>::value,")
+        out.append(f'                  "{name} must be standard layout to overlay an object body");')
+        if slots:
+            out.append(f"    static_assert(sizeof({name}) == {name}Slots::COUNT * sizeof(TaggedValue),")
+            out.append(f'                  "{name} must contain only its ST_SLOT fields");')
+        else:
+            out.append(f"    static_assert(std::is_empty<{name}>::value,")
+            out.append(f'                  "{name} has no named slots");')
+        for field in slots:
+            constant = constant_name(field)
+            out.append(f"    static_assert(offsetof({name}, {field}) ==")
+            out.append(f"                      {name}Slots::{constant} * sizeof(TaggedValue),")
+            out.append(f'                  "{name}::{field} is not at slot {name}Slots::{constant}");')
+        out.append("};")
+        out.append("")
+    out.append("} // namespace st")
+    return "\n".join(out) + "\n"
+
+
+def main() -> int:
+    args = sys.argv[1:]
+    check = "--check" in args
+    args = [a for a in args if a != "--check"]
+    if len(args) != 1:
+        print("usage: generate_mirror_slots.py [--check] <src/classes directory>", file=sys.stderr)
+        return 2
+
+    root = args[0]
+    if not os.path.isdir(root):
+        print(f"error: not a directory: {root}", file=sys.stderr)
+        return 2
+
+    classes = collect(root)
+    outputs = {
+        os.path.join(root, HEADER_NAME): render_header(classes),
+        os.path.join(root, SOURCE_NAME): render_source(classes),
+    }
+
+    stale = []
+    for path, text in outputs.items():
+        try:
+            with open(path, "r", encoding="utf-8") as f:
+                current = f.read()
+        except FileNotFoundError:
+            current = None
+        if current == text:
+            continue
+        if check:
+            stale.append(path)
+        else:
+            with open(path, "w", encoding="utf-8") as f:
+                f.write(text)
+
+    if stale:
+        print("Generated mirror slot files are out of date; run", file=sys.stderr)
+        print(f"  python3 tools/generate_mirror_slots.py {root}", file=sys.stderr)
+        for path in stale:
+            print(f"  stale: {path}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())